@@ -2,4 +2,21 @@ CREATE TABLE users(
     uin TEXT NOT NULL,
     email TEXT NOT NULL,
     md5_password BLOB NOT NULL
-);
\ No newline at end of file
+);
+
+CREATE TABLE feedbags(
+    uin TEXT PRIMARY KEY NOT NULL,
+    version INTEGER NOT NULL,
+    modified INTEGER NOT NULL,
+    num_items INTEGER NOT NULL,
+    items BLOB NOT NULL
+);
+
+CREATE TABLE directory(
+    uin TEXT PRIMARY KEY NOT NULL,
+    seq INTEGER NOT NULL,
+    info BLOB NOT NULL,
+    keywords BLOB NOT NULL
+);
+
+CREATE INDEX directory_seq ON directory(seq);
\ No newline at end of file
@@ -60,4 +60,76 @@ backend_ret_t backend_create_user(char *uin, char *email, char *password) {
     }
     
     return prv_backend->api.create_user(prv_backend, uin, email, password);
+}
+
+backend_ret_t backend_fetch_feedbag(const char *uin, feedbag_blob_t *feedbag) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.fetch_feedbag(prv_backend, uin, feedbag);
+}
+
+backend_ret_t backend_fetch_feedbag_info(const char *uin, feedbag_blob_t *feedbag) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.fetch_feedbag_info(prv_backend, uin, feedbag);
+}
+
+backend_ret_t backend_store_feedbag(const char *uin, feedbag_blob_t *feedbag) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.store_feedbag(prv_backend, uin, feedbag);
+}
+
+backend_ret_t backend_fetch_uins_with_emails(const char *const *emails, uint32_t count, char **uins) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.fetch_uins_with_emails(prv_backend, emails, count, uins);
+}
+
+backend_ret_t backend_store_dir_entry(const dir_entry_t *entry) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.store_dir_entry(prv_backend, entry);
+}
+
+backend_ret_t backend_fetch_dir_entries(uint64_t after_seq, uint32_t max_entries, dir_entry_cb_t cb, void *ctx) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.fetch_dir_entries(prv_backend, after_seq, max_entries, cb, ctx);
+}
+
+backend_ret_t backend_store_login_cookie(const uint8_t *cookie, size_t cookie_len, const char *uin, uint64_t expires_at_ms) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.store_login_cookie(prv_backend, cookie, cookie_len, uin, expires_at_ms);
+}
+
+backend_ret_t backend_take_login_cookie(const uint8_t *cookie, size_t cookie_len, uint64_t now_ms, char *uin, size_t uin_size) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.take_login_cookie(prv_backend, cookie, cookie_len, now_ms, uin, uin_size);
+}
+
+backend_ret_t backend_reserve_bart_item(const char *uin, uint32_t max_items) {
+    if (prv_backend == NULL) {
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return prv_backend->api.reserve_bart_item(prv_backend, uin, max_items);
 }
\ No newline at end of file
@@ -39,6 +39,7 @@ typedef enum {
     BACKEND_RET_BACKEND_ERROR,
     BACKEND_RET_USER_ALREADY_EXISTS,
     BACKEND_RET_EMAIL_ALREADY_EXISTS,
+    BACKEND_RET_VERSION_CONFLICT,
     BACKEND_RET_OTHER_ERROR,
 } backend_ret_t;
 
@@ -50,6 +51,15 @@ typedef struct backend_api_t {
     backend_ret_t (*fetch_user_info_with_uin)(struct backend_t *backend, char *uin, user_info_t *user_info);
     backend_ret_t (*fetch_user_info_with_email)(struct backend_t *backend, char *email, user_info_t *user_info);
     backend_ret_t (*create_user)(struct backend_t *backend, char *uin, char *email, char *password);
+    backend_ret_t (*fetch_feedbag)(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag);
+    backend_ret_t (*fetch_feedbag_info)(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag);
+    backend_ret_t (*store_feedbag)(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag);
+    backend_ret_t (*fetch_uins_with_emails)(struct backend_t *backend, const char *const *emails, uint32_t count, char **uins);
+    backend_ret_t (*store_dir_entry)(struct backend_t *backend, const dir_entry_t *entry);
+    backend_ret_t (*fetch_dir_entries)(struct backend_t *backend, uint64_t after_seq, uint32_t max_entries, dir_entry_cb_t cb, void *ctx);
+    backend_ret_t (*store_login_cookie)(struct backend_t *backend, const uint8_t *cookie, size_t cookie_len, const char *uin, uint64_t expires_at_ms);
+    backend_ret_t (*take_login_cookie)(struct backend_t *backend, const uint8_t *cookie, size_t cookie_len, uint64_t now_ms, char *uin, size_t uin_size);
+    backend_ret_t (*reserve_bart_item)(struct backend_t *backend, const char *uin, uint32_t max_items);
 } backend_api_t;
 
 /**
@@ -99,6 +109,106 @@ backend_ret_t backend_fetch_user_info_with_email(char *email, user_info_t *user_
  */
 backend_ret_t backend_create_user(char *uin, char *email, char *password);
 
+/**
+ * @brief Fetch stored feedbag of user
+ * 
+ * Items are allocated for the caller, who frees them.
+ * 
+ * @param uin Normalized screen name
+ * @param feedbag Pointer to write feedbag to
+ * @return backend_ret_t Return status (BACKEND_RET_NO_RESULT if nothing stored)
+ */
+backend_ret_t backend_fetch_feedbag(const char *uin, feedbag_blob_t *feedbag);
+
+/**
+ * @brief Fetch version, modification time and item count of stored feedbag without items
+ * 
+ * @param uin Normalized screen name
+ * @param feedbag Pointer to write feedbag info to (items left NULL)
+ * @return backend_ret_t Return status (BACKEND_RET_NO_RESULT if nothing stored)
+ */
+backend_ret_t backend_fetch_feedbag_info(const char *uin, feedbag_blob_t *feedbag);
+
+/**
+ * @brief Replace stored feedbag of user
+ * 
+ * Only succeeds if the stored version still matches feedbag->version,
+ * which is bumped on success.
+ * 
+ * @param uin Normalized screen name
+ * @param feedbag Feedbag to store
+ * @return backend_ret_t Return status (BACKEND_RET_VERSION_CONFLICT if changed since fetch)
+ */
+backend_ret_t backend_store_feedbag(const char *uin, feedbag_blob_t *feedbag);
+
+/**
+ * @brief Look up users by email address, all in one request
+ * 
+ * UINs are allocated for the caller, who frees them.
+ * 
+ * @param emails Email addresses
+ * @param count Number of email addresses
+ * @param uins Set to UIN of user with each email address (NULL if none)
+ * @return backend_ret_t Return status (BACKEND_RET_SUCCESS even if nothing matched)
+ */
+backend_ret_t backend_fetch_uins_with_emails(const char *const *emails, uint32_t count, char **uins);
+
+/**
+ * @brief Replace directory entry of user, giving it a new sequence number
+ * 
+ * @param entry Entry (sequence number is assigned by the backend)
+ * @return backend_ret_t Return status
+ */
+backend_ret_t backend_store_dir_entry(const dir_entry_t *entry);
+
+/**
+ * @brief Read directory entries stored after sequence number, in order
+ * 
+ * @param after_seq Last sequence number already seen (0 for everything)
+ * @param max_entries Most entries to read
+ * @param cb Called for every entry read
+ * @param ctx Context passed to callback
+ * @return backend_ret_t Return status
+ */
+backend_ret_t backend_fetch_dir_entries(uint64_t after_seq, uint32_t max_entries, dir_entry_cb_t cb, void *ctx);
+
+/**
+ * @brief Store login cookie minted by auth for user
+ * 
+ * @param cookie Cookie
+ * @param cookie_len Length of cookie
+ * @param uin Screen name as formatted by the backend
+ * @param expires_at_ms Unix time in milliseconds after which the cookie is refused
+ * @return backend_ret_t Return status
+ */
+backend_ret_t backend_store_login_cookie(const uint8_t *cookie, size_t cookie_len, const char *uin, uint64_t expires_at_ms);
+
+/**
+ * @brief Consume login cookie, so it can only ever be used once
+ * 
+ * Expired cookies are dropped along the way.
+ * 
+ * @param cookie Cookie presented by client
+ * @param cookie_len Length of cookie
+ * @param now_ms Current unix time in milliseconds
+ * @param uin Set to screen name cookie was minted for
+ * @param uin_size Size of uin buffer
+ * @return backend_ret_t Return status (BACKEND_RET_NO_RESULT if unknown, used or expired)
+ */
+backend_ret_t backend_take_login_cookie(const uint8_t *cookie, size_t cookie_len, uint64_t now_ms, char *uin, size_t uin_size);
+
+/**
+ * @brief Count one more BART item stored by user, unless they already stored their share
+ * 
+ * The count is kept with the account, so it is the same for every session
+ * and worker of that user.
+ * 
+ * @param uin Normalized screen name
+ * @param max_items Most items user may store
+ * @return backend_ret_t Return status (BACKEND_RET_NO_RESULT if user already stored max_items)
+ */
+backend_ret_t backend_reserve_bart_item(const char *uin, uint32_t max_items);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,6 +27,28 @@
 #define SQLITE3_BACKEND_QUERY_UIN_STATEMENT         "SELECT rowid,uin,email,md5_password FROM users WHERE uin = :uin LIMIT 1"
 #define SQLITE3_BACKEND_QUERY_EMAIL_STATEMENT       "SELECT rowid,uin,email,md5_password FROM users WHERE email = :email LIMIT 1"
 #define SQLITE3_BACKEND_INSERT_USER_STATEMENT       "INSERT INTO users (uin, email, md5_password) VALUES(:uin, :email, :md5_password)"
+#define SQLITE3_BACKEND_QUERY_EMAILS_PREFIX         "SELECT uin,email FROM users WHERE email IN ("
+
+#define SQLITE3_BACKEND_CREATE_FEEDBAGS_STATEMENT   "CREATE TABLE IF NOT EXISTS feedbags(uin TEXT PRIMARY KEY NOT NULL, version INTEGER NOT NULL, modified INTEGER NOT NULL, num_items INTEGER NOT NULL, items BLOB NOT NULL)"
+#define SQLITE3_BACKEND_QUERY_FEEDBAG_STATEMENT     "SELECT version,modified,num_items,items FROM feedbags WHERE uin = :uin LIMIT 1"
+#define SQLITE3_BACKEND_QUERY_FEEDBAG_INFO_STATEMENT "SELECT version,modified,num_items FROM feedbags WHERE uin = :uin LIMIT 1"
+#define SQLITE3_BACKEND_INSERT_FEEDBAG_STATEMENT    "INSERT INTO feedbags (uin, version, modified, num_items, items) VALUES(:uin, 1, :modified, :num_items, :items)"
+#define SQLITE3_BACKEND_UPDATE_FEEDBAG_STATEMENT    "UPDATE feedbags SET version = version + 1, modified = :modified, num_items = :num_items, items = :items WHERE uin = :uin AND version = :version"
+
+#define SQLITE3_BACKEND_CREATE_DIRECTORY_STATEMENT  "CREATE TABLE IF NOT EXISTS directory(uin TEXT PRIMARY KEY NOT NULL, seq INTEGER NOT NULL, info BLOB NOT NULL, keywords BLOB NOT NULL);" \
+                                                    "CREATE INDEX IF NOT EXISTS directory_seq ON directory(seq)"
+#define SQLITE3_BACKEND_STORE_DIR_ENTRY_STATEMENT   "INSERT OR REPLACE INTO directory (uin, seq, info, keywords) VALUES(:uin, (SELECT IFNULL(MAX(seq), 0) + 1 FROM directory), :info, :keywords)"
+#define SQLITE3_BACKEND_QUERY_DIR_ENTRIES_STATEMENT "SELECT uin,seq,info,keywords FROM directory WHERE seq > :seq ORDER BY seq LIMIT :limit"
+
+#define SQLITE3_BACKEND_CREATE_LOGIN_COOKIES_STATEMENT "CREATE TABLE IF NOT EXISTS login_cookies(cookie BLOB PRIMARY KEY NOT NULL, uin TEXT NOT NULL, expires INTEGER NOT NULL);" \
+                                                    "CREATE INDEX IF NOT EXISTS login_cookies_expires ON login_cookies(expires)"
+#define SQLITE3_BACKEND_INSERT_LOGIN_COOKIE_STATEMENT  "INSERT INTO login_cookies (cookie, uin, expires) VALUES(:cookie, :uin, :expires)"
+#define SQLITE3_BACKEND_QUERY_LOGIN_COOKIE_STATEMENT   "SELECT uin,expires FROM login_cookies WHERE cookie = :cookie LIMIT 1"
+#define SQLITE3_BACKEND_DELETE_LOGIN_COOKIE_STATEMENT  "DELETE FROM login_cookies WHERE cookie = :cookie"
+#define SQLITE3_BACKEND_EXPIRE_LOGIN_COOKIES_STATEMENT "DELETE FROM login_cookies WHERE expires <= :now"
+
+#define SQLITE3_BACKEND_CREATE_BART_UPLOADS_STATEMENT  "CREATE TABLE IF NOT EXISTS bart_uploads(uin TEXT PRIMARY KEY NOT NULL, items INTEGER NOT NULL)"
+#define SQLITE3_BACKEND_RESERVE_BART_ITEM_STATEMENT    "INSERT INTO bart_uploads (uin, items) VALUES(:uin, 1) ON CONFLICT(uin) DO UPDATE SET items = items + 1 WHERE items < :max"
 
 #define SQLITE3_BACKEND_UIN_COL_NAME    "uin"
 #define SQLITE3_BACKEND_EMAIL_COL_NAME  "email"
@@ -116,6 +138,121 @@ static bool prv_sqlite3_backend_user_exists_with_email(struct backend_t *backend
  */
 static backend_ret_t prv_sqlite_backend_create_user(struct backend_t *backend, char *uin, char *email, char *password);
 
+/**
+ * @brief Fetch stored feedbag of user
+ * 
+ * @param backend Pointer to backend instance
+ * @param uin Normalized screen name
+ * @param feedbag Pointer to write feedbag to
+ * @return backend_ret_t Status of query
+ */
+static backend_ret_t prv_sqlite3_backend_fetch_feedbag(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag);
+
+/**
+ * @brief Fetch stored feedbag info of user without items
+ * 
+ * @param backend Pointer to backend instance
+ * @param uin Normalized screen name
+ * @param feedbag Pointer to write feedbag info to
+ * @return backend_ret_t Status of query
+ */
+static backend_ret_t prv_sqlite3_backend_fetch_feedbag_info(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag);
+
+/**
+ * @brief Replace stored feedbag of user if version still matches
+ * 
+ * @param backend Pointer to backend instance
+ * @param uin Normalized screen name
+ * @param feedbag Feedbag to store
+ * @return backend_ret_t Status of request
+ */
+static backend_ret_t prv_sqlite3_backend_store_feedbag(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag);
+
+/**
+ * @brief Look up users by email address with a single query
+ * 
+ * @param backend Pointer to backend instance
+ * @param emails Email addresses
+ * @param count Number of email addresses
+ * @param uins Set to UIN of user with each email address (NULL if none)
+ * @return backend_ret_t Status of query
+ */
+static backend_ret_t prv_sqlite3_backend_fetch_uins_with_emails(struct backend_t *backend, const char *const *emails, uint32_t count, char **uins);
+
+/**
+ * @brief Replace directory entry of user
+ * 
+ * @param backend Pointer to backend instance
+ * @param entry Entry to store
+ * @return backend_ret_t Status of request
+ */
+static backend_ret_t prv_sqlite3_backend_store_dir_entry(struct backend_t *backend, const dir_entry_t *entry);
+
+/**
+ * @brief Read directory entries stored after sequence number
+ * 
+ * @param backend Pointer to backend instance
+ * @param after_seq Last sequence number already seen
+ * @param max_entries Most entries to read
+ * @param cb Called for every entry read
+ * @param ctx Context passed to callback
+ * @return backend_ret_t Status of query
+ */
+static backend_ret_t prv_sqlite3_backend_fetch_dir_entries(struct backend_t *backend, uint64_t after_seq, uint32_t max_entries, dir_entry_cb_t cb, void *ctx);
+
+/**
+ * @brief Store login cookie minted for user
+ * 
+ * @param backend Pointer to backend instance
+ * @param cookie Cookie
+ * @param cookie_len Length of cookie
+ * @param uin Screen name cookie is bound to
+ * @param expires_at_ms Unix time in milliseconds cookie expires at
+ * @return backend_ret_t Status of request
+ */
+static backend_ret_t prv_sqlite3_backend_store_login_cookie(struct backend_t *backend, const uint8_t *cookie, size_t cookie_len, const char *uin, uint64_t expires_at_ms);
+
+/**
+ * @brief Consume login cookie and drop expired ones
+ * 
+ * The row is read, then deleted. Only the connection whose delete removed
+ * it gets the screen name, so a cookie can't be used twice even by
+ * workers racing on the same database.
+ * 
+ * @param backend Pointer to backend instance
+ * @param cookie Cookie
+ * @param cookie_len Length of cookie
+ * @param now_ms Current unix time in milliseconds
+ * @param uin Set to screen name cookie is bound to
+ * @param uin_size Size of uin buffer
+ * @return backend_ret_t Status of request
+ */
+static backend_ret_t prv_sqlite3_backend_take_login_cookie(struct backend_t *backend, const uint8_t *cookie, size_t cookie_len, uint64_t now_ms, char *uin, size_t uin_size);
+
+/**
+ * @brief Count one more BART item stored by user
+ * 
+ * Checking and bumping the count is one upsert, so workers racing on the
+ * same user can't both take the last item.
+ * 
+ * @param backend Pointer to backend instance
+ * @param uin Normalized screen name
+ * @param max_items Most items user may store
+ * @return backend_ret_t Status of request
+ */
+static backend_ret_t prv_sqlite3_backend_reserve_bart_item(struct backend_t *backend, const char *uin, uint32_t max_items);
+
+/**
+ * @brief Run statement that only binds a single integer
+ * 
+ * @param inst Instance
+ * @param statement SQL statement
+ * @param name Parameter name
+ * @param val Parameter value
+ * @return int Result of sqlite3_step (or prepare error)
+ */
+static int prv_sqlite3_backend_exec_int64(sqlite3_backend_t *inst, const char *statement, const char *name, int64_t val);
+
 /**
  * @brief SQLite3 callback for fetching user info
  * 
@@ -135,6 +272,15 @@ static void prv_sqlite3_backend_connect_api(sqlite3_backend_t *inst) {
     inst->base.api.fetch_user_info_with_uin = prv_sqlite3_backend_fetch_user_info_with_uin;
     inst->base.api.fetch_user_info_with_email = prv_sqlite3_backend_fetch_user_info_with_email;
     inst->base.api.create_user = prv_sqlite_backend_create_user;
+    inst->base.api.fetch_feedbag = prv_sqlite3_backend_fetch_feedbag;
+    inst->base.api.fetch_feedbag_info = prv_sqlite3_backend_fetch_feedbag_info;
+    inst->base.api.store_feedbag = prv_sqlite3_backend_store_feedbag;
+    inst->base.api.fetch_uins_with_emails = prv_sqlite3_backend_fetch_uins_with_emails;
+    inst->base.api.store_dir_entry = prv_sqlite3_backend_store_dir_entry;
+    inst->base.api.fetch_dir_entries = prv_sqlite3_backend_fetch_dir_entries;
+    inst->base.api.store_login_cookie = prv_sqlite3_backend_store_login_cookie;
+    inst->base.api.take_login_cookie = prv_sqlite3_backend_take_login_cookie;
+    inst->base.api.reserve_bart_item = prv_sqlite3_backend_reserve_bart_item;
 }
 
 static backend_ret_t prv_sqlite3_backend_fetch_user_info_with_uin(struct backend_t *backend, char *uin, user_info_t *user_info) {
@@ -366,6 +512,484 @@ static backend_ret_t prv_sqlite_backend_create_user(struct backend_t *backend, c
     return BACKEND_RET_SUCCESS;
 }
 
+static backend_ret_t prv_sqlite3_backend_fetch_feedbag(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag) {
+    if (
+        backend == NULL || 
+        uin == NULL || 
+        feedbag == NULL
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_QUERY_FEEDBAG_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare feedbag query: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":uin"), uin, -1, NULL);
+    
+    int step_ret = sqlite3_step(stmt);
+    
+    if (step_ret == SQLITE_DONE) {
+        sqlite3_finalize(stmt);
+        return BACKEND_RET_NO_RESULT;
+    }
+    
+    if (step_ret != SQLITE_ROW) {
+        LOG_ERR("SQLite Backend Feedbag Fetch Error: %d", step_ret);
+        sqlite3_finalize(stmt);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    const uint8_t *items = sqlite3_column_blob(stmt, 3);
+    int items_len = sqlite3_column_bytes(stmt, 3);
+    
+    memset(feedbag, 0, sizeof(feedbag_blob_t));
+    feedbag->version = sqlite3_column_int64(stmt, 0);
+    feedbag->modified = sqlite3_column_int64(stmt, 1);
+    feedbag->num_items = sqlite3_column_int(stmt, 2);
+    
+    if (items_len > 0) {
+        feedbag->items = malloc(items_len);
+        
+        if (feedbag->items == NULL) {
+            sqlite3_finalize(stmt);
+            return BACKEND_RET_OTHER_ERROR;
+        }
+        
+        memcpy(feedbag->items, items, items_len);
+        feedbag->items_len = items_len;
+    }
+    
+    sqlite3_finalize(stmt);
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static backend_ret_t prv_sqlite3_backend_fetch_feedbag_info(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag) {
+    if (
+        backend == NULL || 
+        uin == NULL || 
+        feedbag == NULL
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_QUERY_FEEDBAG_INFO_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare feedbag info query: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":uin"), uin, -1, NULL);
+    
+    int step_ret = sqlite3_step(stmt);
+    
+    if (step_ret == SQLITE_DONE) {
+        sqlite3_finalize(stmt);
+        return BACKEND_RET_NO_RESULT;
+    }
+    
+    if (step_ret != SQLITE_ROW) {
+        LOG_ERR("SQLite Backend Feedbag Info Fetch Error: %d", step_ret);
+        sqlite3_finalize(stmt);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    memset(feedbag, 0, sizeof(feedbag_blob_t));
+    feedbag->version = sqlite3_column_int64(stmt, 0);
+    feedbag->modified = sqlite3_column_int64(stmt, 1);
+    feedbag->num_items = sqlite3_column_int(stmt, 2);
+    
+    sqlite3_finalize(stmt);
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static backend_ret_t prv_sqlite3_backend_store_feedbag(struct backend_t *backend, const char *uin, feedbag_blob_t *feedbag) {
+    if (
+        backend == NULL || 
+        uin == NULL || 
+        feedbag == NULL
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    // Nothing stored yet is an insert, which fails if someone else stored first
+    const char *statement = (feedbag->version == 0) ? SQLITE3_BACKEND_INSERT_FEEDBAG_STATEMENT : SQLITE3_BACKEND_UPDATE_FEEDBAG_STATEMENT;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, statement, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare feedbag store: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":uin"), uin, -1, NULL);
+    sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":modified"), feedbag->modified);
+    sqlite3_bind_int(stmt, sqlite3_bind_parameter_index(stmt, ":num_items"), feedbag->num_items);
+    sqlite3_bind_blob(stmt, sqlite3_bind_parameter_index(stmt, ":items"), feedbag->items != NULL ? (const void *)feedbag->items : (const void *)"", feedbag->items_len, NULL);
+    
+    if (feedbag->version != 0) {
+        sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":version"), feedbag->version);
+    }
+    
+    int ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (ret == SQLITE_CONSTRAINT || (ret == SQLITE_DONE && sqlite3_changes(inst->db) == 0)) {
+        return BACKEND_RET_VERSION_CONFLICT;
+    }
+    
+    if (ret != SQLITE_DONE) {
+        LOG_ERR("Failed to store feedbag. (%d)", ret);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    feedbag->version++;
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static backend_ret_t prv_sqlite3_backend_fetch_uins_with_emails(struct backend_t *backend, const char *const *emails, uint32_t count, char **uins) {
+    if (
+        backend == NULL ||
+        emails == NULL ||
+        uins == NULL ||
+        count == 0
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    // One placeholder per address, the whole batch is a single query
+    char query[SQLITE3_MAX_QUERY_SIZE];
+    size_t query_len = strlen(SQLITE3_BACKEND_QUERY_EMAILS_PREFIX);
+    
+    if (query_len + count * 2 + 1 > sizeof(query)) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    memcpy(query, SQLITE3_BACKEND_QUERY_EMAILS_PREFIX, query_len);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        if (i > 0) {
+            query[query_len++] = ',';
+        }
+        
+        query[query_len++] = '?';
+    }
+    
+    query[query_len++] = ')';
+    query[query_len] = '\0';
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare email lookup: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        sqlite3_bind_text(stmt, i + 1, emails[i], -1, NULL);
+        uins[i] = NULL;
+    }
+    
+    int step_ret;
+    
+    while ((step_ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char *uin = (const char *)sqlite3_column_text(stmt, 0);
+        const char *email = (const char *)sqlite3_column_text(stmt, 1);
+        
+        if (uin == NULL || email == NULL) {
+            continue;
+        }
+        
+        // The same address may have been asked for more than once
+        for (uint32_t i = 0; i < count; i++) {
+            if (uins[i] != NULL || strcmp(emails[i], email) != 0) {
+                continue;
+            }
+            
+            uins[i] = strdup(uin);
+            
+            if (uins[i] == NULL) {
+                step_ret = SQLITE_NOMEM;
+                break;
+            }
+        }
+        
+        if (step_ret != SQLITE_ROW) {
+            break;
+        }
+    }
+    
+    sqlite3_finalize(stmt);
+    
+    if (step_ret != SQLITE_DONE) {
+        LOG_ERR("SQLite Backend Email Lookup Error: %d", step_ret);
+        
+        for (uint32_t i = 0; i < count; i++) {
+            free(uins[i]);
+            uins[i] = NULL;
+        }
+        
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static backend_ret_t prv_sqlite3_backend_store_dir_entry(struct backend_t *backend, const dir_entry_t *entry) {
+    if (
+        backend == NULL ||
+        entry == NULL ||
+        entry->uin == NULL
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_STORE_DIR_ENTRY_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare directory store: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":uin"), entry->uin, -1, NULL);
+    sqlite3_bind_blob(stmt, sqlite3_bind_parameter_index(stmt, ":info"), entry->info != NULL ? (const void *)entry->info : (const void *)"", entry->info_len, NULL);
+    sqlite3_bind_blob(stmt, sqlite3_bind_parameter_index(stmt, ":keywords"), entry->keywords != NULL ? (const void *)entry->keywords : (const void *)"", entry->keywords_len, NULL);
+    
+    int ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (ret != SQLITE_DONE) {
+        LOG_ERR("Failed to store directory entry. (%d)", ret);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static backend_ret_t prv_sqlite3_backend_fetch_dir_entries(struct backend_t *backend, uint64_t after_seq, uint32_t max_entries, dir_entry_cb_t cb, void *ctx) {
+    if (
+        backend == NULL ||
+        cb == NULL
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_QUERY_DIR_ENTRIES_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare directory query: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":seq"), after_seq);
+    sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":limit"), max_entries);
+    
+    int step_ret;
+    
+    while ((step_ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+        dir_entry_t entry = {
+            .uin = (const char *)sqlite3_column_text(stmt, 0),
+            .seq = sqlite3_column_int64(stmt, 1),
+            .info = sqlite3_column_blob(stmt, 2),
+            .info_len = sqlite3_column_bytes(stmt, 2),
+            .keywords = sqlite3_column_blob(stmt, 3),
+            .keywords_len = sqlite3_column_bytes(stmt, 3),
+        };
+        
+        if (entry.uin == NULL) {
+            continue;
+        }
+        
+        cb(ctx, &entry);
+    }
+    
+    sqlite3_finalize(stmt);
+    
+    if (step_ret != SQLITE_DONE) {
+        LOG_ERR("SQLite Backend Directory Fetch Error: %d", step_ret);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static backend_ret_t prv_sqlite3_backend_store_login_cookie(struct backend_t *backend, const uint8_t *cookie, size_t cookie_len, const char *uin, uint64_t expires_at_ms) {
+    if (
+        backend == NULL ||
+        cookie == NULL ||
+        cookie_len == 0 ||
+        uin == NULL
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_INSERT_LOGIN_COOKIE_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare login cookie store: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_blob(stmt, sqlite3_bind_parameter_index(stmt, ":cookie"), cookie, cookie_len, NULL);
+    sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":uin"), uin, -1, NULL);
+    sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":expires"), expires_at_ms);
+    
+    int ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (ret != SQLITE_DONE) {
+        LOG_ERR("Failed to store login cookie. (%d)", ret);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static backend_ret_t prv_sqlite3_backend_take_login_cookie(struct backend_t *backend, const uint8_t *cookie, size_t cookie_len, uint64_t now_ms, char *uin, size_t uin_size) {
+    if (
+        backend == NULL ||
+        cookie == NULL ||
+        cookie_len == 0 ||
+        uin == NULL ||
+        uin_size == 0
+    ) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_QUERY_LOGIN_COOKIE_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare login cookie query: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_blob(stmt, sqlite3_bind_parameter_index(stmt, ":cookie"), cookie, cookie_len, NULL);
+    
+    backend_ret_t ret = BACKEND_RET_NO_RESULT;
+    int step_ret = sqlite3_step(stmt);
+    
+    if (step_ret == SQLITE_ROW) {
+        const char *row_uin = (const char *)sqlite3_column_text(stmt, 0);
+        uint64_t expires = sqlite3_column_int64(stmt, 1);
+        
+        if (row_uin != NULL && expires > now_ms && strlen(row_uin) < uin_size) {
+            strcpy(uin, row_uin);
+            ret = BACKEND_RET_SUCCESS;
+        }
+    } else if (step_ret != SQLITE_DONE) {
+        ret = BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_finalize(stmt);
+    
+    if (step_ret != SQLITE_ROW) {
+        return ret;
+    }
+    
+    // Whoever deletes the row owns the cookie, a second signon finds nothing to delete
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_DELETE_LOGIN_COOKIE_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare login cookie delete: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_blob(stmt, sqlite3_bind_parameter_index(stmt, ":cookie"), cookie, cookie_len, NULL);
+    
+    step_ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (step_ret != SQLITE_DONE) {
+        LOG_ERR("Failed to delete login cookie. (%d)", step_ret);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    if (sqlite3_changes(inst->db) != 1) {
+        return BACKEND_RET_NO_RESULT;
+    }
+    
+    if (prv_sqlite3_backend_exec_int64(inst, SQLITE3_BACKEND_EXPIRE_LOGIN_COOKIES_STATEMENT, ":now", now_ms) != SQLITE_DONE) {
+        LOG_WARN("Failed to drop expired login cookies.");
+    }
+    
+    return ret;
+}
+
+static backend_ret_t prv_sqlite3_backend_reserve_bart_item(struct backend_t *backend, const char *uin, uint32_t max_items) {
+    if (backend == NULL || uin == NULL) {
+        return BACKEND_RET_BAD_ARGS;
+    }
+    
+    if (max_items == 0) {
+        return BACKEND_RET_NO_RESULT;
+    }
+    
+    sqlite3_backend_t *inst = (sqlite3_backend_t *)backend;
+    
+    sqlite3_stmt * stmt = NULL;
+    
+    if (sqlite3_prepare_v2(inst->db, SQLITE3_BACKEND_RESERVE_BART_ITEM_STATEMENT, -1, &stmt, NULL) != SQLITE_OK) {
+        LOG_ERR("Failed to prepare BART item reservation: %s", sqlite3_errmsg(inst->db));
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":uin"), uin, -1, NULL);
+    sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":max"), max_items);
+    
+    int ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (ret != SQLITE_DONE) {
+        LOG_ERR("Failed to reserve BART item. (%d)", ret);
+        return BACKEND_RET_BACKEND_ERROR;
+    }
+    
+    // Update is skipped once the count reaches max, leaving nothing changed
+    if (sqlite3_changes(inst->db) != 1) {
+        return BACKEND_RET_NO_RESULT;
+    }
+    
+    return BACKEND_RET_SUCCESS;
+}
+
+static int prv_sqlite3_backend_exec_int64(sqlite3_backend_t *inst, const char *statement, const char *name, int64_t val) {
+    sqlite3_stmt * stmt = NULL;
+    
+    int ret = sqlite3_prepare_v2(inst->db, statement, -1, &stmt, NULL);
+    
+    if (ret != SQLITE_OK) {
+        return ret;
+    }
+    
+    sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, name), val);
+    
+    ret = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    return ret;
+}
+
 /*****************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -383,6 +1007,37 @@ bool sqlite3_backend_init(sqlite3_backend_t *inst, char *db_path) {
         return false;
     }
     
+    // Databases created before feedbags were stored don't have the table yet
+    char *err = NULL;
+    
+    if (sqlite3_exec(inst->db, SQLITE3_BACKEND_CREATE_FEEDBAGS_STATEMENT, NULL, NULL, &err) != SQLITE_OK) {
+        LOG_ERR("Failed to create feedbags table: %s", err);
+        sqlite3_free(err);
+        sqlite3_close(inst->db);
+        return false;
+    }
+    
+    if (sqlite3_exec(inst->db, SQLITE3_BACKEND_CREATE_DIRECTORY_STATEMENT, NULL, NULL, &err) != SQLITE_OK) {
+        LOG_ERR("Failed to create directory table: %s", err);
+        sqlite3_free(err);
+        sqlite3_close(inst->db);
+        return false;
+    }
+    
+    if (sqlite3_exec(inst->db, SQLITE3_BACKEND_CREATE_LOGIN_COOKIES_STATEMENT, NULL, NULL, &err) != SQLITE_OK) {
+        LOG_ERR("Failed to create login cookies table: %s", err);
+        sqlite3_free(err);
+        sqlite3_close(inst->db);
+        return false;
+    }
+    
+    if (sqlite3_exec(inst->db, SQLITE3_BACKEND_CREATE_BART_UPLOADS_STATEMENT, NULL, NULL, &err) != SQLITE_OK) {
+        LOG_ERR("Failed to create BART uploads table: %s", err);
+        sqlite3_free(err);
+        sqlite3_close(inst->db);
+        return false;
+    }
+    
     prv_sqlite3_backend_connect_api(inst);
     
     return true;
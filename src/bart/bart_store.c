@@ -0,0 +1,472 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file bart_store.c
+ * @author Evan Stoddard
+ * @brief Content addressed store for buddy icons and other BART items
+ */
+
+#include "bart_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "md5.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define BART_STORE_RECORD_MAGIC     0x42525431U // "BRT1"
+
+#define BART_STORE_INITIAL_BUCKETS  64U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief On disk record header, followed by the item
+ * 
+ * Host byte order, the pack file never leaves the machine that wrote it.
+ */
+typedef struct bart_record_header_t {
+    uint32_t magic;
+    uint32_t len;
+    uint8_t hash[BART_HASH_LEN];
+} bart_record_header_t;
+
+/**
+ * @brief Stored item
+ * 
+ * Mapped items are kept on an LRU list, most recently served first.
+ */
+typedef struct bart_item_t {
+    uint8_t hash[BART_HASH_LEN];
+    off_t offset;
+    uint32_t len;
+    
+    struct bart_item_t *next_in_bucket;
+    
+    void *map;
+    size_t map_len;
+    struct bart_item_t *lru_prev;
+    struct bart_item_t *lru_next;
+} bart_item_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private static instance of BART store
+ * 
+ */
+static struct {
+    int fd;
+    off_t scanned;
+    size_t page_size;
+    
+    uint32_t max_mapped;
+    
+    bart_item_t **buckets;
+    uint32_t num_buckets;
+    uint32_t num_items;
+    
+    bart_item_t *lru_head;
+    bart_item_t *lru_tail;
+    uint32_t num_mapped;
+} prv_inst = { .fd = -1 };
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Bucket hash of item hash
+ * 
+ * @param hash MD5 of item (already uniform, so its first word is used as is)
+ * @return uint32_t Bucket hash
+ */
+static uint32_t prv_bart_store_bucket_hash(const uint8_t hash[BART_HASH_LEN]);
+
+/**
+ * @brief Find indexed item
+ * 
+ * @param hash MD5 of item
+ * @return bart_item_t* Item (NULL if not indexed)
+ */
+static bart_item_t *prv_bart_store_find(const uint8_t hash[BART_HASH_LEN]);
+
+/**
+ * @brief Index item at offset (no-op if already indexed)
+ * 
+ * @param header Record header
+ * @param offset Offset of item in pack file
+ * @return true Item indexed
+ * @return false Out of memory
+ */
+static bool prv_bart_store_index(const bart_record_header_t *header, off_t offset);
+
+/**
+ * @brief Index records appended since the last scan
+ * 
+ * Stops at a record still being written by another worker, the next scan
+ * picks up from there.
+ * 
+ * @return off_t Size of pack file (-1 if unable to stat)
+ */
+static off_t prv_bart_store_scan(void);
+
+/**
+ * @brief Unlink item from LRU list
+ * 
+ * @param item Item
+ */
+static void prv_bart_store_lru_unlink(bart_item_t *item);
+
+/**
+ * @brief Link item at head of LRU list
+ * 
+ * @param item Item
+ */
+static void prv_bart_store_lru_push(bart_item_t *item);
+
+/**
+ * @brief Map item, unmapping the least recently served one if at the limit
+ * 
+ * @param item Item
+ * @return true Item mapped
+ * @return false Unable to map item
+ */
+static bool prv_bart_store_map(bart_item_t *item);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static uint32_t prv_bart_store_bucket_hash(const uint8_t hash[BART_HASH_LEN]) {
+    uint32_t word;
+    memcpy(&word, hash, sizeof(word));
+    
+    return word;
+}
+
+static bart_item_t *prv_bart_store_find(const uint8_t hash[BART_HASH_LEN]) {
+    if (prv_inst.num_buckets == 0) {
+        return NULL;
+    }
+    
+    bart_item_t *item = prv_inst.buckets[prv_bart_store_bucket_hash(hash) & (prv_inst.num_buckets - 1)];
+    
+    for (; item != NULL; item = item->next_in_bucket) {
+        if (memcmp(item->hash, hash, BART_HASH_LEN) == 0) {
+            return item;
+        }
+    }
+    
+    return NULL;
+}
+
+static bool prv_bart_store_index(const bart_record_header_t *header, off_t offset) {
+    if (prv_bart_store_find(header->hash) != NULL) {
+        return true;
+    }
+    
+    // Grow table once it holds as many items as buckets
+    if (prv_inst.num_items >= prv_inst.num_buckets) {
+        uint32_t new_count = prv_inst.num_buckets * 2;
+        
+        if (new_count == 0) {
+            new_count = BART_STORE_INITIAL_BUCKETS;
+        }
+        
+        bart_item_t **buckets = calloc(new_count, sizeof(bart_item_t *));
+        
+        if (buckets == NULL && prv_inst.num_buckets == 0) {
+            return false;
+        }
+        
+        if (buckets != NULL) {
+            for (uint32_t i = 0; i < prv_inst.num_buckets; i++) {
+                bart_item_t *item = prv_inst.buckets[i];
+                
+                while (item != NULL) {
+                    bart_item_t *next = item->next_in_bucket;
+                    bart_item_t **bucket = &buckets[prv_bart_store_bucket_hash(item->hash) & (new_count - 1)];
+                    
+                    item->next_in_bucket = *bucket;
+                    *bucket = item;
+                    item = next;
+                }
+            }
+            
+            free(prv_inst.buckets);
+            prv_inst.buckets = buckets;
+            prv_inst.num_buckets = new_count;
+        }
+    }
+    
+    bart_item_t *item = calloc(1, sizeof(bart_item_t));
+    
+    if (item == NULL) {
+        return false;
+    }
+    
+    memcpy(item->hash, header->hash, BART_HASH_LEN);
+    item->offset = offset;
+    item->len = header->len;
+    
+    bart_item_t **bucket = &prv_inst.buckets[prv_bart_store_bucket_hash(item->hash) & (prv_inst.num_buckets - 1)];
+    item->next_in_bucket = *bucket;
+    *bucket = item;
+    prv_inst.num_items++;
+    
+    return true;
+}
+
+static off_t prv_bart_store_scan(void) {
+    struct stat st;
+    
+    if (fstat(prv_inst.fd, &st) < 0) {
+        return -1;
+    }
+    
+    while (prv_inst.scanned + (off_t)sizeof(bart_record_header_t) <= st.st_size) {
+        bart_record_header_t header;
+        
+        if (pread(prv_inst.fd, &header, sizeof(header), prv_inst.scanned) != sizeof(header)) {
+            break;
+        }
+        
+        if (header.magic != BART_STORE_RECORD_MAGIC || header.len == 0 || header.len > BART_MAX_DATA_LEN) {
+            LOG_ERR("Corrupt BART record at %lld.", (long long)prv_inst.scanned);
+            break;
+        }
+        
+        off_t offset = prv_inst.scanned + sizeof(header);
+        
+        if (offset + header.len > st.st_size) {
+            break;
+        }
+        
+        if (!prv_bart_store_index(&header, offset)) {
+            LOG_ERR("Unable to index BART item. Out of memory?");
+            break;
+        }
+        
+        prv_inst.scanned = offset + header.len;
+    }
+    
+    return st.st_size;
+}
+
+static void prv_bart_store_lru_unlink(bart_item_t *item) {
+    if (item->lru_prev != NULL) {
+        item->lru_prev->lru_next = item->lru_next;
+    } else {
+        prv_inst.lru_head = item->lru_next;
+    }
+    
+    if (item->lru_next != NULL) {
+        item->lru_next->lru_prev = item->lru_prev;
+    } else {
+        prv_inst.lru_tail = item->lru_prev;
+    }
+    
+    item->lru_prev = NULL;
+    item->lru_next = NULL;
+}
+
+static void prv_bart_store_lru_push(bart_item_t *item) {
+    item->lru_prev = NULL;
+    item->lru_next = prv_inst.lru_head;
+    
+    if (prv_inst.lru_head != NULL) {
+        prv_inst.lru_head->lru_prev = item;
+    } else {
+        prv_inst.lru_tail = item;
+    }
+    
+    prv_inst.lru_head = item;
+}
+
+static bool prv_bart_store_map(bart_item_t *item) {
+    if (prv_inst.num_mapped >= prv_inst.max_mapped && prv_inst.lru_tail != NULL) {
+        bart_item_t *victim = prv_inst.lru_tail;
+        
+        prv_bart_store_lru_unlink(victim);
+        munmap(victim->map, victim->map_len);
+        victim->map = NULL;
+        victim->map_len = 0;
+        prv_inst.num_mapped--;
+    }
+    
+    // Mappings have to start on a page boundary
+    off_t map_offset = item->offset & ~(off_t)(prv_inst.page_size - 1);
+    size_t map_len = (item->offset - map_offset) + item->len;
+    
+    void *map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, prv_inst.fd, map_offset);
+    
+    if (map == MAP_FAILED) {
+        LOG_ERR("Unable to map BART item: %s", strerror(errno));
+        return false;
+    }
+    
+    item->map = map;
+    item->map_len = map_len;
+    prv_bart_store_lru_push(item);
+    prv_inst.num_mapped++;
+    
+    return true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+bool bart_store_init(const config_t *config) {
+    int fd = open(config->bart_store_path, O_RDWR | O_CREAT | O_APPEND, 0600);
+    
+    if (fd < 0) {
+        LOG_ERR("Unable to open BART store %s: %s", config->bart_store_path, strerror(errno));
+        return false;
+    }
+    
+    prv_inst.fd = fd;
+    prv_inst.scanned = 0;
+    prv_inst.page_size = sysconf(_SC_PAGESIZE);
+    prv_inst.max_mapped = config->bart_max_mapped_items;
+    
+    // Workers append under the lock, so a partial record here is from a crash
+    flock(fd, LOCK_EX);
+    
+    off_t size = prv_bart_store_scan();
+    
+    if (size > prv_inst.scanned) {
+        LOG_WARN("Truncating torn BART record at %lld.", (long long)prv_inst.scanned);
+        
+        if (ftruncate(fd, prv_inst.scanned) < 0) {
+            LOG_ERR("Unable to truncate BART store: %s", strerror(errno));
+        }
+    }
+    
+    flock(fd, LOCK_UN);
+    
+    LOG_INFO("BART store holds %u items.", prv_inst.num_items);
+    
+    return true;
+}
+
+void bart_store_hash(const uint8_t *data, size_t len, uint8_t hash[BART_HASH_LEN]) {
+    MD5Context md5_ctx;
+    md5Init(&md5_ctx);
+    md5Update(&md5_ctx, (uint8_t *)data, len);
+    md5Finalize(&md5_ctx);
+    
+    memcpy(hash, md5_ctx.digest, BART_HASH_LEN);
+}
+
+bool bart_store_contains(const uint8_t hash[BART_HASH_LEN]) {
+    return (prv_inst.fd >= 0 && hash != NULL && prv_bart_store_find(hash) != NULL);
+}
+
+bool bart_store_put(const uint8_t *data, size_t len, const uint8_t hash[BART_HASH_LEN]) {
+    if (prv_inst.fd < 0 || data == NULL || hash == NULL || len == 0 || len > BART_MAX_DATA_LEN) {
+        return false;
+    }
+    
+    if (prv_bart_store_find(hash) != NULL) {
+        return true;
+    }
+    
+    flock(prv_inst.fd, LOCK_EX);
+    
+    // Another worker may have stored it since our last scan
+    off_t size = prv_bart_store_scan();
+    
+    if (prv_bart_store_find(hash) != NULL) {
+        flock(prv_inst.fd, LOCK_UN);
+        return true;
+    }
+    
+    if (size < 0) {
+        flock(prv_inst.fd, LOCK_UN);
+        return false;
+    }
+    
+    bart_record_header_t header = {
+        .magic = BART_STORE_RECORD_MAGIC,
+        .len = len,
+    };
+    
+    memcpy(header.hash, hash, BART_HASH_LEN);
+    
+    struct iovec iov[] = {
+        { .iov_base = &header, .iov_len = sizeof(header) },
+        { .iov_base = (void *)data, .iov_len = len },
+    };
+    
+    ssize_t written = writev(prv_inst.fd, iov, 2);
+    bool ret = (written == (ssize_t)(sizeof(header) + len));
+    
+    if (!ret) {
+        LOG_ERR("Unable to write BART record: %s", strerror(errno));
+        
+        // Cut off partial record so the pack stays parseable
+        if (written > 0 && ftruncate(prv_inst.fd, size) < 0) {
+            LOG_ERR("Unable to truncate BART store: %s", strerror(errno));
+        }
+    } else {
+        // Scan is caught up to the end (unless a bad record stopped it)
+        if (prv_inst.scanned == size) {
+            prv_inst.scanned = size + sizeof(header) + len;
+        }
+        
+        ret = prv_bart_store_index(&header, size + sizeof(header));
+    }
+    
+    flock(prv_inst.fd, LOCK_UN);
+    
+    return ret;
+}
+
+bool bart_store_get(const uint8_t hash[BART_HASH_LEN], struct iovec *iov) {
+    if (prv_inst.fd < 0 || hash == NULL || iov == NULL) {
+        return false;
+    }
+    
+    bart_item_t *item = prv_bart_store_find(hash);
+    
+    // Might have been uploaded through another worker
+    if (item == NULL) {
+        prv_bart_store_scan();
+        item = prv_bart_store_find(hash);
+    }
+    
+    if (item == NULL) {
+        return false;
+    }
+    
+    if (item->map != NULL) {
+        prv_bart_store_lru_unlink(item);
+        prv_bart_store_lru_push(item);
+    } else if (!prv_bart_store_map(item)) {
+        return false;
+    }
+    
+    iov->iov_base = (uint8_t *)item->map + (item->offset & (prv_inst.page_size - 1));
+    iov->iov_len = item->len;
+    
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file bart_store.h
+ * @author Evan Stoddard
+ * @brief Content addressed store for buddy icons and other BART items
+ */
+
+#ifndef BART_STORE_H_
+#define BART_STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "config/config.h"
+#include "oscar/bart_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Open pack file, indexing the items already in it
+ * 
+ * Items are appended to one pack file shared by all BOS workers, keyed by
+ * the MD5 of their contents. Only their location is kept in memory.
+ * 
+ * @param config Configuration
+ * @return true Store opened
+ * @return false Unable to open store
+ */
+bool bart_store_init(const config_t *config);
+
+/**
+ * @brief Hash item contents the way the store keys them
+ * 
+ * @param data Contents
+ * @param len Length of contents
+ * @param hash Set to MD5 of contents
+ */
+void bart_store_hash(const uint8_t *data, size_t len, uint8_t hash[BART_HASH_LEN]);
+
+/**
+ * @brief Check whether item is already stored
+ * 
+ * Only what this worker has indexed so far is checked, an item another
+ * worker just appended may not be found.
+ * 
+ * @param hash MD5 of contents
+ * @return true Item stored
+ * @return false Item not indexed
+ */
+bool bart_store_contains(const uint8_t hash[BART_HASH_LEN]);
+
+/**
+ * @brief Store item unless an identical one is already stored
+ * 
+ * @param data Contents
+ * @param len Length of contents
+ * @param hash MD5 of contents, from bart_store_hash
+ * @return true Item stored
+ * @return false Store unavailable or write failed
+ */
+bool bart_store_put(const uint8_t *data, size_t len, const uint8_t hash[BART_HASH_LEN]);
+
+/**
+ * @brief Find item, mapping it into memory if needed
+ * 
+ * Recently served items stay mapped. The iovec points into the mapping,
+ * so it is only valid until the next call into the store.
+ * 
+ * @param hash MD5 of contents
+ * @param iov Set to contents
+ * @return true Item found
+ * @return false No such item or unable to map it
+ */
+bool bart_store_get(const uint8_t hash[BART_HASH_LEN], struct iovec *iov);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BART_STORE_H_ */
\ No newline at end of file
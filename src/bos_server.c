@@ -12,14 +12,28 @@
 
 #include "oscar/flap.h"
 #include "oscar/frame.h"
+#include "oscar/tlv.h"
 
 #include "oscar/flap_decoder.h"
 #include "oscar/snac_decoder.h"
+#include "oscar/tlv_decoder.h"
 
 #include "oscar/flap_encoder.h"
 #include "oscar/snac_encoder.h"
 
 #include "model/client.h"
+#include "model/screenname.h"
+
+#include "session.h"
+#include "session_manager.h"
+
+#include "presence/presence.h"
+
+#include "offline/offline_store.h"
+
+#include "typing/typing_lane.h"
+
+#include "directory/dir_index.h"
 
 #include "handlers/oservice.h"
 #include "handlers/bucp.h"
@@ -27,6 +41,13 @@
 #include "handlers/feedbag.h"
 #include "handlers/icbm.h"
 #include "handlers/buddy_handler.h"
+#include "handlers/odir.h"
+#include "handlers/bart.h"
+
+#include "utils/random.h"
+#include "utils/timestamp.h"
+
+#include "backends/backend.h"
 
 #include <stddef.h>
 #include <stdlib.h>
@@ -107,13 +128,108 @@ static void prv_bos_server_handle_frame(connection_t *conn, frame_t *frame) {
 }
 
 static void prv_bos_server_handle_signon_frame(connection_t *conn, frame_t *frame) {
-    // TODO: Find client info and authenticate
+    uint8_t *blob = frame->payload;
+    ssize_t blob_size = frame->flap.payload_length;
+    
+    // Skip FLAP version
+    ssize_t idx = sizeof(uint32_t);
+    
+    uint8_t *cookie = NULL;
+    uint16_t cookie_size = 0;
+    
+    uint8_t *resume_token = NULL;
+    uint16_t resume_token_size = 0;
+    
+    // Iterate through TLVs
+    while (idx < blob_size) {
+        ssize_t remaining_bytes = blob_size - idx;
+        
+        tlv_t tlv;
+        
+        if (!tlv_decode(&tlv, &blob[idx], remaining_bytes)) {
+            LOG_ERR("Failed to parse TLV.");
+            connection_close(conn);
+            return;
+        }
+        
+        idx += sizeof(tlv_header_t) + tlv.header.length;
+        
+        switch (tlv.header.tag) {
+        case TLV_TAG_LOGIN_COOKIE:
+            cookie = tlv.payload;
+            cookie_size = tlv.header.length;
+            break;
+        case TLV_TAG_CLIENT_RECONNECT:
+            resume_token = tlv.payload;
+            resume_token_size = tlv.header.length;
+            break;
+        default:
+            break;
+        }
+    }
+    
+    // Resume token alone vouches for a client coming back after an unclean disconnect
+    session_t *session = NULL;
+    
+    if (resume_token != NULL) {
+        session = session_manager_resume(conn, resume_token, resume_token_size);
+    }
+    
+    if (session != NULL) {
+        screenname_release(conn->screenname_id);
+        screenname_retain(session->screenname_id);
+        conn->screenname_id = session->screenname_id;
+        
+        oservice_send_host_online_response(conn);
+        return;
+    }
+    
+    if (cookie == NULL) {
+        LOG_ERR("Login cookie not part of signon frame.");
+        connection_close(conn);
+        return;
+    }
+    
+    // Cookie must have been minted by auth, it names the user and is gone once used
+    char uin[SCREENNAME_MAX_LEN + 1];
+    uint64_t now_ms = (uint64_t)timestamp_unix() * 1000;
+    
+    if (backend_take_login_cookie(cookie, cookie_size, now_ms, uin, sizeof(uin)) != BACKEND_RET_SUCCESS) {
+        LOG_ERR("Invalid login cookie.");
+        connection_close(conn);
+        return;
+    }
+    
+    screenname_release(conn->screenname_id);
+    conn->screenname_id = screenname_intern(uin, strlen(uin));
+    
+    if (conn->screenname_id == SCREENNAME_ID_INVALID) {
+        LOG_ERR("Invalid screen name in login cookie.");
+        connection_close(conn);
+        return;
+    }
+    
+    session = session_manager_begin(conn, conn->screenname_id);
+    
+    if (session == NULL) {
+        LOG_ERR("Unable to create session. Out of memory?");
+        connection_close(conn);
+        return;
+    }
+    
+    // Cookie was bound to the screen name as formatted by the backend
+    session_set_formatted_name(session, uin, strlen(uin));
+    presence_session_online(session);
    
     oservice_send_host_online_response(conn);
 }
 
 static void prv_bos_server_handle_signoff_frame(connection_t *conn, frame_t *frame) {
     LOG_INFO("Received signoff frame from client.");
+    
+    // Clean signoff, nothing to keep around for a resume
+    session_manager_end(conn->session);
+    
     connection_close(conn);
 }
 
@@ -183,12 +299,10 @@ static void prv_bos_server_handle_data_frame(connection_t *conn, frame_t *frame)
         LOG_WARN("SNAC_FOODGROUP_ID_CHAT handler not implemented.");
         break;
     case SNAC_FOODGROUP_ID_ODIR:
-        // TODO: Implement SNAC_FOODGROUP_ID_ODIR handler
-        LOG_WARN("SNAC_FOODGROUP_ID_ODIR handler not implemented.");
+        odir_handle_frame(conn, frame);
         break;
     case SNAC_FOODGROUP_ID_BART:
-        // TODO: Implement SNAC_FOODGROUP_ID_BART handler
-        LOG_WARN("SNAC_FOODGROUP_ID_BART handler not implemented.");
+        bart_handle_frame(conn, frame);
         break;
     case SNAC_FOODGROUP_ID_FEEDBAG:
         feedback_handle_frame(conn, frame);
@@ -233,17 +347,26 @@ void bos_server_handle_new_connection(connection_t *conn) {
     }
     LOG_INFO("Handling new boss connection.");
     
-    // Set connection event callback
+    // Set connection callbacks
     conn->callbacks.on_event = bos_server_handle_event;
+    conn->callbacks.on_close = bos_server_handle_close;
+    
+    // Issue token client can present to resume session after a drop
+    generate_random_stream(conn->resume_token, sizeof(conn->resume_token));
     
     // Create start message
     struct {
         flap_t header;
         uint32_t version;
+        tlv_header_t resume_token_header;
+        uint8_t resume_token[CONNECTION_RESUME_TOKEN_LEN];
     } __attribute__((packed)) signon_frame;
     
-    signon_frame.header = flap_encode(FLAP_FRAME_TYPE_SIGNON, 0, sizeof(uint32_t));
+    signon_frame.header = flap_encode(FLAP_FRAME_TYPE_SIGNON, 0, sizeof(signon_frame) - sizeof(flap_t));
     signon_frame.version = htonl(1);
+    signon_frame.resume_token_header.tag = htons(TLV_TAG_CLIENT_RECONNECT);
+    signon_frame.resume_token_header.length = htons(CONNECTION_RESUME_TOKEN_LEN);
+    memcpy(signon_frame.resume_token, conn->resume_token, CONNECTION_RESUME_TOKEN_LEN);
     
     ssize_t ret = connection_write(conn, &signon_frame, sizeof(signon_frame));
     
@@ -316,3 +439,20 @@ void bos_server_handle_event(connection_t *conn) {
         free(frame.payload);
     }
 }
+
+void bos_server_handle_close(connection_t *conn) {
+    if (conn == NULL) {
+        return;
+    }
+    
+    // Unclean disconnect, hold on to session in case client comes back
+    session_manager_handle_disconnect(conn);
+}
+
+void bos_server_handle_tick(uint64_t now_ms) {
+    session_manager_tick(now_ms);
+    presence_flush(now_ms);
+    typing_lane_flush(now_ms);
+    offline_store_tick(now_ms);
+    dir_index_sync(now_ms);
+}
\ No newline at end of file
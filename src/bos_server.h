@@ -11,6 +11,7 @@
 #ifndef BOS_SERVER_H_
 #define BOS_SERVER_H_
 
+#include <stdint.h>
 #include "connection.h"
 
 #ifdef __cplusplus
@@ -43,6 +44,20 @@ void bos_server_handle_new_connection(connection_t *conn);
  */
 void bos_server_handle_event(connection_t *conn);
 
+/**
+ * @brief Handle connection about to close
+ * 
+ * @param conn Connection
+ */
+void bos_server_handle_close(connection_t *conn);
+
+/**
+ * @brief Periodic housekeeping, called once per event loop iteration
+ * 
+ * @param now_ms Current monotonic time
+ */
+void bos_server_handle_tick(uint64_t now_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file config.c
+ * @author Evan Stoddard
+ * @brief Server configuration
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "oscar/bart_types.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define CONFIG_MAX_LINE_LEN 256U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Types of configuration values
+ * 
+ */
+typedef enum {
+    CONFIG_VALUE_TYPE_UINT32,
+    CONFIG_VALUE_TYPE_STRING,
+    CONFIG_VALUE_TYPE_ROLE,
+} config_value_type_t;
+
+/**
+ * @brief Configuration key definition
+ * 
+ */
+typedef struct config_key_t {
+    const char *key;
+    config_value_type_t type;
+    size_t offset;
+} config_key_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Active configuration
+ * 
+ */
+static config_t prv_config = {
+    .role = CONFIG_ROLE_ALL,
+    .auth_port = CONFIG_DEFAULT_AUTH_PORT,
+    .bos_port = CONFIG_DEFAULT_BOS_PORT,
+    .auth_workers = 1,
+    .db_path = "aim_db.db",
+    .auth_cookie_ttl_ms = 60000,
+    .bos_endpoint = "192.168.86.50:5191",
+    .presence_batch_window_ms = 0,
+    .buddy_max_buddies = 500,
+    .buddy_max_watchers = 3000,
+    .buddy_max_temp_buddies = 160,
+    .offline_store_path = "offline",
+    .offline_store_shards = 4,
+    .offline_store_segment_bytes = 4 * 1024 * 1024,
+    .offline_store_sync_interval_ms = 100,
+    .offline_store_compact_percent = 50,
+    .offline_store_max_messages = 100,
+    .icbm_max_message_len = 8000,
+    .icbm_max_sender_warn = 999,
+    .icbm_max_receiver_warn = 999,
+    .icbm_min_interval_ms = 0,
+    .typing_batch_window_ms = 50,
+    .typing_high_water_bytes = 4096,
+    .warning_half_life_ms = 3600000,
+    .warning_sender_window_ms = 600000,
+    .warning_max_per_pair = 2,
+    .feedbag_max_items = 1000,
+    .feedbag_max_buddies = 500,
+    .feedbag_max_groups = 100,
+    .feedbag_max_permits = 500,
+    .feedbag_max_denies = 500,
+    .feedbag_max_class_items = 20,
+    .feedbag_max_name_len = 97,
+    .feedbag_max_attrs_len = 1024,
+    .feedbag_max_buddies_per_group = 200,
+    .feedbag_max_recent_buddies = 10,
+    .directory_sync_interval_ms = 5000,
+    .directory_max_results = 25,
+    .bart_store_path = "bart.pack",
+    .bart_max_item_bytes = 7168,
+    .bart_max_mapped_items = 1024,
+    .bart_max_items_per_user = 16,
+};
+
+/**
+ * @brief Known configuration keys
+ * 
+ */
+static const config_key_t prv_config_keys[] = {
+    { "role", CONFIG_VALUE_TYPE_ROLE, offsetof(config_t, role) },
+    { "auth_port", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, auth_port) },
+    { "bos_port", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, bos_port) },
+    { "auth_workers", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, auth_workers) },
+    { "db_path", CONFIG_VALUE_TYPE_STRING, offsetof(config_t, db_path) },
+    { "auth_cookie_ttl_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, auth_cookie_ttl_ms) },
+    { "bos_endpoint", CONFIG_VALUE_TYPE_STRING, offsetof(config_t, bos_endpoint) },
+    { "presence_batch_window_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, presence_batch_window_ms) },
+    { "buddy_max_buddies", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, buddy_max_buddies) },
+    { "buddy_max_watchers", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, buddy_max_watchers) },
+    { "buddy_max_temp_buddies", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, buddy_max_temp_buddies) },
+    { "offline_store_path", CONFIG_VALUE_TYPE_STRING, offsetof(config_t, offline_store_path) },
+    { "offline_store_shards", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, offline_store_shards) },
+    { "offline_store_segment_bytes", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, offline_store_segment_bytes) },
+    { "offline_store_sync_interval_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, offline_store_sync_interval_ms) },
+    { "offline_store_compact_percent", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, offline_store_compact_percent) },
+    { "offline_store_max_messages", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, offline_store_max_messages) },
+    { "icbm_max_message_len", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, icbm_max_message_len) },
+    { "icbm_max_sender_warn", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, icbm_max_sender_warn) },
+    { "icbm_max_receiver_warn", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, icbm_max_receiver_warn) },
+    { "icbm_min_interval_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, icbm_min_interval_ms) },
+    { "typing_batch_window_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, typing_batch_window_ms) },
+    { "typing_high_water_bytes", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, typing_high_water_bytes) },
+    { "warning_half_life_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, warning_half_life_ms) },
+    { "warning_sender_window_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, warning_sender_window_ms) },
+    { "warning_max_per_pair", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, warning_max_per_pair) },
+    { "feedbag_max_items", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_items) },
+    { "feedbag_max_buddies", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_buddies) },
+    { "feedbag_max_groups", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_groups) },
+    { "feedbag_max_permits", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_permits) },
+    { "feedbag_max_denies", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_denies) },
+    { "feedbag_max_class_items", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_class_items) },
+    { "feedbag_max_name_len", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_name_len) },
+    { "feedbag_max_attrs_len", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_attrs_len) },
+    { "feedbag_max_buddies_per_group", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_buddies_per_group) },
+    { "feedbag_max_recent_buddies", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, feedbag_max_recent_buddies) },
+    { "directory_sync_interval_ms", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, directory_sync_interval_ms) },
+    { "directory_max_results", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, directory_max_results) },
+    { "bart_store_path", CONFIG_VALUE_TYPE_STRING, offsetof(config_t, bart_store_path) },
+    { "bart_max_item_bytes", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, bart_max_item_bytes) },
+    { "bart_max_mapped_items", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, bart_max_mapped_items) },
+    { "bart_max_items_per_user", CONFIG_VALUE_TYPE_UINT32, offsetof(config_t, bart_max_items_per_user) },
+};
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Strip leading and trailing whitespace in place
+ * 
+ * @param str String
+ * @return char* Pointer to first non whitespace character
+ */
+static char *prv_config_trim(char *str);
+
+/**
+ * @brief Parse unsigned 32-bit value
+ * 
+ * @param value String value
+ * @param dest Pointer to write value to
+ * @return true Able to parse value
+ * @return false Unable to parse value
+ */
+static bool prv_config_parse_uint32(const char *value, uint32_t *dest);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static char *prv_config_trim(char *str) {
+    while (isspace((unsigned char)*str)) {
+        str++;
+    }
+    
+    size_t len = strlen(str);
+    
+    while (len > 0 && isspace((unsigned char)str[len - 1])) {
+        str[len - 1] = '\0';
+        len--;
+    }
+    
+    return str;
+}
+
+static bool prv_config_parse_uint32(const char *value, uint32_t *dest) {
+    char *end = NULL;
+    
+    errno = 0;
+    unsigned long parsed = strtoul(value, &end, 0);
+    
+    if (errno != 0 || end == value || *end != '\0' || parsed > UINT32_MAX) {
+        return false;
+    }
+    
+    *dest = parsed;
+    
+    return true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+bool config_init(const char *path) {
+    if (path == NULL) {
+        return true;
+    }
+    
+    FILE *file = fopen(path, "r");
+    
+    if (file == NULL) {
+        LOG_INFO("No configuration file at %s, using defaults.", path);
+        return true;
+    }
+    
+    char line[CONFIG_MAX_LINE_LEN];
+    uint32_t line_num = 0;
+    bool ret = true;
+    
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_num++;
+        
+        // Strip comments
+        char *comment = strchr(line, '#');
+        
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        
+        char *key = prv_config_trim(line);
+        
+        if (*key == '\0') {
+            continue;
+        }
+        
+        char *separator = strchr(key, '=');
+        
+        if (separator == NULL) {
+            LOG_ERR("%s:%u: Expected \"key = value\".", path, line_num);
+            ret = false;
+            continue;
+        }
+        
+        *separator = '\0';
+        key = prv_config_trim(key);
+        char *value = prv_config_trim(separator + 1);
+        
+        if (!config_set(key, value)) {
+            LOG_ERR("%s:%u: Invalid setting \"%s\".", path, line_num, key);
+            ret = false;
+        }
+    }
+    
+    fclose(file);
+    
+    return ret;
+}
+
+config_t *config_get(void) {
+    return &prv_config;
+}
+
+bool config_set(const char *key, const char *value) {
+    if (key == NULL || value == NULL) {
+        return false;
+    }
+    
+    const config_key_t *def = NULL;
+    
+    for (uint32_t i = 0; i < (sizeof(prv_config_keys)/sizeof(config_key_t)); i++) {
+        if (strcmp(prv_config_keys[i].key, key) == 0) {
+            def = &prv_config_keys[i];
+            break;
+        }
+    }
+    
+    if (def == NULL) {
+        return false;
+    }
+    
+    void *dest = (uint8_t *)&prv_config + def->offset;
+    
+    switch (def->type) {
+    case CONFIG_VALUE_TYPE_UINT32:
+        return prv_config_parse_uint32(value, dest);
+    case CONFIG_VALUE_TYPE_STRING:
+        if (strlen(value) >= CONFIG_MAX_STRING_LEN) {
+            return false;
+        }
+        
+        strcpy(dest, value);
+        return true;
+    case CONFIG_VALUE_TYPE_ROLE:
+        if (strcmp(value, "auth") == 0) {
+            prv_config.role = CONFIG_ROLE_AUTH;
+        } else if (strcmp(value, "bos") == 0) {
+            prv_config.role = CONFIG_ROLE_BOS;
+        } else if (strcmp(value, "all") == 0) {
+            prv_config.role = CONFIG_ROLE_ALL;
+        } else {
+            return false;
+        }
+        
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool config_validate(void) {
+    bool ret = true;
+    
+    if (prv_config.auth_port == 0 || prv_config.auth_port > UINT16_MAX) {
+        LOG_ERR("auth_port out of range.");
+        ret = false;
+    }
+    
+    if (prv_config.bos_port == 0 || prv_config.bos_port > UINT16_MAX) {
+        LOG_ERR("bos_port out of range.");
+        ret = false;
+    }
+    
+    if (prv_config.auth_workers == 0 || prv_config.auth_workers > CONFIG_MAX_WORKERS) {
+        LOG_ERR("auth_workers must be between 1 and %u.", CONFIG_MAX_WORKERS);
+        ret = false;
+    }
+    
+    if (prv_config.auth_cookie_ttl_ms == 0) {
+        LOG_ERR("auth_cookie_ttl_ms must be at least 1.");
+        ret = false;
+    }
+    
+    if (prv_config.warning_sender_window_ms == 0) {
+        LOG_ERR("warning_sender_window_ms must be at least 1.");
+        ret = false;
+    }
+    
+    if (prv_config.warning_max_per_pair == 0 || prv_config.warning_max_per_pair > UINT16_MAX) {
+        LOG_ERR("warning_max_per_pair must be between 1 and %u.", UINT16_MAX);
+        ret = false;
+    }
+    
+    if (prv_config.bos_endpoint[0] == '\0') {
+        LOG_ERR("bos_endpoint must be set.");
+        ret = false;
+    }
+    
+    // Advertised to clients as 16 bit values
+    if (
+        prv_config.buddy_max_buddies > UINT16_MAX ||
+        prv_config.buddy_max_watchers > UINT16_MAX ||
+        prv_config.buddy_max_temp_buddies > UINT16_MAX
+    ) {
+        LOG_ERR("Buddy limits must be at most %u.", UINT16_MAX);
+        ret = false;
+    }
+    
+    if (prv_config.offline_store_shards == 0 || prv_config.offline_store_shards > CONFIG_MAX_OFFLINE_SHARDS) {
+        LOG_ERR("offline_store_shards must be between 1 and %u.", CONFIG_MAX_OFFLINE_SHARDS);
+        ret = false;
+    }
+    
+    if (prv_config.offline_store_compact_percent > 100) {
+        LOG_ERR("offline_store_compact_percent must be at most 100.");
+        ret = false;
+    }
+    
+    if (prv_config.icbm_max_message_len > UINT16_MAX) {
+        LOG_ERR("icbm_max_message_len must be at most %u.", UINT16_MAX);
+        ret = false;
+    }
+    
+    // Warning levels are tenths of a percent
+    if (prv_config.icbm_max_sender_warn > 999 || prv_config.icbm_max_receiver_warn > 999) {
+        LOG_ERR("ICBM warning limits must be at most 999.");
+        ret = false;
+    }
+    
+    // Advertised to clients as 16 bit values
+    if (
+        prv_config.feedbag_max_items > UINT16_MAX ||
+        prv_config.feedbag_max_buddies > UINT16_MAX ||
+        prv_config.feedbag_max_groups > UINT16_MAX ||
+        prv_config.feedbag_max_permits > UINT16_MAX ||
+        prv_config.feedbag_max_denies > UINT16_MAX ||
+        prv_config.feedbag_max_class_items > UINT16_MAX ||
+        prv_config.feedbag_max_name_len > UINT16_MAX ||
+        prv_config.feedbag_max_attrs_len > UINT16_MAX ||
+        prv_config.feedbag_max_buddies_per_group > UINT16_MAX ||
+        prv_config.feedbag_max_recent_buddies > UINT16_MAX
+    ) {
+        LOG_ERR("Feedbag limits must be at most %u.", UINT16_MAX);
+        ret = false;
+    }
+    
+    if (prv_config.directory_max_results == 0 || prv_config.directory_max_results > UINT16_MAX) {
+        LOG_ERR("directory_max_results must be between 1 and %u.", UINT16_MAX);
+        ret = false;
+    }
+    
+    if (prv_config.bart_max_item_bytes == 0 || prv_config.bart_max_item_bytes > BART_MAX_DATA_LEN) {
+        LOG_ERR("bart_max_item_bytes must be between 1 and %u.", BART_MAX_DATA_LEN);
+        ret = false;
+    }
+    
+    if (prv_config.bart_max_mapped_items == 0) {
+        LOG_ERR("bart_max_mapped_items must be at least 1.");
+        ret = false;
+    }
+    
+    return ret;
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file config.h
+ * @author Evan Stoddard
+ * @brief Server configuration
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define CONFIG_DEFAULT_PATH             "aim_server.conf"
+
+#define CONFIG_DEFAULT_AUTH_PORT        5190U
+#define CONFIG_DEFAULT_BOS_PORT         5191U
+
+#define CONFIG_MAX_WORKERS              16U
+#define CONFIG_MAX_STRING_LEN           128U
+#define CONFIG_MAX_OFFLINE_SHARDS       64U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Servers run by a process
+ * 
+ */
+typedef enum {
+    CONFIG_ROLE_AUTH = (1 << 0),
+    CONFIG_ROLE_BOS = (1 << 1),
+    CONFIG_ROLE_ALL = (CONFIG_ROLE_AUTH | CONFIG_ROLE_BOS),
+} config_role_t;
+
+/**
+ * @brief Server configuration typedef
+ * 
+ */
+typedef struct config_t {
+    // Process layout
+    uint32_t role;
+    uint32_t auth_port;
+    uint32_t bos_port;
+    uint32_t auth_workers;
+    char db_path[CONFIG_MAX_STRING_LEN];
+    
+    // Login cookies minted by auth are good for one BOS signon within this time
+    uint32_t auth_cookie_ttl_ms;
+    
+    // BOS endpoint handed out by auth ("host:port")
+    char bos_endpoint[CONFIG_MAX_STRING_LEN];
+    
+    // Presence notifications are held at most this long (0 flushes every loop)
+    uint32_t presence_batch_window_ms;
+    
+    // Buddy rights advertised to clients and enforced per session
+    uint32_t buddy_max_buddies;
+    uint32_t buddy_max_watchers;
+    uint32_t buddy_max_temp_buddies;
+    
+    // Offline message store
+    char offline_store_path[CONFIG_MAX_STRING_LEN];
+    uint32_t offline_store_shards;
+    uint32_t offline_store_segment_bytes;
+    uint32_t offline_store_sync_interval_ms;
+    uint32_t offline_store_compact_percent;
+    uint32_t offline_store_max_messages;
+    
+    // Host limits for ICBM parameters, clients may only tighten them
+    uint32_t icbm_max_message_len;
+    uint32_t icbm_max_sender_warn;
+    uint32_t icbm_max_receiver_warn;
+    uint32_t icbm_min_interval_ms;
+    
+    // Typing event lane (held for the window, dropped for backed up sockets)
+    uint32_t typing_batch_window_ms;
+    uint32_t typing_high_water_bytes;
+    
+    // Warning levels halve every half life (0 never decays)
+    uint32_t warning_half_life_ms;
+    
+    // Users may only warn someone who messaged them within the window, a few times per half life
+    uint32_t warning_sender_window_ms;
+    uint32_t warning_max_per_pair;
+    
+    // Feedbag limits advertised in the rights reply and enforced on edits
+    uint32_t feedbag_max_items;
+    uint32_t feedbag_max_buddies;
+    uint32_t feedbag_max_groups;
+    uint32_t feedbag_max_permits;
+    uint32_t feedbag_max_denies;
+    uint32_t feedbag_max_class_items;
+    uint32_t feedbag_max_name_len;
+    uint32_t feedbag_max_attrs_len;
+    uint32_t feedbag_max_buddies_per_group;
+    uint32_t feedbag_max_recent_buddies;
+    
+    // Directory index (refreshed from backend, searched in memory)
+    uint32_t directory_sync_interval_ms;
+    uint32_t directory_max_results;
+    
+    // BART item pack file (shared by BOS workers), recently served items stay mapped
+    char bart_store_path[CONFIG_MAX_STRING_LEN];
+    uint32_t bart_max_item_bytes;
+    uint32_t bart_max_mapped_items;
+    uint32_t bart_max_items_per_user;
+} config_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Load configuration file on top of defaults
+ * 
+ * @param path Path to configuration file (NULL or missing file uses defaults)
+ * @return true Configuration loaded
+ * @return false Configuration file malformed
+ */
+bool config_init(const char *path);
+
+/**
+ * @brief Get active configuration
+ * 
+ * @return config_t* Pointer to configuration
+ */
+config_t *config_get(void);
+
+/**
+ * @brief Apply single "key = value" setting
+ * 
+ * @param key Key
+ * @param value Value
+ * @return true Setting applied
+ * @return false Unknown key or bad value
+ */
+bool config_set(const char *key, const char *value);
+
+/**
+ * @brief Check configuration for out of range values
+ * 
+ * @return true Configuration usable
+ * @return false Configuration invalid
+ */
+bool config_validate(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CONFIG_H_ */
\ No newline at end of file
@@ -10,9 +10,12 @@
 
 #include "connection.h"
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <stddef.h>
 #include "logging.h"
 #include "connection_manager.h"
+#include "oscar/flap.h"
+#include "oscar/flap_encoder.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -35,6 +38,13 @@
  */
 static inline void prv_connection_call_on_closed_callback(connection_t *conn);
 
+/**
+ * @brief Helper function to call on close callback (before socket is closed)
+ * 
+ * @param conn Connection
+ */
+static inline void prv_connection_call_on_close_callback(connection_t *conn);
+
 /*****************************************************************************
  * Functions
  *****************************************************************************/
@@ -65,6 +75,8 @@ void connection_deinit(connection_t *conn) {
         client_deinit(conn->client);
     }
     
+    screenname_release(conn->screenname_id);
+    
     free(conn);
 }
 
@@ -88,11 +100,119 @@ ssize_t connection_write(connection_t *conn, void *buffer, ssize_t size) {
     return written_bytes;
 }
 
+ssize_t connection_write_frame(connection_t *conn, const struct iovec *iov, int iov_count) {
+    if (conn == NULL || iov_count < 0 || iov_count > (int)CONNECTION_MAX_FRAME_IOVECS) {
+        return -1;
+    }
+    
+    struct iovec frame_iov[CONNECTION_MAX_FRAME_IOVECS + 1];
+    size_t payload_length = 0;
+    
+    for (int i = 0; i < iov_count; i++) {
+        frame_iov[i + 1] = iov[i];
+        payload_length += iov[i].iov_len;
+    }
+    
+    if (payload_length > UINT16_MAX) {
+        return -1;
+    }
+    
+    // Encode FLAP
+    conn->last_outbound_seq_num++;
+    flap_t flap = flap_encode(FLAP_FRAME_TYPE_DATA, conn->last_outbound_seq_num, payload_length);
+    
+    frame_iov[0].iov_base = &flap;
+    frame_iov[0].iov_len = sizeof(flap_t);
+    
+    ssize_t written_bytes = writev(conn->socket, frame_iov, iov_count + 1);
+    
+    if (written_bytes == 0 || written_bytes == -1) {
+        connection_close(conn);
+    }
+    
+    return written_bytes;
+}
+
+ssize_t connection_write_frames(connection_t *conn, const struct iovec *payloads, int frame_count) {
+    if (conn == NULL || payloads == NULL || frame_count < 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < frame_count; i++) {
+        if (payloads[i].iov_len > UINT16_MAX) {
+            return -1;
+        }
+    }
+    
+    flap_t flaps[CONNECTION_MAX_BATCH_FRAMES];
+    struct iovec iov[CONNECTION_MAX_BATCH_FRAMES * 2];
+    int idx = 0;
+    
+    while (idx < frame_count) {
+        int count = frame_count - idx;
+        
+        if (count > (int)CONNECTION_MAX_BATCH_FRAMES) {
+            count = CONNECTION_MAX_BATCH_FRAMES;
+        }
+        
+        ssize_t expected = 0;
+        
+        // Interleave FLAP headers with payloads
+        for (int i = 0; i < count; i++) {
+            const struct iovec *payload = &payloads[idx + i];
+            
+            conn->last_outbound_seq_num++;
+            flaps[i] = flap_encode(FLAP_FRAME_TYPE_DATA, conn->last_outbound_seq_num, payload->iov_len);
+            
+            iov[i * 2].iov_base = &flaps[i];
+            iov[i * 2].iov_len = sizeof(flap_t);
+            iov[i * 2 + 1] = *payload;
+            
+            expected += sizeof(flap_t) + payload->iov_len;
+        }
+        
+        ssize_t written_bytes = writev(conn->socket, iov, count * 2);
+        
+        if (written_bytes == 0 || written_bytes == -1) {
+            connection_close(conn);
+            return idx;
+        }
+        
+        // Stream is cut mid frame, count what made it out whole and drop the connection
+        if (written_bytes != expected) {
+            for (int i = 0; i < count && written_bytes >= (ssize_t)(sizeof(flap_t) + payloads[idx].iov_len); i++) {
+                written_bytes -= sizeof(flap_t) + payloads[idx].iov_len;
+                idx++;
+            }
+            
+            connection_close(conn);
+            return idx;
+        }
+        
+        idx += count;
+    }
+    
+    return idx;
+}
+
+ssize_t connection_unsent_bytes(connection_t *conn) {
+    int unsent = 0;
+    
+    if (ioctl(conn->socket, TIOCOUTQ, &unsent) < 0) {
+        return -1;
+    }
+    
+    return unsent;
+}
+
 void connection_close(connection_t *conn) {
     if (conn == NULL) {
         return;
     }
     
+    // Let owner tear down state tied to the connection
+    prv_connection_call_on_close_callback(conn);
+    
     // Close socket
     close(conn->socket);
     
@@ -108,4 +228,14 @@ static inline void prv_connection_call_on_closed_callback(connection_t *conn) {
     if (conn->callbacks.connection_closed) {
         conn->callbacks.connection_closed(conn);
     }
+}
+
+static inline void prv_connection_call_on_close_callback(connection_t *conn) {
+    if (conn == NULL) {
+        return;
+    }
+    
+    if (conn->callbacks.on_close) {
+        conn->callbacks.on_close(conn);
+    }
 }
\ No newline at end of file
@@ -13,7 +13,9 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include "model/client.h"
+#include "model/screenname.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,12 +25,25 @@ extern "C" {
  * Definitions
  *****************************************************************************/
 
+#define CONNECTION_MAX_FRAME_IOVECS 16U
+
+// Frames written per writev() call by connection_write_frames()
+#define CONNECTION_MAX_BATCH_FRAMES 64U
+
+#define CONNECTION_RESUME_TOKEN_LEN 16U
+
 /**
  * @brief Forward declaration of connection type
  * 
  */
 struct connection_t;
 
+/**
+ * @brief Forward declaration of session type
+ * 
+ */
+struct session_t;
+
 /**
  * @brief Connection callbacks typedef
  * 
@@ -36,6 +51,7 @@ struct connection_t;
 typedef struct connection_callbacks_t {
     void(*connection_closed)(struct connection_t *conn);
     void(*on_event)(struct connection_t *conn);
+    void(*on_close)(struct connection_t *conn);
 } connection_callbacks_t;
 
 /**
@@ -48,7 +64,9 @@ typedef struct connection_t {
     uint16_t last_outbound_seq_num;
     connection_callbacks_t callbacks;
     client_t *client;
-    char screenname[20];
+    screenname_id_t screenname_id;
+    struct session_t *session;
+    uint8_t resume_token[CONNECTION_RESUME_TOKEN_LEN];
 } connection_t;
 
 /*****************************************************************************
@@ -94,6 +112,38 @@ ssize_t connection_read(connection_t *conn, void *buffer, ssize_t size);
  */
 ssize_t connection_write(connection_t *conn, void *buffer, ssize_t size);
 
+/**
+ * @brief Write DATA frame to socket, prepending a FLAP header with the next
+ *        outbound sequence number
+ * 
+ * @param conn Connection
+ * @param iov Frame payload segments (SNAC header and body)
+ * @param iov_count Number of segments (Max of CONNECTION_MAX_FRAME_IOVECS)
+ * @return ssize_t Size written (FLAP header included)
+ */
+ssize_t connection_write_frame(connection_t *conn, const struct iovec *iov, int iov_count);
+
+/**
+ * @brief Write several DATA frames with as few syscalls as possible
+ * 
+ * A failed or short write closes the connection, a frame cut off part way
+ * can't be picked up again on the same stream.
+ * 
+ * @param conn Connection
+ * @param payloads One contiguous payload (SNAC header and body) per frame
+ * @param frame_count Number of frames
+ * @return ssize_t Number of leading frames written in full (-1 on invalid arguments)
+ */
+ssize_t connection_write_frames(connection_t *conn, const struct iovec *payloads, int frame_count);
+
+/**
+ * @brief Bytes written to connection but not yet sent by the kernel
+ * 
+ * @param conn Connection
+ * @return ssize_t Unsent bytes (-1 if unknown)
+ */
+ssize_t connection_unsent_bytes(connection_t *conn);
+
 /**
  * @brief Close connection
  * 
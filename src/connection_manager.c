@@ -19,6 +19,8 @@
 #include "auth_server.h"
 #include "bos_server.h"
 
+#include "utils/timestamp.h"
+
 #include "logging.h"
 
 /*****************************************************************************
@@ -35,7 +37,8 @@
 
 #define CONNECTION_MANAGER_SERVER_FD_COUNT (CONNECTION_MANAGER_BOSS_IDX + 1)
 
-#define CONNECTION_MANAGER_POLL_TIMEOUT INT32_MAX
+// Upper bound on time between housekeeping ticks
+#define CONNECTION_MANAGER_POLL_TIMEOUT 1000
 
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
@@ -58,6 +61,12 @@ static struct {
     socket_server_t auth_socket_server;
     socket_server_t boss_socket_server;
     
+    // Servers run by this process (config_role_t)
+    uint32_t role;
+    
+    // Poll timeout, shortened so held presence and typing batches go out on time
+    int poll_timeout_ms;
+    
     nfds_t active_fds;
 } prv_inst;
 
@@ -101,51 +110,78 @@ static void prv_connection_manager_on_connection_closed(connection_t *conn);
  * Functions
  *****************************************************************************/
 
-bool connection_manager_init(uint16_t auth_port, uint16_t boss_port) {
-    // Initialize socket servers
-    socket_server_status_t ret = socket_server_init(
-        &prv_inst.auth_socket_server, 
-        auth_port)
-    ;
+bool connection_manager_init(const config_t *config) {
+    prv_inst.role = config->role;
     
-    if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
-        LOG_ERR("Failed to initialize auth socket server. (%u)", ret);
-        return false;
+    prv_inst.poll_timeout_ms = CONNECTION_MANAGER_POLL_TIMEOUT;
+    
+    if (config->role & CONFIG_ROLE_BOS) {
+        if (config->presence_batch_window_ms > 0 && config->presence_batch_window_ms < (uint32_t)prv_inst.poll_timeout_ms) {
+            prv_inst.poll_timeout_ms = config->presence_batch_window_ms;
+        }
+        
+        if (config->typing_batch_window_ms > 0 && config->typing_batch_window_ms < (uint32_t)prv_inst.poll_timeout_ms) {
+            prv_inst.poll_timeout_ms = config->typing_batch_window_ms;
+        }
     }
     
-    ret = socket_server_init(
-        &prv_inst.boss_socket_server,
-        boss_port
-    );
+    // Initialize socket servers
+    if (prv_inst.role & CONFIG_ROLE_AUTH) {
+        socket_server_status_t ret = socket_server_init(
+            &prv_inst.auth_socket_server, 
+            config->auth_port
+        );
+        
+        if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
+            LOG_ERR("Failed to initialize auth socket server. (%u)", ret);
+            return false;
+        }
+    }
     
-    if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
-        LOG_ERR("Failed to initialize BOSS socket server. (%u)", ret);
-        return false;
+    if (prv_inst.role & CONFIG_ROLE_BOS) {
+        socket_server_status_t ret = socket_server_init(
+            &prv_inst.boss_socket_server,
+            config->bos_port
+        );
+        
+        if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
+            LOG_ERR("Failed to initialize BOSS socket server. (%u)", ret);
+            return false;
+        }
     }
     
     return true;
 }
 
 void connection_manager_start(void) {
-    // Start Socket servers
-    socket_server_status_t ret = socket_server_start(&prv_inst.auth_socket_server);
+    // Negative FDs are ignored by poll
+    prv_inst.pollfds[CONNECTION_MANAGER_AUTH_IDX].fd = -1;
+    prv_inst.pollfds[CONNECTION_MANAGER_BOSS_IDX].fd = -1;
     
-    if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
-        LOG_FATAL("Failed to start auth socket server. (%u)", ret);
-        return;
+    // Start Socket servers
+    if (prv_inst.role & CONFIG_ROLE_AUTH) {
+        socket_server_status_t ret = socket_server_start(&prv_inst.auth_socket_server);
+        
+        if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
+            LOG_FATAL("Failed to start auth socket server. (%u)", ret);
+            return;
+        }
+        
+        prv_inst.pollfds[CONNECTION_MANAGER_AUTH_IDX].fd = prv_inst.auth_socket_server.socket_fd;
     }
     
-    ret = socket_server_start(&prv_inst.boss_socket_server);
-    
-    if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
-        LOG_FATAL("Failed to start BOSS socket server. (%u)", ret);
-        return;
+    if (prv_inst.role & CONFIG_ROLE_BOS) {
+        socket_server_status_t ret = socket_server_start(&prv_inst.boss_socket_server);
+        
+        if (ret != SOCKET_SERVER_STATUS_SUCCESS) {
+            LOG_FATAL("Failed to start BOSS socket server. (%u)", ret);
+            return;
+        }
+        
+        prv_inst.pollfds[CONNECTION_MANAGER_BOSS_IDX].fd = prv_inst.boss_socket_server.socket_fd;
     }
     
     // Set up polling
-    prv_inst.pollfds[CONNECTION_MANAGER_AUTH_IDX].fd = prv_inst.auth_socket_server.socket_fd;
-    prv_inst.pollfds[CONNECTION_MANAGER_BOSS_IDX].fd = prv_inst.boss_socket_server.socket_fd;
-    
     prv_inst.pollfds[CONNECTION_MANAGER_AUTH_IDX].events = POLLIN | POLLPRI;
     prv_inst.pollfds[CONNECTION_MANAGER_BOSS_IDX].events = POLLIN | POLLPRI;
     
@@ -200,16 +236,20 @@ static void prv_connection_manager_polling_loop(void) {
         int poll_result = poll(
             prv_inst.pollfds, 
             prv_inst.active_fds, 
-            CONNECTION_MANAGER_POLL_TIMEOUT
+            prv_inst.poll_timeout_ms
         );
         
         // Check if events occurred
         if (poll_result > 0) {
             prv_connection_manager_service_server_fds();
             prv_connection_manager_service_client_fds();
+            
+            LOG_INFO("Active connections: %lu", prv_inst.active_fds - 2);
         }
         
-        LOG_INFO("Active connections: %lu", prv_inst.active_fds - 2);
+        if (prv_inst.role & CONFIG_ROLE_BOS) {
+            bos_server_handle_tick(timestamp_monotonic_ms());
+        }
     }
 }
 
@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "connection.h"
+#include "config/config.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,9 +27,6 @@ extern "C" {
 #define CONNECTION_MANAGER_MAX_AUTH_CONNECTIONS 10U
 #define CONNECTION_MANAGER_MAX_BOSS_CONNECTIONS 10U
 
-#define CONNECTION_MANAGER_DEFAULT_AUTH_PORT    5190U
-#define CONNECTION_MANAGER_DEFAULT_BOSS_PORT    5191U
-
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
  *****************************************************************************/
@@ -40,12 +38,13 @@ extern "C" {
 /**
  * @brief Initialize connection manager
  * 
- * @param auth_port Port for auth socket
- * @param boss_port Port for BOSS socket
+ * Only socket servers for the configured role are created.
+ * 
+ * @param config Configuration
  * @return true Able to spin up sockets
  * @return false Unable to spin up sockets
  */
-bool connection_manager_init(uint16_t auth_port, uint16_t boss_port);
+bool connection_manager_init(const config_t *config);
 
 /**
  * @brief Start connection manager and socket servers
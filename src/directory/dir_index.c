@@ -0,0 +1,919 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file dir_index.c
+ * @author Evan Stoddard
+ * @brief In memory directory with an inverted index for searches
+ */
+
+#include "dir_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+
+#include "config/config.h"
+#include "backends/backend.h"
+#include "oscar/odir_types.h"
+#include "oscar/tlv.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define DIR_INDEX_INITIAL_BUCKETS 64U
+#define DIR_INDEX_INITIAL_DOCS 64U
+#define DIR_INDEX_INITIAL_POSTINGS 16U
+
+#define DIR_INDEX_FNV_OFFSET_BASIS 2166136261U
+#define DIR_INDEX_FNV_PRIME        16777619U
+
+// Field tag byte plus the token, longer tokens are cut short
+#define DIR_INDEX_MAX_TERM_LEN 32U
+
+// Terms a single query may combine
+#define DIR_INDEX_MAX_QUERY_TERMS 16U
+
+// Entries read from the backend per sync
+#define DIR_INDEX_SYNC_BATCH 1000U
+
+// Longest varint encoding of a 32 bit doc ID delta
+#define DIR_INDEX_MAX_VARINT_LEN 5U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Fields terms are indexed under
+ * 
+ */
+typedef enum {
+    DIR_INDEX_FIELD_NONE = 0,
+    DIR_INDEX_FIELD_NAME,
+    DIR_INDEX_FIELD_CITY,
+    DIR_INDEX_FIELD_INTEREST,
+} dir_index_field_t;
+
+/**
+ * @brief Postings list typedef
+ * 
+ * Doc IDs in ascending order, each stored as a varint of the gap to the
+ * previous one. New users get the highest ID so they are appended,
+ * anything else rewrites the list.
+ */
+typedef struct dir_postings_t {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t last;
+} dir_postings_t;
+
+/**
+ * @brief Indexed term typedef
+ * 
+ */
+typedef struct dir_term_t {
+    uint32_t hash;
+    struct dir_term_t *next_in_bucket;
+    dir_postings_t postings;
+    uint8_t len;
+    char text[DIR_INDEX_MAX_TERM_LEN];
+} dir_term_t;
+
+/**
+ * @brief Position in a postings list while decoding
+ * 
+ */
+typedef struct dir_cursor_t {
+    const uint8_t *ptr;
+    const uint8_t *end;
+    uint32_t current;
+    bool valid;
+} dir_cursor_t;
+
+/**
+ * @brief Terms collected from a query
+ * 
+ */
+typedef struct dir_query_t {
+    dir_term_t *terms[DIR_INDEX_MAX_QUERY_TERMS];
+    uint32_t num_terms;
+    bool missing;
+    bool overflow;
+} dir_query_t;
+
+/**
+ * @brief Callback for every term in a TLV block
+ * 
+ */
+typedef void (*dir_term_cb_t)(const char *text, uint8_t len, void *ctx);
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private static instance of directory index
+ * 
+ * Docs are numbered in the order users first show up and never renumbered.
+ * Docs and terms are each chained into their own hash table.
+ */
+static struct {
+    dir_doc_t **docs;
+    uint32_t num_docs;
+    uint32_t docs_capacity;
+    
+    dir_doc_t **doc_buckets;
+    uint32_t num_doc_buckets;
+    
+    dir_term_t **term_buckets;
+    uint32_t num_term_buckets;
+    uint32_t num_terms;
+    
+    uint64_t last_seq;
+    uint64_t last_sync_ms;
+    bool caught_up;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief FNV-1a hash of bytes
+ * 
+ * @param data Bytes
+ * @param len Number of bytes
+ * @return uint32_t Hash
+ */
+static uint32_t prv_dir_index_hash(const void *data, size_t len);
+
+/**
+ * @brief Field TLV is indexed under
+ * 
+ * @param tag TLV tag
+ * @return dir_index_field_t Field (DIR_INDEX_FIELD_NONE if not indexed)
+ */
+static dir_index_field_t prv_dir_index_field(uint16_t tag);
+
+/**
+ * @brief Split indexed TLVs of block into terms
+ * 
+ * Terms are the field followed by a lower cased run of letters and digits.
+ * 
+ * @param tlvs TLV block (must be well formed)
+ * @param len Length of block
+ * @param cb Called for every term
+ * @param ctx Context passed to callback
+ */
+static void prv_dir_index_for_each_term(const uint8_t *tlvs, size_t len, dir_term_cb_t cb, void *ctx);
+
+/**
+ * @brief Find term
+ * 
+ * @param text Term
+ * @param len Length of term
+ * @param create Create term if it doesn't exist
+ * @return dir_term_t* Term (NULL if not found or out of memory)
+ */
+static dir_term_t *prv_dir_index_term(const char *text, uint8_t len, bool create);
+
+/**
+ * @brief Unlink and free term
+ * 
+ * @param term Term
+ */
+static void prv_dir_index_free_term(dir_term_t *term);
+
+/**
+ * @brief Double bucket count of hash table and rehash
+ * 
+ * @param terms Grow term table (doc table otherwise)
+ * @return true Able to grow table
+ * @return false Unable to grow table
+ */
+static bool prv_dir_index_grow(bool terms);
+
+/**
+ * @brief Append doc ID larger than any in list
+ * 
+ * @param postings Postings list
+ * @param id Doc ID
+ * @return true Appended
+ * @return false Out of memory
+ */
+static bool prv_dir_index_append(dir_postings_t *postings, uint32_t id);
+
+/**
+ * @brief Rewrite list with doc ID added or removed
+ * 
+ * @param postings Postings list
+ * @param id Doc ID
+ * @param insert Add doc ID (removed otherwise)
+ * @return true List rewritten or already as wanted
+ * @return false Out of memory
+ */
+static bool prv_dir_index_rewrite(dir_postings_t *postings, uint32_t id, bool insert);
+
+/**
+ * @brief Start decoding postings list
+ * 
+ * @param cursor Cursor
+ * @param postings Postings list
+ */
+static void prv_dir_index_cursor_init(dir_cursor_t *cursor, const dir_postings_t *postings);
+
+/**
+ * @brief Decode next doc ID
+ * 
+ * @param cursor Cursor (valid cleared at end of list)
+ */
+static void prv_dir_index_cursor_next(dir_cursor_t *cursor);
+
+/**
+ * @brief Add doc to postings of term
+ * 
+ * @param text Term
+ * @param len Length of term
+ * @param ctx Doc
+ */
+static void prv_dir_index_add_term(const char *text, uint8_t len, void *ctx);
+
+/**
+ * @brief Remove doc from postings of term
+ * 
+ * @param text Term
+ * @param len Length of term
+ * @param ctx Doc
+ */
+static void prv_dir_index_remove_term(const char *text, uint8_t len, void *ctx);
+
+/**
+ * @brief Collect query term
+ * 
+ * @param text Term
+ * @param len Length of term
+ * @param ctx Query
+ */
+static void prv_dir_index_query_term(const char *text, uint8_t len, void *ctx);
+
+/**
+ * @brief Create entry for user who has none yet
+ * 
+ * @param uin Normalized screen name
+ * @param hash Hash of screen name
+ * @return dir_doc_t* Entry (NULL if out of memory)
+ */
+static dir_doc_t *prv_dir_index_create_doc(const char *uin, uint32_t hash);
+
+/**
+ * @brief Replace a blob of doc with a copy
+ * 
+ * @param blob Blob to replace
+ * @param blob_len Length of blob to replace
+ * @param data New contents
+ * @param len Length of new contents
+ * @return true Replaced
+ * @return false Out of memory
+ */
+static bool prv_dir_index_copy_blob(uint8_t **blob, uint16_t *blob_len, const uint8_t *data, size_t len);
+
+/**
+ * @brief Apply entry read from backend
+ * 
+ * @param ctx Unused
+ * @param entry Entry
+ */
+static void prv_dir_index_sync_entry(void *ctx, const dir_entry_t *entry);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static uint32_t prv_dir_index_hash(const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    uint32_t hash = DIR_INDEX_FNV_OFFSET_BASIS;
+    
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= DIR_INDEX_FNV_PRIME;
+    }
+    
+    return hash;
+}
+
+static dir_index_field_t prv_dir_index_field(uint16_t tag) {
+    switch (tag) {
+    case DIR_INFO_TLV_FIRST_NAME:
+    case DIR_INFO_TLV_LAST_NAME:
+    case DIR_INFO_TLV_MIDDLE_NAME:
+    case DIR_INFO_TLV_MAIDEN_NAME:
+    case DIR_INFO_TLV_NICKNAME:
+        return DIR_INDEX_FIELD_NAME;
+    case DIR_INFO_TLV_CITY:
+        return DIR_INDEX_FIELD_CITY;
+    case DIR_INFO_TLV_INTEREST:
+        return DIR_INDEX_FIELD_INTEREST;
+    default:
+        return DIR_INDEX_FIELD_NONE;
+    }
+}
+
+static void prv_dir_index_for_each_term(const uint8_t *tlvs, size_t len, dir_term_cb_t cb, void *ctx) {
+    size_t idx = 0;
+    
+    while (idx + sizeof(tlv_header_t) <= len) {
+        const tlv_header_t *header = (const tlv_header_t *)&tlvs[idx];
+        uint16_t value_len = ntohs(header->length);
+        const uint8_t *value = &tlvs[idx + sizeof(tlv_header_t)];
+        dir_index_field_t field = prv_dir_index_field(ntohs(header->tag));
+        
+        idx += sizeof(tlv_header_t) + value_len;
+        
+        if (field == DIR_INDEX_FIELD_NONE) {
+            continue;
+        }
+        
+        char term[DIR_INDEX_MAX_TERM_LEN];
+        uint8_t term_len = 0;
+        
+        // One extra pass over the end flushes the last token
+        for (uint16_t i = 0; i <= value_len; i++) {
+            if (i < value_len && isalnum(value[i])) {
+                if (term_len == 0) {
+                    term[term_len++] = (char)field;
+                }
+                
+                if (term_len < DIR_INDEX_MAX_TERM_LEN) {
+                    term[term_len++] = (char)tolower(value[i]);
+                }
+                
+                continue;
+            }
+            
+            if (term_len > 0) {
+                cb(term, term_len, ctx);
+                term_len = 0;
+            }
+        }
+    }
+}
+
+static dir_term_t *prv_dir_index_term(const char *text, uint8_t len, bool create) {
+    uint32_t hash = prv_dir_index_hash(text, len);
+    
+    if (prv_inst.num_term_buckets > 0) {
+        dir_term_t *term = prv_inst.term_buckets[hash & (prv_inst.num_term_buckets - 1)];
+        
+        for (; term != NULL; term = term->next_in_bucket) {
+            if (term->hash == hash && term->len == len && memcmp(term->text, text, len) == 0) {
+                return term;
+            }
+        }
+    }
+    
+    if (!create) {
+        return NULL;
+    }
+    
+    if (prv_inst.num_terms >= prv_inst.num_term_buckets && !prv_dir_index_grow(true) && prv_inst.num_term_buckets == 0) {
+        return NULL;
+    }
+    
+    dir_term_t *term = calloc(1, sizeof(dir_term_t));
+    
+    if (term == NULL) {
+        return NULL;
+    }
+    
+    term->hash = hash;
+    term->len = len;
+    memcpy(term->text, text, len);
+    
+    dir_term_t **bucket = &prv_inst.term_buckets[hash & (prv_inst.num_term_buckets - 1)];
+    term->next_in_bucket = *bucket;
+    *bucket = term;
+    prv_inst.num_terms++;
+    
+    return term;
+}
+
+static void prv_dir_index_free_term(dir_term_t *term) {
+    dir_term_t **link = &prv_inst.term_buckets[term->hash & (prv_inst.num_term_buckets - 1)];
+    
+    while (*link != NULL && *link != term) {
+        link = &(*link)->next_in_bucket;
+    }
+    
+    if (*link != NULL) {
+        *link = term->next_in_bucket;
+    }
+    
+    prv_inst.num_terms--;
+    free(term->postings.data);
+    free(term);
+}
+
+static bool prv_dir_index_grow(bool terms) {
+    uint32_t old_count = terms ? prv_inst.num_term_buckets : prv_inst.num_doc_buckets;
+    uint32_t new_count = old_count * 2;
+    
+    if (new_count == 0) {
+        new_count = DIR_INDEX_INITIAL_BUCKETS;
+    }
+    
+    void **buckets = calloc(new_count, sizeof(void *));
+    
+    if (buckets == NULL) {
+        return false;
+    }
+    
+    // Both chains are rehashed the same way, only the link types differ
+    if (terms) {
+        for (uint32_t i = 0; i < old_count; i++) {
+            dir_term_t *term = prv_inst.term_buckets[i];
+            
+            while (term != NULL) {
+                dir_term_t *next = term->next_in_bucket;
+                dir_term_t **bucket = (dir_term_t **)&buckets[term->hash & (new_count - 1)];
+                
+                term->next_in_bucket = *bucket;
+                *bucket = term;
+                term = next;
+            }
+        }
+        
+        free(prv_inst.term_buckets);
+        prv_inst.term_buckets = (dir_term_t **)buckets;
+        prv_inst.num_term_buckets = new_count;
+    } else {
+        for (uint32_t i = 0; i < old_count; i++) {
+            dir_doc_t *doc = prv_inst.doc_buckets[i];
+            
+            while (doc != NULL) {
+                dir_doc_t *next = doc->next_in_bucket;
+                dir_doc_t **bucket = (dir_doc_t **)&buckets[doc->hash & (new_count - 1)];
+                
+                doc->next_in_bucket = *bucket;
+                *bucket = doc;
+                doc = next;
+            }
+        }
+        
+        free(prv_inst.doc_buckets);
+        prv_inst.doc_buckets = (dir_doc_t **)buckets;
+        prv_inst.num_doc_buckets = new_count;
+    }
+    
+    return true;
+}
+
+static bool prv_dir_index_append(dir_postings_t *postings, uint32_t id) {
+    if (postings->len + DIR_INDEX_MAX_VARINT_LEN > postings->capacity) {
+        uint32_t new_capacity = postings->capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = DIR_INDEX_INITIAL_POSTINGS;
+        }
+        
+        uint8_t *data = realloc(postings->data, new_capacity);
+        
+        if (data == NULL) {
+            return false;
+        }
+        
+        postings->data = data;
+        postings->capacity = new_capacity;
+    }
+    
+    uint32_t delta = id - postings->last;
+    
+    do {
+        uint8_t byte = delta & 0x7F;
+        delta >>= 7;
+        
+        postings->data[postings->len++] = byte | (delta > 0 ? 0x80 : 0);
+    } while (delta > 0);
+    
+    postings->last = id;
+    postings->count++;
+    
+    return true;
+}
+
+static bool prv_dir_index_rewrite(dir_postings_t *postings, uint32_t id, bool insert) {
+    dir_postings_t rewritten = { 0 };
+    dir_cursor_t cursor;
+    bool placed = false;
+    
+    prv_dir_index_cursor_init(&cursor, postings);
+    
+    for (; cursor.valid; prv_dir_index_cursor_next(&cursor)) {
+        if (cursor.current == id) {
+            // Already there, or the one being removed
+            if (insert) {
+                free(rewritten.data);
+                return true;
+            }
+            
+            placed = true;
+            continue;
+        }
+        
+        if (insert && !placed && id < cursor.current) {
+            if (!prv_dir_index_append(&rewritten, id)) {
+                free(rewritten.data);
+                return false;
+            }
+            
+            placed = true;
+        }
+        
+        if (!prv_dir_index_append(&rewritten, cursor.current)) {
+            free(rewritten.data);
+            return false;
+        }
+    }
+    
+    // Nothing to remove
+    if (!insert && !placed) {
+        free(rewritten.data);
+        return true;
+    }
+    
+    if (insert && !placed && !prv_dir_index_append(&rewritten, id)) {
+        free(rewritten.data);
+        return false;
+    }
+    
+    free(postings->data);
+    *postings = rewritten;
+    
+    return true;
+}
+
+static void prv_dir_index_cursor_init(dir_cursor_t *cursor, const dir_postings_t *postings) {
+    cursor->ptr = postings->data;
+    cursor->end = postings->data + postings->len;
+    cursor->current = 0;
+    cursor->valid = true;
+    
+    prv_dir_index_cursor_next(cursor);
+}
+
+static void prv_dir_index_cursor_next(dir_cursor_t *cursor) {
+    uint32_t delta = 0;
+    uint32_t shift = 0;
+    
+    if (cursor->ptr == NULL || cursor->ptr >= cursor->end) {
+        cursor->valid = false;
+        return;
+    }
+    
+    while (cursor->ptr < cursor->end) {
+        uint8_t byte = *cursor->ptr++;
+        
+        delta |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+        
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    
+    cursor->current += delta;
+}
+
+static void prv_dir_index_add_term(const char *text, uint8_t len, void *ctx) {
+    dir_doc_t *doc = ctx;
+    dir_term_t *term = prv_dir_index_term(text, len, true);
+    
+    if (term == NULL) {
+        LOG_ERR("Unable to index directory term. Out of memory?");
+        return;
+    }
+    
+    dir_postings_t *postings = &term->postings;
+    bool ret;
+    
+    if (postings->count == 0 || doc->id > postings->last) {
+        ret = prv_dir_index_append(postings, doc->id);
+    } else {
+        ret = prv_dir_index_rewrite(postings, doc->id, true);
+    }
+    
+    if (!ret) {
+        LOG_ERR("Unable to index directory term. Out of memory?");
+    }
+}
+
+static void prv_dir_index_remove_term(const char *text, uint8_t len, void *ctx) {
+    dir_doc_t *doc = ctx;
+    dir_term_t *term = prv_dir_index_term(text, len, false);
+    
+    if (term == NULL) {
+        return;
+    }
+    
+    if (!prv_dir_index_rewrite(&term->postings, doc->id, false)) {
+        LOG_ERR("Unable to unindex directory term. Out of memory?");
+        return;
+    }
+    
+    if (term->postings.count == 0) {
+        prv_dir_index_free_term(term);
+    }
+}
+
+static void prv_dir_index_query_term(const char *text, uint8_t len, void *ctx) {
+    dir_query_t *query = ctx;
+    
+    if (query->num_terms == DIR_INDEX_MAX_QUERY_TERMS) {
+        query->overflow = true;
+        return;
+    }
+    
+    dir_term_t *term = prv_dir_index_term(text, len, false);
+    
+    // A term nobody has means nobody matches, but keep checking the query
+    if (term == NULL) {
+        query->missing = true;
+        return;
+    }
+    
+    query->terms[query->num_terms++] = term;
+}
+
+static dir_doc_t *prv_dir_index_create_doc(const char *uin, uint32_t hash) {
+    if (prv_inst.num_docs >= prv_inst.num_doc_buckets && !prv_dir_index_grow(false) && prv_inst.num_doc_buckets == 0) {
+        return NULL;
+    }
+    
+    if (prv_inst.num_docs == prv_inst.docs_capacity) {
+        uint32_t new_capacity = prv_inst.docs_capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = DIR_INDEX_INITIAL_DOCS;
+        }
+        
+        dir_doc_t **docs = realloc(prv_inst.docs, new_capacity * sizeof(dir_doc_t *));
+        
+        if (docs == NULL) {
+            return NULL;
+        }
+        
+        prv_inst.docs = docs;
+        prv_inst.docs_capacity = new_capacity;
+    }
+    
+    dir_doc_t *doc = calloc(1, sizeof(dir_doc_t));
+    
+    if (doc == NULL) {
+        return NULL;
+    }
+    
+    doc->id = prv_inst.num_docs;
+    doc->hash = hash;
+    strcpy(doc->uin, uin);
+    
+    prv_inst.docs[prv_inst.num_docs++] = doc;
+    
+    dir_doc_t **bucket = &prv_inst.doc_buckets[hash & (prv_inst.num_doc_buckets - 1)];
+    doc->next_in_bucket = *bucket;
+    *bucket = doc;
+    
+    return doc;
+}
+
+static bool prv_dir_index_copy_blob(uint8_t **blob, uint16_t *blob_len, const uint8_t *data, size_t len) {
+    uint8_t *copy = NULL;
+    
+    if (len > 0) {
+        copy = malloc(len);
+        
+        if (copy == NULL) {
+            return false;
+        }
+        
+        memcpy(copy, data, len);
+    }
+    
+    free(*blob);
+    *blob = copy;
+    *blob_len = len;
+    
+    return true;
+}
+
+static void prv_dir_index_sync_entry(void *ctx, const dir_entry_t *entry) {
+    uint32_t *count = ctx;
+    
+    (*count)++;
+    
+    if (entry->seq > prv_inst.last_seq) {
+        prv_inst.last_seq = entry->seq;
+    }
+    
+    if (!dir_index_update(entry)) {
+        LOG_WARN("Skipping directory entry of %s.", entry->uin);
+    }
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+bool dir_index_count_tlvs(const uint8_t *tlvs, size_t len, uint16_t *count) {
+    size_t idx = 0;
+    uint32_t num = 0;
+    
+    while (idx < len) {
+        if (idx + sizeof(tlv_header_t) > len) {
+            return false;
+        }
+        
+        const tlv_header_t *header = (const tlv_header_t *)&tlvs[idx];
+        idx += sizeof(tlv_header_t) + ntohs(header->length);
+        
+        if (idx > len || ++num > UINT16_MAX) {
+            return false;
+        }
+    }
+    
+    *count = num;
+    
+    return true;
+}
+
+bool dir_index_update(const dir_entry_t *entry) {
+    if (entry == NULL || entry->uin == NULL || strlen(entry->uin) > SCREENNAME_MAX_LEN) {
+        return false;
+    }
+    
+    uint16_t info_count = 0;
+    uint16_t keywords_count = 0;
+    
+    if (
+        entry->info_len > DIR_MAX_INFO_LEN ||
+        entry->keywords_len > DIR_MAX_INFO_LEN ||
+        !dir_index_count_tlvs(entry->info, entry->info_len, &info_count) ||
+        !dir_index_count_tlvs(entry->keywords, entry->keywords_len, &keywords_count)
+    ) {
+        return false;
+    }
+    
+    dir_doc_t *doc = (dir_doc_t *)dir_index_find(entry->uin);
+    
+    if (doc == NULL) {
+        doc = prv_dir_index_create_doc(entry->uin, prv_dir_index_hash(entry->uin, strlen(entry->uin)));
+        
+        if (doc == NULL) {
+            LOG_ERR("Unable to add directory entry. Out of memory?");
+            return false;
+        }
+    }
+    
+    // Our own stores come back with the next sync, nothing to redo for those
+    if (
+        doc->info_len == entry->info_len &&
+        doc->keywords_len == entry->keywords_len &&
+        (entry->info_len == 0 || memcmp(doc->info, entry->info, entry->info_len) == 0) &&
+        (entry->keywords_len == 0 || memcmp(doc->keywords, entry->keywords, entry->keywords_len) == 0)
+    ) {
+        return true;
+    }
+    
+    prv_dir_index_for_each_term(doc->info, doc->info_len, prv_dir_index_remove_term, doc);
+    prv_dir_index_for_each_term(doc->keywords, doc->keywords_len, prv_dir_index_remove_term, doc);
+    
+    bool ret = prv_dir_index_copy_blob(&doc->info, &doc->info_len, entry->info, entry->info_len) &&
+               prv_dir_index_copy_blob(&doc->keywords, &doc->keywords_len, entry->keywords, entry->keywords_len);
+    
+    if (!ret) {
+        LOG_ERR("Unable to copy directory entry. Out of memory?");
+    }
+    
+    // Whatever the doc holds now is what gets indexed
+    dir_index_count_tlvs(doc->info, doc->info_len, &doc->info_count);
+    dir_index_count_tlvs(doc->keywords, doc->keywords_len, &doc->keywords_count);
+    
+    prv_dir_index_for_each_term(doc->info, doc->info_len, prv_dir_index_add_term, doc);
+    prv_dir_index_for_each_term(doc->keywords, doc->keywords_len, prv_dir_index_add_term, doc);
+    
+    return ret;
+}
+
+const dir_doc_t *dir_index_find(const char *uin) {
+    if (uin == NULL || prv_inst.num_doc_buckets == 0) {
+        return NULL;
+    }
+    
+    uint32_t hash = prv_dir_index_hash(uin, strlen(uin));
+    dir_doc_t *doc = prv_inst.doc_buckets[hash & (prv_inst.num_doc_buckets - 1)];
+    
+    for (; doc != NULL; doc = doc->next_in_bucket) {
+        if (doc->hash == hash && strcmp(doc->uin, uin) == 0) {
+            return doc;
+        }
+    }
+    
+    return NULL;
+}
+
+bool dir_index_search(const uint8_t *tlvs, size_t len, const dir_doc_t **results, uint32_t *num_results) {
+    uint16_t count = 0;
+    
+    if (tlvs == NULL || results == NULL || num_results == NULL || !dir_index_count_tlvs(tlvs, len, &count)) {
+        return false;
+    }
+    
+    dir_query_t query = { 0 };
+    
+    prv_dir_index_for_each_term(tlvs, len, prv_dir_index_query_term, &query);
+    
+    if (query.overflow || (query.num_terms == 0 && !query.missing)) {
+        return false;
+    }
+    
+    uint32_t max_results = *num_results;
+    *num_results = 0;
+    
+    if (query.missing) {
+        return true;
+    }
+    
+    // Drive the intersection from the shortest list
+    for (uint32_t i = 1; i < query.num_terms; i++) {
+        dir_term_t *term = query.terms[i];
+        uint32_t j = i;
+        
+        for (; j > 0 && query.terms[j - 1]->postings.count > term->postings.count; j--) {
+            query.terms[j] = query.terms[j - 1];
+        }
+        
+        query.terms[j] = term;
+    }
+    
+    dir_cursor_t cursors[DIR_INDEX_MAX_QUERY_TERMS];
+    
+    for (uint32_t i = 0; i < query.num_terms; i++) {
+        prv_dir_index_cursor_init(&cursors[i], &query.terms[i]->postings);
+    }
+    
+    while (cursors[0].valid && *num_results < max_results) {
+        uint32_t target = cursors[0].current;
+        bool matched = true;
+        
+        for (uint32_t i = 1; i < query.num_terms; i++) {
+            while (cursors[i].valid && cursors[i].current < target) {
+                prv_dir_index_cursor_next(&cursors[i]);
+            }
+            
+            if (!cursors[i].valid) {
+                return true;
+            }
+            
+            // Skip the shortest list ahead to where this one is
+            if (cursors[i].current > target) {
+                while (cursors[0].valid && cursors[0].current < cursors[i].current) {
+                    prv_dir_index_cursor_next(&cursors[0]);
+                }
+                
+                matched = false;
+                break;
+            }
+        }
+        
+        if (matched) {
+            results[(*num_results)++] = prv_inst.docs[target];
+            prv_dir_index_cursor_next(&cursors[0]);
+        }
+    }
+    
+    return true;
+}
+
+void dir_index_sync(uint64_t now_ms) {
+    if (prv_inst.caught_up && (now_ms - prv_inst.last_sync_ms) < config_get()->directory_sync_interval_ms) {
+        return;
+    }
+    
+    uint32_t count = 0;
+    
+    prv_inst.last_sync_ms = now_ms;
+    
+    if (backend_fetch_dir_entries(prv_inst.last_seq, DIR_INDEX_SYNC_BATCH, prv_dir_index_sync_entry, &count) != BACKEND_RET_SUCCESS) {
+        prv_inst.caught_up = true;
+        return;
+    }
+    
+    // A full batch likely means more are waiting, read them next pass
+    prv_inst.caught_up = (count < DIR_INDEX_SYNC_BATCH);
+}
\ No newline at end of file
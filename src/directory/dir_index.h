@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file dir_index.h
+ * @author Evan Stoddard
+ * @brief In memory directory with an inverted index for searches
+ */
+
+#ifndef DIR_INDEX_H_
+#define DIR_INDEX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model/model_types.h"
+#include "model/screenname.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Directory entry of one user
+ * 
+ * Info and keywords are kept as the TLV blocks the user set, so results
+ * can be sent without encoding anything.
+ */
+typedef struct dir_doc_t {
+    uint32_t id;
+    uint32_t hash;
+    struct dir_doc_t *next_in_bucket;
+    
+    char uin[SCREENNAME_MAX_LEN + 1];
+    
+    uint8_t *info;
+    uint16_t info_len;
+    uint16_t info_count;
+    
+    uint8_t *keywords;
+    uint16_t keywords_len;
+    uint16_t keywords_count;
+} dir_doc_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Count TLVs in block, checking it is well formed
+ * 
+ * @param tlvs TLV block
+ * @param len Length of block
+ * @param count Set to number of TLVs
+ * @return true Block well formed
+ * @return false Block malformed or holds too many TLVs
+ */
+bool dir_index_count_tlvs(const uint8_t *tlvs, size_t len, uint16_t *count);
+
+/**
+ * @brief Add or replace entry of user, reindexing only if it changed
+ * 
+ * @param entry Entry (normalized screen name, sequence number may be 0)
+ * @return true Entry indexed
+ * @return false Entry malformed or out of memory
+ */
+bool dir_index_update(const dir_entry_t *entry);
+
+/**
+ * @brief Find entry of user
+ * 
+ * @param uin Normalized screen name
+ * @return const dir_doc_t* Entry (NULL if user has none)
+ */
+const dir_doc_t *dir_index_find(const char *uin);
+
+/**
+ * @brief Find users matching every name, city and interest term in query
+ * 
+ * @param tlvs Query TLV block
+ * @param len Length of query
+ * @param results Set to matching entries
+ * @param num_results Room in results, set to number of matches
+ * @return true Query searched
+ * @return false Query malformed or had nothing to search for
+ */
+bool dir_index_search(const uint8_t *tlvs, size_t len, const dir_doc_t **results, uint32_t *num_results);
+
+/**
+ * @brief Pick up entries stored since the last sync
+ * 
+ * Reads a bounded batch per call, so a large directory is loaded over
+ * several loop passes. Once caught up, the backend is only asked again
+ * after the sync interval.
+ * 
+ * @param now_ms Current monotonic time
+ */
+void dir_index_sync(uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* DIR_INDEX_H_ */
\ No newline at end of file
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file feedbag_index.c
+ * @author Evan Stoddard
+ * @brief Parsed view of the users named by a feedbag
+ */
+
+#include "feedbag_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "feedbag/feedbag_store.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define FEEDBAG_INDEX_INITIAL_REFS 16U
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get users counted for item class
+ * 
+ * @param index Index
+ * @param class_id Item class
+ * @return feedbag_refs_t* Users (NULL if class doesn't name users)
+ */
+static feedbag_refs_t *prv_feedbag_index_refs(feedbag_index_t *index, uint16_t class_id);
+
+/**
+ * @brief Position of user in sorted refs (or where it would go)
+ * 
+ * @param refs Users
+ * @param id User
+ * @return uint32_t Position
+ */
+static uint32_t prv_feedbag_index_lower_bound(const feedbag_refs_t *refs, screenname_id_t id);
+
+/**
+ * @brief Record buddy gained, cancelling out an earlier loss
+ * 
+ * @param index Index
+ * @param id Buddy
+ */
+static void prv_feedbag_index_gained(feedbag_index_t *index, screenname_id_t id);
+
+/**
+ * @brief Record buddy lost, cancelling out an earlier gain
+ * 
+ * @param index Index
+ * @param id Buddy
+ */
+static void prv_feedbag_index_lost(feedbag_index_t *index, screenname_id_t id);
+
+/**
+ * @brief Release every ID in set and empty it
+ * 
+ * @param set Set
+ */
+static void prv_feedbag_index_release_set(buddy_set_t *set);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static feedbag_refs_t *prv_feedbag_index_refs(feedbag_index_t *index, uint16_t class_id) {
+    switch (class_id) {
+    case FEEDBAG_CLASS_BUDDY:
+        return &index->buddies;
+    case FEEDBAG_CLASS_PERMIT:
+        return &index->permit;
+    case FEEDBAG_CLASS_DENY:
+        return &index->deny;
+    default:
+        return NULL;
+    }
+}
+
+static uint32_t prv_feedbag_index_lower_bound(const feedbag_refs_t *refs, screenname_id_t id) {
+    uint32_t low = 0;
+    uint32_t high = refs->count;
+    
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        
+        if (refs->refs[mid].id < id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    return low;
+}
+
+static void prv_feedbag_index_gained(feedbag_index_t *index, screenname_id_t id) {
+    if (buddy_set_remove(&index->watch_removed, id)) {
+        screenname_release(id);
+        return;
+    }
+    
+    if (buddy_set_add(&index->watch_added, id)) {
+        screenname_retain(id);
+    }
+}
+
+static void prv_feedbag_index_lost(feedbag_index_t *index, screenname_id_t id) {
+    if (buddy_set_remove(&index->watch_added, id)) {
+        screenname_release(id);
+        return;
+    }
+    
+    if (buddy_set_add(&index->watch_removed, id)) {
+        screenname_retain(id);
+    }
+}
+
+static void prv_feedbag_index_release_set(buddy_set_t *set) {
+    buddy_set_iter_t iter;
+    screenname_id_t id;
+    
+    buddy_set_iter_init(&iter, set);
+    
+    while (buddy_set_iter_next(&iter, &id)) {
+        screenname_release(id);
+    }
+    
+    buddy_set_deinit(set);
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void feedbag_index_deinit(feedbag_index_t *index) {
+    if (index == NULL) {
+        return;
+    }
+    
+    feedbag_refs_t *lists[] = { &index->buddies, &index->permit, &index->deny };
+    
+    for (uint32_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+        for (uint32_t j = 0; j < lists[i]->count; j++) {
+            screenname_release(lists[i]->refs[j].id);
+        }
+        
+        free(lists[i]->refs);
+    }
+    
+    prv_feedbag_index_release_set(&index->watch_added);
+    prv_feedbag_index_release_set(&index->watch_removed);
+    
+    memset(index, 0, sizeof(feedbag_index_t));
+}
+
+void feedbag_index_add(feedbag_index_t *index, const struct feedbag_item_t *item) {
+    feedbag_refs_t *refs = prv_feedbag_index_refs(index, item->class_id);
+    
+    if (refs == NULL) {
+        return;
+    }
+    
+    // Items may carry names that aren't valid screen names, those name nobody
+    screenname_id_t id = screenname_intern(item->name, item->name_len);
+    
+    if (id == SCREENNAME_ID_INVALID) {
+        return;
+    }
+    
+    uint32_t idx = prv_feedbag_index_lower_bound(refs, id);
+    
+    if (idx < refs->count && refs->refs[idx].id == id) {
+        refs->refs[idx].refs++;
+        screenname_release(id);
+        return;
+    }
+    
+    if (refs->count == refs->capacity) {
+        uint32_t new_capacity = refs->capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = FEEDBAG_INDEX_INITIAL_REFS;
+        }
+        
+        feedbag_ref_t *new_refs = realloc(refs->refs, new_capacity * sizeof(feedbag_ref_t));
+        
+        if (new_refs == NULL) {
+            LOG_ERR("Unable to index feedbag item. Out of memory?");
+            screenname_release(id);
+            return;
+        }
+        
+        refs->refs = new_refs;
+        refs->capacity = new_capacity;
+    }
+    
+    // Index keeps the reference from interning
+    memmove(&refs->refs[idx + 1], &refs->refs[idx], (refs->count - idx) * sizeof(feedbag_ref_t));
+    refs->refs[idx].id = id;
+    refs->refs[idx].refs = 1;
+    refs->count++;
+    
+    if (refs == &index->buddies) {
+        prv_feedbag_index_gained(index, id);
+    }
+}
+
+void feedbag_index_remove(feedbag_index_t *index, const struct feedbag_item_t *item) {
+    feedbag_refs_t *refs = prv_feedbag_index_refs(index, item->class_id);
+    
+    if (refs == NULL) {
+        return;
+    }
+    
+    screenname_id_t id = screenname_find(item->name, item->name_len);
+    
+    if (id == SCREENNAME_ID_INVALID) {
+        return;
+    }
+    
+    uint32_t idx = prv_feedbag_index_lower_bound(refs, id);
+    
+    if (idx == refs->count || refs->refs[idx].id != id) {
+        return;
+    }
+    
+    if (--refs->refs[idx].refs > 0) {
+        return;
+    }
+    
+    refs->count--;
+    memmove(&refs->refs[idx], &refs->refs[idx + 1], (refs->count - idx) * sizeof(feedbag_ref_t));
+    
+    if (refs == &index->buddies) {
+        prv_feedbag_index_lost(index, id);
+    }
+    
+    screenname_release(id);
+}
+
+void feedbag_index_clear_delta(feedbag_index_t *index) {
+    prv_feedbag_index_release_set(&index->watch_added);
+    prv_feedbag_index_release_set(&index->watch_removed);
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file feedbag_index.h
+ * @author Evan Stoddard
+ * @brief Parsed view of the users named by a feedbag
+ */
+
+#ifndef FEEDBAG_INDEX_H_
+#define FEEDBAG_INDEX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "model/screenname.h"
+#include "model/buddy_set.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+struct feedbag_item_t;
+
+/**
+ * @brief User named by one or more items
+ * 
+ */
+typedef struct feedbag_ref_t {
+    screenname_id_t id;
+    uint32_t refs;
+} feedbag_ref_t;
+
+/**
+ * @brief Users named by items of one class, sorted by ID
+ * 
+ */
+typedef struct feedbag_refs_t {
+    feedbag_ref_t *refs;
+    uint32_t count;
+    uint32_t capacity;
+} feedbag_refs_t;
+
+/**
+ * @brief Feedbag index typedef
+ * 
+ * The same buddy may sit in several groups, so every user is counted and
+ * only the first and last item naming a buddy change what is watched.
+ * Those changes pile up in the delta sets until they are applied.
+ * A zeroed index is a valid empty index.
+ */
+typedef struct feedbag_index_t {
+    feedbag_refs_t buddies;
+    feedbag_refs_t permit;
+    feedbag_refs_t deny;
+    
+    // Buddies gained and lost since the delta was last cleared (each retained)
+    buddy_set_t watch_added;
+    buddy_set_t watch_removed;
+} feedbag_index_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Release everything held by index
+ * 
+ * @param index Index
+ */
+void feedbag_index_deinit(feedbag_index_t *index);
+
+/**
+ * @brief Count item naming a user
+ * 
+ * @param index Index
+ * @param item Item (items of other classes are ignored)
+ */
+void feedbag_index_add(feedbag_index_t *index, const struct feedbag_item_t *item);
+
+/**
+ * @brief Uncount item naming a user
+ * 
+ * @param index Index
+ * @param item Item (items of other classes are ignored)
+ */
+void feedbag_index_remove(feedbag_index_t *index, const struct feedbag_item_t *item);
+
+/**
+ * @brief Forget buddies gained and lost so far
+ * 
+ * @param index Index
+ */
+void feedbag_index_clear_delta(feedbag_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* FEEDBAG_INDEX_H_ */
\ No newline at end of file
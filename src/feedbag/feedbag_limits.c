@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file feedbag_limits.c
+ * @author Evan Stoddard
+ * @brief Feedbag limits advertised to clients and enforced on edits
+ */
+
+#include "feedbag_limits.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "config/config.h"
+#include "oscar/feedbag_types.h"
+#include "oscar/tlv.h"
+#include "oscar/tlv_encoder.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief FEEDBAG_RIGHTS_REPLY TLVs
+ * 
+ */
+typedef struct feedbag_rights_wire_t {
+    tlv_uint16_t max_class_attrs;
+    tlv_uint16_t max_item_attrs;
+    tlv_header_t max_items_by_class_header;
+    uint16_t max_items_by_class[FEEDBAG_NUM_CLASSES];
+    tlv_uint16_t max_client_items;
+    tlv_uint16_t max_item_name_len;
+    tlv_uint16_t max_recent_buddies;
+    tlv_uint16_t max_buddies_per_group;
+} __attribute__((packed)) feedbag_rights_wire_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static struct {
+    bool initialized;
+    feedbag_limits_t limits;
+    feedbag_rights_wire_t rights;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Build limits and their encoding from configuration
+ * 
+ */
+static void prv_feedbag_limits_init(void);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static void prv_feedbag_limits_init(void) {
+    config_t *config = config_get();
+    feedbag_limits_t *limits = &prv_inst.limits;
+    
+    limits->max_items = config->feedbag_max_items;
+    limits->max_name_len = config->feedbag_max_name_len;
+    limits->max_attrs_len = config->feedbag_max_attrs_len;
+    limits->max_buddies_per_group = config->feedbag_max_buddies_per_group;
+    limits->max_recent_buddies = config->feedbag_max_recent_buddies;
+    
+    // Classes without a key of their own share one limit
+    for (uint32_t i = 0; i < FEEDBAG_NUM_CLASSES; i++) {
+        limits->max_items_by_class[i] = config->feedbag_max_class_items;
+    }
+    
+    limits->max_items_by_class[FEEDBAG_CLASS_BUDDY] = config->feedbag_max_buddies;
+    limits->max_items_by_class[FEEDBAG_CLASS_GROUP] = config->feedbag_max_groups;
+    limits->max_items_by_class[FEEDBAG_CLASS_PERMIT] = config->feedbag_max_permits;
+    limits->max_items_by_class[FEEDBAG_CLASS_DENY] = config->feedbag_max_denies;
+    
+    feedbag_rights_wire_t *rights = &prv_inst.rights;
+    
+    rights->max_class_attrs = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_CLASS_ATTRS, limits->max_attrs_len);
+    rights->max_item_attrs = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_ITEM_ATTRS, limits->max_attrs_len);
+    rights->max_items_by_class_header.tag = htons(FEEDBAG_RIGHTS_MAX_ITEMS_BY_CLASS);
+    rights->max_items_by_class_header.length = htons(sizeof(rights->max_items_by_class));
+    
+    for (uint32_t i = 0; i < FEEDBAG_NUM_CLASSES; i++) {
+        rights->max_items_by_class[i] = htons(limits->max_items_by_class[i]);
+    }
+    
+    rights->max_client_items = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_CLIENT_ITEMS, limits->max_items);
+    rights->max_item_name_len = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_ITEM_NAME_LEN, limits->max_name_len);
+    rights->max_recent_buddies = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_RECENT_BUDDIES, limits->max_recent_buddies);
+    rights->max_buddies_per_group = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_BUDDIES_PER_GROUP, limits->max_buddies_per_group);
+    
+    prv_inst.initialized = true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+const feedbag_limits_t *feedbag_limits_get(void) {
+    if (!prv_inst.initialized) {
+        prv_feedbag_limits_init();
+    }
+    
+    return &prv_inst.limits;
+}
+
+const void *feedbag_limits_rights(size_t *len) {
+    if (!prv_inst.initialized) {
+        prv_feedbag_limits_init();
+    }
+    
+    *len = sizeof(feedbag_rights_wire_t);
+    
+    return &prv_inst.rights;
+}
\ No newline at end of file
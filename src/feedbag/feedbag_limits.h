@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file feedbag_limits.h
+ * @author Evan Stoddard
+ * @brief Feedbag limits advertised to clients and enforced on edits
+ */
+
+#ifndef FEEDBAG_LIMITS_H_
+#define FEEDBAG_LIMITS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Item classes with their own limit (FEEDBAG_CLASS_BUDDY to FEEDBAG_CLASS_BART)
+ * 
+ */
+#define FEEDBAG_NUM_CLASSES 0x15U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Feedbag limits typedef
+ * 
+ */
+typedef struct feedbag_limits_t {
+    uint16_t max_items;
+    uint16_t max_items_by_class[FEEDBAG_NUM_CLASSES];
+    uint16_t max_name_len;
+    uint16_t max_attrs_len;
+    uint16_t max_buddies_per_group;
+    uint16_t max_recent_buddies;
+} feedbag_limits_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get limits, built from configuration on first use
+ * 
+ * @return const feedbag_limits_t* Limits
+ */
+const feedbag_limits_t *feedbag_limits_get(void);
+
+/**
+ * @brief Get limits encoded as FEEDBAG_RIGHTS_REPLY TLVs, encoded on first use
+ * 
+ * @param len Pointer to write length of TLVs to
+ * @return const void* TLVs
+ */
+const void *feedbag_limits_rights(size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* FEEDBAG_LIMITS_H_ */
\ No newline at end of file
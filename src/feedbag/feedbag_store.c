@@ -0,0 +1,476 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file feedbag_store.c
+ * @author Evan Stoddard
+ * @brief Server stored feedbag of a user
+ */
+
+#include "feedbag_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "backends/backend.h"
+#include "utils/timestamp.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define FEEDBAG_STORE_INITIAL_CAPACITY 256U
+
+#define FEEDBAG_STORE_INITIAL_STAGED 8U
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Find stored item by group and item id
+ * 
+ * @param store Store
+ * @param group_id Group ID
+ * @param item_id Item ID
+ * @param found Stored item
+ * @return true Item found
+ * @return false No such item
+ */
+static bool prv_feedbag_store_find(const feedbag_store_t *store, uint16_t group_id, uint16_t item_id, feedbag_item_t *found);
+
+/**
+ * @brief Count buddies in group
+ * 
+ * @param store Store
+ * @param group_id Group ID
+ * @return uint32_t Number of buddies
+ */
+static uint32_t prv_feedbag_store_group_buddies(const feedbag_store_t *store, uint16_t group_id);
+
+/**
+ * @brief Check item against limits that don't depend on what is stored
+ * 
+ * @param limits Limits
+ * @param item Item
+ * @return feedbag_status_t FEEDBAG_STATUS_SUCCESS if within limits
+ */
+static feedbag_status_t prv_feedbag_store_check_item(const feedbag_limits_t *limits, const feedbag_item_t *item);
+
+/**
+ * @brief Count item of class
+ * 
+ * @param store Store
+ * @param class_id Item class
+ * @param delta Change in count
+ */
+static void prv_feedbag_store_count_class(feedbag_store_t *store, uint16_t class_id, int delta);
+
+/**
+ * @brief Replace range of stored bytes
+ * 
+ * @param store Store
+ * @param offset Offset of range
+ * @param len Length of range
+ * @param data Replacement (NULL to only remove)
+ * @param data_len Length of replacement
+ * @return true Range replaced
+ * @return false Out of memory
+ */
+static bool prv_feedbag_store_splice(feedbag_store_t *store, size_t offset, size_t len, const uint8_t *data, size_t data_len);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static bool prv_feedbag_store_find(const feedbag_store_t *store, uint16_t group_id, uint16_t item_id, feedbag_item_t *found) {
+    size_t offset = 0;
+    
+    while (feedbag_store_next(store, &offset, found)) {
+        if (found->group_id == group_id && found->item_id == item_id) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static uint32_t prv_feedbag_store_group_buddies(const feedbag_store_t *store, uint16_t group_id) {
+    size_t offset = 0;
+    feedbag_item_t item;
+    uint32_t count = 0;
+    
+    while (feedbag_store_next(store, &offset, &item)) {
+        if (item.class_id == FEEDBAG_CLASS_BUDDY && item.group_id == group_id) {
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+static feedbag_status_t prv_feedbag_store_check_item(const feedbag_limits_t *limits, const feedbag_item_t *item) {
+    if (item->name_len > limits->max_name_len || item->attrs_len > limits->max_attrs_len) {
+        return FEEDBAG_STATUS_BAD_REQUEST;
+    }
+    
+    return FEEDBAG_STATUS_SUCCESS;
+}
+
+static void prv_feedbag_store_count_class(feedbag_store_t *store, uint16_t class_id, int delta) {
+    if (class_id < FEEDBAG_NUM_CLASSES) {
+        store->class_counts[class_id] += delta;
+    }
+}
+
+static bool prv_feedbag_store_splice(feedbag_store_t *store, size_t offset, size_t len, const uint8_t *data, size_t data_len) {
+    size_t new_len = store->blob.items_len - len + data_len;
+    
+    if (new_len > store->capacity) {
+        size_t new_capacity = store->capacity * 2;
+        
+        if (new_capacity < FEEDBAG_STORE_INITIAL_CAPACITY) {
+            new_capacity = FEEDBAG_STORE_INITIAL_CAPACITY;
+        }
+        
+        while (new_capacity < new_len) {
+            new_capacity *= 2;
+        }
+        
+        uint8_t *items = realloc(store->blob.items, new_capacity);
+        
+        if (items == NULL) {
+            return false;
+        }
+        
+        store->blob.items = items;
+        store->capacity = new_capacity;
+    }
+    
+    uint8_t *tail = store->blob.items + offset + len;
+    size_t tail_len = store->blob.items_len - offset - len;
+    
+    memmove(store->blob.items + offset + data_len, tail, tail_len);
+    
+    if (data_len > 0) {
+        memcpy(store->blob.items + offset, data, data_len);
+    }
+    
+    store->blob.items_len = new_len;
+    
+    return true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+bool feedbag_item_parse(const uint8_t *data, size_t len, feedbag_item_t *item) {
+    if (data == NULL || item == NULL || len < sizeof(uint16_t)) {
+        return false;
+    }
+    
+    uint16_t name_len = ntohs(*(uint16_t *)data);
+    size_t header_idx = sizeof(uint16_t) + name_len;
+    
+    if (header_idx + sizeof(feedbag_item_header_t) > len) {
+        return false;
+    }
+    
+    feedbag_item_header_t header;
+    memcpy(&header, &data[header_idx], sizeof(feedbag_item_header_t));
+    
+    size_t attrs_idx = header_idx + sizeof(feedbag_item_header_t);
+    uint16_t attrs_len = ntohs(header.attrs_len);
+    
+    if (attrs_idx + attrs_len > len) {
+        return false;
+    }
+    
+    item->name = (const char *)&data[sizeof(uint16_t)];
+    item->name_len = name_len;
+    item->group_id = ntohs(header.group_id);
+    item->item_id = ntohs(header.item_id);
+    item->class_id = ntohs(header.class_id);
+    item->attrs = &data[attrs_idx];
+    item->attrs_len = attrs_len;
+    item->wire = data;
+    item->wire_len = attrs_idx + attrs_len;
+    
+    return true;
+}
+
+feedbag_store_t *feedbag_store_load(screenname_id_t owner) {
+    feedbag_store_t *store = malloc(sizeof(feedbag_store_t));
+    
+    if (store == NULL) {
+        return NULL;
+    }
+    
+    memset(store, 0, sizeof(feedbag_store_t));
+    
+    backend_ret_t ret = backend_fetch_feedbag(screenname_str(owner), &store->blob);
+    
+    if (ret != BACKEND_RET_SUCCESS && ret != BACKEND_RET_NO_RESULT) {
+        LOG_ERR("Failed to fetch feedbag. (%d)", ret);
+        free(store);
+        return NULL;
+    }
+    
+    // Nothing stored yet is an empty feedbag at version 0
+    if (ret == BACKEND_RET_NO_RESULT) {
+        memset(&store->blob, 0, sizeof(feedbag_blob_t));
+    }
+    
+    screenname_retain(owner);
+    store->owner = owner;
+    store->capacity = store->blob.items_len;
+    
+    size_t offset = 0;
+    feedbag_item_t item;
+    
+    while (feedbag_store_next(store, &offset, &item)) {
+        feedbag_index_add(&store->index, &item);
+        prv_feedbag_store_count_class(store, item.class_id, 1);
+    }
+    
+    // Stored buddies are what the session already watches, if anything
+    feedbag_index_clear_delta(&store->index);
+    
+    return store;
+}
+
+bool feedbag_store_info(screenname_id_t owner, uint32_t *modified, uint16_t *num_items) {
+    if (modified == NULL || num_items == NULL) {
+        return false;
+    }
+    
+    feedbag_blob_t info;
+    memset(&info, 0, sizeof(feedbag_blob_t));
+    
+    backend_ret_t ret = backend_fetch_feedbag_info(screenname_str(owner), &info);
+    
+    if (ret != BACKEND_RET_SUCCESS && ret != BACKEND_RET_NO_RESULT) {
+        LOG_ERR("Failed to fetch feedbag info. (%d)", ret);
+        return false;
+    }
+    
+    *modified = info.modified;
+    *num_items = info.num_items;
+    
+    return true;
+}
+
+void feedbag_store_free(feedbag_store_t *store) {
+    if (store == NULL) {
+        return;
+    }
+    
+    screenname_release(store->owner);
+    feedbag_index_deinit(&store->index);
+    free(store->blob.items);
+    free(store->staged);
+    free(store->staged_statuses);
+    free(store);
+}
+
+bool feedbag_store_next(const feedbag_store_t *store, size_t *offset, feedbag_item_t *item) {
+    if (store == NULL || offset == NULL || *offset >= store->blob.items_len) {
+        return false;
+    }
+    
+    if (feedbag_item_parse(store->blob.items + *offset, store->blob.items_len - *offset, item) == false) {
+        LOG_ERR("Stored feedbag truncated.");
+        return false;
+    }
+    
+    *offset += item->wire_len;
+    
+    return true;
+}
+
+feedbag_status_t feedbag_store_apply(feedbag_store_t *store, feedbag_op_t op, const feedbag_item_t *item) {
+    if (store == NULL || item == NULL) {
+        return FEEDBAG_STATUS_BAD_REQUEST;
+    }
+    
+    const feedbag_limits_t *limits = feedbag_limits_get();
+    
+    feedbag_item_t stored;
+    bool exists = prv_feedbag_store_find(store, item->group_id, item->item_id, &stored);
+    size_t stored_idx = exists ? (size_t)(stored.wire - store->blob.items) : 0;
+    
+    // Class limits only apply to items that would add to the class
+    bool adds_to_class = (op == FEEDBAG_OP_INSERT || (exists && stored.class_id != item->class_id));
+    bool class_full = (item->class_id < FEEDBAG_NUM_CLASSES && store->class_counts[item->class_id] >= limits->max_items_by_class[item->class_id]);
+    feedbag_status_t status = FEEDBAG_STATUS_SUCCESS;
+    
+    switch (op) {
+    case FEEDBAG_OP_INSERT:
+        if (exists) {
+            return FEEDBAG_STATUS_ALREADY_EXISTS;
+        }
+        
+        if ((status = prv_feedbag_store_check_item(limits, item)) != FEEDBAG_STATUS_SUCCESS) {
+            return status;
+        }
+        
+        if (store->blob.num_items >= limits->max_items || class_full) {
+            return FEEDBAG_STATUS_OVER_ROW_LIMIT;
+        }
+        
+        if (
+            item->class_id == FEEDBAG_CLASS_BUDDY &&
+            prv_feedbag_store_group_buddies(store, item->group_id) >= limits->max_buddies_per_group
+        ) {
+            return FEEDBAG_STATUS_OVER_ROW_LIMIT;
+        }
+        
+        if (prv_feedbag_store_splice(store, store->blob.items_len, 0, item->wire, item->wire_len) == false) {
+            return FEEDBAG_STATUS_DB_ERROR;
+        }
+        
+        feedbag_index_add(&store->index, item);
+        prv_feedbag_store_count_class(store, item->class_id, 1);
+        store->blob.num_items++;
+        break;
+    case FEEDBAG_OP_UPDATE:
+        if (exists == false) {
+            return FEEDBAG_STATUS_NOT_FOUND;
+        }
+        
+        if ((status = prv_feedbag_store_check_item(limits, item)) != FEEDBAG_STATUS_SUCCESS) {
+            return status;
+        }
+        
+        if (adds_to_class && class_full) {
+            return FEEDBAG_STATUS_OVER_ROW_LIMIT;
+        }
+        
+        // Counted before the stored bytes move, so a buddy kept by name is never lost in between
+        feedbag_index_add(&store->index, item);
+        feedbag_index_remove(&store->index, &stored);
+        
+        if (prv_feedbag_store_splice(store, stored_idx, stored.wire_len, item->wire, item->wire_len) == false) {
+            feedbag_index_add(&store->index, &stored);
+            feedbag_index_remove(&store->index, item);
+            return FEEDBAG_STATUS_DB_ERROR;
+        }
+        
+        prv_feedbag_store_count_class(store, stored.class_id, -1);
+        prv_feedbag_store_count_class(store, item->class_id, 1);
+        break;
+    case FEEDBAG_OP_DELETE:
+        if (exists == false) {
+            return FEEDBAG_STATUS_NOT_FOUND;
+        }
+        
+        feedbag_index_remove(&store->index, &stored);
+        prv_feedbag_store_count_class(store, stored.class_id, -1);
+        prv_feedbag_store_splice(store, stored_idx, stored.wire_len, NULL, 0);
+        store->blob.num_items--;
+        break;
+    default:
+        return FEEDBAG_STATUS_BAD_REQUEST;
+    }
+    
+    // Stamp must change on every edit, clients compare it to skip the list
+    uint32_t now = timestamp_unix();
+    store->blob.modified = (now > store->blob.modified) ? now : store->blob.modified + 1;
+    store->dirty = true;
+    
+    return FEEDBAG_STATUS_SUCCESS;
+}
+
+bool feedbag_store_stage(feedbag_store_t *store, uint32_t request_id, const uint16_t *statuses, uint32_t count) {
+    if (store == NULL || statuses == NULL) {
+        return false;
+    }
+    
+    if (store->num_staged == store->staged_capacity) {
+        uint32_t new_capacity = store->staged_capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = FEEDBAG_STORE_INITIAL_STAGED;
+        }
+        
+        feedbag_staged_t *staged = realloc(store->staged, new_capacity * sizeof(feedbag_staged_t));
+        
+        if (staged == NULL) {
+            return false;
+        }
+        
+        store->staged = staged;
+        store->staged_capacity = new_capacity;
+    }
+    
+    if (store->num_staged_statuses + count > store->staged_statuses_capacity) {
+        uint32_t new_capacity = store->staged_statuses_capacity * 2;
+        
+        if (new_capacity < FEEDBAG_STORE_INITIAL_STAGED) {
+            new_capacity = FEEDBAG_STORE_INITIAL_STAGED;
+        }
+        
+        while (new_capacity < store->num_staged_statuses + count) {
+            new_capacity *= 2;
+        }
+        
+        uint16_t *staged_statuses = realloc(store->staged_statuses, new_capacity * sizeof(uint16_t));
+        
+        if (staged_statuses == NULL) {
+            return false;
+        }
+        
+        store->staged_statuses = staged_statuses;
+        store->staged_statuses_capacity = new_capacity;
+    }
+    
+    feedbag_staged_t *staged = &store->staged[store->num_staged];
+    staged->request_id = request_id;
+    staged->first_status = store->num_staged_statuses;
+    staged->num_statuses = count;
+    
+    memcpy(&store->staged_statuses[store->num_staged_statuses], statuses, count * sizeof(uint16_t));
+    store->num_staged_statuses += count;
+    store->num_staged++;
+    
+    return true;
+}
+
+void feedbag_store_clear_staged(feedbag_store_t *store) {
+    if (store == NULL) {
+        return;
+    }
+    
+    store->num_staged = 0;
+    store->num_staged_statuses = 0;
+}
+
+bool feedbag_store_commit(feedbag_store_t *store) {
+    if (store == NULL) {
+        return false;
+    }
+    
+    if (store->dirty == false) {
+        return true;
+    }
+    
+    backend_ret_t ret = backend_store_feedbag(screenname_str(store->owner), &store->blob);
+    
+    if (ret != BACKEND_RET_SUCCESS) {
+        LOG_ERR("Failed to store feedbag. (%d)", ret);
+        return false;
+    }
+    
+    store->dirty = false;
+    
+    return true;
+}
\ No newline at end of file
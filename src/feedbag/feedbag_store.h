@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file feedbag_store.h
+ * @author Evan Stoddard
+ * @brief Server stored feedbag of a user
+ */
+
+#ifndef FEEDBAG_STORE_H_
+#define FEEDBAG_STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "feedbag/feedbag_index.h"
+#include "feedbag/feedbag_limits.h"
+#include "model/screenname.h"
+#include "model/model_types.h"
+#include "oscar/feedbag_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Edit applied to a feedbag
+ * 
+ */
+typedef enum {
+    FEEDBAG_OP_INSERT = 0,
+    FEEDBAG_OP_UPDATE,
+    FEEDBAG_OP_DELETE,
+} feedbag_op_t;
+
+/**
+ * @brief Item view into a wire encoded feedbag
+ * 
+ */
+typedef struct feedbag_item_t {
+    const char *name;
+    uint16_t name_len;
+    uint16_t group_id;
+    uint16_t item_id;
+    uint16_t class_id;
+    const uint8_t *attrs;
+    uint16_t attrs_len;
+    
+    // Whole item, as stored and sent
+    const uint8_t *wire;
+    size_t wire_len;
+} feedbag_item_t;
+
+/**
+ * @brief Results of one edit request waiting for its commit
+ * 
+ */
+typedef struct feedbag_staged_t {
+    uint32_t request_id;
+    uint32_t first_status;
+    uint32_t num_statuses;
+} feedbag_staged_t;
+
+/**
+ * @brief Feedbag store instance typedef
+ * 
+ * Items are kept exactly as they are sent, back to back in one buffer,
+ * and written back to the backend as a single versioned blob.
+ */
+typedef struct feedbag_store_t {
+    screenname_id_t owner;
+    feedbag_blob_t blob;
+    size_t capacity;
+    
+    // Users named by the items, kept in step with every edit
+    feedbag_index_t index;
+    uint16_t class_counts[FEEDBAG_NUM_CLASSES];
+    
+    // Set by edits, cleared by commit
+    bool dirty;
+    
+    // Edits inside FEEDBAG_START_CLUSTER/END_CLUSTER share one commit, results wait for it
+    bool in_cluster;
+    feedbag_staged_t *staged;
+    uint32_t num_staged;
+    uint32_t staged_capacity;
+    uint16_t *staged_statuses;
+    uint32_t num_staged_statuses;
+    uint32_t staged_statuses_capacity;
+} feedbag_store_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Parse single wire encoded item
+ * 
+ * @param data Data
+ * @param len Length of data
+ * @param item Item to fill (points into data)
+ * @return true Item parsed
+ * @return false Item truncated
+ */
+bool feedbag_item_parse(const uint8_t *data, size_t len, feedbag_item_t *item);
+
+/**
+ * @brief Load stored feedbag of user
+ * 
+ * @param owner Screen name of user (store takes a reference)
+ * @return feedbag_store_t* Store (NULL on backend error)
+ */
+feedbag_store_t *feedbag_store_load(screenname_id_t owner);
+
+/**
+ * @brief Get modification time and item count of user's feedbag without loading items
+ * 
+ * @param owner Screen name of user
+ * @param modified Pointer to write modification time to
+ * @param num_items Pointer to write item count to
+ * @return true Info fetched (zeroes if nothing stored)
+ * @return false Backend error
+ */
+bool feedbag_store_info(screenname_id_t owner, uint32_t *modified, uint16_t *num_items);
+
+/**
+ * @brief Free feedbag store without writing it back
+ * 
+ * @param store Store
+ */
+void feedbag_store_free(feedbag_store_t *store);
+
+/**
+ * @brief Iterate items of store
+ * 
+ * @param store Store
+ * @param offset Iterator offset (start at 0)
+ * @param item Next item
+ * @return true Item returned
+ * @return false No more items
+ */
+bool feedbag_store_next(const feedbag_store_t *store, size_t *offset, feedbag_item_t *item);
+
+/**
+ * @brief Apply edit to store in memory
+ * 
+ * Items are identified by group and item id. Inserts and updates are held
+ * to the feedbag limits. Buddies gained or lost are added to the index delta.
+ * 
+ * @param store Store
+ * @param op Edit
+ * @param item Item (from the request)
+ * @return feedbag_status_t Result for item
+ */
+feedbag_status_t feedbag_store_apply(feedbag_store_t *store, feedbag_op_t op, const feedbag_item_t *item);
+
+/**
+ * @brief Keep results of an edit request until the edits are committed
+ * 
+ * @param store Store
+ * @param request_id Request ID of edit
+ * @param statuses Results (network byte order)
+ * @param count Number of results
+ * @return true Results staged
+ * @return false Out of memory
+ */
+bool feedbag_store_stage(feedbag_store_t *store, uint32_t request_id, const uint16_t *statuses, uint32_t count);
+
+/**
+ * @brief Drop staged results
+ * 
+ * @param store Store
+ */
+void feedbag_store_clear_staged(feedbag_store_t *store);
+
+/**
+ * @brief Write store back to backend if edited
+ * 
+ * Fails if the stored feedbag changed since it was loaded.
+ * 
+ * @param store Store
+ * @return true Store written
+ * @return false Backend error or version conflict
+ */
+bool feedbag_store_commit(feedbag_store_t *store);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* FEEDBAG_STORE_H_ */
\ No newline at end of file
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file bart.c
+ * @author Evan Stoddard
+ * @brief BART SNAC Handler
+ */
+
+#include "bart.h"
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "session.h"
+#include "backends/backend.h"
+#include "presence/presence.h"
+
+#include "bart/bart_store.h"
+
+#include "handlers/snac_error.h"
+
+#include "config/config.h"
+
+#include "oscar/bart_types.h"
+
+#include "oscar/snac_encoder.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+// Type (2 bytes) and data length (2 bytes) of BART_UPLOAD_QUERY
+#define BART_UPLOAD_QUERY_MIN_LEN 4U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Handle BART_UPLOAD_QUERY
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_bart_handle_upload_query(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Send BART_UPLOAD_REPLY
+ * 
+ * @param conn Connection
+ * @param request_id Request ID of upload
+ * @param code Result code
+ * @param type Type of item
+ * @param hash Hash of stored item (NULL if not stored)
+ */
+static void prv_bart_send_upload_reply(connection_t *conn, uint32_t request_id, bart_reply_code_t code, uint16_t type, const uint8_t *hash);
+
+/**
+ * @brief Handle BART_DOWNLOAD_QUERY
+ * 
+ * Items are sent straight from their mapping in the store, one reply per
+ * item found.
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_bart_handle_download_query(connection_t *conn, frame_t *frame);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static void prv_bart_handle_upload_query(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
+    
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (blob_size < (ssize_t)BART_UPLOAD_QUERY_MIN_LEN) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    uint16_t type = ntohs(*(uint16_t *)blob);
+    uint16_t len = ntohs(*(uint16_t *)&blob[2]);
+    
+    if (blob_size < (ssize_t)BART_UPLOAD_QUERY_MIN_LEN + len) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    // Only buddy icons are stored for now
+    if (type != BART_TYPE_BUDDY_ICON_SMALL && type != BART_TYPE_BUDDY_ICON && type != BART_TYPE_BUDDY_ICON_BIG) {
+        prv_bart_send_upload_reply(conn, frame->snac.request_id, BART_REPLY_CODE_INVALID_TYPE, type, NULL);
+        return;
+    }
+    
+    if (len == 0) {
+        prv_bart_send_upload_reply(conn, frame->snac.request_id, BART_REPLY_CODE_TOO_SMALL, type, NULL);
+        return;
+    }
+    
+    if (len > config_get()->bart_max_item_bytes) {
+        prv_bart_send_upload_reply(conn, frame->snac.request_id, BART_REPLY_CODE_TOO_BIG, type, NULL);
+        return;
+    }
+    
+    uint8_t hash[BART_HASH_LEN];
+    bart_store_hash(&blob[BART_UPLOAD_QUERY_MIN_LEN], len, hash);
+    
+    // Every new item grows the pack shared by all workers, so each user only gets so many
+    if (!bart_store_contains(hash)) {
+        backend_ret_t ret = backend_reserve_bart_item(screenname_str(session->screenname_id), config_get()->bart_max_items_per_user);
+        
+        if (ret == BACKEND_RET_NO_RESULT) {
+            LOG_WARN("Refusing BART upload from %s, limit reached.", screenname_str(session->screenname_id));
+            snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_REQUEST_DENIED);
+            return;
+        }
+        
+        if (ret != BACKEND_RET_SUCCESS) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+            return;
+        }
+    }
+    
+    if (!bart_store_put(&blob[BART_UPLOAD_QUERY_MIN_LEN], len, hash)) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+        return;
+    }
+    
+    LOG_INFO("Stored BART item %u for %s.", type, screenname_str(session->screenname_id));
+    
+    prv_bart_send_upload_reply(conn, frame->snac.request_id, BART_REPLY_CODE_SUCCESS, type, hash);
+    
+    // Icon belongs to whoever uploaded it, buddies see it in our user info
+    memcpy(session->bart_icon_hash, hash, BART_HASH_LEN);
+    session->bart_icon_type = type;
+    session->has_bart_icon = true;
+    
+    presence_status_changed(session);
+}
+
+static void prv_bart_send_upload_reply(connection_t *conn, uint32_t request_id, bart_reply_code_t code, uint16_t type, const uint8_t *hash) {
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_BART, BART_UPLOAD_REPLY, 0, request_id);
+    uint8_t code_byte = code;
+    
+    bart_id_header_t id = {
+        .type = htons(type),
+        .flags = (hash != NULL) ? BART_FLAG_CUSTOM : 0,
+        .length = (hash != NULL) ? BART_HASH_LEN : 0,
+    };
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = &code_byte, .iov_len = sizeof(uint8_t) },
+        { .iov_base = &id, .iov_len = sizeof(bart_id_header_t) },
+        { .iov_base = (void *)hash, .iov_len = id.length },
+    };
+    
+    connection_write_frame(conn, iov, 4);
+}
+
+static void prv_bart_handle_download_query(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    // String8 screen name of owner, then a count and that many BART IDs
+    if (blob_size < 2 || blob_size < 2 + blob[0]) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    uint8_t *name = blob;
+    size_t name_len = 1 + blob[0];
+    uint8_t count = blob[name_len];
+    ssize_t idx = name_len + 1;
+    uint32_t num_sent = 0;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        if (idx + (ssize_t)sizeof(bart_id_header_t) > blob_size) {
+            break;
+        }
+        
+        bart_id_header_t *id = (bart_id_header_t *)&blob[idx];
+        size_t id_len = sizeof(bart_id_header_t) + id->length;
+        
+        if (idx + (ssize_t)id_len > blob_size) {
+            break;
+        }
+        
+        idx += id_len;
+        
+        struct iovec data;
+        
+        if (id->length != BART_HASH_LEN || !bart_store_get((uint8_t *)(id + 1), &data)) {
+            continue;
+        }
+        
+        snac_t snac = snac_encode(SNAC_FOODGROUP_ID_BART, BART_DOWNLOAD_REPLY, 0, frame->snac.request_id);
+        uint16_t data_len = htons(data.iov_len);
+        
+        // Name and ID are echoed from the query, the item comes from its mapping
+        struct iovec iov[] = {
+            { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+            { .iov_base = name, .iov_len = name_len },
+            { .iov_base = id, .iov_len = id_len },
+            { .iov_base = &data_len, .iov_len = sizeof(uint16_t) },
+            data,
+        };
+        
+        if (connection_write_frame(conn, iov, 5) <= 0) {
+            return;
+        }
+        
+        num_sent++;
+    }
+    
+    if (num_sent == 0) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BART, frame->snac.request_id, SNAC_ERROR_NO_MATCH);
+    }
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void bart_handle_frame(connection_t *conn, frame_t *frame) {
+    switch(frame->snac.subgroup_id) {
+    case BART_ERR:
+        // TODO: Implement BART_ERR
+        LOG_INFO("BART_ERR handler not implemented.");
+        break;
+    case BART_UPLOAD_QUERY:
+        prv_bart_handle_upload_query(conn, frame);
+        break;
+    case BART_UPLOAD_REPLY:
+        // TODO: Implement BART_UPLOAD_REPLY
+        LOG_INFO("BART_UPLOAD_REPLY handler not implemented.");
+        break;
+    case BART_DOWNLOAD_QUERY:
+        prv_bart_handle_download_query(conn, frame);
+        break;
+    case BART_DOWNLOAD_REPLY:
+        // TODO: Implement BART_DOWNLOAD_REPLY
+        LOG_INFO("BART_DOWNLOAD_REPLY handler not implemented.");
+        break;
+    case BART_DOWNLOAD2_QUERY:
+        // TODO: Implement BART_DOWNLOAD2_QUERY
+        LOG_INFO("BART_DOWNLOAD2_QUERY handler not implemented.");
+        break;
+    case BART_DOWNLOAD2_REPLY:
+        // TODO: Implement BART_DOWNLOAD2_REPLY
+        LOG_INFO("BART_DOWNLOAD2_REPLY handler not implemented.");
+        break;
+    default:
+        LOG_INFO("Unknown BART Sub ID: 0x%04X", frame->snac.subgroup_id);
+        break;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file bart.h
+ * @author Evan Stoddard
+ * @brief Handler for BART SNACs
+ */
+
+#ifndef BART_H_
+#define BART_H_
+
+#include "connection.h"
+#include "oscar/frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Handle BART Frame
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+void bart_handle_frame(connection_t *conn, frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BART_H_ */
\ No newline at end of file
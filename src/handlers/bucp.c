@@ -22,9 +22,20 @@
 #include "oscar/snac_encoder.h"
 
 #include "model/client.h"
+#include "model/screenname.h"
 
 #include "memory/buffer.h"
 
+#include "backends/backend.h"
+
+#include "handlers/snac_error.h"
+#include "oscar/auth_types.h"
+
+#include "config/config.h"
+
+#include "utils/timestamp.h"
+#include "utils/random.h"
+
 #include <stddef.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
@@ -60,6 +71,46 @@ static void prv_bucp_handle_login_request(connection_t *conn, frame_t *frame);
  */
 static void prv_bucp_handle_challenge_request(connection_t *conn, frame_t *frame);
 
+/**
+ * @brief Drive login state machine until it finishes or suspends
+ * 
+ * Connection may be closed (and freed) by the time this returns.
+ * 
+ * @param conn Connection
+ */
+static void prv_bucp_login_advance(connection_t *conn);
+
+/**
+ * @brief Fail login with error code
+ * 
+ * @param conn Connection
+ * @param error Login error code
+ */
+static void prv_bucp_login_fail(connection_t *conn, auth_login_error_t error);
+
+/**
+ * @brief Start user lookup for credentials received
+ * 
+ * @param conn Connection
+ */
+static void prv_bucp_login_lookup(connection_t *conn);
+
+/**
+ * @brief Resume login once user lookup finishes
+ * 
+ * @param conn Connection
+ * @param ret Result of lookup
+ */
+static void prv_bucp_login_lookup_complete(connection_t *conn, backend_ret_t ret);
+
+/**
+ * @brief Reject malformed request and close connection
+ * 
+ * @param conn Connection
+ * @param frame Frame being rejected
+ */
+static void prv_bucp_reject_request(connection_t *conn, frame_t *frame);
+
 /**
  * @brief Send challenge response
  * 
@@ -75,6 +126,13 @@ static void prv_bucp_send_challenge_response(connection_t *conn);
  */
 static void prv_bucp_send_login_response_success(connection_t *conn);
 
+/**
+ * @brief Send failed login response
+ * 
+ * @param conn Connection
+ */
+static void prv_bucp_send_login_response_error(connection_t *conn);
+
 /**
  * @brief Send signoff flap
  * 
@@ -86,16 +144,106 @@ static void prv_bucp_send_signoff_flap(connection_t *conn);
  * Private Functions
  *****************************************************************************/
 
+static void prv_bucp_login_advance(connection_t *conn) {
+    client_t *client = conn->client;
+    
+    switch (client->login_state) {
+    case CLIENT_LOGIN_STATE_CREDENTIALS_RECEIVED:
+        client->login_state = CLIENT_LOGIN_STATE_LOOKUP_PENDING;
+        
+        // Lookup completion re-enters the state machine
+        prv_bucp_login_lookup(conn);
+        break;
+    case CLIENT_LOGIN_STATE_LOOKUP_PENDING:
+        // Suspended until lookup completes
+        break;
+    case CLIENT_LOGIN_STATE_VERIFIED:
+        prv_bucp_send_login_response_success(conn);
+        break;
+    case CLIENT_LOGIN_STATE_FAILED:
+        prv_bucp_send_login_response_error(conn);
+        break;
+    default:
+        break;
+    }
+}
+
+static void prv_bucp_login_fail(connection_t *conn, auth_login_error_t error) {
+    conn->client->login_state = CLIENT_LOGIN_STATE_FAILED;
+    conn->client->login_error = error;
+    
+    prv_bucp_login_advance(conn);
+}
+
+static void prv_bucp_login_lookup(connection_t *conn) {
+    client_t *client = conn->client;
+    
+    // Backend is synchronous for now so completion happens inline
+    backend_ret_t ret = backend_fetch_user_info_with_uin(client->login_screenname, &client->user_info);
+    
+    prv_bucp_login_lookup_complete(conn, ret);
+}
+
+static void prv_bucp_login_lookup_complete(connection_t *conn, backend_ret_t ret) {
+    client_t *client = conn->client;
+    
+    // Stale completion
+    if (client->login_state != CLIENT_LOGIN_STATE_LOOKUP_PENDING) {
+        return;
+    }
+    
+    switch (ret) {
+    case BACKEND_RET_SUCCESS:
+        break;
+    case BACKEND_RET_NO_RESULT:
+        LOG_INFO("Login for unknown screen name.");
+        prv_bucp_login_fail(conn, AUTH_LOGIN_ERROR_INVALID_SCREENNAME);
+        return;
+    default:
+        LOG_ERR("User lookup failed. (%u)", ret);
+        prv_bucp_login_fail(conn, AUTH_LOGIN_ERROR_SERVICE_UNAVAILABLE);
+        return;
+    }
+    
+    if (!client_validate_challenge(client, client->login_password_hash, CLIENT_PASSWORD_HASH_LEN)) {
+        LOG_INFO("User challenge response incorrect.");
+        prv_bucp_login_fail(conn, AUTH_LOGIN_ERROR_INCORRECT_PASSWORD);
+        return;
+    }
+    
+    client->login_state = CLIENT_LOGIN_STATE_VERIFIED;
+    prv_bucp_login_advance(conn);
+}
+
+static void prv_bucp_reject_request(connection_t *conn, frame_t *frame) {
+    // Connection is already gone if the error couldn't be written
+    if (snac_error_send(conn, SNAC_FOODGROUP_ID_BUCP, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD)) {
+        connection_close(conn);
+    }
+}
+
 /*****************************************************************************
  * Handlers
  *****************************************************************************/
 
 static void prv_bucp_handle_login_request(connection_t *conn, frame_t *frame) {
+    client_t *client = conn->client;
+    
+    // Only one login attempt per challenge
+    if (client->login_state != CLIENT_LOGIN_STATE_CHALLENGE_ISSUED) {
+        LOG_WARN("Login request without outstanding challenge.");
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BUCP, frame->snac.request_id, SNAC_ERROR_INVALID_SNAC);
+        return;
+    }
+    
     uint8_t *blob = frame->snac_blob;
     ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
     ssize_t idx = 0;
     
-    // Iterate through TLVs
+    bool screenname_matches = false;
+    bool password_hash_received = false;
+    
+    // Collect TLVs first, they may arrive in any order
     while (idx < blob_size) {
         ssize_t remaining_bytes = blob_size - idx;
         
@@ -106,91 +254,71 @@ static void prv_bucp_handle_login_request(connection_t *conn, frame_t *frame) {
 
         if (!ret) {
             LOG_ERR("Failed to parse TLV.");
-            connection_close(conn);
+            prv_bucp_reject_request(conn, frame);
             return;
         }
         
         switch (tlv.header.tag) {
         case TLV_TAG_VERSION_MAJOR: {
             tlv_client_version_major_f_t *version = (tlv_client_version_major_f_t*)tlv.payload;
-            conn->client->version_major = version->version_major;
+            client->version_major = version->version_major;
             break;
         }
         case TLV_TAG_VERSION_MINOR: {
             tlv_client_version_minor_f_t *version = (tlv_client_version_minor_f_t*)tlv.payload;
-            conn->client->version_minor = version->version_minor;
+            client->version_minor = version->version_minor;
             break;
         }
         case TLV_TAG_VERSION_LESSER: {
             tlv_client_version_lesser_f_t *version = (tlv_client_version_lesser_f_t*)tlv.payload;
-            conn->client->version_lesser = version->version_lesser;
+            client->version_lesser = version->version_lesser;
             break;
         }
         case TLV_TAG_BUILD_NUM: {
             tlv_client_build_number_f_t *build = (tlv_client_build_number_f_t*)tlv.payload;
-            conn->client->version_build = build->build_number;
+            client->version_build = build->build_number;
             break;
         }
         case TLV_TAG_CLIENT_ID: {
             tlv_client_id_f_t *client_id = (tlv_client_id_f_t*)tlv.payload;
-            conn->client->client_id = client_id->client_id;
+            client->client_id = client_id->client_id;
             break;
         }
         case TLV_TAG_CLIENT_LANG: {
             tlv_client_language_f_t *lang = (tlv_client_language_f_t*)tlv.payload;
-            memcpy(conn->client->lang, lang->language, 2);
+            memcpy(client->lang, lang->language, 2);
             break;
         }
         case TLV_TAG_CLIENT_COUNTRY: {
             tlv_client_country_f_t *country = (tlv_client_country_f_t*)tlv.payload;
-            memcpy(conn->client->country, country->country, 2);
+            memcpy(client->country, country->country, 2);
             break;
         }
         case TLV_TAG_SSI_FLAG: {
             tlv_client_ssi_flag_f_t *payload = (tlv_client_ssi_flag_f_t*)tlv.payload;
-            conn->client->ssi = payload->ssi_flag;
+            client->ssi = payload->ssi_flag;
             break;
         }
-        case TLV_TAG_SCREEN_NAME: {
-            char *uin = calloc(sizeof(char), tlv.header.length + 1);
-            
-            if (uin == NULL) {
-                LOG_ERR("Unable to malloc space for screen name. Out of memory?");
-                connection_close(conn);
-                return;
-            }
-
-            memcpy(uin, tlv.payload, tlv.header.length);
-            
-            // Attempt to fetch user info
-            bool ret = client_fetch_user_info_with_uin(conn->client, uin);
-            free(uin);
+        case TLV_TAG_SCREEN_NAME:
+            // Screenname must match the one the challenge was issued for
+            screenname_matches = (screenname_find(tlv.payload, tlv.header.length) == conn->screenname_id);
+            break;
+        case TLV_TAG_CLIENT_NAME:
+            free(client->client_id_str);
+            client->client_id_str = calloc(sizeof(char), tlv.header.length + 1);
             
-            // TODO: Implement login failed response instead of silently dumping connection
-            if (!ret) {
-                LOG_ERR("Failed to find user.");
-                connection_close(conn);
-                return;
+            if (client->client_id_str != NULL) {
+                memcpy(client->client_id_str, tlv.payload, tlv.header.length);
             }
-            
-            break;
-        }
-        case TLV_TAG_CLIENT_NAME: {
-            conn->client->client_id_str = malloc(tlv.header.length + 1);
-            memcpy(conn->client->client_id_str, tlv.payload, tlv.header.length);
             break;
-        }
-        case TLV_TAG_MD5_HASHED_PASSWORD: {
-            bool valid_challenge = client_validate_challenge(conn->client, tlv.payload, tlv.header.length);
+        case TLV_TAG_MD5_HASHED_PASSWORD:
+            // Copied since the frame is gone by the time the lookup completes
+            password_hash_received = (tlv.header.length == CLIENT_PASSWORD_HASH_LEN);
             
-            if (valid_challenge == false) {
-                // TODO: Implement login failed response instead of silently dumping connection.
-                LOG_INFO("User challenge response incorrect.");
-                connection_close(conn);
-                return;
+            if (password_hash_received) {
+                memcpy(client->login_password_hash, tlv.payload, CLIENT_PASSWORD_HASH_LEN);
             }
             break;
-        }
         default:
             break;
         }
@@ -198,7 +326,20 @@ static void prv_bucp_handle_login_request(connection_t *conn, frame_t *frame) {
         idx += sizeof(tlv_header_t) + tlv.header.length;
     }
     
-    prv_bucp_send_login_response_success(conn);
+    if (!screenname_matches) {
+        LOG_ERR("Screenname missing or does not match challenge request.");
+        prv_bucp_login_fail(conn, AUTH_LOGIN_ERROR_INVALID_SCREENNAME);
+        return;
+    }
+    
+    if (!password_hash_received) {
+        LOG_ERR("Password hash missing from login request.");
+        prv_bucp_login_fail(conn, AUTH_LOGIN_ERROR_INCORRECT_PASSWORD);
+        return;
+    }
+    
+    client->login_state = CLIENT_LOGIN_STATE_CREDENTIALS_RECEIVED;
+    prv_bucp_login_advance(conn);
 }
 
 static void prv_bucp_handle_challenge_request(connection_t *conn, frame_t *frame) {
@@ -221,7 +362,7 @@ static void prv_bucp_handle_challenge_request(connection_t *conn, frame_t *frame
 
         if (!ret) {
             LOG_ERR("Failed to parse TLV.");
-            connection_close(conn);
+            prv_bucp_reject_request(conn, frame);
             return;
         }
         
@@ -239,15 +380,38 @@ static void prv_bucp_handle_challenge_request(connection_t *conn, frame_t *frame
     
     if (screenname == NULL) {
         LOG_ERR("Screenname not part of request.");
+        prv_bucp_reject_request(conn, frame);
+        return;
+    }
+    
+    if (conn->client->login_state != CLIENT_LOGIN_STATE_IDLE) {
+        LOG_WARN("Challenge already issued.");
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BUCP, frame->snac.request_id, SNAC_ERROR_INVALID_SNAC);
+        return;
+    }
+    
+    // Keep screenname as typed for lookup and replies
+    conn->client->login_screenname = calloc(sizeof(char), screenname_size + 1);
+    
+    if (conn->client->login_screenname == NULL) {
+        LOG_ERR("Unable to malloc space for screen name. Out of memory?");
         connection_close(conn);
         return;
     }
     
-    // Copy screenname to connection
-    memcpy(conn->screenname, screenname, screenname_size);
+    memcpy(conn->client->login_screenname, screenname, screenname_size);
+    
+    // Intern screenname and attach to connection
+    screenname_release(conn->screenname_id);
+    conn->screenname_id = screenname_intern(screenname, screenname_size);
+    
+    if (conn->screenname_id == SCREENNAME_ID_INVALID) {
+        LOG_ERR("Invalid screenname in request.");
+        prv_bucp_login_fail(conn, AUTH_LOGIN_ERROR_INVALID_SCREENNAME);
+        return;
+    }
 
     prv_bucp_send_challenge_response(conn);
-    
 }
 
 /*****************************************************************************
@@ -297,9 +461,13 @@ static void prv_bucp_send_challenge_response(connection_t *conn) {
     
     if (connection_write(conn, buffer_ptr(buffer), buffer_size) != buffer_size) {
         LOG_ERR("Failed to write to connection.");
+        buffer_deinit(buffer);
+        return;
     }
     
     buffer_deinit(buffer);
+    
+    conn->client->login_state = CLIENT_LOGIN_STATE_CHALLENGE_ISSUED;
 }
 
 static void prv_bucp_send_login_response_success(connection_t *conn) {
@@ -316,13 +484,24 @@ static void prv_bucp_send_login_response_success(connection_t *conn) {
     payload_length += uid_tlv_size;
     
     tlv_t bos_address_tlv;
-    ssize_t bos_address_tlv_size = tlv_encode_bos_address(&bos_address_tlv, "192.168.86.50:5191");
+    ssize_t bos_address_tlv_size = tlv_encode_bos_address(&bos_address_tlv, config_get()->bos_endpoint);
     ssize_t bos_address_payload_size = bos_address_tlv_size - sizeof(tlv_header_t);
     payload_length += bos_address_tlv_size;
     
-    // TODO: Create real cookie and base64 encode.
+    // BOS only trusts a cookie it can find (and consume) in the backend
+    uint8_t cookie[AUTH_COOKIE_LEN];
+    uint64_t expires_at_ms = (uint64_t)timestamp_unix() * 1000 + config_get()->auth_cookie_ttl_ms;
+    
+    generate_random_stream(cookie, sizeof(cookie));
+    
+    if (backend_store_login_cookie(cookie, sizeof(cookie), conn->client->user_info.uin, expires_at_ms) != BACKEND_RET_SUCCESS) {
+        LOG_ERR("Unable to store login cookie.");
+        connection_close(conn);
+        return;
+    }
+    
     tlv_t login_cookie_tlv;
-    ssize_t login_cookie_tlv_size = tlv_encode_login_cookie(&login_cookie_tlv, conn->client->user_info.uin);
+    ssize_t login_cookie_tlv_size = tlv_encode_login_cookie(&login_cookie_tlv, cookie, sizeof(cookie));
     ssize_t login_cookie_payload_size = login_cookie_tlv_size - sizeof(tlv_header_t);
     payload_length += login_cookie_tlv_size;
 
@@ -344,6 +523,7 @@ static void prv_bucp_send_login_response_success(connection_t *conn) {
     if (buffer == NULL) {
         LOG_ERR("Unable to allocate buffer.  Out of memory?");
         connection_close(conn);
+        return;
     }
     
     buffer_write(buffer, &flap, sizeof(flap));
@@ -357,8 +537,12 @@ static void prv_bucp_send_login_response_success(connection_t *conn) {
     buffer_write(buffer, &email_address_tlv.header, sizeof(tlv_header_t));
     buffer_write(buffer, email_address_tlv.payload, email_address_payload_size);
     
+    conn->client->login_state = CLIENT_LOGIN_STATE_REDIRECTED;
+    
     if (connection_write(conn, buffer_ptr(buffer), buffer_size) != buffer_size) {
         LOG_ERR("Failed to write to connection.");
+        buffer_deinit(buffer);
+        return;
     }
     
     buffer_deinit(buffer);
@@ -369,6 +553,49 @@ static void prv_bucp_send_login_response_success(connection_t *conn) {
     connection_close(conn);
 }
 
+static void prv_bucp_send_login_response_error(connection_t *conn) {
+    client_t *client = conn->client;
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_BUCP, BUCP_LOGIN_RESPONSE, 0, 0);
+    tlv_uint16_t error_tlv = tlv_uint16_encode(TLV_TAG_LOGIN_ERROR, client->login_error);
+    
+    struct iovec iov[4];
+    int iov_count = 0;
+    
+    iov[iov_count].iov_base = &snac;
+    iov[iov_count].iov_len = sizeof(snac_t);
+    iov_count++;
+    
+    // Echo screen name back if the client got far enough to send one
+    tlv_t screenname_tlv;
+    
+    if (client->login_screenname != NULL) {
+        ssize_t screenname_tlv_size = tlv_encode_screen_name(&screenname_tlv, client->login_screenname);
+        
+        iov[iov_count].iov_base = &screenname_tlv.header;
+        iov[iov_count].iov_len = sizeof(tlv_header_t);
+        iov_count++;
+        
+        iov[iov_count].iov_base = screenname_tlv.payload;
+        iov[iov_count].iov_len = screenname_tlv_size - sizeof(tlv_header_t);
+        iov_count++;
+    }
+    
+    iov[iov_count].iov_base = &error_tlv;
+    iov[iov_count].iov_len = sizeof(tlv_uint16_t);
+    iov_count++;
+    
+    LOG_INFO("Login failed. (0x%04x)", client->login_error);
+    
+    if (connection_write_frame(conn, iov, iov_count) <= 0) {
+        return;
+    }
+    
+    prv_bucp_send_signoff_flap(conn);
+    
+    connection_close(conn);
+}
+
 static void prv_bucp_send_signoff_flap(connection_t *conn) {
     // Encode FLAP
     uint16_t sequence_number = conn->last_outbound_seq_num + 1;
@@ -9,12 +9,39 @@
  */
 
 #include "buddy_handler.h"
+
+#include "session.h"
+#include "presence/presence.h"
+
+#include "handlers/snac_error.h"
+
+#include "config/config.h"
+
+#include "oscar/snac_encoder.h"
+#include "oscar/tlv_encoder.h"
+
+#include "memory/buffer.h"
+
 #include "logging.h"
 
 /*****************************************************************************
  * Definitions
  *****************************************************************************/
 
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief BUDDY rights TLV tag IDs
+ * 
+ */
+typedef enum {
+    BUDDY_RIGHTS_MAX_BUDDIES        = 0x01,
+    BUDDY_RIGHTS_MAX_WATCHERS       = 0x02,
+    BUDDY_RIGHTS_MAX_TEMP_BUDDIES   = 0x04,
+} buddy_rights_tlv_tag_t;
+
 /*****************************************************************************
  * Variables
  *****************************************************************************/
@@ -23,6 +50,240 @@
  * Prototypes
  *****************************************************************************/
 
+/**
+ * @brief Get session of connection, rejecting request if not signed on
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ * @return session_t* Session (NULL if request was rejected)
+ */
+static session_t *prv_buddy_handler_session(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Count string8 screen names in SNAC body
+ * 
+ * @param blob SNAC body
+ * @param blob_size Size of SNAC body
+ * @return ssize_t Number of names (-1 if list runs past end of body)
+ */
+static ssize_t prv_buddy_handler_count_names(uint8_t *blob, ssize_t blob_size);
+
+/**
+ * @brief Handle rights query
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_buddy_handler_handle_rights_query(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle add buddies (list of string8 screen names)
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ * @param temporary Add to temporary buddy list
+ */
+static void prv_buddy_handler_handle_add_buddies(connection_t *conn, frame_t *frame, bool temporary);
+
+/**
+ * @brief Handle delete buddies (list of string8 screen names)
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ * @param temporary Delete from temporary buddy list
+ */
+static void prv_buddy_handler_handle_del_buddies(connection_t *conn, frame_t *frame, bool temporary);
+
+/**
+ * @brief Handle watcher list query
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_buddy_handler_handle_watcher_list_query(connection_t *conn, frame_t *frame);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static session_t *prv_buddy_handler_session(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BUDDY, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+    }
+    
+    return conn->session;
+}
+
+static ssize_t prv_buddy_handler_count_names(uint8_t *blob, ssize_t blob_size) {
+    ssize_t count = 0;
+    ssize_t idx = 0;
+    
+    while (idx < blob_size) {
+        idx += 1 + blob[idx];
+        count++;
+    }
+    
+    if (idx > blob_size) {
+        return -1;
+    }
+    
+    return count;
+}
+
+static void prv_buddy_handler_handle_rights_query(connection_t *conn, frame_t *frame) {
+    config_t *config = config_get();
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_BUDDY, BUDDY_RIGHTS_REPLY, 0, frame->snac.request_id);
+    
+    tlv_uint16_t rights[] = {
+        tlv_uint16_encode(BUDDY_RIGHTS_MAX_BUDDIES, config->buddy_max_buddies),
+        tlv_uint16_encode(BUDDY_RIGHTS_MAX_WATCHERS, config->buddy_max_watchers),
+        tlv_uint16_encode(BUDDY_RIGHTS_MAX_TEMP_BUDDIES, config->buddy_max_temp_buddies),
+    };
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = rights, .iov_len = sizeof(rights) },
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_buddy_handler_handle_add_buddies(connection_t *conn, frame_t *frame, bool temporary) {
+    session_t *session = prv_buddy_handler_session(conn, frame);
+    
+    if (session == NULL) {
+        return;
+    }
+    
+    config_t *config = config_get();
+    uint32_t max_buddies = temporary ? config->buddy_max_temp_buddies : config->buddy_max_buddies;
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    ssize_t num_names = prv_buddy_handler_count_names(blob, blob_size);
+    
+    if (num_names < 0) {
+        LOG_ERR("Buddy list runs past end of SNAC.");
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BUDDY, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    // Can never fit, refuse before interning anything
+    if (num_names > max_buddies) {
+        LOG_WARN("Refusing %zd buddies from %s, limit is %u.", num_names, screenname_str(session->screenname_id), max_buddies);
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BUDDY, frame->snac.request_id, SNAC_ERROR_LIST_OVERFLOW);
+        return;
+    }
+    
+    buddy_set_t added;
+    bool overflow = false;
+    ssize_t idx = 0;
+    
+    buddy_set_init(&added);
+    
+    while (idx < blob_size) {
+        uint8_t len = blob[idx];
+        idx++;
+        
+        screenname_id_t screenname_id = screenname_intern((char *)&blob[idx], len);
+        idx += len;
+        
+        if (screenname_id == SCREENNAME_ID_INVALID) {
+            continue;
+        }
+        
+        switch(presence_watch(session, screenname_id, temporary)) {
+        case PRESENCE_WATCH_RET_SUCCESS:
+            buddy_set_add(&added, screenname_id);
+            break;
+        case PRESENCE_WATCH_RET_LIST_FULL:
+            overflow = true;
+            break;
+        default:
+            LOG_ERR("Unable to watch buddy. Out of memory?");
+            break;
+        }
+        
+        // Presence engine keeps its own reference
+        screenname_release(screenname_id);
+    }
+    
+    presence_send_arrivals(session, &added);
+    buddy_set_deinit(&added);
+    
+    if (overflow) {
+        LOG_WARN("Buddy list of %s is full.", screenname_str(session->screenname_id));
+        snac_error_send(conn, SNAC_FOODGROUP_ID_BUDDY, frame->snac.request_id, SNAC_ERROR_LIST_OVERFLOW);
+    }
+}
+
+static void prv_buddy_handler_handle_del_buddies(connection_t *conn, frame_t *frame, bool temporary) {
+    session_t *session = prv_buddy_handler_session(conn, frame);
+    
+    if (session == NULL) {
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    ssize_t idx = 0;
+    
+    while (idx < blob_size) {
+        uint8_t len = blob[idx];
+        idx++;
+        
+        if (idx + len > blob_size) {
+            LOG_ERR("Buddy list runs past end of SNAC.");
+            snac_error_send(conn, SNAC_FOODGROUP_ID_BUDDY, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+            return;
+        }
+        
+        // Nothing to delete if name isn't interned
+        screenname_id_t screenname_id = screenname_find((char *)&blob[idx], len);
+        idx += len;
+        
+        if (screenname_id != SCREENNAME_ID_INVALID) {
+            presence_unwatch(session, screenname_id, temporary);
+        }
+    }
+}
+
+static void prv_buddy_handler_handle_watcher_list_query(connection_t *conn, frame_t *frame) {
+    session_t *session = prv_buddy_handler_session(conn, frame);
+    
+    if (session == NULL) {
+        return;
+    }
+    
+    session_t *const *watchers = NULL;
+    uint32_t num_watchers = presence_watchers(session->screenname_id, &watchers);
+    
+    buffer_t buffer = buffer_init();
+    
+    if (buffer == NULL) {
+        LOG_ERR("Unable to allocate buffer.  Out of memory?");
+        return;
+    }
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_BUDDY, BUDDY_WATCHER_LIST_RESPONSE, 0, frame->snac.request_id);
+    buffer_write(buffer, &snac, sizeof(snac_t));
+    
+    for (uint32_t i = 0; i < num_watchers; i++) {
+        buffer_write(buffer, &watchers[i]->formatted_name_len, sizeof(uint8_t));
+        buffer_write(buffer, watchers[i]->formatted_name, watchers[i]->formatted_name_len);
+    }
+    
+    struct iovec iov = {
+        .iov_base = buffer_ptr(buffer),
+        .iov_len = buffer_size(buffer),
+    };
+    
+    connection_write_frame(conn, &iov, 1);
+    
+    buffer_deinit(buffer);
+}
+
 /*****************************************************************************
  * Functions
  *****************************************************************************/
@@ -34,24 +295,20 @@ void buddy_handler_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("BUDDY_ERR not implemented.");
         break;
     case BUDDY_RIGHTS_QUERY:
-        // TODO: Implement BUDDY_RIGHTS_QUERY
-        LOG_INFO("BUDDY_RIGHTS_QUERY not implemented.");
+        prv_buddy_handler_handle_rights_query(conn, frame);
         break;
     case BUDDY_RIGHTS_REPLY:
         // TODO: Implement BUDDY_RIGHTS_REPLY
         LOG_INFO("BUDDY_RIGHTS_REPLY not implemented.");
         break;
     case BUDDY_ADD_BUDDIES:
-        // TODO: Implement BUDDY_ADD_BUDDIES
-        LOG_INFO("BUDDY_ADD_BUDDIES not implemented.");
+        prv_buddy_handler_handle_add_buddies(conn, frame, false);
         break;
     case BUDDY_DEL_BUDDIES:
-        // TODO: Implement BUDDY_DEL_BUDDIES
-        LOG_INFO("BUDDY_DEL_BUDDIES not implemented.");
+        prv_buddy_handler_handle_del_buddies(conn, frame, false);
         break;
     case BUDDY_WATCHER_LIST_QUERY:
-        // TODO: Implement BUDDY_WATCHER_LIST_QUERY
-        LOG_INFO("BUDDY_WATCHER_LIST_QUERY not implemented.");
+        prv_buddy_handler_handle_watcher_list_query(conn, frame);
         break;
     case BUDDY_WATCHER_LIST_RESPONSE:
         // TODO: Implement BUDDY_WATCHER_LIST_RESPONSE
@@ -78,12 +335,10 @@ void buddy_handler_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("BUDDY_DEPARTED not implemented.");
         break;
     case BUDDY_ADD_TEMP_BUDDIES:
-        // TODO: Implement BUDDY_ADD_TEMP_BUDDIES
-        LOG_INFO("BUDDY_ADD_TEMP_BUDDIES not implemented.");
+        prv_buddy_handler_handle_add_buddies(conn, frame, true);
         break;
     case BUDDY_DEL_TEMP_BUDDIES:
-        // TODO: Implement BUDDY_DEL_TEMP_BUDDIES
-        LOG_INFO("BUDDY_DEL_TEMP_BUDDIES not implemented.");
+        prv_buddy_handler_handle_del_buddies(conn, frame, true);
         break;
     default:
         LOG_INFO("Unknown BUDDY Sub ID: 0x%04X", frame->snac.subgroup_id);
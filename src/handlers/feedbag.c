@@ -10,8 +10,19 @@
 
 #include "feedbag.h"
 
+#include <string.h>
 #include <arpa/inet.h>
 
+#include "session.h"
+
+#include "feedbag/feedbag_limits.h"
+#include "feedbag/feedbag_store.h"
+
+#include "presence/presence.h"
+
+#include "handlers/snac_error.h"
+
+#include "oscar/feedbag_types.h"
 #include "oscar/flap.h"
 #include "oscar/tlv.h"
 
@@ -23,7 +34,7 @@
 #include "oscar/flap_encoder.h"
 #include "oscar/snac_encoder.h"
 
-#include "memory/buffer.h"
+#include "memory/msgbuf.h"
 
 #include "logging.h"
 
@@ -31,30 +42,19 @@
  * Definitions
  *****************************************************************************/
 
+// Stored items are sent in FEEDBAG_REPLY chunks of at most this many bytes
+#define FEEDBAG_REPLY_MAX_CHUNK_LEN 0x2000U
+
+// Smallest item (empty name and attributes) bounds the items of one edit
+#define FEEDBAG_MAX_EDIT_ITEMS (UINT16_MAX / (sizeof(uint16_t) + sizeof(feedbag_item_header_t)))
+
+// Clusters holding more results than this are committed early
+#define FEEDBAG_CLUSTER_MAX_STATUSES 0x4000U
+
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
  *****************************************************************************/
 
-/**
- * @brief FEEDBAG TLV Class tag IDs
- * 
- */
-typedef enum {
-    FEEDBAG_RIGHTS_MAX_CLASS_ATTRS          = 0x02,
-    FEEDBAG_RIGHTS_MAX_ITEM_ATTRS           = 0x03,
-    FEEDBAG_RIGHTS_MAX_ITEMS_BY_CLASS       = 0x04,
-    FEEDBAG_RIGHTS_MAX_CLIENT_ITEMS         = 0x05,
-    FEEDBAG_RIGHTS_MAX_ITEM_NAME_LEN        = 0x06,
-    FEEDBAG_RIGHTS_MAX_RECENT_BUDDIES       = 0x07,
-    FEEDBAG_RIGHTS_INTERACTION_BUDDIES      = 0x08,
-    FEEDBAG_RIGHTS_INTERACTION_HALF_LIFE    = 0x09,
-    FEEDBAG_RIGHTS_INTERACTION_MAX_SCORE    = 0x0A,
-    FEEDBAG_RIGHTS_MAX_UNKNOWN_0B           = 0x0B,
-    FEEDBAG_RIGHTS_MAX_BUDDIES_PER_GROUP    = 0x0C,
-    FEEDBAG_RIGHTS_MAX_MEGA_BOTS            = 0x0D,
-    FEEDBAG_RIGHTS_MAX_SMART_GROUPS         = 0x0E,
-} feedback_tlv_tag_t;
-
 /*****************************************************************************
  * Variables
  *****************************************************************************/
@@ -75,91 +75,477 @@ void feedback_handle_rights_query(connection_t *conn, frame_t *frame);
  * @brief Send rights reply
  * 
  * @param conn Connection
+ * @param request_id Request ID of query
  */
-void feedback_send_rights_reply(connection_t *conn);
+void feedback_send_rights_reply(connection_t *conn, uint32_t request_id);
+
+/**
+ * @brief Get stored feedbag of session, loading it on first use
+ * 
+ * @param session Session
+ * @return feedbag_store_t* Store (NULL on backend error)
+ */
+static feedbag_store_t *prv_feedbag_get_store(session_t *session);
+
+/**
+ * @brief Handle FEEDBAG_QUERY
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_feedbag_handle_query(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle FEEDBAG_QUERY_IF_MODIFIED
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_feedbag_handle_query_if_modified(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Send stored items as FEEDBAG_REPLY chunks
+ * 
+ * @param conn Connection
+ * @param request_id Request ID of query
+ * @param store Store
+ */
+static void prv_feedbag_send_reply(connection_t *conn, uint32_t request_id, feedbag_store_t *store);
+
+/**
+ * @brief Handle FEEDBAG_INSERT_ITEM, FEEDBAG_UPDATE_ITEM and FEEDBAG_DELETE_ITEM
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ * @param op Edit requested
+ */
+static void prv_feedbag_handle_edit(connection_t *conn, frame_t *frame, feedbag_op_t op);
+
+/**
+ * @brief Handle FEEDBAG_USE, watching every buddy on the feedbag
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_feedbag_handle_use(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle FEEDBAG_START_CLUSTER
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_feedbag_handle_start_cluster(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle FEEDBAG_END_CLUSTER
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_feedbag_handle_end_cluster(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Commit edits and send every staged FEEDBAG_STATUS
+ * 
+ * @param session Session (its store is dropped if the commit fails)
+ * @return true Edits committed
+ * @return false Edits lost
+ */
+static bool prv_feedbag_finish_edits(session_t *session);
+
+/**
+ * @brief Apply buddies gained and lost by committed edits to presence
+ * 
+ * @param session Session
+ */
+static void prv_feedbag_apply_delta(session_t *session);
+
+/**
+ * @brief Watch feedbag buddy
+ * 
+ * Buddies past the BUDDY list limit stay in the feedbag but aren't watched.
+ * 
+ * @param session Session
+ * @param screenname_id Buddy
+ */
+static void prv_feedbag_watch(session_t *session, screenname_id_t screenname_id);
+
+/**
+ * @brief Send FEEDBAG_STATUS with one result per item
+ * 
+ * @param session Session
+ * @param request_id Request ID of edit
+ * @param statuses Results (network byte order)
+ * @param count Number of results
+ */
+static void prv_feedbag_send_status(session_t *session, uint32_t request_id, uint16_t *statuses, uint32_t count);
 
 /*****************************************************************************
  * Private Functions
  *****************************************************************************/
 
 void feedback_handle_rights_query(connection_t *conn, frame_t *frame) {
-    feedback_send_rights_reply(conn);
+    feedback_send_rights_reply(conn, frame->snac.request_id);
 }
 
-void feedback_send_rights_reply(connection_t *conn) {
-    uint16_t payload_length =  sizeof(snac_t);
-    size_t buffer_size = sizeof(flap_t);
-    
-    // Encode SNAC
-    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_FEEDBAG, FEEDBAG_RIGHTS_REPLY, 0, 0);
-    
-    // Create TLVs
-    
-    // Don't love this. Maybe refactor in the future
-    uint16_t max_items_tlv[] = {
-        htons(FEEDBAG_RIGHTS_MAX_ITEMS_BY_CLASS),
-        htons(21),
-        htons(200),
-        htons(61),
-        htons(50),
-        htons(150),
-        htons(0x1),
-        htons(0x1),
-        htons(0x32),
-        htons(0),
-        htons(0),
-        htons(0x3),
-        htons(0),
-        htons(0),
-        htons(0),
-        htons(0x80),
-        htons(0),
-        htons(0),
-        htons(0x0014),
-        htons(0x00C8),
-        htons(0x0001),
-        htons(0x0000),
-        htons(0x0001),
-        htons(0x0000),
-        htons(0x0002),
-        htons(0x0002),
-        htons(0x00FE),
-        htons(0x0003),
-        htons(0x0002),
-        htons(0x01FC),
+void feedback_send_rights_reply(connection_t *conn, uint32_t request_id) {
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_FEEDBAG, FEEDBAG_RIGHTS_REPLY, 0, request_id);
+    
+    // Limits don't change while running, so the TLVs are only encoded once
+    size_t rights_len = 0;
+    const void *rights = feedbag_limits_rights(&rights_len);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = (void *)rights, .iov_len = rights_len },
     };
     
-    tlv_uint16_t max_client_items_tlv = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_CLIENT_ITEMS, 0);
-    payload_length += sizeof(tlv_uint16_t);
+    connection_write_frame(conn, iov, 2);
+}
+
+static feedbag_store_t *prv_feedbag_get_store(session_t *session) {
+    if (session->feedbag == NULL) {
+        session->feedbag = feedbag_store_load(session->screenname_id);
+    }
+    
+    return session->feedbag;
+}
+
+static void prv_feedbag_handle_query(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
     
-    tlv_uint16_t max_item_name_len = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_ITEM_NAME_LEN, 0x61);
-    payload_length += sizeof(tlv_uint16_t);
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
     
-    tlv_uint16_t max_recent_buddies_len = tlv_uint16_encode(FEEDBAG_RIGHTS_MAX_RECENT_BUDDIES, 0xA);
-    payload_length += sizeof(tlv_uint16_t);
+    feedbag_store_t *store = prv_feedbag_get_store(session);
     
-    buffer_size += payload_length;
+    if (store == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+        return;
+    }
     
-    // Encode flap
-    uint16_t sequence_number = conn->last_outbound_seq_num + 1;
-    conn->last_outbound_seq_num = sequence_number;
-    flap_t flap = flap_encode(FLAP_FRAME_TYPE_DATA, sequence_number, payload_length);
+    prv_feedbag_send_reply(conn, frame->snac.request_id, store);
+}
+
+static void prv_feedbag_handle_query_if_modified(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
     
-    // Create outbound buffer
-    buffer_t buffer = buffer_init();
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
     
-    buffer_write(buffer, &flap, sizeof(flap_t));
-    buffer_write(buffer, &snac, sizeof(snac_t));
-    buffer_write(buffer, &max_client_items_tlv, sizeof(max_client_items_tlv));
-    buffer_write(buffer, &max_item_name_len, sizeof(max_item_name_len));
-    buffer_write(buffer, &max_recent_buddies_len, sizeof(max_recent_buddies_len));
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
     
-    if (connection_write(conn, buffer_ptr(buffer), buffer_size) == false) {
-        LOG_ERR("Failed to write to connection.");
+    if (blob_size < (ssize_t)sizeof(feedbag_if_modified_t)) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
     }
     
-    buffer_deinit(buffer);
+    feedbag_if_modified_t client;
+    memcpy(&client, frame->snac_blob, sizeof(feedbag_if_modified_t));
+    
+    uint32_t modified = 0;
+    uint16_t num_items = 0;
+    
+    // Only the row header is needed to tell, items stay in the backend unless they changed
+    if (session->feedbag != NULL) {
+        modified = session->feedbag->blob.modified;
+        num_items = session->feedbag->blob.num_items;
+    } else if (feedbag_store_info(session->screenname_id, &modified, &num_items) == false) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+        return;
+    }
+    
+    if (ntohl(client.modified) != modified || ntohs(client.num_items) != num_items) {
+        prv_feedbag_handle_query(conn, frame);
+        return;
+    }
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_FEEDBAG, FEEDBAG_REPLY_NOT_MODIFIED, 0, frame->snac.request_id);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = &client, .iov_len = sizeof(feedbag_if_modified_t) },
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_feedbag_send_reply(connection_t *conn, uint32_t request_id, feedbag_store_t *store) {
+    uint8_t version = 0;
+    uint32_t modified = htonl(store->blob.modified);
+    
+    size_t offset = 0;
+    feedbag_item_t item;
+    bool more = true;
+    
+    // Stored bytes are already the wire encoding, chunks only need splitting at item boundaries
+    while (more) {
+        size_t chunk_idx = offset;
+        size_t chunk_len = 0;
+        uint16_t count = 0;
+        
+        while (true) {
+            size_t next_offset = offset;
+            
+            if (feedbag_store_next(store, &next_offset, &item) == false) {
+                more = false;
+                break;
+            }
+            
+            if (count > 0 && chunk_len + item.wire_len > FEEDBAG_REPLY_MAX_CHUNK_LEN) {
+                break;
+            }
+            
+            offset = next_offset;
+            chunk_len += item.wire_len;
+            count++;
+        }
+        
+        snac_t snac = snac_encode(SNAC_FOODGROUP_ID_FEEDBAG, FEEDBAG_REPLY, more ? FEEDBAG_SNAC_FLAG_MORE_REPLIES : 0, request_id);
+        uint16_t num_items = htons(count);
+        
+        struct iovec iov[] = {
+            { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+            { .iov_base = &version, .iov_len = sizeof(version) },
+            { .iov_base = &num_items, .iov_len = sizeof(num_items) },
+            { .iov_base = store->blob.items + chunk_idx, .iov_len = chunk_len },
+            { .iov_base = &modified, .iov_len = sizeof(modified) },
+        };
+        
+        // Failed write closes the connection
+        if (connection_write_frame(conn, iov, 5) <= 0) {
+            return;
+        }
+    }
+}
+
+static void prv_feedbag_handle_edit(connection_t *conn, frame_t *frame, feedbag_op_t op) {
+    session_t *session = conn->session;
+    
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    feedbag_store_t *store = prv_feedbag_get_store(session);
+    
+    if (store == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+        return;
+    }
+    
+    uint16_t statuses[FEEDBAG_MAX_EDIT_ITEMS];
+    uint32_t count = 0;
+    
+    uint8_t *blob = frame->snac_blob;
+    size_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    size_t idx = 0;
+    
+    while (idx < blob_size && count < FEEDBAG_MAX_EDIT_ITEMS) {
+        feedbag_item_t item;
+        
+        // Nothing after a malformed item can be located
+        if (feedbag_item_parse(&blob[idx], blob_size - idx, &item) == false) {
+            statuses[count++] = htons(FEEDBAG_STATUS_BAD_REQUEST);
+            break;
+        }
+        
+        statuses[count++] = htons(feedbag_store_apply(store, op, &item));
+        idx += item.wire_len;
+    }
+    
+    bool staged = feedbag_store_stage(store, frame->snac.request_id, statuses, count);
+    
+    // Inside a cluster results wait for its end, unless too much piled up
+    if (staged && store->in_cluster && store->num_staged_statuses < FEEDBAG_CLUSTER_MAX_STATUSES) {
+        return;
+    }
+    
+    bool committed = prv_feedbag_finish_edits(session);
+    
+    if (staged) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < count && committed == false; i++) {
+        if (statuses[i] == htons(FEEDBAG_STATUS_SUCCESS)) {
+            statuses[i] = htons(FEEDBAG_STATUS_DB_ERROR);
+        }
+    }
+    
+    prv_feedbag_send_status(session, frame->snac.request_id, statuses, count);
+}
+
+static void prv_feedbag_handle_use(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
+    
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    feedbag_store_t *store = prv_feedbag_get_store(session);
+    
+    if (store == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+        return;
+    }
+    
+    if (session->feedbag_in_use) {
+        return;
+    }
+    
+    session->feedbag_in_use = true;
+    
+    // Whole list is watched once, every edit after that only moves the delta
+    feedbag_index_clear_delta(&store->index);
+    
+    for (uint32_t i = 0; i < store->index.buddies.count; i++) {
+        prv_feedbag_watch(session, store->index.buddies.refs[i].id);
+    }
+    
+    presence_send_arrivals(session, &session->buddies);
+}
+
+static void prv_feedbag_handle_start_cluster(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
+    
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_FEEDBAG, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    feedbag_store_t *store = prv_feedbag_get_store(session);
+    
+    // Without a store every edit fails on its own anyway
+    if (store != NULL) {
+        store->in_cluster = true;
+    }
+}
+
+static void prv_feedbag_handle_end_cluster(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
+    
+    if (session == NULL || session->feedbag == NULL) {
+        return;
+    }
+    
+    session->feedbag->in_cluster = false;
+    
+    prv_feedbag_finish_edits(session);
+}
+
+static bool prv_feedbag_finish_edits(session_t *session) {
+    feedbag_store_t *store = session->feedbag;
+    
+    // Every edit since the last commit shares one write
+    bool committed = feedbag_store_commit(store);
+    
+    if (committed == false) {
+        for (uint32_t i = 0; i < store->num_staged_statuses; i++) {
+            if (store->staged_statuses[i] == htons(FEEDBAG_STATUS_SUCCESS)) {
+                store->staged_statuses[i] = htons(FEEDBAG_STATUS_DB_ERROR);
+            }
+        }
+    }
+    
+    msgbuf_t replies[CONNECTION_MAX_BATCH_FRAMES];
+    uint32_t num_replies = 0;
+    
+    // Results go out in as few writes as possible, each still answering its own request
+    for (uint32_t i = 0; i < store->num_staged; i++) {
+        feedbag_staged_t *staged = &store->staged[i];
+        snac_t snac = snac_encode(SNAC_FOODGROUP_ID_FEEDBAG, FEEDBAG_STATUS, 0, staged->request_id);
+        
+        struct iovec iov[] = {
+            { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+            { .iov_base = &store->staged_statuses[staged->first_status], .iov_len = staged->num_statuses * sizeof(uint16_t) },
+        };
+        
+        msgbuf_t reply = msgbuf_init(iov, 2);
+        
+        if (reply != NULL) {
+            replies[num_replies++] = reply;
+        }
+        
+        if (num_replies == CONNECTION_MAX_BATCH_FRAMES || (i + 1 == store->num_staged && num_replies > 0)) {
+            session_write_msgbufs(session, replies, num_replies);
+            
+            for (uint32_t j = 0; j < num_replies; j++) {
+                msgbuf_release(replies[j]);
+            }
+            
+            num_replies = 0;
+        }
+    }
+    
+    feedbag_store_clear_staged(store);
+    
+    if (committed) {
+        prv_feedbag_apply_delta(session);
+    }
+    
+    // Edits never made it to the backend, reload on next use
+    if (committed == false) {
+        feedbag_store_free(session->feedbag);
+        session->feedbag = NULL;
+    }
+    
+    return committed;
+}
+
+static void prv_feedbag_apply_delta(session_t *session) {
+    feedbag_index_t *index = &session->feedbag->index;
+    
+    if (session->feedbag_in_use) {
+        buddy_set_iter_t iter;
+        screenname_id_t id;
+        
+        buddy_set_iter_init(&iter, &index->watch_removed);
+        
+        while (buddy_set_iter_next(&iter, &id)) {
+            presence_unwatch(session, id, false);
+        }
+        
+        buddy_set_iter_init(&iter, &index->watch_added);
+        
+        while (buddy_set_iter_next(&iter, &id)) {
+            prv_feedbag_watch(session, id);
+        }
+        
+        presence_send_arrivals(session, &index->watch_added);
+    }
+    
+    feedbag_index_clear_delta(index);
+}
 
+static void prv_feedbag_watch(session_t *session, screenname_id_t screenname_id) {
+    switch(presence_watch(session, screenname_id, false)) {
+    case PRESENCE_WATCH_RET_SUCCESS:
+        break;
+    case PRESENCE_WATCH_RET_LIST_FULL:
+        LOG_WARN("Buddy list of %s is full, not watching %s.", screenname_str(session->screenname_id), screenname_str(screenname_id));
+        break;
+    default:
+        LOG_ERR("Unable to watch buddy. Out of memory?");
+        break;
+    }
+}
+
+static void prv_feedbag_send_status(session_t *session, uint32_t request_id, uint16_t *statuses, uint32_t count) {
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_FEEDBAG, FEEDBAG_STATUS, 0, request_id);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = statuses, .iov_len = count * sizeof(uint16_t) },
+    };
+    
+    session_write_frame(session, iov, 2);
 }
 
 /*****************************************************************************
@@ -180,32 +566,26 @@ void feedback_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("FEEDBAG_RIGHTS_REPLY handler not implemented.");
         break;
     case FEEDBAG_QUERY:
-        // TODO: Implement FEEDBAG_QUERY
-        LOG_INFO("FEEDBAG_QUERY handler not implemented.");
+        prv_feedbag_handle_query(conn, frame);
         break;
     case FEEDBAG_QUERY_IF_MODIFIED:
-        // TODO: Implement FEEDBAG_QUERY_IF_MODIFIED
-        LOG_INFO("FEEDBAG_QUERY_IF_MODIFIED handler not implemented.");
+        prv_feedbag_handle_query_if_modified(conn, frame);
         break;
     case FEEDBAG_REPLY:
         // TODO: Implement FEEDBAG_REPLY
         LOG_INFO("FEEDBAG_REPLY handler not implemented.");
         break;
     case FEEDBAG_USE:
-        // TODO: Implement FEEDBAG_USE
-        LOG_INFO("FEEDBAG_USE handler not implemented.");
+        prv_feedbag_handle_use(conn, frame);
         break;
     case FEEDBAG_INSERT_ITEM:
-        // TODO: Implement FEEDBAG_INSERT_ITEM
-        LOG_INFO("FEEDBAG_INSERT_ITEM handler not implemented.");
+        prv_feedbag_handle_edit(conn, frame, FEEDBAG_OP_INSERT);
         break;
     case FEEDBAG_UPDATE_ITEM:
-        // TODO: Implement FEEDBAG_UPDATE_ITEM
-        LOG_INFO("FEEDBAG_UPDATE_ITEM handler not implemented.");
+        prv_feedbag_handle_edit(conn, frame, FEEDBAG_OP_UPDATE);
         break;
     case FEEDBAG_DELETE_ITEM:
-        // TODO: Implement FEEDBAG_DELETE_ITEM
-        LOG_INFO("FEEDBAG_DELETE_ITEM handler not implemented.");
+        prv_feedbag_handle_edit(conn, frame, FEEDBAG_OP_DELETE);
         break;
     case FEEDBAG_INSERT_CLASS:
         // TODO: Implement FEEDBAG_INSERT_CLASS
@@ -232,12 +612,10 @@ void feedback_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("FEEDBAG_DELETE_USER handler not implemented.");
         break;
     case FEEDBAG_START_CLUSTER:
-        // TODO: Implement FEEDBAG_START_CLUSTER
-        LOG_INFO("FEEDBAG_START_CLUSTER handler not implemented.");
+        prv_feedbag_handle_start_cluster(conn, frame);
         break;
     case FEEDBAG_END_CLUSTER:
-        // TODO: Implement FEEDBAG_END_CLUSTER
-        LOG_INFO("FEEDBAG_END_CLUSTER handler not implemented.");
+        prv_feedbag_handle_end_cluster(conn, frame);
         break;
     case FEEDBAG_AUTHORIZE_BUDDY:
         // TODO: Implement FEEDBAG_AUTHORIZE_BUDDY
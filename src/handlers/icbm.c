@@ -10,12 +10,90 @@
 
 #include "icbm.h"
 
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "session.h"
+#include "session_manager.h"
+
+#include "offline/offline_store.h"
+
+#include "presence/presence.h"
+
+#include "typing/typing_lane.h"
+
+#include "config/config.h"
+
+#include "handlers/snac_error.h"
+
+#include "model/screenname.h"
+#include "model/warning.h"
+
+#include "oscar/icbm_types.h"
+#include "oscar/snac_encoder.h"
+#include "oscar/tlv.h"
+#include "oscar/user_info_encoder.h"
+
+#include "utils/timestamp.h"
+
 #include "logging.h"
 
 /*****************************************************************************
  * Definitions
  *****************************************************************************/
 
+// Cookie (8 bytes) and channel (2 bytes) lead every channel message
+#define ICBM_MESSAGE_HEADER_LEN 10U
+
+// Message TLVs forwarded by reference, split around the ones we drop
+#define ICBM_MAX_TLV_SEGMENTS (CONNECTION_MAX_FRAME_IOVECS - 3U)
+
+// Anonymous flag (2 bytes) and string8 screen name of ICBM_EVIL_REQUEST
+#define ICBM_EVIL_REQUEST_MIN_LEN 3U
+
+// Channels a client may keep open, advertised in ICBM_PARAMETER_REPLY
+#define ICBM_MAX_SLOTS 100U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief ICBM channel message TLV tag IDs
+ * 
+ */
+typedef enum {
+    ICBM_TLV_MESSAGE_DATA       = 0x02,
+    ICBM_TLV_REQUEST_HOST_ACK   = 0x03,
+    ICBM_TLV_AUTO_RESPONSE      = 0x04,
+    ICBM_TLV_RENDEZVOUS_DATA    = 0x05,
+    ICBM_TLV_STORE              = 0x06,
+} icbm_tlv_tag_t;
+
+/**
+ * @brief Channel message parsed in place
+ * 
+ * Every pointer refers into the inbound frame, nothing is copied.
+ */
+typedef struct icbm_message_t {
+    // Cookie and channel, followed directly by the string8 screen name
+    uint8_t *header;
+    uint16_t channel;
+    
+    char *screenname;
+    uint8_t screenname_len;
+    
+    bool host_ack;
+    bool store;
+    
+    // Length of message (or rendezvous) data, checked against ICBM parameters
+    uint16_t data_len;
+    
+    // Remaining TLVs minus the ones only meant for the host
+    struct iovec tlvs[ICBM_MAX_TLV_SEGMENTS];
+    int num_tlv_segments;
+} icbm_message_t;
+
 /*****************************************************************************
  * Variables
  *****************************************************************************/
@@ -24,6 +102,545 @@
  * Prototypes
  *****************************************************************************/
 
+/**
+ * @brief Parse ICBM_CHANNEL_MSG_TOHOST body
+ * 
+ * @param blob SNAC body
+ * @param blob_size Size of SNAC body
+ * @param message Parsed message
+ * @return true Message parsed
+ * @return false Malformed message
+ */
+static bool prv_icbm_parse_message(uint8_t *blob, ssize_t blob_size, icbm_message_t *message);
+
+/**
+ * @brief Handle ICBM_ADD_PARAMETERS
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_icbm_handle_add_parameters(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle ICBM_PARAMETER_QUERY
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_icbm_handle_parameter_query(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle ICBM_CLIENT_EVENT (typing notifications)
+ * 
+ * Events are disposable, anything malformed or undeliverable is dropped
+ * without an error.
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_icbm_handle_client_event(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle ICBM_EVIL_REQUEST
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_icbm_handle_evil_request(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Tell session its warning level changed (OSERVICE_EVIL_NOTIFICATION)
+ * 
+ * @param target Warned session
+ * @param warner Warning session (NULL if anonymous)
+ * @param level New warning level
+ */
+static void prv_icbm_send_evil_notification(session_t *target, session_t *warner, uint16_t level);
+
+/**
+ * @brief Check warning levels of both ends against their ICBM parameters
+ * 
+ * @param sender Sending session
+ * @param recipient Receiving session
+ * @param error Set to error to send when refused
+ * @return true Message allowed
+ * @return false Message refused
+ */
+static bool prv_icbm_check_warning_limits(session_t *sender, session_t *recipient, snac_error_code_t *error);
+
+/**
+ * @brief Handle ICBM_CHANNEL_MSG_TOHOST, routing message to recipient
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_icbm_handle_channel_msg_tohost(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Build ICBM_CHANNEL_MSG_TOCLIENT body (without SNAC header)
+ * 
+ * @param sender Sending session
+ * @param message Message
+ * @param encoded_info Buffer for sender user info (USER_INFO_MAX_ENCODED_LEN)
+ * @param iov Body segments (CONNECTION_MAX_FRAME_IOVECS - 1)
+ * @return int Number of body segments (0 on failure)
+ */
+static int prv_icbm_encode_body(session_t *sender, icbm_message_t *message, uint8_t *encoded_info, struct iovec *iov);
+
+/**
+ * @brief Deliver message to recipient as ICBM_CHANNEL_MSG_TOCLIENT
+ * 
+ * @param sender Sending session
+ * @param recipient Receiving session
+ * @param message Message
+ * @return true Delivered or queued for recipient
+ * @return false Unable to deliver
+ */
+static bool prv_icbm_deliver(session_t *sender, session_t *recipient, icbm_message_t *message);
+
+/**
+ * @brief Keep message for offline recipient
+ * 
+ * @param sender Sending session
+ * @param recipient_id Recipient
+ * @param message Message
+ * @return offline_store_ret_t Result
+ */
+static offline_store_ret_t prv_icbm_store(session_t *sender, screenname_id_t recipient_id, icbm_message_t *message);
+
+/**
+ * @brief Acknowledge message to sender
+ * 
+ * @param conn Sender connection
+ * @param request_id Request ID of message
+ * @param message Message
+ */
+static void prv_icbm_send_host_ack(connection_t *conn, uint32_t request_id, icbm_message_t *message);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static bool prv_icbm_parse_message(uint8_t *blob, ssize_t blob_size, icbm_message_t *message) {
+    if (blob_size < (ssize_t)ICBM_MESSAGE_HEADER_LEN + 1) {
+        return false;
+    }
+    
+    memset(message, 0, sizeof(icbm_message_t));
+    
+    message->header = blob;
+    message->channel = ntohs(*(uint16_t *)&blob[8]);
+    message->screenname_len = blob[ICBM_MESSAGE_HEADER_LEN];
+    message->screenname = (char *)&blob[ICBM_MESSAGE_HEADER_LEN + 1];
+    
+    ssize_t idx = ICBM_MESSAGE_HEADER_LEN + 1 + message->screenname_len;
+    
+    if (idx > blob_size) {
+        return false;
+    }
+    
+    // Start of the run of TLVs being forwarded
+    ssize_t run_start = idx;
+    
+    while (idx < blob_size) {
+        if (idx + (ssize_t)sizeof(tlv_header_t) > blob_size) {
+            return false;
+        }
+        
+        tlv_header_t *header = (tlv_header_t *)&blob[idx];
+        uint16_t tag = ntohs(header->tag);
+        ssize_t tlv_len = sizeof(tlv_header_t) + ntohs(header->length);
+        
+        if (idx + tlv_len > blob_size) {
+            return false;
+        }
+        
+        if (tag == ICBM_TLV_MESSAGE_DATA || tag == ICBM_TLV_RENDEZVOUS_DATA) {
+            message->data_len = ntohs(header->length);
+        }
+        
+        if (tag != ICBM_TLV_REQUEST_HOST_ACK && tag != ICBM_TLV_STORE) {
+            idx += tlv_len;
+            continue;
+        }
+        
+        message->host_ack |= (tag == ICBM_TLV_REQUEST_HOST_ACK);
+        message->store |= (tag == ICBM_TLV_STORE);
+        
+        // Close run in front of dropped TLV
+        if (idx > run_start) {
+            if (message->num_tlv_segments == ICBM_MAX_TLV_SEGMENTS) {
+                return false;
+            }
+            
+            message->tlvs[message->num_tlv_segments].iov_base = &blob[run_start];
+            message->tlvs[message->num_tlv_segments].iov_len = idx - run_start;
+            message->num_tlv_segments++;
+        }
+        
+        idx += tlv_len;
+        run_start = idx;
+    }
+    
+    if (idx > run_start) {
+        if (message->num_tlv_segments == ICBM_MAX_TLV_SEGMENTS) {
+            return false;
+        }
+        
+        message->tlvs[message->num_tlv_segments].iov_base = &blob[run_start];
+        message->tlvs[message->num_tlv_segments].iov_len = idx - run_start;
+        message->num_tlv_segments++;
+    }
+    
+    return true;
+}
+
+static int prv_icbm_encode_body(session_t *sender, icbm_message_t *message, uint8_t *encoded_info, struct iovec *iov) {
+    user_info_block_t info;
+    
+    session_user_info(sender, &info);
+    size_t encoded_len = user_info_encode(encoded_info, USER_INFO_MAX_ENCODED_LEN, &info);
+    
+    if (encoded_len == 0) {
+        return 0;
+    }
+    
+    // Sender info takes the place of the recipient's screen name, TLVs are passed through
+    iov[0].iov_base = message->header;
+    iov[0].iov_len = ICBM_MESSAGE_HEADER_LEN;
+    iov[1].iov_base = encoded_info;
+    iov[1].iov_len = encoded_len;
+    
+    for (int i = 0; i < message->num_tlv_segments; i++) {
+        iov[2 + i] = message->tlvs[i];
+    }
+    
+    return 2 + message->num_tlv_segments;
+}
+
+static bool prv_icbm_deliver(session_t *sender, session_t *recipient, icbm_message_t *message) {
+    uint8_t encoded_info[USER_INFO_MAX_ENCODED_LEN];
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_ICBM, ICBM_CHANNEL_MSG_TOCLIENT, 0, 0);
+    
+    struct iovec iov[CONNECTION_MAX_FRAME_IOVECS] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+    };
+    int body_count = prv_icbm_encode_body(sender, message, encoded_info, &iov[1]);
+    
+    if (body_count == 0) {
+        return false;
+    }
+    
+    return session_write_frame(recipient, iov, 1 + body_count);
+}
+
+static offline_store_ret_t prv_icbm_store(session_t *sender, screenname_id_t recipient_id, icbm_message_t *message) {
+    uint8_t encoded_info[USER_INFO_MAX_ENCODED_LEN];
+    struct iovec iov[CONNECTION_MAX_FRAME_IOVECS - 1];
+    int body_count = prv_icbm_encode_body(sender, message, encoded_info, iov);
+    
+    if (body_count == 0) {
+        return OFFLINE_STORE_ERROR;
+    }
+    
+    return offline_store_append(recipient_id, iov, body_count);
+}
+
+static void prv_icbm_send_host_ack(connection_t *conn, uint32_t request_id, icbm_message_t *message) {
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_ICBM, ICBM_HOST_ACK, 0, request_id);
+    
+    // Cookie, channel and screen name are echoed straight out of the request
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = message->header, .iov_len = ICBM_MESSAGE_HEADER_LEN + 1 + message->screenname_len },
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_icbm_handle_add_parameters(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
+    
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (blob_size < (ssize_t)sizeof(icbm_params_wire_t)) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    icbm_params_wire_t wire;
+    memcpy(&wire, frame->snac_blob, sizeof(icbm_params_wire_t));
+    
+    config_t *config = config_get();
+    icbm_params_t *params = &session->icbm_params;
+    
+    // Only one set of parameters is kept, whatever the channel. Clients may tighten host limits but not loosen them.
+    params->flags = ntohl(wire.flags);
+    params->min_interval_ms = ntohl(wire.min_interval_ms);
+    params->max_message_len = ntohs(wire.max_message_len);
+    params->max_sender_warn = ntohs(wire.max_sender_warn);
+    params->max_receiver_warn = ntohs(wire.max_receiver_warn);
+    
+    if (params->min_interval_ms < config->icbm_min_interval_ms) {
+        params->min_interval_ms = config->icbm_min_interval_ms;
+    }
+    
+    if (params->max_message_len > config->icbm_max_message_len) {
+        params->max_message_len = config->icbm_max_message_len;
+    }
+    
+    if (params->max_sender_warn > config->icbm_max_sender_warn) {
+        params->max_sender_warn = config->icbm_max_sender_warn;
+    }
+    
+    if (params->max_receiver_warn > config->icbm_max_receiver_warn) {
+        params->max_receiver_warn = config->icbm_max_receiver_warn;
+    }
+}
+
+static void prv_icbm_handle_parameter_query(connection_t *conn, frame_t *frame) {
+    config_t *config = config_get();
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_ICBM, ICBM_PARAMETER_REPLY, 0, frame->snac.request_id);
+    
+    icbm_params_reply_t reply = {
+        .max_slots = htons(ICBM_MAX_SLOTS),
+        .flags = htonl(ICBM_PARAMS_DEFAULT_FLAGS),
+        .max_message_len = htons(config->icbm_max_message_len),
+        .max_sender_warn = htons(config->icbm_max_sender_warn),
+        .max_receiver_warn = htons(config->icbm_max_receiver_warn),
+        .min_interval_ms = htonl(config->icbm_min_interval_ms),
+    };
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = &reply, .iov_len = sizeof(reply) },
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_icbm_handle_client_event(connection_t *conn, frame_t *frame) {
+    session_t *sender = conn->session;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (sender == NULL || blob_size < (ssize_t)TYPING_LANE_HEADER_LEN + 1) {
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    uint8_t screenname_len = blob[TYPING_LANE_HEADER_LEN];
+    ssize_t event_idx = TYPING_LANE_HEADER_LEN + 1 + screenname_len;
+    
+    if (event_idx + (ssize_t)sizeof(uint16_t) > blob_size) {
+        return;
+    }
+    
+    screenname_id_t recipient_id = screenname_find((char *)&blob[TYPING_LANE_HEADER_LEN + 1], screenname_len);
+    session_t *recipient = session_manager_find(recipient_id);
+    
+    // Only clients that asked for events get them
+    if (recipient == NULL || (recipient->icbm_params.flags & ICBM_PARAM_FLAG_EVENTS_ALLOWED) == 0) {
+        return;
+    }
+    
+    typing_lane_enqueue(sender, recipient_id, blob, ntohs(*(uint16_t *)&blob[event_idx]));
+}
+
+static void prv_icbm_handle_evil_request(connection_t *conn, frame_t *frame) {
+    session_t *warner = conn->session;
+    
+    if (warner == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (blob_size < (ssize_t)ICBM_EVIL_REQUEST_MIN_LEN || blob_size < (ssize_t)ICBM_EVIL_REQUEST_MIN_LEN + blob[2]) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    bool anonymous = (ntohs(*(uint16_t *)blob) != 0);
+    screenname_id_t target_id = screenname_find((char *)&blob[ICBM_EVIL_REQUEST_MIN_LEN], blob[2]);
+    session_t *target = session_manager_find(target_id);
+    
+    if (target == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    // Only users that messaged the warner can be warned, and only a few times
+    if (target == warner || !session_allow_warning(warner, target_id, timestamp_monotonic_ms())) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_REQUEST_DENIED);
+        return;
+    }
+    
+    uint16_t previous = session_warning_level(target);
+    uint16_t level = session_warn(target, anonymous ? WARNING_LEVEL_ANONYMOUS_DELTA : WARNING_LEVEL_NORMAL_DELTA);
+    
+    prv_icbm_send_evil_notification(target, anonymous ? NULL : warner, level);
+    
+    // Watchers get the new level with the next presence flush
+    presence_status_changed(target);
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_ICBM, ICBM_EVIL_REPLY, 0, frame->snac.request_id);
+    uint16_t reply[] = {
+        htons(level - previous),
+        htons(level),
+    };
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = reply, .iov_len = sizeof(reply) },
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_icbm_send_evil_notification(session_t *target, session_t *warner, uint16_t level) {
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_OSERVICE, OSERVICE_EVIL_NOTIFICATION, 0, 0);
+    uint16_t level_be = htons(level);
+    uint8_t encoded_info[USER_INFO_MAX_ENCODED_LEN];
+    size_t encoded_len = 0;
+    
+    // Warner is only named when the warning wasn't anonymous
+    if (warner != NULL) {
+        user_info_block_t info;
+        
+        session_user_info(warner, &info);
+        encoded_len = user_info_encode_brief(encoded_info, sizeof(encoded_info), &info);
+    }
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = &level_be, .iov_len = sizeof(uint16_t) },
+        { .iov_base = encoded_info, .iov_len = encoded_len },
+    };
+    
+    session_write_frame(target, iov, encoded_len > 0 ? 3 : 2);
+}
+
+static bool prv_icbm_check_warning_limits(session_t *sender, session_t *recipient, snac_error_code_t *error) {
+    // Limits at the maximum can't be exceeded, skip working out the level
+    uint16_t max_sender_warn = recipient->icbm_params.max_sender_warn;
+    
+    if (max_sender_warn < WARNING_LEVEL_MAX && session_warning_level(sender) > max_sender_warn) {
+        *error = SNAC_ERROR_TOO_EVIL_SENDER;
+        return false;
+    }
+    
+    uint16_t max_receiver_warn = sender->icbm_params.max_receiver_warn;
+    
+    if (max_receiver_warn < WARNING_LEVEL_MAX && session_warning_level(recipient) > max_receiver_warn) {
+        *error = SNAC_ERROR_TOO_EVIL_RECIPIENT;
+        return false;
+    }
+    
+    return true;
+}
+
+static void prv_icbm_handle_channel_msg_tohost(connection_t *conn, frame_t *frame) {
+    session_t *sender = conn->session;
+    
+    if (sender == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    // Rate is checked before anything else so floods cost a clock read
+    icbm_params_t *params = &sender->icbm_params;
+    uint64_t now_ms = 0;
+    
+    if (params->min_interval_ms > 0) {
+        now_ms = timestamp_monotonic_ms();
+        
+        if (now_ms - sender->last_icbm_ms < params->min_interval_ms) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_RATE_TO_HOST);
+            return;
+        }
+    }
+    
+    icbm_message_t message;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (!prv_icbm_parse_message(frame->snac_blob, blob_size, &message)) {
+        LOG_ERR("Malformed ICBM channel message.");
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    // Parsing is done in place, the session directory hasn't been touched yet
+    if (message.data_len > params->max_message_len) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_REQUEST_DENIED);
+        return;
+    }
+    
+    sender->last_icbm_ms = now_ms;
+    
+    // Users that were never interned can't have a session
+    screenname_id_t recipient_id = screenname_find(message.screenname, message.screenname_len);
+    session_t *recipient = session_manager_find(recipient_id);
+    snac_error_code_t error;
+    
+    if (recipient != NULL && !prv_icbm_check_warning_limits(sender, recipient, &error)) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, error);
+        return;
+    }
+    
+    bool delivered = false;
+    
+    if (recipient != NULL) {
+        delivered = prv_icbm_deliver(sender, recipient, &message);
+        
+        if (delivered) {
+            // Recipient may now warn sender
+            session_note_icbm_sender(recipient, sender->screenname_id, timestamp_monotonic_ms());
+        } else {
+            LOG_WARN("Unable to deliver ICBM to %s.", screenname_str(recipient_id));
+        }
+    }
+    
+    // Sending to ourselves may have taken the connection with it
+    if (sender->conn != conn) {
+        return;
+    }
+    
+    // Never acknowledge a message that went nowhere, keep it for later if the sender allows
+    if (!delivered) {
+        if (!message.store) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, (recipient == NULL) ? SNAC_ERROR_NOT_LOGGED_ON : SNAC_ERROR_QUEUE_FULL);
+            return;
+        }
+        
+        // Store holds its own reference to the recipient
+        recipient_id = screenname_intern(message.screenname, message.screenname_len);
+        offline_store_ret_t ret = prv_icbm_store(sender, recipient_id, &message);
+        screenname_release(recipient_id);
+        
+        if (ret == OFFLINE_STORE_FULL) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_QUEUE_FULL);
+            return;
+        }
+        
+        if (ret != OFFLINE_STORE_OK) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_ICBM, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+            return;
+        }
+    }
+    
+    if (message.host_ack) {
+        prv_icbm_send_host_ack(conn, frame->snac.request_id, &message);
+    }
+}
+
 /*****************************************************************************
  * Functions
  *****************************************************************************/
@@ -35,32 +652,28 @@ void icbm_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("ICBM_ERR not implemented.");
         break;
     case ICBM_ADD_PARAMETERS:
-        // TODO: Implement ICBM_ADD_PARAMETERS
-        LOG_INFO("ICBM_ADD_PARAMETERS not implemented.");
+        prv_icbm_handle_add_parameters(conn, frame);
         break;
     case ICBM_DEL_PARAMETERS:
         // TODO: Implement ICBM_DEL_PARAMETERS
         LOG_INFO("ICBM_DEL_PARAMETERS not implemented.");
         break;
     case ICBM_PARAMETER_QUERY:
-        // TODO: Implement ICBM_PARAMETER_QUERY
-        LOG_INFO("ICBM_PARAMETER_QUERY not implemented.");
+        prv_icbm_handle_parameter_query(conn, frame);
         break;
     case ICBM_PARAMETER_REPLY:
         // TODO: Implement ICBM_PARAMETER_REPLY
         LOG_INFO("ICBM_PARAMETER_REPLY not implemented.");
         break;
     case ICBM_CHANNEL_MSG_TOHOST:
-        // TODO: Implement ICBM_CHANNEL_MSG_TOHOST
-        LOG_INFO("ICBM_CHANNEL_MSG_TOHOST not implemented.");
+        prv_icbm_handle_channel_msg_tohost(conn, frame);
         break;
     case ICBM_CHANNEL_MSG_TOCLIENT:
         // TODO: Implement ICBM_CHANNEL_MSG_TOCLIENT
         LOG_INFO("ICBM_CHANNEL_MSG_TOCLIENT not implemented.");
         break;
     case ICBM_EVIL_REQUEST:
-        // TODO: Implement ICBM_EVIL_REQUEST
-        LOG_INFO("ICBM_EVIL_REQUEST not implemented.");
+        prv_icbm_handle_evil_request(conn, frame);
         break;
     case ICBM_EVIL_REPLY:
         // TODO: Implement ICBM_EVIL_REPLY
@@ -107,8 +720,7 @@ void icbm_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("ICBM_NOTIFY_REPLY not implemented.");
         break;
     case ICBM_CLIENT_EVENT:
-        // TODO: Implement ICBM_CLIENT_EVENT
-        LOG_INFO("ICBM_CLIENT_EVENT not implemented.");
+        prv_icbm_handle_client_event(conn, frame);
         break;
     case ICBM_SIN_REPLY:
         // TODO: Implement ICBM_SIN_REPLY
@@ -5,12 +5,34 @@
 /**
  * @file locate.c
  * @author Evan Stoddard
- * @brief 
+ * @brief LOCATE SNAC Handler
  */
 
 #include "locate.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "session.h"
+#include "session_manager.h"
+
+#include "presence/presence.h"
+
+#include "locate/locate_store.h"
+#include "locate/locate_cache.h"
+
+#include "directory/dir_index.h"
+
+#include "handlers/snac_error.h"
+
+#include "model/screenname.h"
+
+#include "backends/backend.h"
+
 #include "oscar/flap.h"
+#include "oscar/locate_types.h"
+#include "oscar/odir_types.h"
 #include "oscar/tlv.h"
 
 #include "oscar/flap_decoder.h"
@@ -21,7 +43,10 @@
 #include "oscar/flap_encoder.h"
 #include "oscar/snac_encoder.h"
 
+#include "oscar/user_info_encoder.h"
+
 #include "memory/buffer.h"
+#include "memory/msgbuf.h"
 
 #include "logging.h"
 
@@ -29,7 +54,17 @@
  * Definitions
  *****************************************************************************/
 
-#define LOCATE_MAX_SIGNATURE_LEN    127
+// Request type (2 bytes) and string8 screen name of LOCATE_USER_INFO_QUERY
+#define LOCATE_USER_INFO_QUERY_MIN_LEN 3U
+
+// Flags (4 bytes) and string8 screen name of LOCATE_USER_INFO_QUERY2
+#define LOCATE_USER_INFO_QUERY2_MIN_LEN 5U
+
+// Longest email address looked up by LOCATE_FIND_LIST_BY_EMAIL
+#define LOCATE_MAX_EMAIL_LEN 254U
+
+// Highest info TLV tag kept from LOCATE_SET_INFO
+#define LOCATE_INFO_TLV_MAX LOCATE_INFO_TLV_CAPABILITIES
 
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
@@ -78,6 +113,112 @@ void prv_locate_handle_rights_query(connection_t *conn, frame_t *frame);
  */
 void prv_locate_send_rights_reply(connection_t *conn);
 
+/**
+ * @brief Find info TLVs in LOCATE_SET_INFO payload
+ * 
+ * @param blob Payload
+ * @param blob_size Size of payload
+ * @param tlvs Set to whole TLV (header included) for each known tag, indexed by tag
+ * @return true Payload well formed
+ * @return false Payload malformed
+ */
+static bool prv_locate_parse_info(uint8_t *blob, ssize_t blob_size, struct iovec *tlvs);
+
+/**
+ * @brief Replace stored blob with new contents
+ * 
+ * Empty contents clear the blob. The old blob is only released once the
+ * new one is stored, so setting the same info again never copies it.
+ * 
+ * @param slot Blob to replace
+ * @param iov Contents
+ * @param iov_count Number of segments
+ * @param value_len Length of the value being set (0 clears)
+ */
+static void prv_locate_replace(locate_blob_t **slot, const struct iovec *iov, int iov_count, uint16_t value_len);
+
+/**
+ * @brief Handle LOCATE_SET_INFO
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_locate_handle_set_info(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle LOCATE_USER_INFO_QUERY
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_locate_handle_user_info_query(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle LOCATE_USER_INFO_QUERY2
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_locate_handle_user_info_query2(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Encode body of LOCATE_USER_INFO_REPLY
+ * 
+ * @param target User asked about
+ * @param flags Requested info (LOCATE_QUERY2_FLAG_*)
+ * @param warning_level Set to warning level encoded
+ * @return msgbuf_t Body holding one reference (NULL if out of memory)
+ */
+static msgbuf_t prv_locate_encode_user_info(session_t *target, uint32_t flags, uint16_t *warning_level);
+
+/**
+ * @brief Send LOCATE_USER_INFO_REPLY, encoding it only if no cached reply is still valid
+ * 
+ * @param conn Connection
+ * @param request_id Request ID being answered
+ * @param target User asked about
+ * @param flags Requested info (LOCATE_QUERY2_FLAG_*)
+ */
+static void prv_locate_send_user_info(connection_t *conn, uint32_t request_id, session_t *target, uint32_t flags);
+
+/**
+ * @brief Handle LOCATE_FIND_LIST_BY_EMAIL
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_locate_handle_find_list_by_email(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Handle LOCATE_SET_DIR_INFO and LOCATE_SET_KEYWORD_INFO
+ * 
+ * Both replace one half of the directory entry of the user, the other
+ * half is carried over from the index.
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ * @param keywords Frame sets keywords (directory info otherwise)
+ */
+static void prv_locate_handle_set_dir_entry(connection_t *conn, frame_t *frame, bool keywords);
+
+/**
+ * @brief Send LOCATE_SET_DIR_REPLY or LOCATE_SET_KEYWORD_REPLY
+ * 
+ * @param conn Connection
+ * @param request_id Request ID of set
+ * @param keywords Reply to keyword set
+ * @param result Result code
+ */
+static void prv_locate_send_set_dir_reply(connection_t *conn, uint32_t request_id, bool keywords, dir_set_result_t result);
+
+/**
+ * @brief Handle LOCATE_GET_DIR_INFO
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_locate_handle_get_dir_info(connection_t *conn, frame_t *frame);
+
 /*****************************************************************************
  * Private Functions
  *****************************************************************************/
@@ -97,10 +238,10 @@ void prv_locate_send_rights_reply(connection_t *conn) {
     tlv_uint16_t sig_len_tlv = tlv_uint16_encode(LOCATE_TLV_TAGS_RIGHTS_MAX_SIG_LEN, LOCATE_MAX_SIGNATURE_LEN);
     payload_length += sizeof(tlv_uint16_t);
     
-    tlv_uint16_t capabilities_tlv = tlv_uint16_encode(LOCATE_TLV_TAGS_RIGHTS_MAX_CAPABILITIES_LEN, 0);
+    tlv_uint16_t capabilities_tlv = tlv_uint16_encode(LOCATE_TLV_TAGS_RIGHTS_MAX_CAPABILITIES_LEN, LOCATE_MAX_CAPABILITIES);
     payload_length += sizeof(tlv_uint16_t);
     
-    tlv_uint16_t email_count_tlv = tlv_uint16_encode(LOCATE_TLV_TAGS_RIGHTS_MAX_FIND_BY_EMAIL_LIST, 0xA);
+    tlv_uint16_t email_count_tlv = tlv_uint16_encode(LOCATE_TLV_TAGS_RIGHTS_MAX_FIND_BY_EMAIL_LIST, LOCATE_MAX_FIND_BY_EMAIL_LIST);
     payload_length += sizeof(tlv_uint16_t);
     
     tlv_uint16_t cert_len_tlv = tlv_uint16_encode(LOCATE_TLV_TAGS_RIGHTS_MAX_CERTS_LEN, 0x1000);
@@ -130,6 +271,428 @@ void prv_locate_send_rights_reply(connection_t *conn) {
     buffer_deinit(buffer);
 }
 
+static bool prv_locate_parse_info(uint8_t *blob, ssize_t blob_size, struct iovec *tlvs) {
+    ssize_t idx = 0;
+    
+    memset(tlvs, 0, (LOCATE_INFO_TLV_MAX + 1) * sizeof(struct iovec));
+    
+    while (idx < blob_size) {
+        if (idx + (ssize_t)sizeof(tlv_header_t) > blob_size) {
+            return false;
+        }
+        
+        tlv_header_t *header = (tlv_header_t *)&blob[idx];
+        uint16_t tag = ntohs(header->tag);
+        ssize_t tlv_len = sizeof(tlv_header_t) + ntohs(header->length);
+        
+        if (idx + tlv_len > blob_size) {
+            return false;
+        }
+        
+        // TLVs are stored as sent, so keep the header with the value
+        if (tag > 0 && tag <= LOCATE_INFO_TLV_MAX) {
+            tlvs[tag].iov_base = header;
+            tlvs[tag].iov_len = tlv_len;
+        }
+        
+        idx += tlv_len;
+    }
+    
+    return true;
+}
+
+static void prv_locate_replace(locate_blob_t **slot, const struct iovec *iov, int iov_count, uint16_t value_len) {
+    locate_blob_t *blob = NULL;
+    
+    if (value_len > 0) {
+        blob = locate_store_intern(iov, iov_count);
+        
+        // Keep what was set before rather than losing it
+        if (blob == NULL) {
+            return;
+        }
+    }
+    
+    locate_store_release(*slot);
+    *slot = blob;
+}
+
+static void prv_locate_handle_set_info(connection_t *conn, frame_t *frame) {
+    session_t *session = conn->session;
+    
+    if (session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    struct iovec tlvs[LOCATE_INFO_TLV_MAX + 1];
+    
+    if (prv_locate_parse_info(frame->snac_blob, frame->flap.payload_length - sizeof(snac_t), tlvs) == false) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    struct iovec *sig = &tlvs[LOCATE_INFO_TLV_SIG];
+    struct iovec *unavailable = &tlvs[LOCATE_INFO_TLV_UNAVAILABLE];
+    struct iovec *capabilities = &tlvs[LOCATE_INFO_TLV_CAPABILITIES];
+    
+    uint16_t sig_len = sig->iov_len > 0 ? sig->iov_len - sizeof(tlv_header_t) : 0;
+    uint16_t unavailable_len = unavailable->iov_len > 0 ? unavailable->iov_len - sizeof(tlv_header_t) : 0;
+    uint16_t capabilities_len = capabilities->iov_len > 0 ? capabilities->iov_len - sizeof(tlv_header_t) : 0;
+    
+    if (sig_len > LOCATE_MAX_SIGNATURE_LEN || unavailable_len > LOCATE_MAX_SIGNATURE_LEN ||
+        capabilities_len > LOCATE_MAX_CAPABILITIES * LOCATE_CAPABILITY_LEN ||
+        capabilities_len % LOCATE_CAPABILITY_LEN != 0) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_REQUEST_DENIED);
+        return;
+    }
+    
+    // Text is stored together with its MIME type, each pair replaced as a whole
+    if (sig->iov_base != NULL) {
+        prv_locate_replace(&session->profile, &tlvs[LOCATE_INFO_TLV_SIG_MIME], 2, sig_len);
+    }
+    
+    if (unavailable->iov_base != NULL) {
+        prv_locate_replace(&session->away_message, &tlvs[LOCATE_INFO_TLV_UNAVAILABLE_MIME], 2, unavailable_len);
+    }
+    
+    if (capabilities->iov_base != NULL) {
+        prv_locate_replace(&session->capabilities, capabilities, 1, capabilities_len);
+    }
+    
+    // Replies cached for others asking about us are stale now
+    session->info_generation++;
+    
+    uint16_t user_class = session->user_class & ~USER_CLASS_AWAY;
+    
+    if (session->away_message != NULL) {
+        user_class |= USER_CLASS_AWAY;
+    }
+    
+    // Watchers see the away flag with the next presence flush
+    if (user_class != session->user_class) {
+        session->user_class = user_class;
+        presence_status_changed(session);
+    }
+}
+
+static void prv_locate_handle_user_info_query(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (blob_size < (ssize_t)LOCATE_USER_INFO_QUERY_MIN_LEN || blob_size < (ssize_t)LOCATE_USER_INFO_QUERY_MIN_LEN + blob[2]) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    uint16_t type = ntohs(*(uint16_t *)blob);
+    screenname_id_t target_id = screenname_find((char *)&blob[LOCATE_USER_INFO_QUERY_MIN_LEN], blob[2]);
+    session_t *target = session_manager_find(target_id);
+    
+    if (target == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint32_t flags = 0;
+    
+    switch (type) {
+    case LOCATE_QUERY_TYPE_SIG:
+        flags = LOCATE_QUERY2_FLAG_SIG;
+        break;
+    case LOCATE_QUERY_TYPE_UNAVAILABLE:
+        flags = LOCATE_QUERY2_FLAG_UNAVAILABLE;
+        break;
+    case LOCATE_QUERY_TYPE_CAPABILITIES:
+        flags = LOCATE_QUERY2_FLAG_CAPABILITIES;
+        break;
+    default:
+        break;
+    }
+    
+    prv_locate_send_user_info(conn, frame->snac.request_id, target, flags);
+}
+
+static void prv_locate_handle_user_info_query2(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (blob_size < (ssize_t)LOCATE_USER_INFO_QUERY2_MIN_LEN || blob_size < (ssize_t)LOCATE_USER_INFO_QUERY2_MIN_LEN + blob[4]) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    uint32_t flags = ntohl(*(uint32_t *)blob);
+    screenname_id_t target_id = screenname_find((char *)&blob[LOCATE_USER_INFO_QUERY2_MIN_LEN], blob[4]);
+    session_t *target = session_manager_find(target_id);
+    
+    if (target == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    // Info we don't keep would only split the cache
+    prv_locate_send_user_info(conn, frame->snac.request_id, target, flags & LOCATE_QUERY2_FLAGS_SUPPORTED);
+}
+
+static msgbuf_t prv_locate_encode_user_info(session_t *target, uint32_t flags, uint16_t *warning_level) {
+    uint8_t encoded_info[USER_INFO_MAX_ENCODED_LEN];
+    user_info_block_t info;
+    
+    session_user_info(target, &info);
+    size_t encoded_len = user_info_encode(encoded_info, sizeof(encoded_info), &info);
+    
+    if (encoded_len == 0) {
+        return NULL;
+    }
+    
+    *warning_level = info.warning_level;
+    
+    // Stored TLVs are appended as they are, in the order they were asked for
+    struct iovec iov[] = {
+        { .iov_base = encoded_info, .iov_len = encoded_len },
+        locate_blob_iovec((flags & LOCATE_QUERY2_FLAG_SIG) ? target->profile : NULL),
+        locate_blob_iovec((flags & LOCATE_QUERY2_FLAG_UNAVAILABLE) ? target->away_message : NULL),
+        locate_blob_iovec((flags & LOCATE_QUERY2_FLAG_CAPABILITIES) ? target->capabilities : NULL),
+    };
+    
+    return msgbuf_init(iov, sizeof(iov) / sizeof(iov[0]));
+}
+
+static void prv_locate_send_user_info(connection_t *conn, uint32_t request_id, session_t *target, uint32_t flags) {
+    msgbuf_t body = locate_cache_find(&target->info_cache, flags, target->info_generation, session_warning_level(target));
+    
+    if (body == NULL) {
+        uint16_t warning_level = 0;
+        
+        body = prv_locate_encode_user_info(target, flags, &warning_level);
+        
+        if (body == NULL) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+            return;
+        }
+        
+        locate_cache_put(&target->info_cache, flags, target->info_generation, warning_level, body);
+    }
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_LOCATE, LOCATE_USER_INFO_REPLY, 0, request_id);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        msgbuf_iovec(body),
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_locate_handle_find_list_by_email(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    char emails[LOCATE_MAX_FIND_BY_EMAIL_LIST][LOCATE_MAX_EMAIL_LEN + 1];
+    const char *email_ptrs[LOCATE_MAX_FIND_BY_EMAIL_LIST];
+    uint32_t count = 0;
+    ssize_t idx = 0;
+    
+    // Addresses are back to back string16s
+    while (idx < blob_size) {
+        if (idx + (ssize_t)sizeof(uint16_t) > blob_size) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+            return;
+        }
+        
+        uint16_t len = ntohs(*(uint16_t *)&blob[idx]);
+        idx += sizeof(uint16_t);
+        
+        if (idx + len > blob_size || len > LOCATE_MAX_EMAIL_LEN) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+            return;
+        }
+        
+        if (count == LOCATE_MAX_FIND_BY_EMAIL_LIST) {
+            snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_LIST_OVERFLOW);
+            return;
+        }
+        
+        memcpy(emails[count], &blob[idx], len);
+        emails[count][len] = '\0';
+        email_ptrs[count] = emails[count];
+        count++;
+        
+        idx += len;
+    }
+    
+    if (count == 0) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    char *uins[LOCATE_MAX_FIND_BY_EMAIL_LIST];
+    
+    if (backend_fetch_uins_with_emails(email_ptrs, count, uins) != BACKEND_RET_SUCCESS) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_SERVICE_UNAVAILABLE);
+        return;
+    }
+    
+    // Matched screen names as string8s, in the order the addresses were asked for
+    uint8_t names[LOCATE_MAX_FIND_BY_EMAIL_LIST * (1 + SCREENNAME_MAX_LEN)];
+    size_t names_len = 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        if (uins[i] == NULL) {
+            continue;
+        }
+        
+        const char *name = uins[i];
+        size_t len = strlen(name);
+        
+        // Online users are named the way they want to be seen
+        session_t *session = session_manager_find(screenname_find(name, len));
+        
+        if (session != NULL) {
+            name = session->formatted_name;
+            len = session->formatted_name_len;
+        }
+        
+        if (len <= SCREENNAME_MAX_LEN) {
+            names[names_len] = len;
+            memcpy(&names[names_len + 1], name, len);
+            names_len += 1 + len;
+        }
+        
+        free(uins[i]);
+    }
+    
+    if (names_len == 0) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NO_MATCH);
+        return;
+    }
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_LOCATE, LOCATE_FIND_LIST_REPLY, 0, frame->snac.request_id);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = names, .iov_len = names_len },
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_locate_handle_set_dir_entry(connection_t *conn, frame_t *frame, bool keywords) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    uint16_t count = 0;
+    
+    if (!dir_index_count_tlvs(blob, blob_size, &count)) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    if (blob_size > (ssize_t)DIR_MAX_INFO_LEN) {
+        prv_locate_send_set_dir_reply(conn, frame->snac.request_id, keywords, DIR_SET_RESULT_FAILURE);
+        return;
+    }
+    
+    const char *uin = screenname_str(conn->session->screenname_id);
+    const dir_doc_t *doc = dir_index_find(uin);
+    
+    dir_entry_t entry = {
+        .uin = uin,
+        .info = doc != NULL ? doc->info : NULL,
+        .info_len = doc != NULL ? doc->info_len : 0,
+        .keywords = doc != NULL ? doc->keywords : NULL,
+        .keywords_len = doc != NULL ? doc->keywords_len : 0,
+    };
+    
+    if (keywords) {
+        entry.keywords = blob;
+        entry.keywords_len = blob_size;
+    } else {
+        entry.info = blob;
+        entry.info_len = blob_size;
+    }
+    
+    if (backend_store_dir_entry(&entry) != BACKEND_RET_SUCCESS) {
+        prv_locate_send_set_dir_reply(conn, frame->snac.request_id, keywords, DIR_SET_RESULT_FAILURE);
+        return;
+    }
+    
+    // Searches here see it right away, other servers on their next sync
+    dir_index_update(&entry);
+    
+    prv_locate_send_set_dir_reply(conn, frame->snac.request_id, keywords, DIR_SET_RESULT_SUCCESS);
+}
+
+static void prv_locate_send_set_dir_reply(connection_t *conn, uint32_t request_id, bool keywords, dir_set_result_t result) {
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_LOCATE, keywords ? LOCATE_SET_KEYWORD_REPLY : LOCATE_SET_DIR_REPLY, 0, request_id);
+    uint16_t result_be = htons(result);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = &result_be, .iov_len = sizeof(uint16_t) },
+    };
+    
+    connection_write_frame(conn, iov, 2);
+}
+
+static void prv_locate_handle_get_dir_info(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    
+    if (blob_size < 1 || blob_size < 1 + blob[0]) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_LOCATE, frame->snac.request_id, SNAC_ERROR_BUSTED_SNAC_PAYLOAD);
+        return;
+    }
+    
+    char uin[SCREENNAME_MAX_LEN + 1];
+    const dir_doc_t *doc = NULL;
+    
+    if (screenname_normalize(uin, sizeof(uin), (char *)&blob[1], blob[0]) > 0) {
+        doc = dir_index_find(uin);
+    }
+    
+    // Status, then the entry as a counted TLV block
+    uint16_t header[] = {
+        htons(doc != NULL ? DIR_GET_STATUS_FOUND : DIR_GET_STATUS_NOT_FOUND),
+        htons(doc != NULL ? doc->info_count : 0),
+    };
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_LOCATE, LOCATE_GET_DIR_REPLY, 0, frame->snac.request_id);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = header, .iov_len = sizeof(header) },
+        { .iov_base = doc != NULL ? doc->info : NULL, .iov_len = doc != NULL ? doc->info_len : 0 },
+    };
+    
+    connection_write_frame(conn, iov, 3);
+}
+
 /*****************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -148,12 +711,10 @@ void locate_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("LOCATE_RIGHTS_REPLY handler not implemented.");
         break;
     case LOCATE_SET_INFO:
-        // TODO: Implement LOCATE_SET_INFO
-        LOG_INFO("LOCATE_SET_INFO handler not implemented.");
+        prv_locate_handle_set_info(conn, frame);
         break;
     case LOCATE_USER_INFO_QUERY:
-        // TODO: Implement LOCATE_USER_INFO_QUERY
-        LOG_INFO("LOCATE_USER_INFO_QUERY handler not implemented.");
+        prv_locate_handle_user_info_query(conn, frame);
         break;
     case LOCATE_USER_INFO_REPLY:
         // TODO: Implement LOCATE_USER_INFO_REPLY
@@ -168,16 +729,14 @@ void locate_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("LOCATE_WATCHER_NOTIFICATION handler not implemented.");
         break;
     case LOCATE_SET_DIR_INFO:
-        // TODO: Implement LOCATE_SET_DIR_INFO
-        LOG_INFO("LOCATE_SET_DIR_INFO handler not implemented.");
+        prv_locate_handle_set_dir_entry(conn, frame, false);
         break;
     case LOCATE_SET_DIR_REPLY:
         // TODO: Implement LOCATE_SET_DIR_REPLY
         LOG_INFO("LOCATE_SET_DIR_REPLY handler not implemented.");
         break;
     case LOCATE_GET_DIR_INFO:
-        // TODO: Implement LOCATE_GET_DIR_INFO
-        LOG_INFO("LOCATE_GET_DIR_INFO handler not implemented.");
+        prv_locate_handle_get_dir_info(conn, frame);
         break;
     case LOCATE_GET_DIR_REPLY:
         // TODO: Implement LOCATE_GET_DIR_REPLY
@@ -192,8 +751,7 @@ void locate_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("LOCATE_GROUP_CAPABILITY_REPLY handler not implemented.");
         break;
     case LOCATE_SET_KEYWORD_INFO:
-        // TODO: Implement LOCATE_SET_KEYWORD_INFO
-        LOG_INFO("LOCATE_SET_KEYWORD_INFO handler not implemented.");
+        prv_locate_handle_set_dir_entry(conn, frame, true);
         break;
     case LOCATE_SET_KEYWORD_REPLY:
         // TODO: Implement LOCATE_SET_KEYWORD_REPLY
@@ -208,16 +766,14 @@ void locate_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("LOCATE_GET_KEYWORD_REPLY handler not implemented.");
         break;
     case LOCATE_FIND_LIST_BY_EMAIL:
-        // TODO: Implement LOCATE_FIND_LIST_BY_EMAIL
-        LOG_INFO("LOCATE_FIND_LIST_BY_EMAIL handler not implemented.");
+        prv_locate_handle_find_list_by_email(conn, frame);
         break;
     case LOCATE_FIND_LIST_REPLY:
         // TODO: Implement LOCATE_FIND_LIST_REPLY
         LOG_INFO("LOCATE_FIND_LIST_REPLY handler not implemented.");
         break;
     case LOCATE_USER_INFO_QUERY2:
-        // TODO: Implement LOCATE_USER_INFO_QUERY2
-        LOG_INFO("LOCATE_USER_INFO_QUERY2 handler not implemented.");
+        prv_locate_handle_user_info_query2(conn, frame);
         break;
     default:
         LOG_INFO("Unknown LOCATE Sub ID: 0x%04X", frame->snac.subgroup_id);
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file odir.c
+ * @author Evan Stoddard
+ * @brief ODIR SNAC Handler
+ */
+
+#include "odir.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "session.h"
+#include "session_manager.h"
+
+#include "directory/dir_index.h"
+
+#include "handlers/snac_error.h"
+
+#include "model/screenname.h"
+
+#include "config/config.h"
+
+#include "oscar/odir_types.h"
+#include "oscar/tlv.h"
+
+#include "oscar/snac_encoder.h"
+
+#include "memory/buffer.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+// Results past this many bytes are left out of ODIR_INFO_REPLY
+#define ODIR_MAX_REPLY_LEN 0x4000U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Handle ODIR_INFO_QUERY
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+static void prv_odir_handle_info_query(connection_t *conn, frame_t *frame);
+
+/**
+ * @brief Send ODIR_INFO_REPLY
+ * 
+ * @param conn Connection
+ * @param request_id Request ID of query
+ * @param status Status code
+ * @param results Matching entries
+ * @param num_results Number of matching entries
+ */
+static void prv_odir_send_info_reply(connection_t *conn, uint32_t request_id, odir_status_t status, const dir_doc_t **results, uint32_t num_results);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static void prv_odir_handle_info_query(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        snac_error_send(conn, SNAC_FOODGROUP_ID_ODIR, frame->snac.request_id, SNAC_ERROR_NOT_LOGGED_ON);
+        return;
+    }
+    
+    uint8_t *blob = frame->snac_blob;
+    ssize_t blob_size = frame->flap.payload_length - sizeof(snac_t);
+    uint32_t num_results = config_get()->directory_max_results;
+    
+    const dir_doc_t **results = malloc(num_results * sizeof(dir_doc_t *));
+    
+    if (results == NULL) {
+        LOG_ERR("Unable to allocate search results. Out of memory?");
+        prv_odir_send_info_reply(conn, frame->snac.request_id, ODIR_STATUS_UNAVAILABLE, NULL, 0);
+        return;
+    }
+    
+    if (!dir_index_search(blob, blob_size, results, &num_results)) {
+        prv_odir_send_info_reply(conn, frame->snac.request_id, ODIR_STATUS_BAD_QUERY, NULL, 0);
+    } else {
+        prv_odir_send_info_reply(conn, frame->snac.request_id, ODIR_STATUS_SUCCESS, results, num_results);
+    }
+    
+    free(results);
+}
+
+static void prv_odir_send_info_reply(connection_t *conn, uint32_t request_id, odir_status_t status, const dir_doc_t **results, uint32_t num_results) {
+    buffer_t buffer = buffer_init();
+    
+    if (buffer == NULL) {
+        LOG_ERR("Unable to allocate buffer.  Out of memory?");
+        return;
+    }
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_ODIR, ODIR_INFO_REPLY, 0, request_id);
+    buffer_write(buffer, &snac, sizeof(snac_t));
+    
+    // Status, unknown word, then the result count patched in below
+    uint16_t header[] = { htons(status), 0, 0 };
+    size_t header_offset = buffer_size(buffer);
+    buffer_write(buffer, header, sizeof(header));
+    
+    uint16_t num_sent = 0;
+    
+    for (uint32_t i = 0; i < num_results; i++) {
+        const dir_doc_t *doc = results[i];
+        const char *name = doc->uin;
+        uint16_t name_len = strlen(doc->uin);
+        
+        // Online users are named the way they want to be seen
+        session_t *session = session_manager_find(screenname_find(doc->uin, name_len));
+        
+        if (session != NULL) {
+            name = session->formatted_name;
+            name_len = session->formatted_name_len;
+        }
+        
+        size_t result_len = sizeof(uint16_t) + sizeof(tlv_header_t) + name_len + doc->info_len;
+        
+        if (buffer_size(buffer) + result_len > ODIR_MAX_REPLY_LEN) {
+            break;
+        }
+        
+        // Every result is a counted TLV block led by the screen name
+        uint16_t count = htons(doc->info_count + 1);
+        tlv_header_t name_header = { .tag = htons(DIR_INFO_TLV_SCREEN_NAME), .length = htons(name_len) };
+        
+        buffer_write(buffer, &count, sizeof(uint16_t));
+        buffer_write(buffer, &name_header, sizeof(tlv_header_t));
+        buffer_write(buffer, (void *)name, name_len);
+        buffer_write(buffer, doc->info, doc->info_len);
+        
+        num_sent++;
+    }
+    
+    uint16_t num_sent_be = htons(num_sent);
+    memcpy((uint8_t *)buffer_ptr(buffer) + header_offset + 2 * sizeof(uint16_t), &num_sent_be, sizeof(uint16_t));
+    
+    struct iovec iov = {
+        .iov_base = buffer_ptr(buffer),
+        .iov_len = buffer_size(buffer),
+    };
+    
+    connection_write_frame(conn, &iov, 1);
+    
+    buffer_deinit(buffer);
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void odir_handle_frame(connection_t *conn, frame_t *frame) {
+    switch(frame->snac.subgroup_id) {
+    case ODIR_ERR:
+        // TODO: Implement ODIR_ERR
+        LOG_INFO("ODIR_ERR handler not implemented.");
+        break;
+    case ODIR_INFO_QUERY:
+        prv_odir_handle_info_query(conn, frame);
+        break;
+    case ODIR_INFO_REPLY:
+        // TODO: Implement ODIR_INFO_REPLY
+        LOG_INFO("ODIR_INFO_REPLY handler not implemented.");
+        break;
+    case ODIR_KEYWORD_LIST_QUERY:
+        // TODO: Implement ODIR_KEYWORD_LIST_QUERY
+        LOG_INFO("ODIR_KEYWORD_LIST_QUERY handler not implemented.");
+        break;
+    case ODIR_KEYWORD_LIST_REPLY:
+        // TODO: Implement ODIR_KEYWORD_LIST_REPLY
+        LOG_INFO("ODIR_KEYWORD_LIST_REPLY handler not implemented.");
+        break;
+    default:
+        LOG_INFO("Unknown ODIR Sub ID: 0x%04X", frame->snac.subgroup_id);
+        break;
+    }
+}
\ No newline at end of file
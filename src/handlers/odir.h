@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file odir.h
+ * @author Evan Stoddard
+ * @brief Handler for ODIR SNACs
+ */
+
+#ifndef ODIR_H_
+#define ODIR_H_
+
+#include "connection.h"
+#include "oscar/frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Handle ODIR Frame
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+void odir_handle_frame(connection_t *conn, frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ODIR_H_ */
\ No newline at end of file
@@ -21,6 +21,8 @@
 #include "oscar/tlv_encoder.h"
 #include "oscar/tlv_decoder.h"
 
+#include "offline/offline_store.h"
+
 #include <stdlib.h>
 #include <string.h>
 #include <arpa/inet.h>
@@ -86,6 +88,7 @@ static uint16_t prv_oservice_supported_snacs[] = {
     SNAC_FOODGROUP_ID_INVITE,
     SNAC_FOODGROUP_ID_USER_LOOKUP,
     SNAC_FOODGROUP_ID_CHAT,
+    SNAC_FOODGROUP_ID_ODIR,
     SNAC_FOODGROUP_ID_BART    
 };
 
@@ -127,6 +130,10 @@ static snac_version_t prv_oservice_snac_versions[] = {
         .snac_id = SNAC_FOODGROUP_ID_CHAT,
         .version = 0x1,
     },
+    {
+        .snac_id = SNAC_FOODGROUP_ID_ODIR,
+        .version = 0x1,
+    },
     {
         .snac_id = SNAC_FOODGROUP_ID_BART,
         .version = 0x1,
@@ -198,6 +205,24 @@ void prv_oserver_handle_user_info_query(connection_t *conn, frame_t *frame) {
     prv_oserver_send_user_info_repsonse(conn);
 }
 
+/**
+ * @brief Handle client online, client is now ready for messages
+ * 
+ * @param conn Connection
+ * @param frame Frame
+ */
+void prv_oservice_handle_client_online(connection_t *conn, frame_t *frame) {
+    if (conn->session == NULL) {
+        return;
+    }
+    
+    uint32_t delivered = offline_store_deliver(conn->session, SNAC_FOODGROUP_ID_ICBM, ICBM_CHANNEL_MSG_TOCLIENT);
+    
+    if (delivered > 0) {
+        LOG_INFO("Delivered %u offline messages to %s.", delivered, screenname_str(conn->session->screenname_id));
+    }
+}
+
 /*****************************************************************************
  * Responses
  *****************************************************************************/
@@ -448,8 +473,7 @@ void oservice_handle_frame(connection_t *conn, frame_t *frame) {
         LOG_INFO("OSERVICE_ERR handler not implemented.");
         break;
     case OSERVICE_CLIENT_ONLINE:
-        // TODO: Implement OSERVICE_CLIENT_ONLINE
-        LOG_INFO("OSERVICE_CLIENT_ONLINE handler not implemented.");
+        prv_oservice_handle_client_online(conn, frame);
         break;
     case OSERVICE_HOST_ONLINE:
         // TODO: Implement OSERVICE_HOST_ONLINE
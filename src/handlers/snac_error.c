@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file snac_error.c
+ * @author Evan Stoddard
+ * @brief Error replies shared by all foodgroups
+ */
+
+#include "snac_error.h"
+
+#include <arpa/inet.h>
+
+#include "oscar/snac_encoder.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+bool snac_error_send(connection_t *conn, uint16_t foodgroup_id, uint32_t request_id, snac_error_code_t error_code) {
+    if (conn == NULL) {
+        return false;
+    }
+    
+    snac_t snac = snac_encode(foodgroup_id, SNAC_ERROR_SUBGROUP_ID, 0, request_id);
+    uint16_t code = htons(error_code);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = &code, .iov_len = sizeof(code) },
+    };
+    
+    LOG_DEBUG("Sending error 0x%04x for foodgroup 0x%04x.", error_code, foodgroup_id);
+    
+    return connection_write_frame(conn, iov, 2) > 0;
+}
\ No newline at end of file
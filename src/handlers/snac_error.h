@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file snac_error.h
+ * @author Evan Stoddard
+ * @brief Error replies shared by all foodgroups
+ */
+
+#ifndef SNAC_ERROR_H_
+#define SNAC_ERROR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "connection.h"
+#include "oscar/snac.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Every foodgroup uses subgroup 0x0001 for errors
+ * 
+ */
+#define SNAC_ERROR_SUBGROUP_ID 0x0001U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Send *_ERR SNAC in reply to a request
+ * 
+ * Connection is closed (and freed) if the write fails.
+ * 
+ * @param conn Connection
+ * @param foodgroup_id Foodgroup of request
+ * @param request_id Request ID of request being rejected
+ * @param error_code Error code
+ * @return true Error sent
+ * @return false Unable to send error
+ */
+bool snac_error_send(connection_t *conn, uint16_t foodgroup_id, uint32_t request_id, snac_error_code_t error_code);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SNAC_ERROR_H_ */
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file locate_cache.c
+ * @author Evan Stoddard
+ * @brief Encoded user info replies cached per queried user
+ */
+
+#include "locate_cache.h"
+
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Find slot holding reply for info, valid or not
+ * 
+ * @param cache Cache
+ * @param flags Requested info
+ * @return locate_cached_reply_t* Slot (NULL if none)
+ */
+static locate_cached_reply_t *prv_locate_cache_slot(locate_cache_t *cache, uint32_t flags);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static locate_cached_reply_t *prv_locate_cache_slot(locate_cache_t *cache, uint32_t flags) {
+    for (uint32_t i = 0; i < LOCATE_CACHE_SLOTS; i++) {
+        if (cache->slots[i].body != NULL && cache->slots[i].flags == flags) {
+            return &cache->slots[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+msgbuf_t locate_cache_find(locate_cache_t *cache, uint32_t flags, uint32_t generation, uint16_t warning_level) {
+    locate_cached_reply_t *slot = prv_locate_cache_slot(cache, flags);
+    
+    if (slot == NULL) {
+        return NULL;
+    }
+    
+    // Warning levels decay without anything changing, so they're checked as well
+    if (slot->generation != generation || slot->warning_level != warning_level) {
+        return NULL;
+    }
+    
+    return slot->body;
+}
+
+void locate_cache_put(locate_cache_t *cache, uint32_t flags, uint32_t generation, uint16_t warning_level, msgbuf_t body) {
+    locate_cached_reply_t *slot = prv_locate_cache_slot(cache, flags);
+    
+    // Few combinations are ever asked for, so evicting in turn is good enough
+    if (slot == NULL) {
+        slot = &cache->slots[cache->next_victim];
+        cache->next_victim = (cache->next_victim + 1) % LOCATE_CACHE_SLOTS;
+    }
+    
+    msgbuf_release(slot->body);
+    
+    slot->body = body;
+    slot->flags = flags;
+    slot->generation = generation;
+    slot->warning_level = warning_level;
+}
+
+void locate_cache_deinit(locate_cache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < LOCATE_CACHE_SLOTS; i++) {
+        msgbuf_release(cache->slots[i].body);
+    }
+    
+    memset(cache, 0, sizeof(locate_cache_t));
+}
\ No newline at end of file
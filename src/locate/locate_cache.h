@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file locate_cache.h
+ * @author Evan Stoddard
+ * @brief Encoded user info replies cached per queried user
+ */
+
+#ifndef LOCATE_CACHE_H_
+#define LOCATE_CACHE_H_
+
+#include <stdint.h>
+
+#include "memory/msgbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Replies kept per user, one per combination of requested info
+ * 
+ */
+#define LOCATE_CACHE_SLOTS 4U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Cached reply typedef
+ * 
+ * Body of LOCATE_USER_INFO_REPLY (no SNAC header, every query has its own
+ * request ID). Valid while the user's info generation and warning level
+ * match the ones it was encoded with.
+ */
+typedef struct locate_cached_reply_t {
+    msgbuf_t body;
+    uint32_t flags;
+    uint32_t generation;
+    uint16_t warning_level;
+} locate_cached_reply_t;
+
+/**
+ * @brief Reply cache typedef
+ * 
+ * A zeroed cache is a valid empty cache.
+ */
+typedef struct locate_cache_t {
+    locate_cached_reply_t slots[LOCATE_CACHE_SLOTS];
+    uint32_t next_victim;
+} locate_cache_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Find reply still valid for user's current info
+ * 
+ * @param cache Cache
+ * @param flags Requested info
+ * @param generation Current info generation of user
+ * @param warning_level Current warning level of user
+ * @return msgbuf_t Reply body owned by cache (NULL if none valid)
+ */
+msgbuf_t locate_cache_find(locate_cache_t *cache, uint32_t flags, uint32_t generation, uint16_t warning_level);
+
+/**
+ * @brief Cache reply, replacing any other reply for the same info
+ * 
+ * @param cache Cache
+ * @param flags Requested info
+ * @param generation Info generation reply was encoded with
+ * @param warning_level Warning level reply was encoded with
+ * @param body Reply body, cache takes over the caller's reference
+ */
+void locate_cache_put(locate_cache_t *cache, uint32_t flags, uint32_t generation, uint16_t warning_level, msgbuf_t body);
+
+/**
+ * @brief Release every cached reply
+ * 
+ * @param cache Cache
+ */
+void locate_cache_deinit(locate_cache_t *cache);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LOCATE_CACHE_H_ */
\ No newline at end of file
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file locate_store.c
+ * @author Evan Stoddard
+ * @brief Content addressed store of encoded locate info
+ */
+
+#include "locate_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define LOCATE_STORE_INITIAL_BUCKETS 64U
+
+#define LOCATE_STORE_FNV_OFFSET_BASIS 2166136261U
+#define LOCATE_STORE_FNV_PRIME        16777619U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private static instance of locate store
+ * 
+ * Blobs are chained into buckets by a hash of their contents. The table
+ * grows to keep chains short, a hash match is confirmed by comparing
+ * contents before a blob is shared.
+ */
+static struct {
+    locate_blob_t **buckets;
+    uint32_t num_buckets;
+    uint32_t num_blobs;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Hash contents given as segments
+ * 
+ * @param iov Segments
+ * @param iov_count Number of segments
+ * @param len Set to total length of contents
+ * @return uint32_t Hash
+ */
+static uint32_t prv_locate_store_hash(const struct iovec *iov, int iov_count, size_t *len);
+
+/**
+ * @brief Check if blob holds contents given as segments
+ * 
+ * @param blob Blob
+ * @param iov Segments
+ * @param iov_count Number of segments
+ * @param len Total length of contents
+ * @return true Contents match
+ * @return false Contents differ
+ */
+static bool prv_locate_store_matches(const locate_blob_t *blob, const struct iovec *iov, int iov_count, size_t len);
+
+/**
+ * @brief Double bucket count and rehash blobs
+ * 
+ * @return true Able to grow table
+ * @return false Unable to grow table
+ */
+static bool prv_locate_store_grow(void);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static uint32_t prv_locate_store_hash(const struct iovec *iov, int iov_count, size_t *len) {
+    uint32_t hash = LOCATE_STORE_FNV_OFFSET_BASIS;
+    
+    *len = 0;
+    
+    for (int i = 0; i < iov_count; i++) {
+        const uint8_t *bytes = iov[i].iov_base;
+        
+        for (size_t j = 0; j < iov[i].iov_len; j++) {
+            hash ^= bytes[j];
+            hash *= LOCATE_STORE_FNV_PRIME;
+        }
+        
+        *len += iov[i].iov_len;
+    }
+    
+    return hash;
+}
+
+static bool prv_locate_store_matches(const locate_blob_t *blob, const struct iovec *iov, int iov_count, size_t len) {
+    if (blob->len != len) {
+        return false;
+    }
+    
+    size_t offset = 0;
+    
+    for (int i = 0; i < iov_count; i++) {
+        if (iov[i].iov_len > 0 && memcmp(&blob->data[offset], iov[i].iov_base, iov[i].iov_len) != 0) {
+            return false;
+        }
+        
+        offset += iov[i].iov_len;
+    }
+    
+    return true;
+}
+
+static bool prv_locate_store_grow(void) {
+    uint32_t new_count = prv_inst.num_buckets * 2;
+    
+    if (new_count == 0) {
+        new_count = LOCATE_STORE_INITIAL_BUCKETS;
+    }
+    
+    locate_blob_t **buckets = calloc(new_count, sizeof(locate_blob_t *));
+    
+    if (buckets == NULL) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < prv_inst.num_buckets; i++) {
+        locate_blob_t *blob = prv_inst.buckets[i];
+        
+        while (blob != NULL) {
+            locate_blob_t *next = blob->next_in_bucket;
+            locate_blob_t **bucket = &buckets[blob->hash & (new_count - 1)];
+            
+            blob->next_in_bucket = *bucket;
+            *bucket = blob;
+            blob = next;
+        }
+    }
+    
+    free(prv_inst.buckets);
+    prv_inst.buckets = buckets;
+    prv_inst.num_buckets = new_count;
+    
+    return true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+locate_blob_t *locate_store_intern(const struct iovec *iov, int iov_count) {
+    if (iov == NULL) {
+        return NULL;
+    }
+    
+    size_t len = 0;
+    uint32_t hash = prv_locate_store_hash(iov, iov_count, &len);
+    
+    if (prv_inst.num_buckets > 0) {
+        locate_blob_t *blob = prv_inst.buckets[hash & (prv_inst.num_buckets - 1)];
+        
+        for (; blob != NULL; blob = blob->next_in_bucket) {
+            if (blob->hash == hash && prv_locate_store_matches(blob, iov, iov_count, len)) {
+                blob->refcount++;
+                return blob;
+            }
+        }
+    }
+    
+    // Keep about one blob per bucket
+    if (prv_inst.num_blobs >= prv_inst.num_buckets && prv_locate_store_grow() == false) {
+        // Longer chains still work, only give up if there's no table at all
+        if (prv_inst.num_buckets == 0) {
+            LOG_ERR("Unable to allocate locate store. Out of memory?");
+            return NULL;
+        }
+    }
+    
+    locate_blob_t *blob = malloc(sizeof(locate_blob_t) + len);
+    
+    if (blob == NULL) {
+        LOG_ERR("Unable to store locate info. Out of memory?");
+        return NULL;
+    }
+    
+    size_t offset = 0;
+    
+    for (int i = 0; i < iov_count; i++) {
+        if (iov[i].iov_len > 0) {
+            memcpy(&blob->data[offset], iov[i].iov_base, iov[i].iov_len);
+        }
+        
+        offset += iov[i].iov_len;
+    }
+    
+    blob->hash = hash;
+    blob->refcount = 1;
+    blob->len = len;
+    
+    locate_blob_t **bucket = &prv_inst.buckets[hash & (prv_inst.num_buckets - 1)];
+    blob->next_in_bucket = *bucket;
+    *bucket = blob;
+    prv_inst.num_blobs++;
+    
+    return blob;
+}
+
+void locate_store_release(locate_blob_t *blob) {
+    if (blob == NULL) {
+        return;
+    }
+    
+    if (--blob->refcount > 0) {
+        return;
+    }
+    
+    locate_blob_t **link = &prv_inst.buckets[blob->hash & (prv_inst.num_buckets - 1)];
+    
+    while (*link != NULL && *link != blob) {
+        link = &(*link)->next_in_bucket;
+    }
+    
+    if (*link != NULL) {
+        *link = blob->next_in_bucket;
+    }
+    
+    prv_inst.num_blobs--;
+    free(blob);
+}
+
+struct iovec locate_blob_iovec(const locate_blob_t *blob) {
+    struct iovec iov = { .iov_base = NULL, .iov_len = 0 };
+    
+    if (blob != NULL) {
+        iov.iov_base = (void *)blob->data;
+        iov.iov_len = blob->len;
+    }
+    
+    return iov;
+}
+
+uint32_t locate_store_count(void) {
+    return prv_inst.num_blobs;
+}
\ No newline at end of file
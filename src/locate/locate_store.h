@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file locate_store.h
+ * @author Evan Stoddard
+ * @brief Content addressed store of encoded locate info
+ */
+
+#ifndef LOCATE_STORE_H_
+#define LOCATE_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Stored blob typedef
+ * 
+ * Holds TLVs exactly as they are sent to other users. Identical blobs
+ * (the same away message set by many users) are stored once and shared,
+ * contents never change once stored.
+ */
+typedef struct locate_blob_t {
+    uint32_t hash;
+    uint32_t refcount;
+    struct locate_blob_t *next_in_bucket;
+    size_t len;
+    uint8_t data[];
+} locate_blob_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get blob with contents, storing it if it isn't stored yet
+ * 
+ * @param iov Contents as segments, copied if not stored yet
+ * @param iov_count Number of segments
+ * @return locate_blob_t* Blob holding a reference for caller (NULL if out of memory)
+ */
+locate_blob_t *locate_store_intern(const struct iovec *iov, int iov_count);
+
+/**
+ * @brief Drop reference to blob, freeing it with the last one
+ * 
+ * @param blob Blob (may be NULL)
+ */
+void locate_store_release(locate_blob_t *blob);
+
+/**
+ * @brief Describe blob contents as an iovec for writing
+ * 
+ * @param blob Blob (NULL describes nothing)
+ * @return struct iovec Contents
+ */
+struct iovec locate_blob_iovec(const locate_blob_t *blob);
+
+/**
+ * @brief Get number of distinct blobs stored
+ * 
+ * @return uint32_t Number of blobs
+ */
+uint32_t locate_store_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LOCATE_STORE_H_ */
\ No newline at end of file
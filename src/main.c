@@ -8,9 +8,20 @@
  * @brief AIM Server
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
 #include "logging.h"
 #include "connection_manager.h"
 
+#include "config/config.h"
+#include "offline/offline_store.h"
+#include "bart/bart_store.h"
+
 #include "backends/backend.h"
 #include "backends/sqlite3/sqlite3_backend.h"
 
@@ -18,25 +29,124 @@
  * Definitions
  *****************************************************************************/
 
+#define MAIN_CONFIG_ARG         "--config="
+#define MAIN_MAX_WORKERS        (CONFIG_MAX_WORKERS + 1)
+
 /*****************************************************************************
  * Variables
  *****************************************************************************/
 
 static sqlite3_backend_t data_backend;
 
+/**
+ * @brief Worker processes forked by supervisor
+ * 
+ */
+static pid_t prv_workers[MAIN_MAX_WORKERS];
+static uint32_t prv_num_workers = 0;
+
 /*****************************************************************************
  * Prototypes
  *****************************************************************************/
 
+/**
+ * @brief Load configuration file and apply command line overrides
+ * 
+ * Arguments are "--config=<path>" or "--<key>=<value>" for any config key.
+ * 
+ * @param argc Argument count
+ * @param argv Arguments
+ * @return true Configuration loaded
+ * @return false Bad arguments or configuration
+ */
+static bool prv_main_load_config(int argc, char **argv);
+
+/**
+ * @brief Run event loop for role in this process
+ * 
+ * @param role Role (config_role_t)
+ * @return int Exit code
+ */
+static int prv_main_run_worker(uint32_t role);
+
+/**
+ * @brief Fork worker process
+ * 
+ * @param role Role (config_role_t)
+ * @param index Index of worker within role
+ * @return true Worker forked
+ * @return false Unable to fork
+ */
+static bool prv_main_spawn_worker(uint32_t role, uint32_t index);
+
+/**
+ * @brief Forward termination signals to workers
+ * 
+ * @param sig Signal
+ */
+static void prv_main_forward_signal(int sig);
+
 /*****************************************************************************
- * Functions
+ * Private Functions
  *****************************************************************************/
 
-int main(int argc, char **argv) {
-    LOG_INFO("Application started.")
+static bool prv_main_load_config(int argc, char **argv) {
+    const char *path = CONFIG_DEFAULT_PATH;
     
-    // Initialize backend
-    if (!sqlite3_backend_init(&data_backend, "aim_db.db")) {
+    // Config file first so command line always wins
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], MAIN_CONFIG_ARG, strlen(MAIN_CONFIG_ARG)) == 0) {
+            path = argv[i] + strlen(MAIN_CONFIG_ARG);
+        }
+    }
+    
+    if (!config_init(path)) {
+        return false;
+    }
+    
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], MAIN_CONFIG_ARG, strlen(MAIN_CONFIG_ARG)) == 0) {
+            continue;
+        }
+        
+        char key[CONFIG_MAX_STRING_LEN];
+        char *separator = strchr(argv[i], '=');
+        
+        if (
+            strncmp(argv[i], "--", 2) != 0 ||
+            separator == NULL ||
+            (size_t)(separator - argv[i] - 2) >= sizeof(key)
+        ) {
+            LOG_ERR("Usage: %s [--config=<path>] [--role=auth|bos|all] [--<key>=<value>]...", argv[0]);
+            return false;
+        }
+        
+        memcpy(key, argv[i] + 2, separator - argv[i] - 2);
+        key[separator - argv[i] - 2] = '\0';
+        
+        if (!config_set(key, separator + 1)) {
+            LOG_ERR("Invalid argument \"%s\".", argv[i]);
+            return false;
+        }
+    }
+    
+    return config_validate();
+}
+
+static int prv_main_run_worker(uint32_t role) {
+    config_t *config = config_get();
+    config->role = role;
+    
+    if ((role & CONFIG_ROLE_BOS) && !offline_store_init(config)) {
+        LOG_WARN("Offline messages unavailable.");
+    }
+    
+    if ((role & CONFIG_ROLE_BOS) && !bart_store_init(config)) {
+        LOG_WARN("Buddy icons unavailable.");
+    }
+    
+    // Backend connections must not be shared across forks
+    if (!sqlite3_backend_init(&data_backend, config->db_path)) {
         LOG_FATAL("Failed to initialize backend.");
         return 1;
     }
@@ -44,17 +154,90 @@ int main(int argc, char **argv) {
     backend_set_backend((backend_t *)&data_backend);
     
     // Initialize connection manager
-    bool ret = connection_manager_init(
-        CONNECTION_MANAGER_DEFAULT_AUTH_PORT,
-        CONNECTION_MANAGER_DEFAULT_BOSS_PORT
-    );
-    
-    if (!ret) {
+    if (!connection_manager_init(config)) {
         LOG_FATAL("Failed to initialize connection manager.");
         return 1;
     }
     
     connection_manager_start();
     
+    return 0;
+}
+
+static bool prv_main_spawn_worker(uint32_t role, uint32_t index) {
+    pid_t pid = fork();
+    
+    if (pid < 0) {
+        LOG_ERR("Unable to fork worker.");
+        return false;
+    }
+    
+    if (pid == 0) {
+        // Supervisor handlers don't apply to workers
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        
+        _exit(prv_main_run_worker(role));
+    }
+    
+    LOG_INFO("Started %s worker %u. (pid %d)", (role == CONFIG_ROLE_AUTH) ? "auth" : "BOS", index, pid);
+    
+    prv_workers[prv_num_workers] = pid;
+    prv_num_workers++;
+    
+    return true;
+}
+
+static void prv_main_forward_signal(int sig) {
+    for (uint32_t i = 0; i < prv_num_workers; i++) {
+        kill(prv_workers[i], sig);
+    }
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv) {
+    LOG_INFO("Application started.")
+    
+    // Load configuration
+    if (!prv_main_load_config(argc, argv)) {
+        LOG_FATAL("Failed to load configuration.");
+        return 1;
+    }
+    
+    config_t *config = config_get();
+    
+    uint32_t num_auth_workers = (config->role & CONFIG_ROLE_AUTH) ? config->auth_workers : 0;
+    
+    // Single auth worker runs everything in this process
+    if (num_auth_workers <= 1) {
+        return prv_main_run_worker(config->role);
+    }
+    
+    signal(SIGINT, prv_main_forward_signal);
+    signal(SIGTERM, prv_main_forward_signal);
+    
+    // Auth workers share a port through SO_REUSEPORT
+    for (uint32_t i = 0; i < num_auth_workers; i++) {
+        prv_main_spawn_worker(CONFIG_ROLE_AUTH, i);
+    }
+    
+    // Sessions live in a single BOS process, nothing routes between several
+    if (config->role & CONFIG_ROLE_BOS) {
+        prv_main_spawn_worker(CONFIG_ROLE_BOS, 0);
+    }
+    
+    // Wait for workers to exit
+    int status = 0;
+    pid_t pid;
+    
+    while ((pid = wait(&status)) > 0 || (pid < 0 && errno == EINTR)) {
+        if (pid > 0) {
+            LOG_WARN("Worker %d exited. (%d)", pid, status);
+        }
+    }
+    
     return 0;
 }
\ No newline at end of file
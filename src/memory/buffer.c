@@ -74,7 +74,7 @@ bool buffer_write(buffer_t inst, void *src, size_t size) {
     }
     
     // Check if we need to allocate more space
-    size_t required_space = inst->allocated_size + size;
+    size_t required_space = inst->size + size;
     if (required_space > inst->allocated_size) {
         size_t new_size = required_space * 2;
         
@@ -103,8 +103,8 @@ bool buffer_reserve(buffer_t inst, size_t size) {
     if (required_space > inst->allocated_size) {
         size_t new_size = inst->allocated_size * 2;
         
-        if (new_size == 0) {
-            new_size = size;
+        if (new_size < required_space) {
+            new_size = required_space;
         }
         
         inst->ptr = realloc(inst->ptr, new_size);
@@ -121,6 +121,14 @@ bool buffer_reserve(buffer_t inst, size_t size) {
     return true;
 }
 
+void buffer_clear(buffer_t inst) {
+    if (inst == NULL) {
+        return;
+    }
+    
+    inst->size = 0;
+}
+
 void *buffer_ptr(buffer_t inst) {
     if (inst == NULL) {
         return false;
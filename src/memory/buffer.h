@@ -71,6 +71,13 @@ bool buffer_write(buffer_t inst, void *src, size_t size);
  */
 bool buffer_reserve(buffer_t inst, size_t size);
 
+/**
+ * @brief Clear buffer contents (keeps allocated space for reuse)
+ * 
+ * @param inst Buffer instance
+ */
+void buffer_clear(buffer_t inst);
+
 /**
  * @brief Get pointer to buffer data
  * 
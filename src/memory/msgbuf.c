@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file msgbuf.c
+ * @author Evan Stoddard
+ * @brief Reference counted, immutable message buffer
+ */
+
+#include "msgbuf.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Definition of message buffer type
+ * 
+ * Header and contents share one allocation.
+ */
+struct msgbuf_prv_t {
+    uint32_t refcount;
+    uint32_t size;
+    uint8_t data[];
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+msgbuf_t msgbuf_init(const struct iovec *iov, int iov_count) {
+    size_t size = 0;
+    
+    for (int i = 0; i < iov_count; i++) {
+        size += iov[i].iov_len;
+    }
+    
+    if (size > UINT32_MAX) {
+        return NULL;
+    }
+    
+    msgbuf_t inst = malloc(sizeof(struct msgbuf_prv_t) + size);
+    
+    if (inst == NULL) {
+        return NULL;
+    }
+    
+    inst->refcount = 1;
+    inst->size = size;
+    
+    size_t offset = 0;
+    
+    for (int i = 0; i < iov_count; i++) {
+        memcpy(&inst->data[offset], iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+    
+    return inst;
+}
+
+msgbuf_t msgbuf_retain(msgbuf_t inst) {
+    if (inst == NULL) {
+        return NULL;
+    }
+    
+    inst->refcount++;
+    
+    return inst;
+}
+
+void msgbuf_release(msgbuf_t inst) {
+    if (inst == NULL) {
+        return;
+    }
+    
+    inst->refcount--;
+    
+    if (inst->refcount == 0) {
+        free(inst);
+    }
+}
+
+const void *msgbuf_ptr(msgbuf_t inst) {
+    if (inst == NULL) {
+        return NULL;
+    }
+    
+    return inst->data;
+}
+
+size_t msgbuf_size(msgbuf_t inst) {
+    if (inst == NULL) {
+        return 0;
+    }
+    
+    return inst->size;
+}
+
+struct iovec msgbuf_iovec(msgbuf_t inst) {
+    struct iovec iov = {
+        .iov_base = (void *)msgbuf_ptr(inst),
+        .iov_len = msgbuf_size(inst),
+    };
+    
+    return iov;
+}
\ No newline at end of file
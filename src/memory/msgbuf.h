@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file msgbuf.h
+ * @author Evan Stoddard
+ * @brief Reference counted, immutable message buffer
+ */
+
+#ifndef MSGBUF_H_
+#define MSGBUF_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Message buffer typedef
+ * 
+ * Holds one frame payload (SNAC header and body) shared by every
+ * recipient it's sent to. Contents never change once built, each
+ * recipient only adds its own FLAP header when writing.
+ */
+typedef struct msgbuf_prv_t* msgbuf_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Build message buffer from segments
+ * 
+ * @param iov Segments, copied once
+ * @param iov_count Number of segments
+ * @return msgbuf_t Message buffer holding one reference (NULL if out of memory)
+ */
+msgbuf_t msgbuf_init(const struct iovec *iov, int iov_count);
+
+/**
+ * @brief Take another reference to message buffer
+ * 
+ * @param inst Message buffer
+ * @return msgbuf_t Same message buffer
+ */
+msgbuf_t msgbuf_retain(msgbuf_t inst);
+
+/**
+ * @brief Drop reference to message buffer, freeing it with the last one
+ * 
+ * @param inst Message buffer
+ */
+void msgbuf_release(msgbuf_t inst);
+
+/**
+ * @brief Get pointer to contents
+ * 
+ * @param inst Message buffer
+ * @return const void* Contents
+ */
+const void *msgbuf_ptr(msgbuf_t inst);
+
+/**
+ * @brief Get size of contents
+ * 
+ * @param inst Message buffer
+ * @return size_t Size
+ */
+size_t msgbuf_size(msgbuf_t inst);
+
+/**
+ * @brief Describe contents as an iovec for writing
+ * 
+ * @param inst Message buffer
+ * @return struct iovec Contents
+ */
+struct iovec msgbuf_iovec(msgbuf_t inst);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* MSGBUF_H_ */
\ No newline at end of file
@@ -0,0 +1,637 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file buddy_set.c
+ * @author Evan Stoddard
+ * @brief Compact set of interned screen name IDs
+ */
+
+#include "buddy_set.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define BUDDY_SET_INITIAL_CONTAINERS    1U
+#define BUDDY_SET_INITIAL_ARRAY         8U
+
+#define BUDDY_SET_BITMAP_WORDS          (65536U / 64U)
+
+// Binary search stops once window is this small, rest is a linear scan
+#define BUDDY_SET_LINEAR_SCAN           16U
+
+#define BUDDY_SET_KEY(id)               ((uint16_t)((id) >> 16))
+#define BUDDY_SET_LOW(id)               ((uint16_t)((id) & 0xFFFFU))
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Check if container holds a bitmap
+ * 
+ * @param container Container
+ * @return true Bitmap container
+ * @return false Array container
+ */
+static bool prv_buddy_set_is_bitmap(const buddy_set_container_t *container);
+
+/**
+ * @brief Index of first array element not less than value
+ * 
+ * @param array Sorted array
+ * @param len Length of array
+ * @param value Value
+ * @return uint32_t Index (len if every element is less)
+ */
+static uint32_t prv_buddy_set_lower_bound(const uint16_t *array, uint32_t len, uint16_t value);
+
+/**
+ * @brief Index of first container with key not less than key
+ * 
+ * @param set Buddy set
+ * @param key Key
+ * @return uint32_t Index (num_containers if every key is less)
+ */
+static uint32_t prv_buddy_set_find_container(const buddy_set_t *set, uint16_t key);
+
+/**
+ * @brief Insert empty array container at index
+ * 
+ * @param set Buddy set
+ * @param idx Index
+ * @param key Key of container
+ * @return buddy_set_container_t* New container (NULL if out of memory)
+ */
+static buddy_set_container_t *prv_buddy_set_insert_container(buddy_set_t *set, uint32_t idx, uint16_t key);
+
+/**
+ * @brief Free container and remove it from set
+ * 
+ * @param set Buddy set
+ * @param idx Index
+ */
+static void prv_buddy_set_remove_container(buddy_set_t *set, uint32_t idx);
+
+/**
+ * @brief Convert full array container to bitmap
+ * 
+ * @param container Container
+ * @return true Converted
+ * @return false Out of memory
+ */
+static bool prv_buddy_set_to_bitmap(buddy_set_container_t *container);
+
+/**
+ * @brief Convert bitmap container that shrank to array
+ * 
+ * @param container Container
+ * @return true Converted
+ * @return false Out of memory
+ */
+static bool prv_buddy_set_to_array(buddy_set_container_t *container);
+
+/**
+ * @brief Intersect two containers with equal keys into dest
+ * 
+ * @param dest Empty container (key already set)
+ * @param a Container
+ * @param b Container
+ * @return true Able to intersect
+ * @return false Out of memory
+ */
+static bool prv_buddy_set_intersect_container(buddy_set_container_t *dest, const buddy_set_container_t *a, const buddy_set_container_t *b);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static bool prv_buddy_set_is_bitmap(const buddy_set_container_t *container) {
+    return container->cardinality > BUDDY_SET_ARRAY_MAX_IDS;
+}
+
+static uint32_t prv_buddy_set_lower_bound(const uint16_t *array, uint32_t len, uint16_t value) {
+    uint32_t base = 0;
+    
+    // Answer always stays within [base, base + len]
+    while (len > BUDDY_SET_LINEAR_SCAN) {
+        uint32_t half = len / 2;
+        
+        if (array[base + half] < value) {
+            base += half;
+        }
+        
+        len -= half;
+    }
+    
+    // Branch free count over the window, compilers turn this into SIMD compares
+    uint32_t count = 0;
+    
+    for (uint32_t i = 0; i < len; i++) {
+        count += (array[base + i] < value);
+    }
+    
+    return base + count;
+}
+
+static uint32_t prv_buddy_set_find_container(const buddy_set_t *set, uint16_t key) {
+    uint32_t lo = 0;
+    uint32_t hi = set->num_containers;
+    
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        
+        if (set->containers[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    
+    return lo;
+}
+
+static buddy_set_container_t *prv_buddy_set_insert_container(buddy_set_t *set, uint32_t idx, uint16_t key) {
+    if (set->num_containers == set->capacity) {
+        uint32_t new_capacity = set->capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = BUDDY_SET_INITIAL_CONTAINERS;
+        }
+        
+        buddy_set_container_t *containers = realloc(set->containers, new_capacity * sizeof(buddy_set_container_t));
+        
+        if (containers == NULL) {
+            return NULL;
+        }
+        
+        set->containers = containers;
+        set->capacity = new_capacity;
+    }
+    
+    memmove(
+        &set->containers[idx + 1],
+        &set->containers[idx],
+        (set->num_containers - idx) * sizeof(buddy_set_container_t)
+    );
+    set->num_containers++;
+    
+    buddy_set_container_t *container = &set->containers[idx];
+    memset(container, 0, sizeof(buddy_set_container_t));
+    container->key = key;
+    
+    return container;
+}
+
+static void prv_buddy_set_remove_container(buddy_set_t *set, uint32_t idx) {
+    // Array and bitmap share the same pointer
+    free(set->containers[idx].data.array);
+    
+    set->num_containers--;
+    memmove(
+        &set->containers[idx],
+        &set->containers[idx + 1],
+        (set->num_containers - idx) * sizeof(buddy_set_container_t)
+    );
+}
+
+static bool prv_buddy_set_to_bitmap(buddy_set_container_t *container) {
+    uint64_t *bitmap = calloc(BUDDY_SET_BITMAP_WORDS, sizeof(uint64_t));
+    
+    if (bitmap == NULL) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < container->cardinality; i++) {
+        uint16_t low = container->data.array[i];
+        bitmap[low >> 6] |= (1ULL << (low & 63));
+    }
+    
+    free(container->data.array);
+    container->data.bitmap = bitmap;
+    container->capacity = 0;
+    
+    return true;
+}
+
+static bool prv_buddy_set_to_array(buddy_set_container_t *container) {
+    uint16_t *array = malloc(BUDDY_SET_ARRAY_MAX_IDS * sizeof(uint16_t));
+    
+    if (array == NULL) {
+        return false;
+    }
+    
+    uint32_t len = 0;
+    
+    for (uint32_t word = 0; word < BUDDY_SET_BITMAP_WORDS; word++) {
+        uint64_t bits = container->data.bitmap[word];
+        
+        while (bits != 0) {
+            array[len] = (uint16_t)((word << 6) + __builtin_ctzll(bits));
+            len++;
+            bits &= bits - 1;
+        }
+    }
+    
+    free(container->data.bitmap);
+    container->data.array = array;
+    container->capacity = BUDDY_SET_ARRAY_MAX_IDS;
+    
+    return true;
+}
+
+static bool prv_buddy_set_intersect_container(buddy_set_container_t *dest, const buddy_set_container_t *a, const buddy_set_container_t *b) {
+    // Bitmap & bitmap, word at a time
+    if (prv_buddy_set_is_bitmap(a) && prv_buddy_set_is_bitmap(b)) {
+        uint64_t *bitmap = malloc(BUDDY_SET_BITMAP_WORDS * sizeof(uint64_t));
+        
+        if (bitmap == NULL) {
+            return false;
+        }
+        
+        uint32_t cardinality = 0;
+        
+        for (uint32_t i = 0; i < BUDDY_SET_BITMAP_WORDS; i++) {
+            bitmap[i] = a->data.bitmap[i] & b->data.bitmap[i];
+            cardinality += __builtin_popcountll(bitmap[i]);
+        }
+        
+        dest->data.bitmap = bitmap;
+        dest->cardinality = cardinality;
+        
+        if (cardinality <= BUDDY_SET_ARRAY_MAX_IDS) {
+            return prv_buddy_set_to_array(dest);
+        }
+        
+        return true;
+    }
+    
+    // Anything involving an array is no larger than the smaller array
+    if (prv_buddy_set_is_bitmap(a)) {
+        const buddy_set_container_t *tmp = a;
+        a = b;
+        b = tmp;
+    }
+    
+    uint32_t max_len = a->cardinality;
+    
+    if (!prv_buddy_set_is_bitmap(b) && b->cardinality < max_len) {
+        max_len = b->cardinality;
+    }
+    
+    if (max_len == 0) {
+        return true;
+    }
+    
+    uint16_t *array = malloc(max_len * sizeof(uint16_t));
+    
+    if (array == NULL) {
+        return false;
+    }
+    
+    uint32_t len = 0;
+    
+    if (prv_buddy_set_is_bitmap(b)) {
+        for (uint32_t i = 0; i < a->cardinality; i++) {
+            uint16_t low = a->data.array[i];
+            array[len] = low;
+            len += (b->data.bitmap[low >> 6] >> (low & 63)) & 1;
+        }
+    } else {
+        uint32_t i = 0;
+        uint32_t j = 0;
+        
+        while (i < a->cardinality && j < b->cardinality) {
+            uint16_t va = a->data.array[i];
+            uint16_t vb = b->data.array[j];
+            
+            array[len] = va;
+            len += (va == vb);
+            i += (va <= vb);
+            j += (vb <= va);
+        }
+    }
+    
+    dest->data.array = array;
+    dest->capacity = max_len;
+    dest->cardinality = len;
+    
+    return true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void buddy_set_init(buddy_set_t *set) {
+    memset(set, 0, sizeof(buddy_set_t));
+}
+
+void buddy_set_deinit(buddy_set_t *set) {
+    if (set == NULL) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < set->num_containers; i++) {
+        free(set->containers[i].data.array);
+    }
+    
+    free(set->containers);
+    buddy_set_init(set);
+}
+
+bool buddy_set_add(buddy_set_t *set, screenname_id_t id) {
+    if (set == NULL || id == SCREENNAME_ID_INVALID) {
+        return false;
+    }
+    
+    uint16_t key = BUDDY_SET_KEY(id);
+    uint16_t low = BUDDY_SET_LOW(id);
+    uint32_t idx = prv_buddy_set_find_container(set, key);
+    buddy_set_container_t *container = NULL;
+    
+    if (idx < set->num_containers && set->containers[idx].key == key) {
+        container = &set->containers[idx];
+    } else {
+        container = prv_buddy_set_insert_container(set, idx, key);
+        
+        if (container == NULL) {
+            return false;
+        }
+    }
+    
+    if (prv_buddy_set_is_bitmap(container)) {
+        uint64_t bit = 1ULL << (low & 63);
+        
+        if ((container->data.bitmap[low >> 6] & bit) == 0) {
+            container->data.bitmap[low >> 6] |= bit;
+            container->cardinality++;
+            set->count++;
+        }
+        
+        return true;
+    }
+    
+    uint32_t pos = prv_buddy_set_lower_bound(container->data.array, container->cardinality, low);
+    
+    if (pos < container->cardinality && container->data.array[pos] == low) {
+        return true;
+    }
+    
+    if (container->cardinality == BUDDY_SET_ARRAY_MAX_IDS) {
+        if (!prv_buddy_set_to_bitmap(container)) {
+            return false;
+        }
+        
+        container->data.bitmap[low >> 6] |= (1ULL << (low & 63));
+        container->cardinality++;
+        set->count++;
+        
+        return true;
+    }
+    
+    if (container->cardinality == container->capacity) {
+        uint32_t new_capacity = container->capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = BUDDY_SET_INITIAL_ARRAY;
+        }
+        
+        if (new_capacity > BUDDY_SET_ARRAY_MAX_IDS) {
+            new_capacity = BUDDY_SET_ARRAY_MAX_IDS;
+        }
+        
+        uint16_t *array = realloc(container->data.array, new_capacity * sizeof(uint16_t));
+        
+        if (array == NULL) {
+            // Don't leave an empty container behind
+            if (container->cardinality == 0) {
+                prv_buddy_set_remove_container(set, idx);
+            }
+            
+            return false;
+        }
+        
+        container->data.array = array;
+        container->capacity = new_capacity;
+    }
+    
+    memmove(
+        &container->data.array[pos + 1],
+        &container->data.array[pos],
+        (container->cardinality - pos) * sizeof(uint16_t)
+    );
+    container->data.array[pos] = low;
+    container->cardinality++;
+    set->count++;
+    
+    return true;
+}
+
+bool buddy_set_remove(buddy_set_t *set, screenname_id_t id) {
+    if (set == NULL || id == SCREENNAME_ID_INVALID) {
+        return false;
+    }
+    
+    uint16_t key = BUDDY_SET_KEY(id);
+    uint16_t low = BUDDY_SET_LOW(id);
+    uint32_t idx = prv_buddy_set_find_container(set, key);
+    
+    if (idx == set->num_containers || set->containers[idx].key != key) {
+        return false;
+    }
+    
+    buddy_set_container_t *container = &set->containers[idx];
+    
+    if (prv_buddy_set_is_bitmap(container)) {
+        uint64_t bit = 1ULL << (low & 63);
+        
+        if ((container->data.bitmap[low >> 6] & bit) == 0) {
+            return false;
+        }
+        
+        container->data.bitmap[low >> 6] &= ~bit;
+        container->cardinality--;
+        
+        // Shrinking back to an array only fails on out of memory, bitmap stays valid
+        if (container->cardinality == BUDDY_SET_ARRAY_MAX_IDS && !prv_buddy_set_to_array(container)) {
+            container->cardinality++;
+            container->data.bitmap[low >> 6] |= bit;
+            
+            return false;
+        }
+        
+        set->count--;
+        
+        return true;
+    }
+    
+    uint32_t pos = prv_buddy_set_lower_bound(container->data.array, container->cardinality, low);
+    
+    if (pos == container->cardinality || container->data.array[pos] != low) {
+        return false;
+    }
+    
+    container->cardinality--;
+    set->count--;
+    memmove(
+        &container->data.array[pos],
+        &container->data.array[pos + 1],
+        (container->cardinality - pos) * sizeof(uint16_t)
+    );
+    
+    if (container->cardinality == 0) {
+        prv_buddy_set_remove_container(set, idx);
+    }
+    
+    return true;
+}
+
+bool buddy_set_contains(const buddy_set_t *set, screenname_id_t id) {
+    if (set == NULL || id == SCREENNAME_ID_INVALID) {
+        return false;
+    }
+    
+    uint16_t key = BUDDY_SET_KEY(id);
+    uint16_t low = BUDDY_SET_LOW(id);
+    uint32_t idx = prv_buddy_set_find_container(set, key);
+    
+    if (idx == set->num_containers || set->containers[idx].key != key) {
+        return false;
+    }
+    
+    const buddy_set_container_t *container = &set->containers[idx];
+    
+    if (prv_buddy_set_is_bitmap(container)) {
+        return (container->data.bitmap[low >> 6] >> (low & 63)) & 1;
+    }
+    
+    uint32_t pos = prv_buddy_set_lower_bound(container->data.array, container->cardinality, low);
+    
+    return (pos < container->cardinality && container->data.array[pos] == low);
+}
+
+uint32_t buddy_set_count(const buddy_set_t *set) {
+    if (set == NULL) {
+        return 0;
+    }
+    
+    return set->count;
+}
+
+size_t buddy_set_allocated_size(const buddy_set_t *set) {
+    if (set == NULL) {
+        return 0;
+    }
+    
+    size_t size = set->capacity * sizeof(buddy_set_container_t);
+    
+    for (uint32_t i = 0; i < set->num_containers; i++) {
+        const buddy_set_container_t *container = &set->containers[i];
+        
+        if (prv_buddy_set_is_bitmap(container)) {
+            size += BUDDY_SET_BITMAP_WORDS * sizeof(uint64_t);
+        } else {
+            size += container->capacity * sizeof(uint16_t);
+        }
+    }
+    
+    return size;
+}
+
+bool buddy_set_intersect(buddy_set_t *dest, const buddy_set_t *a, const buddy_set_t *b) {
+    if (dest == NULL || a == NULL || b == NULL) {
+        return false;
+    }
+    
+    buddy_set_deinit(dest);
+    
+    uint32_t i = 0;
+    uint32_t j = 0;
+    
+    // Walk both container lists in key order, only matching keys can intersect
+    while (i < a->num_containers && j < b->num_containers) {
+        const buddy_set_container_t *ca = &a->containers[i];
+        const buddy_set_container_t *cb = &b->containers[j];
+        
+        if (ca->key < cb->key) {
+            i++;
+            continue;
+        }
+        
+        if (cb->key < ca->key) {
+            j++;
+            continue;
+        }
+        
+        buddy_set_container_t *container = prv_buddy_set_insert_container(dest, dest->num_containers, ca->key);
+        
+        if (container == NULL || !prv_buddy_set_intersect_container(container, ca, cb)) {
+            buddy_set_deinit(dest);
+            return false;
+        }
+        
+        dest->count += container->cardinality;
+        
+        if (container->cardinality == 0) {
+            prv_buddy_set_remove_container(dest, dest->num_containers - 1);
+        }
+        
+        i++;
+        j++;
+    }
+    
+    return true;
+}
+
+void buddy_set_iter_init(buddy_set_iter_t *iter, const buddy_set_t *set) {
+    iter->set = set;
+    iter->container = 0;
+    iter->pos = 0;
+}
+
+bool buddy_set_iter_next(buddy_set_iter_t *iter, screenname_id_t *id) {
+    const buddy_set_t *set = iter->set;
+    
+    while (set != NULL && iter->container < set->num_containers) {
+        const buddy_set_container_t *container = &set->containers[iter->container];
+        
+        if (!prv_buddy_set_is_bitmap(container)) {
+            if (iter->pos < container->cardinality) {
+                *id = ((screenname_id_t)container->key << 16) | container->data.array[iter->pos];
+                iter->pos++;
+                return true;
+            }
+        } else {
+            // pos is the next bit to look at
+            while (iter->pos < BUDDY_SET_BITMAP_WORDS * 64) {
+                uint32_t word = iter->pos >> 6;
+                uint64_t bits = container->data.bitmap[word] >> (iter->pos & 63);
+                
+                if (bits == 0) {
+                    iter->pos = (word + 1) << 6;
+                    continue;
+                }
+                
+                iter->pos += __builtin_ctzll(bits);
+                *id = ((screenname_id_t)container->key << 16) | iter->pos;
+                iter->pos++;
+                return true;
+            }
+        }
+        
+        iter->container++;
+        iter->pos = 0;
+    }
+    
+    return false;
+}
\ No newline at end of file
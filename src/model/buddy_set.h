@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file buddy_set.h
+ * @author Evan Stoddard
+ * @brief Compact set of interned screen name IDs
+ */
+
+#ifndef BUDDY_SET_H_
+#define BUDDY_SET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model/screenname.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Largest container kept as a sorted array, bigger ones become bitmaps
+ * 
+ */
+#define BUDDY_SET_ARRAY_MAX_IDS 4096U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Container for all IDs sharing the upper 16 bits
+ * 
+ * Holds a sorted array of the lower 16 bits while cardinality is at most
+ * BUDDY_SET_ARRAY_MAX_IDS, a 65536 bit bitmap otherwise.
+ */
+typedef struct buddy_set_container_t {
+    uint16_t key;
+    uint16_t capacity;
+    uint32_t cardinality;
+    
+    union {
+        uint16_t *array;
+        uint64_t *bitmap;
+    } data;
+} buddy_set_container_t;
+
+/**
+ * @brief Buddy set typedef
+ * 
+ * Containers are sorted by key. Interned IDs are small and dense, so
+ * ordinary buddy lists fit in one array container (2 bytes per buddy).
+ * A zeroed buddy set is a valid empty set.
+ */
+typedef struct buddy_set_t {
+    buddy_set_container_t *containers;
+    uint32_t num_containers;
+    uint32_t capacity;
+    
+    // Total IDs across containers
+    uint32_t count;
+} buddy_set_t;
+
+/**
+ * @brief Buddy set iterator
+ * 
+ */
+typedef struct buddy_set_iter_t {
+    const buddy_set_t *set;
+    uint32_t container;
+    uint32_t pos;
+} buddy_set_iter_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize empty buddy set
+ * 
+ * @param set Buddy set
+ */
+void buddy_set_init(buddy_set_t *set);
+
+/**
+ * @brief Free everything held by buddy set, leaving it empty
+ * 
+ * @param set Buddy set
+ */
+void buddy_set_deinit(buddy_set_t *set);
+
+/**
+ * @brief Add ID to set
+ * 
+ * @param set Buddy set
+ * @param id ID to add
+ * @return true ID is in set
+ * @return false Unable to add ID (invalid or out of memory)
+ */
+bool buddy_set_add(buddy_set_t *set, screenname_id_t id);
+
+/**
+ * @brief Remove ID from set
+ * 
+ * @param set Buddy set
+ * @param id ID to remove
+ * @return true ID was in set
+ * @return false ID was not in set
+ */
+bool buddy_set_remove(buddy_set_t *set, screenname_id_t id);
+
+/**
+ * @brief Check if ID is in set
+ * 
+ * @param set Buddy set
+ * @param id ID
+ * @return true ID is in set
+ * @return false ID is not in set
+ */
+bool buddy_set_contains(const buddy_set_t *set, screenname_id_t id);
+
+/**
+ * @brief Number of IDs in set
+ * 
+ * @param set Buddy set
+ * @return uint32_t Number of IDs
+ */
+uint32_t buddy_set_count(const buddy_set_t *set);
+
+/**
+ * @brief Heap memory held by set
+ * 
+ * @param set Buddy set
+ * @return size_t Bytes allocated
+ */
+size_t buddy_set_allocated_size(const buddy_set_t *set);
+
+/**
+ * @brief Replace contents of dest with IDs in both a and b
+ * 
+ * @param dest Destination set (must not be a or b)
+ * @param a Buddy set
+ * @param b Buddy set
+ * @return true Able to intersect
+ * @return false Out of memory (dest is left empty)
+ */
+bool buddy_set_intersect(buddy_set_t *dest, const buddy_set_t *a, const buddy_set_t *b);
+
+/**
+ * @brief Start iterating set in ascending ID order
+ * 
+ * Set must not be modified while iterating.
+ * 
+ * @param iter Iterator
+ * @param set Buddy set
+ */
+void buddy_set_iter_init(buddy_set_iter_t *iter, const buddy_set_t *set);
+
+/**
+ * @brief Get next ID from iterator
+ * 
+ * @param iter Iterator
+ * @param id Set to next ID
+ * @return true ID returned
+ * @return false No IDs left
+ */
+bool buddy_set_iter_next(buddy_set_iter_t *iter, screenname_id_t *id);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BUDDY_SET_H_ */
\ No newline at end of file
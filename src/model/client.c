@@ -108,6 +108,10 @@ void client_deinit(client_t *client) {
         free(client->challenge);
     }
     
+    if (client->login_screenname) {
+        free(client->login_screenname);
+    }
+    
     free(client);
 }
 
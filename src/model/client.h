@@ -27,10 +27,26 @@ extern "C" {
 
 #define CLIENT_MD5_AIM_STRING "AOL Instant Messenger (SM)"
 
+#define CLIENT_PASSWORD_HASH_LEN 16U
+
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
  *****************************************************************************/
 
+/**
+ * @brief BUCP login progress
+ * 
+ */
+typedef enum {
+    CLIENT_LOGIN_STATE_IDLE = 0,
+    CLIENT_LOGIN_STATE_CHALLENGE_ISSUED,
+    CLIENT_LOGIN_STATE_CREDENTIALS_RECEIVED,
+    CLIENT_LOGIN_STATE_LOOKUP_PENDING,
+    CLIENT_LOGIN_STATE_VERIFIED,
+    CLIENT_LOGIN_STATE_REDIRECTED,
+    CLIENT_LOGIN_STATE_FAILED,
+} client_login_state_t;
+
 /**
  * @brief Client Model Definition
  * 
@@ -52,6 +68,12 @@ typedef struct client_t {
     char country[3];
     
     char *challenge;
+    
+    // Login state machine
+    client_login_state_t login_state;
+    uint16_t login_error;
+    char *login_screenname;
+    uint8_t login_password_hash[CLIENT_PASSWORD_HASH_LEN];
 } client_t;
 
 /*****************************************************************************
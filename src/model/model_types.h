@@ -12,6 +12,7 @@
 #define MODEL_TYPES_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,6 +36,42 @@ typedef struct user_info_t {
     uint8_t md5_password[16];
 } user_info_t;
 
+/**
+ * @brief Stored feedbag typedef
+ * 
+ * Items are kept back to back in their wire encoding, so the blob can be
+ * sent to clients as is. Version 0 means nothing is stored yet.
+ */
+typedef struct feedbag_blob_t {
+    uint32_t version;
+    uint32_t modified;
+    uint16_t num_items;
+    uint8_t *items;
+    size_t items_len;
+} feedbag_blob_t;
+
+/**
+ * @brief Stored directory entry typedef
+ * 
+ * Info and keywords are TLV blocks as set by the client. Every store
+ * gets a new sequence number, so readers can pick up changes in order.
+ */
+typedef struct dir_entry_t {
+    const char *uin;
+    uint64_t seq;
+    const uint8_t *info;
+    size_t info_len;
+    const uint8_t *keywords;
+    size_t keywords_len;
+} dir_entry_t;
+
+/**
+ * @brief Callback for each directory entry read from backend
+ * 
+ * Entry is only valid for the duration of the call.
+ */
+typedef void (*dir_entry_cb_t)(void *ctx, const dir_entry_t *entry);
+
 /*****************************************************************************
  * Function Prototypes
  *****************************************************************************/
@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file screenname.c
+ * @author Evan Stoddard
+ * @brief Screen name normalization and interning
+ */
+
+#include "screenname.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define SCREENNAME_INITIAL_CAPACITY 64U
+
+#define SCREENNAME_FNV_OFFSET_BASIS 2166136261U
+#define SCREENNAME_FNV_PRIME        16777619U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Interned screen name entry
+ * 
+ */
+typedef struct screenname_entry_t {
+    uint32_t hash;
+    uint32_t refcount;
+    uint8_t len;
+    char name[SCREENNAME_MAX_LEN + 1];
+} screenname_entry_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance of intern table
+ * 
+ * Entries are indexed by (id - 1). The index is an open addressed table of
+ * IDs (linear probing) sized to a power of two and kept at most half full.
+ */
+static struct {
+    screenname_entry_t *entries;
+    uint32_t num_entries;
+    uint32_t entry_capacity;
+    
+    // Stack of entry slots released back to the table
+    uint32_t *free_ids;
+    uint32_t num_free_ids;
+    
+    screenname_id_t *index;
+    uint32_t index_capacity;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Hash normalized screen name (FNV-1a)
+ * 
+ * @param name Normalized screen name
+ * @param len Length of name
+ * @return uint32_t Hash
+ */
+static uint32_t prv_screenname_hash(const char *name, size_t len);
+
+/**
+ * @brief Get entry for ID
+ * 
+ * @param id Handle
+ * @return screenname_entry_t* Entry (NULL if invalid)
+ */
+static screenname_entry_t *prv_screenname_entry(screenname_id_t id);
+
+/**
+ * @brief Find index slot for normalized screen name
+ * 
+ * @param name Normalized screen name
+ * @param len Length of name
+ * @param hash Hash of name
+ * @return uint32_t Slot holding name, or empty slot where it would go
+ */
+static uint32_t prv_screenname_index_slot(const char *name, size_t len, uint32_t hash);
+
+/**
+ * @brief Grow index and rehash all live entries
+ * 
+ * @return true Able to grow index
+ * @return false Unable to grow index
+ */
+static bool prv_screenname_grow_index(void);
+
+/**
+ * @brief Allocate a new entry slot
+ * 
+ * @return screenname_id_t ID of slot (SCREENNAME_ID_INVALID if out of memory)
+ */
+static screenname_id_t prv_screenname_alloc_entry(void);
+
+/**
+ * @brief Remove ID from index, shifting back any displaced entries
+ * 
+ * @param id Handle
+ */
+static void prv_screenname_index_remove(screenname_id_t id);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static uint32_t prv_screenname_hash(const char *name, size_t len) {
+    uint32_t hash = SCREENNAME_FNV_OFFSET_BASIS;
+    
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= SCREENNAME_FNV_PRIME;
+    }
+    
+    return hash;
+}
+
+static screenname_entry_t *prv_screenname_entry(screenname_id_t id) {
+    if (id == SCREENNAME_ID_INVALID || id > prv_inst.num_entries) {
+        return NULL;
+    }
+    
+    screenname_entry_t *entry = &prv_inst.entries[id - 1];
+    
+    if (entry->refcount == 0) {
+        return NULL;
+    }
+    
+    return entry;
+}
+
+static uint32_t prv_screenname_index_slot(const char *name, size_t len, uint32_t hash) {
+    uint32_t mask = prv_inst.index_capacity - 1;
+    uint32_t slot = hash & mask;
+    
+    while (prv_inst.index[slot] != SCREENNAME_ID_INVALID) {
+        screenname_entry_t *entry = &prv_inst.entries[prv_inst.index[slot] - 1];
+        
+        if (
+            entry->hash == hash &&
+            entry->len == len &&
+            memcmp(entry->name, name, len) == 0
+        ) {
+            break;
+        }
+        
+        slot = (slot + 1) & mask;
+    }
+    
+    return slot;
+}
+
+static bool prv_screenname_grow_index(void) {
+    uint32_t new_capacity = prv_inst.index_capacity * 2;
+    
+    if (new_capacity == 0) {
+        new_capacity = SCREENNAME_INITIAL_CAPACITY * 2;
+    }
+    
+    screenname_id_t *new_index = calloc(new_capacity, sizeof(screenname_id_t));
+    
+    if (new_index == NULL) {
+        return false;
+    }
+    
+    screenname_id_t *old_index = prv_inst.index;
+    uint32_t old_capacity = prv_inst.index_capacity;
+    
+    prv_inst.index = new_index;
+    prv_inst.index_capacity = new_capacity;
+    
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        screenname_id_t id = old_index[i];
+        
+        if (id == SCREENNAME_ID_INVALID) {
+            continue;
+        }
+        
+        screenname_entry_t *entry = &prv_inst.entries[id - 1];
+        uint32_t slot = prv_screenname_index_slot(entry->name, entry->len, entry->hash);
+        prv_inst.index[slot] = id;
+    }
+    
+    free(old_index);
+    
+    return true;
+}
+
+static screenname_id_t prv_screenname_alloc_entry(void) {
+    // Reuse released slot if possible
+    if (prv_inst.num_free_ids > 0) {
+        prv_inst.num_free_ids--;
+        return prv_inst.free_ids[prv_inst.num_free_ids];
+    }
+    
+    if (prv_inst.num_entries == prv_inst.entry_capacity) {
+        uint32_t new_capacity = prv_inst.entry_capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = SCREENNAME_INITIAL_CAPACITY;
+        }
+        
+        screenname_entry_t *entries = realloc(prv_inst.entries, new_capacity * sizeof(screenname_entry_t));
+        
+        if (entries == NULL) {
+            return SCREENNAME_ID_INVALID;
+        }
+        
+        // Free list can never be longer than number of entries
+        uint32_t *free_ids = realloc(prv_inst.free_ids, new_capacity * sizeof(uint32_t));
+        
+        if (free_ids == NULL) {
+            prv_inst.entries = entries;
+            return SCREENNAME_ID_INVALID;
+        }
+        
+        prv_inst.entries = entries;
+        prv_inst.free_ids = free_ids;
+        prv_inst.entry_capacity = new_capacity;
+    }
+    
+    prv_inst.num_entries++;
+    
+    return prv_inst.num_entries;
+}
+
+static void prv_screenname_index_remove(screenname_id_t id) {
+    screenname_entry_t *entry = &prv_inst.entries[id - 1];
+    uint32_t mask = prv_inst.index_capacity - 1;
+    uint32_t slot = prv_screenname_index_slot(entry->name, entry->len, entry->hash);
+    
+    if (prv_inst.index[slot] != id) {
+        return;
+    }
+    
+    prv_inst.index[slot] = SCREENNAME_ID_INVALID;
+    
+    // Backward shift deletion so probe sequences stay unbroken
+    uint32_t next = (slot + 1) & mask;
+    
+    while (prv_inst.index[next] != SCREENNAME_ID_INVALID) {
+        screenname_id_t next_id = prv_inst.index[next];
+        uint32_t home = prv_inst.entries[next_id - 1].hash & mask;
+        
+        // Move entry into hole if its home slot is not between hole and itself
+        bool in_range = (slot <= next) ?
+            (home > slot && home <= next) :
+            (home > slot || home <= next);
+        
+        if (!in_range) {
+            prv_inst.index[slot] = next_id;
+            prv_inst.index[next] = SCREENNAME_ID_INVALID;
+            slot = next;
+        }
+        
+        next = (next + 1) & mask;
+    }
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+size_t screenname_normalize(char *dest, size_t dest_size, const char *src, size_t src_len) {
+    if (dest == NULL || src == NULL || dest_size == 0) {
+        return 0;
+    }
+    
+    size_t len = 0;
+    
+    for (size_t i = 0; i < src_len; i++) {
+        if (src[i] == '\0') {
+            break;
+        }
+        
+        if (src[i] == ' ') {
+            continue;
+        }
+        
+        // Leave room for null terminator
+        if (len + 1 >= dest_size) {
+            return 0;
+        }
+        
+        dest[len] = tolower((unsigned char)src[i]);
+        len++;
+    }
+    
+    dest[len] = '\0';
+    
+    return len;
+}
+
+screenname_id_t screenname_intern(const char *src, size_t src_len) {
+    char name[SCREENNAME_MAX_LEN + 1];
+    size_t len = screenname_normalize(name, sizeof(name), src, src_len);
+    
+    if (len == 0) {
+        return SCREENNAME_ID_INVALID;
+    }
+    
+    // Keep index at most half full
+    if ((prv_inst.num_entries - prv_inst.num_free_ids + 1) * 2 > prv_inst.index_capacity) {
+        if (!prv_screenname_grow_index()) {
+            LOG_ERR("Unable to grow screen name index. Out of memory?");
+            return SCREENNAME_ID_INVALID;
+        }
+    }
+    
+    uint32_t hash = prv_screenname_hash(name, len);
+    uint32_t slot = prv_screenname_index_slot(name, len, hash);
+    
+    // Already interned
+    if (prv_inst.index[slot] != SCREENNAME_ID_INVALID) {
+        prv_inst.entries[prv_inst.index[slot] - 1].refcount++;
+        return prv_inst.index[slot];
+    }
+    
+    screenname_id_t id = prv_screenname_alloc_entry();
+    
+    if (id == SCREENNAME_ID_INVALID) {
+        LOG_ERR("Unable to allocate screen name entry. Out of memory?");
+        return SCREENNAME_ID_INVALID;
+    }
+    
+    screenname_entry_t *entry = &prv_inst.entries[id - 1];
+    entry->hash = hash;
+    entry->refcount = 1;
+    entry->len = len;
+    memcpy(entry->name, name, len + 1);
+    
+    prv_inst.index[slot] = id;
+    
+    return id;
+}
+
+screenname_id_t screenname_find(const char *src, size_t src_len) {
+    if (prv_inst.index_capacity == 0) {
+        return SCREENNAME_ID_INVALID;
+    }
+    
+    char name[SCREENNAME_MAX_LEN + 1];
+    size_t len = screenname_normalize(name, sizeof(name), src, src_len);
+    
+    if (len == 0) {
+        return SCREENNAME_ID_INVALID;
+    }
+    
+    uint32_t slot = prv_screenname_index_slot(name, len, prv_screenname_hash(name, len));
+    
+    return prv_inst.index[slot];
+}
+
+void screenname_retain(screenname_id_t id) {
+    screenname_entry_t *entry = prv_screenname_entry(id);
+    
+    if (entry == NULL) {
+        return;
+    }
+    
+    entry->refcount++;
+}
+
+void screenname_release(screenname_id_t id) {
+    screenname_entry_t *entry = prv_screenname_entry(id);
+    
+    if (entry == NULL) {
+        return;
+    }
+    
+    entry->refcount--;
+    
+    if (entry->refcount > 0) {
+        return;
+    }
+    
+    // Last reference dropped, hand slot back to the table
+    prv_screenname_index_remove(id);
+    
+    prv_inst.free_ids[prv_inst.num_free_ids] = id;
+    prv_inst.num_free_ids++;
+}
+
+const char *screenname_str(screenname_id_t id) {
+    screenname_entry_t *entry = prv_screenname_entry(id);
+    
+    if (entry == NULL) {
+        return NULL;
+    }
+    
+    return entry->name;
+}
+
+uint8_t screenname_len(screenname_id_t id) {
+    screenname_entry_t *entry = prv_screenname_entry(id);
+    
+    if (entry == NULL) {
+        return 0;
+    }
+    
+    return entry->len;
+}
+
+uint32_t screenname_hash(screenname_id_t id) {
+    screenname_entry_t *entry = prv_screenname_entry(id);
+    
+    if (entry == NULL) {
+        return 0;
+    }
+    
+    return entry->hash;
+}
\ No newline at end of file
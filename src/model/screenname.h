@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file screenname.h
+ * @author Evan Stoddard
+ * @brief Screen name normalization and interning
+ */
+
+#ifndef SCREENNAME_H_
+#define SCREENNAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "oscar/oscar_constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief ID that will never be handed out by the intern table
+ * 
+ */
+#define SCREENNAME_ID_INVALID 0U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Handle to an interned, normalized screen name
+ * 
+ * Two handles are equal if and only if the normalized screen names are equal.
+ */
+typedef uint32_t screenname_id_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Normalize screen name (strip spaces and lowercase)
+ * 
+ * @param dest Destination buffer (will be null terminated)
+ * @param dest_size Size of destination buffer
+ * @param src Screen name (does not need to be null terminated)
+ * @param src_len Length of screen name
+ * @return size_t Length of normalized screen name (0 if invalid)
+ */
+size_t screenname_normalize(char *dest, size_t dest_size, const char *src, size_t src_len);
+
+/**
+ * @brief Intern screen name, taking a reference to it
+ * 
+ * @param src Screen name (does not need to be null terminated or normalized)
+ * @param src_len Length of screen name
+ * @return screenname_id_t Handle (SCREENNAME_ID_INVALID if invalid or out of memory)
+ */
+screenname_id_t screenname_intern(const char *src, size_t src_len);
+
+/**
+ * @brief Look up screen name without interning it or taking a reference
+ * 
+ * @param src Screen name (does not need to be null terminated or normalized)
+ * @param src_len Length of screen name
+ * @return screenname_id_t Handle (SCREENNAME_ID_INVALID if not interned)
+ */
+screenname_id_t screenname_find(const char *src, size_t src_len);
+
+/**
+ * @brief Take an additional reference to an interned screen name
+ * 
+ * @param id Handle
+ */
+void screenname_retain(screenname_id_t id);
+
+/**
+ * @brief Release reference to interned screen name
+ * 
+ * @param id Handle
+ */
+void screenname_release(screenname_id_t id);
+
+/**
+ * @brief Get normalized screen name for handle
+ * 
+ * @param id Handle
+ * @return const char* Null terminated normalized screen name (NULL if invalid)
+ */
+const char *screenname_str(screenname_id_t id);
+
+/**
+ * @brief Get length of normalized screen name for handle
+ * 
+ * @param id Handle
+ * @return uint8_t Length of screen name (0 if invalid)
+ */
+uint8_t screenname_len(screenname_id_t id);
+
+/**
+ * @brief Get precomputed hash of normalized screen name
+ * 
+ * @param id Handle
+ * @return uint32_t Hash (0 if invalid)
+ */
+uint32_t screenname_hash(screenname_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SCREENNAME_H_ */
\ No newline at end of file
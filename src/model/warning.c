@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file warning.c
+ * @author Evan Stoddard
+ * @brief Warning (evil) levels that decay over time
+ */
+
+#include "warning.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+// Steps per half life in the decay table
+#define WARNING_DECAY_STEPS 16U
+
+// Past this many half lives every level is 0
+#define WARNING_MAX_HALVINGS 10U
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief 2^(-i / WARNING_DECAY_STEPS) in Q16
+ * 
+ */
+static const uint32_t prv_warning_decay[WARNING_DECAY_STEPS + 1] = {
+    65536, 62757, 60097, 57549, 55109, 52773, 50535, 48393,
+    46341, 44376, 42495, 40693, 38968, 37316, 35734, 34219,
+    32768,
+};
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+uint16_t warning_level_get(const warning_level_t *level, uint64_t now_ms, uint32_t half_life_ms) {
+    if (level->value == 0 || half_life_ms == 0 || now_ms <= level->updated_ms) {
+        return level->value;
+    }
+    
+    uint64_t elapsed = now_ms - level->updated_ms;
+    uint64_t halvings = elapsed / half_life_ms;
+    
+    if (halvings >= WARNING_MAX_HALVINGS) {
+        return 0;
+    }
+    
+    // Interpolate within the table for the part of a half life left over
+    uint64_t rem = (elapsed % half_life_ms) * WARNING_DECAY_STEPS;
+    uint32_t step = rem / half_life_ms;
+    uint64_t frac = ((rem % half_life_ms) << 16) / half_life_ms;
+    
+    uint64_t factor = prv_warning_decay[step] - (((prv_warning_decay[step] - prv_warning_decay[step + 1]) * frac) >> 16);
+    
+    return (uint16_t)(((uint64_t)level->value * factor) >> (16 + halvings));
+}
+
+uint16_t warning_level_add(warning_level_t *level, uint16_t delta, uint64_t now_ms, uint32_t half_life_ms) {
+    uint32_t value = (uint32_t)warning_level_get(level, now_ms, half_life_ms) + delta;
+    
+    if (value > WARNING_LEVEL_MAX) {
+        value = WARNING_LEVEL_MAX;
+    }
+    
+    level->value = value;
+    level->updated_ms = now_ms;
+    
+    return level->value;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file warning.h
+ * @author Evan Stoddard
+ * @brief Warning (evil) levels that decay over time
+ */
+
+#ifndef WARNING_H_
+#define WARNING_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Highest warning level (tenths of a percent)
+ * 
+ */
+#define WARNING_LEVEL_MAX 999U
+
+/**
+ * @brief Level added by a warning from a named user
+ * 
+ */
+#define WARNING_LEVEL_NORMAL_DELTA 100U
+
+/**
+ * @brief Level added by an anonymous warning
+ * 
+ */
+#define WARNING_LEVEL_ANONYMOUS_DELTA 30U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Warning level as of a point in time
+ * 
+ * Decay is never stored, the current level is worked out from the level
+ * at the last change whenever it is read. A zeroed struct is level 0.
+ */
+typedef struct warning_level_t {
+    uint16_t value;
+    uint64_t updated_ms;
+} warning_level_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Current warning level
+ * 
+ * Level halves every half life.
+ * 
+ * @param level Warning level
+ * @param now_ms Current monotonic time
+ * @param half_life_ms Half life of level (0 never decays)
+ * @return uint16_t Current level
+ */
+uint16_t warning_level_get(const warning_level_t *level, uint64_t now_ms, uint32_t half_life_ms);
+
+/**
+ * @brief Raise warning level
+ * 
+ * @param level Warning level
+ * @param delta Amount to add
+ * @param now_ms Current monotonic time
+ * @param half_life_ms Half life of level (0 never decays)
+ * @return uint16_t New level (capped at WARNING_LEVEL_MAX)
+ */
+uint16_t warning_level_add(warning_level_t *level, uint16_t delta, uint64_t now_ms, uint32_t half_life_ms);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* WARNING_H_ */
\ No newline at end of file
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file warning_table.c
+ * @author Evan Stoddard
+ * @brief Warning levels of users that are signed off
+ */
+
+#include "warning_table.h"
+
+#include <stdlib.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define WARNING_TABLE_INITIAL_BUCKETS 64U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Kept warning level of one user
+ * 
+ */
+typedef struct warning_table_entry_t {
+    screenname_id_t screenname_id;
+    warning_level_t level;
+    
+    struct warning_table_entry_t *next_in_bucket;
+} warning_table_entry_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance of warning table
+ * 
+ */
+static struct {
+    // Grows by doubling once it holds as many entries as buckets
+    warning_table_entry_t **buckets;
+    uint32_t num_buckets;
+    uint32_t num_entries;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get bucket of user
+ * 
+ * @param screenname_id User
+ * @return warning_table_entry_t** Bucket
+ */
+static warning_table_entry_t **prv_warning_table_bucket(screenname_id_t screenname_id);
+
+/**
+ * @brief Unlink and free entry
+ * 
+ * @param link Link pointing at entry
+ */
+static void prv_warning_table_remove(warning_table_entry_t **link);
+
+/**
+ * @brief Double number of buckets
+ * 
+ * @return true Table grown
+ * @return false Out of memory
+ */
+static bool prv_warning_table_grow(void);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static warning_table_entry_t **prv_warning_table_bucket(screenname_id_t screenname_id) {
+    return &prv_inst.buckets[screenname_hash(screenname_id) & (prv_inst.num_buckets - 1)];
+}
+
+static void prv_warning_table_remove(warning_table_entry_t **link) {
+    warning_table_entry_t *entry = *link;
+    
+    *link = entry->next_in_bucket;
+    prv_inst.num_entries--;
+    
+    screenname_release(entry->screenname_id);
+    free(entry);
+}
+
+static bool prv_warning_table_grow(void) {
+    uint32_t old_count = prv_inst.num_buckets;
+    uint32_t new_count = old_count * 2;
+    
+    if (new_count == 0) {
+        new_count = WARNING_TABLE_INITIAL_BUCKETS;
+    }
+    
+    warning_table_entry_t **buckets = calloc(new_count, sizeof(warning_table_entry_t *));
+    
+    if (buckets == NULL) {
+        return false;
+    }
+    
+    warning_table_entry_t **old_buckets = prv_inst.buckets;
+    
+    prv_inst.buckets = buckets;
+    prv_inst.num_buckets = new_count;
+    
+    for (uint32_t i = 0; i < old_count; i++) {
+        warning_table_entry_t *entry = old_buckets[i];
+        
+        while (entry != NULL) {
+            warning_table_entry_t *next = entry->next_in_bucket;
+            warning_table_entry_t **bucket = prv_warning_table_bucket(entry->screenname_id);
+            
+            entry->next_in_bucket = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+    
+    free(old_buckets);
+    
+    return true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void warning_table_save(screenname_id_t screenname_id, const warning_level_t *level, uint64_t now_ms, uint32_t half_life_ms) {
+    warning_level_t discarded;
+    
+    // Never more than one entry per user
+    warning_table_take(screenname_id, &discarded, now_ms, half_life_ms);
+    
+    if (warning_level_get(level, now_ms, half_life_ms) == 0) {
+        return;
+    }
+    
+    // A failed grow only makes chains longer, unless there is no table at all
+    if (prv_inst.num_entries >= prv_inst.num_buckets && !prv_warning_table_grow() && prv_inst.num_buckets == 0) {
+        return;
+    }
+    
+    warning_table_entry_t *entry = malloc(sizeof(warning_table_entry_t));
+    
+    if (entry == NULL) {
+        return;
+    }
+    
+    warning_table_entry_t **bucket = prv_warning_table_bucket(screenname_id);
+    
+    screenname_retain(screenname_id);
+    entry->screenname_id = screenname_id;
+    entry->level = *level;
+    entry->next_in_bucket = *bucket;
+    *bucket = entry;
+    prv_inst.num_entries++;
+}
+
+bool warning_table_take(screenname_id_t screenname_id, warning_level_t *level, uint64_t now_ms, uint32_t half_life_ms) {
+    if (prv_inst.num_buckets == 0) {
+        return false;
+    }
+    
+    warning_table_entry_t **link = prv_warning_table_bucket(screenname_id);
+    
+    while (*link != NULL) {
+        warning_table_entry_t *entry = *link;
+        
+        // Users away long enough to have decayed are dropped as the chain is walked anyway
+        if (warning_level_get(&entry->level, now_ms, half_life_ms) == 0) {
+            prv_warning_table_remove(link);
+            continue;
+        }
+        
+        if (entry->screenname_id == screenname_id) {
+            *level = entry->level;
+            prv_warning_table_remove(link);
+            return true;
+        }
+        
+        link = &entry->next_in_bucket;
+    }
+    
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file warning_table.h
+ * @author Evan Stoddard
+ * @brief Warning levels of users that are signed off
+ */
+
+#ifndef WARNING_TABLE_H_
+#define WARNING_TABLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "model/screenname.h"
+#include "model/warning.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Keep warning level of user whose session is ending
+ * 
+ * Levels are kept with the time of their last change so they go on
+ * decaying while the user is away. Levels that have decayed to 0 are not
+ * kept, and kept ones that have since decayed are dropped whenever a
+ * lookup comes across them.
+ * 
+ * @param screenname_id User (retained while kept)
+ * @param level Warning level
+ * @param now_ms Current monotonic time
+ * @param half_life_ms Half life of levels (0 never decays)
+ */
+void warning_table_save(screenname_id_t screenname_id, const warning_level_t *level, uint64_t now_ms, uint32_t half_life_ms);
+
+/**
+ * @brief Remove kept warning level of user that is signing on
+ * 
+ * @param screenname_id User
+ * @param level Set to kept level
+ * @param now_ms Current monotonic time
+ * @param half_life_ms Half life of levels (0 never decays)
+ * @return true Level found
+ * @return false No level kept for user (or it has decayed to 0)
+ */
+bool warning_table_take(screenname_id_t screenname_id, warning_level_t *level, uint64_t now_ms, uint32_t half_life_ms);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* WARNING_TABLE_H_ */
\ No newline at end of file
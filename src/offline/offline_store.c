@@ -0,0 +1,1155 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file offline_store.c
+ * @author Evan Stoddard
+ * @brief Durable store for messages to users that are offline
+ */
+
+#include "offline_store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "connection.h"
+
+#include "oscar/snac_encoder.h"
+
+#include "utils/timestamp.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define OFFLINE_STORE_RECORD_MAGIC      0x4f464d31U // "OFM1"
+
+#define OFFLINE_STORE_INITIAL_BUCKETS   64U
+#define OFFLINE_STORE_INITIAL_MESSAGES  4U
+#define OFFLINE_STORE_INITIAL_SEGMENTS  4U
+
+#define OFFLINE_STORE_MAX_DIR           (CONFIG_MAX_STRING_LEN + 16U)
+#define OFFLINE_STORE_MAX_PATH          (OFFLINE_STORE_MAX_DIR + 16U)
+#define OFFLINE_STORE_MAX_PAYLOAD       UINT16_MAX
+#define OFFLINE_STORE_MAX_RECORD        (sizeof(offline_record_header_t) + SCREENNAME_MAX_LEN + OFFLINE_STORE_MAX_PAYLOAD)
+
+#define OFFLINE_STORE_FNV_OFFSET_BASIS  2166136261U
+#define OFFLINE_STORE_FNV_PRIME         16777619U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Record types
+ * 
+ */
+typedef enum {
+    OFFLINE_RECORD_MESSAGE = 1,
+    OFFLINE_RECORD_ACK = 2,
+} offline_record_type_t;
+
+/**
+ * @brief On disk record header, followed by recipient name and payload
+ * 
+ * Host byte order, segments never leave the machine that wrote them. An ACK
+ * record drops every message to its recipient with a sequence number up to
+ * and including its own.
+ */
+typedef struct offline_record_header_t {
+    uint64_t seq;
+    uint32_t magic;
+    uint32_t checksum;
+    uint32_t timestamp;
+    uint32_t payload_len;
+    uint8_t type;
+    uint8_t recipient_len;
+    uint8_t reserved[6];
+} offline_record_header_t;
+
+/**
+ * @brief Location of a stored message
+ * 
+ */
+typedef struct offline_message_t {
+    uint64_t seq;
+    uint32_t segment_id;
+    uint32_t offset;
+    uint32_t record_len;
+    uint32_t payload_len;
+} offline_message_t;
+
+/**
+ * @brief Messages waiting for one recipient, ordered by sequence number
+ * 
+ */
+typedef struct offline_recipient_t {
+    screenname_id_t recipient;
+    uint64_t acked_seq;
+    
+    offline_message_t *messages;
+    uint32_t num_messages;
+    uint32_t capacity;
+    
+    struct offline_recipient_t *next_in_bucket;
+} offline_recipient_t;
+
+/**
+ * @brief Segment file
+ * 
+ */
+typedef struct offline_segment_t {
+    uint32_t id;
+    int fd;
+    uint32_t size;
+    
+    // Bytes of message records still waiting for delivery
+    uint32_t live_bytes;
+} offline_segment_t;
+
+/**
+ * @brief Shard, one directory of segments and the index for its recipients
+ * 
+ */
+typedef struct offline_shard_t {
+    char dir[OFFLINE_STORE_MAX_DIR];
+    
+    // Oldest first, last one is appended to
+    offline_segment_t *segments;
+    uint32_t num_segments;
+    uint32_t segment_capacity;
+    
+    // Grows by doubling once it holds as many recipients as buckets
+    offline_recipient_t **buckets;
+    uint32_t num_buckets;
+    uint32_t num_recipients;
+    
+    uint64_t next_seq;
+    bool dirty;
+    uint64_t synced_at_ms;
+} offline_shard_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance of offline store
+ * 
+ */
+static struct {
+    bool enabled;
+    
+    offline_shard_t *shards;
+    uint32_t num_shards;
+    
+    uint32_t segment_bytes;
+    uint32_t sync_interval_ms;
+    uint32_t compact_percent;
+    uint32_t max_messages;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Continue FNV-1a hash over data
+ * 
+ * @param hash Hash so far
+ * @param data Data
+ * @param len Length of data
+ * @return uint32_t Hash
+ */
+static uint32_t prv_offline_store_fnv(uint32_t hash, const void *data, size_t len);
+
+/**
+ * @brief Checksum of record (checksum field treated as zero)
+ * 
+ * @param header Record header
+ * @param recipient Recipient name
+ * @param payload Payload segments
+ * @param payload_count Number of payload segments
+ * @return uint32_t Checksum
+ */
+static uint32_t prv_offline_store_checksum(const offline_record_header_t *header, const char *recipient, const struct iovec *payload, int payload_count);
+
+/**
+ * @brief Get shard recipient belongs to
+ * 
+ * @param recipient Recipient
+ * @return offline_shard_t* Shard
+ */
+static offline_shard_t *prv_offline_store_shard(screenname_id_t recipient);
+
+/**
+ * @brief Find index entry for recipient
+ * 
+ * @param shard Shard
+ * @param recipient Recipient
+ * @param create Create entry if missing (retains recipient)
+ * @return offline_recipient_t* Entry (NULL if missing or out of memory)
+ */
+static offline_recipient_t *prv_offline_store_find_recipient(offline_shard_t *shard, screenname_id_t recipient, bool create);
+
+/**
+ * @brief Bucket of recipient in shard index
+ * 
+ * @param shard Shard
+ * @param recipient Recipient
+ * @return uint32_t Bucket
+ */
+static uint32_t prv_offline_store_bucket(offline_shard_t *shard, screenname_id_t recipient);
+
+/**
+ * @brief Double bucket count of shard index and rehash
+ * 
+ * @param shard Shard
+ * @return true Able to grow index
+ * @return false Unable to grow index
+ */
+static bool prv_offline_store_grow_index(offline_shard_t *shard);
+
+/**
+ * @brief Remove index entry for recipient
+ * 
+ * @param shard Shard
+ * @param entry Entry
+ */
+static void prv_offline_store_drop_recipient(offline_shard_t *shard, offline_recipient_t *entry);
+
+/**
+ * @brief Insert message into entry, keeping sequence order
+ * 
+ * A message with a sequence number already in the entry replaces it (a
+ * compacted copy supersedes the original).
+ * 
+ * @param shard Shard
+ * @param entry Entry
+ * @param message Message
+ * @return true Message indexed
+ * @return false Out of memory
+ */
+static bool prv_offline_store_index_message(offline_shard_t *shard, offline_recipient_t *entry, const offline_message_t *message);
+
+/**
+ * @brief Drop messages up to and including sequence number
+ * 
+ * @param shard Shard
+ * @param entry Entry
+ * @param seq Sequence number
+ */
+static void prv_offline_store_ack_messages(offline_shard_t *shard, offline_recipient_t *entry, uint64_t seq);
+
+/**
+ * @brief Find segment by ID
+ * 
+ * @param shard Shard
+ * @param id Segment ID
+ * @return offline_segment_t* Segment (NULL if not found)
+ */
+static offline_segment_t *prv_offline_store_segment(offline_shard_t *shard, uint32_t id);
+
+/**
+ * @brief Build path of segment file
+ * 
+ * @param shard Shard
+ * @param id Segment ID
+ * @param path Destination buffer (OFFLINE_STORE_MAX_PATH)
+ */
+static void prv_offline_store_segment_path(offline_shard_t *shard, uint32_t id, char *path);
+
+/**
+ * @brief Open segment and add it to the end of the shard's segment list
+ * 
+ * @param shard Shard
+ * @param id Segment ID
+ * @return offline_segment_t* Segment (NULL on failure)
+ */
+static offline_segment_t *prv_offline_store_open_segment(offline_shard_t *shard, uint32_t id);
+
+/**
+ * @brief Append record to active segment, starting a new segment when full
+ * 
+ * @param shard Shard
+ * @param iov Record segments
+ * @param iov_count Number of record segments
+ * @param len Total record length
+ * @param segment_id Set to segment record was written to
+ * @param offset Set to offset of record in segment
+ * @return true Record written
+ * @return false Unable to write record
+ */
+static bool prv_offline_store_write(offline_shard_t *shard, const struct iovec *iov, int iov_count, uint32_t len, uint32_t *segment_id, uint32_t *offset);
+
+/**
+ * @brief Append ACK record for recipient
+ * 
+ * @param shard Shard
+ * @param recipient Recipient
+ * @param seq Last delivered sequence number
+ * @return true Record written
+ * @return false Unable to write record
+ */
+static bool prv_offline_store_write_ack(offline_shard_t *shard, screenname_id_t recipient, uint64_t seq);
+
+/**
+ * @brief Replay segment into index
+ * 
+ * @param shard Shard
+ * @param segment Segment
+ * @param scratch Buffer of OFFLINE_STORE_MAX_RECORD bytes
+ * @param last Segment is the newest one (torn tail is truncated)
+ */
+static void prv_offline_store_replay_segment(offline_shard_t *shard, offline_segment_t *segment, uint8_t *scratch, bool last);
+
+/**
+ * @brief Open shard directory and rebuild its index
+ * 
+ * @param shard Shard
+ * @param scratch Buffer of OFFLINE_STORE_MAX_RECORD bytes
+ * @return true Shard opened
+ * @return false Unable to open shard
+ */
+static bool prv_offline_store_init_shard(offline_shard_t *shard, uint8_t *scratch);
+
+/**
+ * @brief Move live messages out of oldest segment and delete it
+ * 
+ * Only the oldest segment is compacted, so an ACK record can never be
+ * dropped while an older copy of a message it covers is still on disk.
+ * 
+ * @param shard Shard
+ * @return true Segment removed
+ * @return false Unable to compact
+ */
+static bool prv_offline_store_compact(offline_shard_t *shard);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static uint32_t prv_offline_store_fnv(uint32_t hash, const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= OFFLINE_STORE_FNV_PRIME;
+    }
+    
+    return hash;
+}
+
+static uint32_t prv_offline_store_checksum(const offline_record_header_t *header, const char *recipient, const struct iovec *payload, int payload_count) {
+    offline_record_header_t copy = *header;
+    copy.checksum = 0;
+    
+    uint32_t hash = prv_offline_store_fnv(OFFLINE_STORE_FNV_OFFSET_BASIS, &copy, sizeof(copy));
+    hash = prv_offline_store_fnv(hash, recipient, header->recipient_len);
+    
+    for (int i = 0; i < payload_count; i++) {
+        hash = prv_offline_store_fnv(hash, payload[i].iov_base, payload[i].iov_len);
+    }
+    
+    return hash;
+}
+
+static offline_shard_t *prv_offline_store_shard(screenname_id_t recipient) {
+    return &prv_inst.shards[screenname_hash(recipient) % prv_inst.num_shards];
+}
+
+static offline_recipient_t *prv_offline_store_find_recipient(offline_shard_t *shard, screenname_id_t recipient, bool create) {
+    offline_recipient_t *entry = NULL;
+    
+    if (shard->num_buckets > 0) {
+        entry = shard->buckets[prv_offline_store_bucket(shard, recipient)];
+    }
+    
+    while (entry != NULL) {
+        if (entry->recipient == recipient) {
+            return entry;
+        }
+        
+        entry = entry->next_in_bucket;
+    }
+    
+    if (!create) {
+        return NULL;
+    }
+    
+    // A failed grow only makes chains longer, unless there is no table at all
+    if (shard->num_recipients >= shard->num_buckets && !prv_offline_store_grow_index(shard) && shard->num_buckets == 0) {
+        return NULL;
+    }
+    
+    entry = calloc(1, sizeof(offline_recipient_t));
+    
+    if (entry == NULL) {
+        return NULL;
+    }
+    
+    uint32_t bucket = prv_offline_store_bucket(shard, recipient);
+    
+    screenname_retain(recipient);
+    entry->recipient = recipient;
+    entry->next_in_bucket = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+    shard->num_recipients++;
+    
+    return entry;
+}
+
+static uint32_t prv_offline_store_bucket(offline_shard_t *shard, screenname_id_t recipient) {
+    // Low bits already picked the shard
+    return (screenname_hash(recipient) / prv_inst.num_shards) & (shard->num_buckets - 1);
+}
+
+static bool prv_offline_store_grow_index(offline_shard_t *shard) {
+    uint32_t old_count = shard->num_buckets;
+    uint32_t new_count = old_count * 2;
+    
+    if (new_count == 0) {
+        new_count = OFFLINE_STORE_INITIAL_BUCKETS;
+    }
+    
+    offline_recipient_t **buckets = calloc(new_count, sizeof(offline_recipient_t *));
+    
+    if (buckets == NULL) {
+        return false;
+    }
+    
+    offline_recipient_t **old_buckets = shard->buckets;
+    
+    shard->buckets = buckets;
+    shard->num_buckets = new_count;
+    
+    for (uint32_t i = 0; i < old_count; i++) {
+        offline_recipient_t *entry = old_buckets[i];
+        
+        while (entry != NULL) {
+            offline_recipient_t *next = entry->next_in_bucket;
+            uint32_t bucket = prv_offline_store_bucket(shard, entry->recipient);
+            
+            entry->next_in_bucket = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+    
+    free(old_buckets);
+    
+    return true;
+}
+
+static void prv_offline_store_drop_recipient(offline_shard_t *shard, offline_recipient_t *entry) {
+    offline_recipient_t **link = &shard->buckets[prv_offline_store_bucket(shard, entry->recipient)];
+    
+    while (*link != NULL && *link != entry) {
+        link = &(*link)->next_in_bucket;
+    }
+    
+    if (*link == entry) {
+        *link = entry->next_in_bucket;
+        shard->num_recipients--;
+    }
+    
+    screenname_release(entry->recipient);
+    free(entry->messages);
+    free(entry);
+}
+
+static bool prv_offline_store_index_message(offline_shard_t *shard, offline_recipient_t *entry, const offline_message_t *message) {
+    // New messages always go on the end, only replayed compaction copies land earlier
+    uint32_t pos = entry->num_messages;
+    
+    while (pos > 0 && entry->messages[pos - 1].seq >= message->seq) {
+        pos--;
+    }
+    
+    if (pos < entry->num_messages && entry->messages[pos].seq == message->seq) {
+        offline_segment_t *segment = prv_offline_store_segment(shard, entry->messages[pos].segment_id);
+        
+        if (segment != NULL) {
+            segment->live_bytes -= entry->messages[pos].record_len;
+        }
+        
+        entry->messages[pos] = *message;
+        return true;
+    }
+    
+    if (entry->num_messages == entry->capacity) {
+        uint32_t new_capacity = entry->capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = OFFLINE_STORE_INITIAL_MESSAGES;
+        }
+        
+        offline_message_t *messages = realloc(entry->messages, new_capacity * sizeof(offline_message_t));
+        
+        if (messages == NULL) {
+            return false;
+        }
+        
+        entry->messages = messages;
+        entry->capacity = new_capacity;
+    }
+    
+    memmove(
+        &entry->messages[pos + 1],
+        &entry->messages[pos],
+        (entry->num_messages - pos) * sizeof(offline_message_t)
+    );
+    entry->messages[pos] = *message;
+    entry->num_messages++;
+    
+    return true;
+}
+
+static void prv_offline_store_ack_messages(offline_shard_t *shard, offline_recipient_t *entry, uint64_t seq) {
+    uint32_t count = 0;
+    
+    while (count < entry->num_messages && entry->messages[count].seq <= seq) {
+        offline_segment_t *segment = prv_offline_store_segment(shard, entry->messages[count].segment_id);
+        
+        if (segment != NULL) {
+            segment->live_bytes -= entry->messages[count].record_len;
+        }
+        
+        count++;
+    }
+    
+    entry->num_messages -= count;
+    memmove(entry->messages, &entry->messages[count], entry->num_messages * sizeof(offline_message_t));
+    
+    if (seq > entry->acked_seq) {
+        entry->acked_seq = seq;
+    }
+}
+
+static offline_segment_t *prv_offline_store_segment(offline_shard_t *shard, uint32_t id) {
+    // Only a handful of segments per shard, newest are looked up most
+    for (uint32_t i = shard->num_segments; i > 0; i--) {
+        if (shard->segments[i - 1].id == id) {
+            return &shard->segments[i - 1];
+        }
+    }
+    
+    return NULL;
+}
+
+static void prv_offline_store_segment_path(offline_shard_t *shard, uint32_t id, char *path) {
+    snprintf(path, OFFLINE_STORE_MAX_PATH, "%s/%08u.log", shard->dir, id);
+}
+
+static offline_segment_t *prv_offline_store_open_segment(offline_shard_t *shard, uint32_t id) {
+    if (shard->num_segments == shard->segment_capacity) {
+        uint32_t new_capacity = shard->segment_capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = OFFLINE_STORE_INITIAL_SEGMENTS;
+        }
+        
+        offline_segment_t *segments = realloc(shard->segments, new_capacity * sizeof(offline_segment_t));
+        
+        if (segments == NULL) {
+            return NULL;
+        }
+        
+        shard->segments = segments;
+        shard->segment_capacity = new_capacity;
+    }
+    
+    char path[OFFLINE_STORE_MAX_PATH];
+    prv_offline_store_segment_path(shard, id, path);
+    
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+    
+    if (fd < 0) {
+        LOG_ERR("Unable to open offline segment %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    
+    struct stat st;
+    
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    
+    offline_segment_t *segment = &shard->segments[shard->num_segments];
+    shard->num_segments++;
+    
+    segment->id = id;
+    segment->fd = fd;
+    segment->size = st.st_size;
+    segment->live_bytes = 0;
+    
+    return segment;
+}
+
+static bool prv_offline_store_write(offline_shard_t *shard, const struct iovec *iov, int iov_count, uint32_t len, uint32_t *segment_id, uint32_t *offset) {
+    offline_segment_t *active = &shard->segments[shard->num_segments - 1];
+    
+    // Seal full segment, it is never written again
+    if (active->size > 0 && active->size + len > prv_inst.segment_bytes) {
+        fdatasync(active->fd);
+        
+        active = prv_offline_store_open_segment(shard, active->id + 1);
+        
+        if (active == NULL) {
+            return false;
+        }
+    }
+    
+    ssize_t written = writev(active->fd, iov, iov_count);
+    
+    if (written != (ssize_t)len) {
+        LOG_ERR("Unable to write offline record: %s", strerror(errno));
+        
+        // Cut off partial record so the segment stays parseable
+        if (written > 0 && ftruncate(active->fd, active->size) < 0) {
+            LOG_ERR("Unable to truncate offline segment: %s", strerror(errno));
+        }
+        
+        return false;
+    }
+    
+    *segment_id = active->id;
+    *offset = active->size;
+    
+    active->size += len;
+    shard->dirty = true;
+    
+    return true;
+}
+
+static bool prv_offline_store_write_ack(offline_shard_t *shard, screenname_id_t recipient, uint64_t seq) {
+    offline_record_header_t header;
+    memset(&header, 0, sizeof(header));
+    
+    header.seq = seq;
+    header.magic = OFFLINE_STORE_RECORD_MAGIC;
+    header.timestamp = timestamp_unix();
+    header.type = OFFLINE_RECORD_ACK;
+    header.recipient_len = screenname_len(recipient);
+    header.checksum = prv_offline_store_checksum(&header, screenname_str(recipient), NULL, 0);
+    
+    struct iovec iov[] = {
+        { .iov_base = &header, .iov_len = sizeof(header) },
+        { .iov_base = (char *)screenname_str(recipient), .iov_len = header.recipient_len },
+    };
+    
+    uint32_t segment_id;
+    uint32_t offset;
+    
+    return prv_offline_store_write(shard, iov, 2, sizeof(header) + header.recipient_len, &segment_id, &offset);
+}
+
+static void prv_offline_store_replay_segment(offline_shard_t *shard, offline_segment_t *segment, uint8_t *scratch, bool last) {
+    uint32_t offset = 0;
+    
+    while (offset < segment->size) {
+        offline_record_header_t header;
+        
+        if (pread(segment->fd, &header, sizeof(header), offset) != sizeof(header)) {
+            break;
+        }
+        
+        if (
+            header.magic != OFFLINE_STORE_RECORD_MAGIC ||
+            header.recipient_len == 0 ||
+            header.recipient_len > SCREENNAME_MAX_LEN ||
+            header.payload_len > OFFLINE_STORE_MAX_PAYLOAD
+        ) {
+            break;
+        }
+        
+        uint32_t body_len = header.recipient_len + header.payload_len;
+        
+        if (pread(segment->fd, scratch, body_len, offset + sizeof(header)) != (ssize_t)body_len) {
+            break;
+        }
+        
+        struct iovec payload = {
+            .iov_base = &scratch[header.recipient_len],
+            .iov_len = header.payload_len,
+        };
+        
+        if (prv_offline_store_checksum(&header, (char *)scratch, &payload, 1) != header.checksum) {
+            break;
+        }
+        
+        screenname_id_t recipient = screenname_intern((char *)scratch, header.recipient_len);
+        offline_recipient_t *entry = prv_offline_store_find_recipient(shard, recipient, true);
+        screenname_release(recipient);
+        
+        if (entry == NULL) {
+            LOG_ERR("Unable to index offline message. Out of memory?");
+            return;
+        }
+        
+        uint32_t record_len = sizeof(header) + body_len;
+        
+        if (header.type == OFFLINE_RECORD_ACK) {
+            prv_offline_store_ack_messages(shard, entry, header.seq);
+        } else if (header.seq > entry->acked_seq) {
+            offline_message_t message = {
+                .seq = header.seq,
+                .segment_id = segment->id,
+                .offset = offset,
+                .record_len = record_len,
+                .payload_len = header.payload_len,
+            };
+            
+            if (prv_offline_store_index_message(shard, entry, &message)) {
+                segment->live_bytes += record_len;
+            }
+        }
+        
+        if (header.seq >= shard->next_seq) {
+            shard->next_seq = header.seq + 1;
+        }
+        
+        offset += record_len;
+    }
+    
+    if (offset == segment->size) {
+        return;
+    }
+    
+    // Torn write at the end of the log, everything before it is intact
+    if (last) {
+        LOG_WARN("Truncating torn offline record in %s at %u.", shard->dir, offset);
+        
+        if (ftruncate(segment->fd, offset) == 0) {
+            segment->size = offset;
+        }
+    } else {
+        LOG_ERR("Corrupt offline record in %s segment %u at %u.", shard->dir, segment->id, offset);
+    }
+}
+
+static bool prv_offline_store_init_shard(offline_shard_t *shard, uint8_t *scratch) {
+    if (mkdir(shard->dir, 0700) < 0 && errno != EEXIST) {
+        LOG_ERR("Unable to create %s: %s", shard->dir, strerror(errno));
+        return false;
+    }
+    
+    DIR *dir = opendir(shard->dir);
+    
+    if (dir == NULL) {
+        return false;
+    }
+    
+    uint32_t *ids = NULL;
+    uint32_t num_ids = 0;
+    uint32_t ids_capacity = 0;
+    struct dirent *dirent;
+    
+    while ((dirent = readdir(dir)) != NULL) {
+        unsigned int id;
+        char suffix[8];
+        
+        if (sscanf(dirent->d_name, "%8u.%7s", &id, suffix) != 2 || strcmp(suffix, "log") != 0) {
+            continue;
+        }
+        
+        if (num_ids == ids_capacity) {
+            ids_capacity = ids_capacity ? ids_capacity * 2 : OFFLINE_STORE_INITIAL_SEGMENTS;
+            uint32_t *new_ids = realloc(ids, ids_capacity * sizeof(uint32_t));
+            
+            if (new_ids == NULL) {
+                free(ids);
+                closedir(dir);
+                return false;
+            }
+            
+            ids = new_ids;
+        }
+        
+        // Keep IDs sorted, directories are small
+        uint32_t pos = num_ids;
+        
+        while (pos > 0 && ids[pos - 1] > id) {
+            ids[pos] = ids[pos - 1];
+            pos--;
+        }
+        
+        ids[pos] = id;
+        num_ids++;
+    }
+    
+    closedir(dir);
+    
+    bool ret = true;
+    
+    for (uint32_t i = 0; i < num_ids && ret; i++) {
+        offline_segment_t *segment = prv_offline_store_open_segment(shard, ids[i]);
+        
+        if (segment == NULL) {
+            ret = false;
+            break;
+        }
+        
+        prv_offline_store_replay_segment(shard, segment, scratch, i == num_ids - 1);
+    }
+    
+    free(ids);
+    
+    if (ret && shard->num_segments == 0) {
+        ret = (prv_offline_store_open_segment(shard, 1) != NULL);
+    }
+    
+    // Entries only kept around for their ACK watermark during replay
+    for (uint32_t i = 0; i < shard->num_buckets; i++) {
+        offline_recipient_t *entry = shard->buckets[i];
+        
+        while (entry != NULL) {
+            offline_recipient_t *next = entry->next_in_bucket;
+            
+            if (entry->num_messages == 0) {
+                prv_offline_store_drop_recipient(shard, entry);
+            }
+            
+            entry = next;
+        }
+    }
+    
+    if (shard->next_seq == 0) {
+        shard->next_seq = 1;
+    }
+    
+    return ret;
+}
+
+static bool prv_offline_store_compact(offline_shard_t *shard) {
+    offline_segment_t *oldest = &shard->segments[0];
+    uint32_t oldest_id = oldest->id;
+    int oldest_fd = oldest->fd;
+    uint8_t *scratch = NULL;
+    
+    if (oldest->live_bytes > 0) {
+        scratch = malloc(OFFLINE_STORE_MAX_RECORD);
+        
+        if (scratch == NULL) {
+            return false;
+        }
+    }
+    
+    // Copy records verbatim, a crash midway leaves duplicates that replay collapses
+    for (uint32_t i = 0; i < shard->num_buckets && scratch != NULL; i++) {
+        for (offline_recipient_t *entry = shard->buckets[i]; entry != NULL; entry = entry->next_in_bucket) {
+            for (uint32_t j = 0; j < entry->num_messages; j++) {
+                offline_message_t *message = &entry->messages[j];
+                
+                if (message->segment_id != oldest_id) {
+                    continue;
+                }
+                
+                if (pread(oldest_fd, scratch, message->record_len, message->offset) != (ssize_t)message->record_len) {
+                    free(scratch);
+                    return false;
+                }
+                
+                struct iovec iov = {
+                    .iov_base = scratch,
+                    .iov_len = message->record_len,
+                };
+                uint32_t segment_id;
+                uint32_t offset;
+                
+                if (!prv_offline_store_write(shard, &iov, 1, message->record_len, &segment_id, &offset)) {
+                    free(scratch);
+                    return false;
+                }
+                
+                prv_offline_store_segment(shard, oldest_id)->live_bytes -= message->record_len;
+                prv_offline_store_segment(shard, segment_id)->live_bytes += message->record_len;
+                message->segment_id = segment_id;
+                message->offset = offset;
+            }
+        }
+    }
+    
+    free(scratch);
+    
+    // Copies must be durable before the originals go away
+    fdatasync(shard->segments[shard->num_segments - 1].fd);
+    shard->dirty = false;
+    
+    char path[OFFLINE_STORE_MAX_PATH];
+    prv_offline_store_segment_path(shard, oldest_id, path);
+    
+    close(oldest_fd);
+    unlink(path);
+    
+    shard->num_segments--;
+    memmove(&shard->segments[0], &shard->segments[1], shard->num_segments * sizeof(offline_segment_t));
+    
+    return true;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+bool offline_store_init(const config_t *config) {
+    if (mkdir(config->offline_store_path, 0700) < 0 && errno != EEXIST) {
+        LOG_ERR("Unable to create %s: %s", config->offline_store_path, strerror(errno));
+        return false;
+    }
+    
+    prv_inst.shards = calloc(config->offline_store_shards, sizeof(offline_shard_t));
+    
+    if (prv_inst.shards == NULL) {
+        return false;
+    }
+    
+    prv_inst.num_shards = config->offline_store_shards;
+    prv_inst.segment_bytes = config->offline_store_segment_bytes;
+    prv_inst.sync_interval_ms = config->offline_store_sync_interval_ms;
+    prv_inst.compact_percent = config->offline_store_compact_percent;
+    prv_inst.max_messages = config->offline_store_max_messages;
+    
+    uint8_t *scratch = malloc(OFFLINE_STORE_MAX_RECORD);
+    
+    if (scratch == NULL) {
+        return false;
+    }
+    
+    uint32_t num_messages = 0;
+    
+    for (uint32_t i = 0; i < prv_inst.num_shards; i++) {
+        offline_shard_t *shard = &prv_inst.shards[i];
+        snprintf(shard->dir, sizeof(shard->dir), "%s/%02u", config->offline_store_path, i);
+        
+        if (!prv_offline_store_init_shard(shard, scratch)) {
+            free(scratch);
+            return false;
+        }
+        
+        for (uint32_t j = 0; j < shard->num_buckets; j++) {
+            for (offline_recipient_t *entry = shard->buckets[j]; entry != NULL; entry = entry->next_in_bucket) {
+                num_messages += entry->num_messages;
+            }
+        }
+    }
+    
+    free(scratch);
+    
+    prv_inst.enabled = true;
+    
+    LOG_INFO("Offline store %s holds %u messages.", config->offline_store_path, num_messages);
+    
+    return true;
+}
+
+offline_store_ret_t offline_store_append(screenname_id_t recipient, const struct iovec *payload, int payload_count) {
+    if (!prv_inst.enabled || recipient == SCREENNAME_ID_INVALID || payload_count > (int)CONNECTION_MAX_FRAME_IOVECS) {
+        return OFFLINE_STORE_ERROR;
+    }
+    
+    uint32_t payload_len = 0;
+    
+    for (int i = 0; i < payload_count; i++) {
+        payload_len += payload[i].iov_len;
+    }
+    
+    if (payload_len > OFFLINE_STORE_MAX_PAYLOAD) {
+        return OFFLINE_STORE_ERROR;
+    }
+    
+    offline_shard_t *shard = prv_offline_store_shard(recipient);
+    offline_recipient_t *entry = prv_offline_store_find_recipient(shard, recipient, true);
+    
+    if (entry == NULL) {
+        return OFFLINE_STORE_ERROR;
+    }
+    
+    if (entry->num_messages >= prv_inst.max_messages) {
+        if (entry->num_messages == 0) {
+            prv_offline_store_drop_recipient(shard, entry);
+        }
+        
+        return OFFLINE_STORE_FULL;
+    }
+    
+    offline_record_header_t header;
+    memset(&header, 0, sizeof(header));
+    
+    header.seq = shard->next_seq;
+    header.magic = OFFLINE_STORE_RECORD_MAGIC;
+    header.timestamp = timestamp_unix();
+    header.payload_len = payload_len;
+    header.type = OFFLINE_RECORD_MESSAGE;
+    header.recipient_len = screenname_len(recipient);
+    header.checksum = prv_offline_store_checksum(&header, screenname_str(recipient), payload, payload_count);
+    
+    struct iovec iov[CONNECTION_MAX_FRAME_IOVECS + 2] = {
+        { .iov_base = &header, .iov_len = sizeof(header) },
+        { .iov_base = (char *)screenname_str(recipient), .iov_len = header.recipient_len },
+    };
+    
+    for (int i = 0; i < payload_count; i++) {
+        iov[2 + i] = payload[i];
+    }
+    
+    offline_message_t message = {
+        .seq = header.seq,
+        .record_len = sizeof(header) + header.recipient_len + payload_len,
+        .payload_len = payload_len,
+    };
+    offline_store_ret_t ret = OFFLINE_STORE_ERROR;
+    
+    if (prv_offline_store_write(shard, iov, payload_count + 2, message.record_len, &message.segment_id, &message.offset)) {
+        shard->next_seq++;
+        
+        if (prv_offline_store_index_message(shard, entry, &message)) {
+            prv_offline_store_segment(shard, message.segment_id)->live_bytes += message.record_len;
+            ret = OFFLINE_STORE_OK;
+        } else {
+            // On disk but not indexed, shows up again after a restart
+            LOG_ERR("Unable to index offline message. Out of memory?");
+        }
+    }
+    
+    if (entry->num_messages == 0) {
+        prv_offline_store_drop_recipient(shard, entry);
+    }
+    
+    return ret;
+}
+
+uint32_t offline_store_pending(screenname_id_t recipient) {
+    if (!prv_inst.enabled || recipient == SCREENNAME_ID_INVALID) {
+        return 0;
+    }
+    
+    offline_recipient_t *entry = prv_offline_store_find_recipient(prv_offline_store_shard(recipient), recipient, false);
+    
+    if (entry == NULL) {
+        return 0;
+    }
+    
+    return entry->num_messages;
+}
+
+uint32_t offline_store_deliver(session_t *session, uint16_t foodgroup_id, uint16_t subgroup_id) {
+    if (!prv_inst.enabled || session == NULL) {
+        return 0;
+    }
+    
+    offline_shard_t *shard = prv_offline_store_shard(session->screenname_id);
+    offline_recipient_t *entry = prv_offline_store_find_recipient(shard, session->screenname_id, false);
+    
+    if (entry == NULL || entry->num_messages == 0) {
+        return 0;
+    }
+    
+    uint32_t num_messages = entry->num_messages;
+    size_t total_len = 0;
+    
+    for (uint32_t i = 0; i < num_messages; i++) {
+        total_len += sizeof(snac_t) + entry->messages[i].payload_len;
+    }
+    
+    uint8_t *buffer = malloc(total_len);
+    struct iovec *payloads = malloc(num_messages * sizeof(struct iovec));
+    
+    if (buffer == NULL || payloads == NULL) {
+        LOG_ERR("Unable to allocate offline delivery. Out of memory?");
+        free(buffer);
+        free(payloads);
+        return 0;
+    }
+    
+    snac_t snac = snac_encode(foodgroup_id, subgroup_id, 0, 0);
+    size_t pos = 0;
+    
+    for (uint32_t i = 0; i < num_messages; i++) {
+        offline_message_t *message = &entry->messages[i];
+        offline_segment_t *segment = prv_offline_store_segment(shard, message->segment_id);
+        uint32_t payload_offset = message->offset + message->record_len - message->payload_len;
+        
+        memcpy(&buffer[pos], &snac, sizeof(snac_t));
+        
+        if (
+            segment == NULL ||
+            pread(segment->fd, &buffer[pos + sizeof(snac_t)], message->payload_len, payload_offset) != (ssize_t)message->payload_len
+        ) {
+            LOG_ERR("Unable to read offline message for %s.", screenname_str(session->screenname_id));
+            free(buffer);
+            free(payloads);
+            return 0;
+        }
+        
+        payloads[i].iov_base = &buffer[pos];
+        payloads[i].iov_len = sizeof(snac_t) + message->payload_len;
+        pos += payloads[i].iov_len;
+    }
+    
+    int delivered = session_write_frames(session, payloads, num_messages);
+    
+    free(buffer);
+    free(payloads);
+    
+    // Whatever didn't go out is left in place for the next signon
+    if (delivered <= 0) {
+        return 0;
+    }
+    
+    uint64_t last_seq = entry->messages[delivered - 1].seq;
+    
+    if (!prv_offline_store_write_ack(shard, session->screenname_id, last_seq)) {
+        LOG_ERR("Unable to acknowledge offline messages for %s.", screenname_str(session->screenname_id));
+    }
+    
+    prv_offline_store_ack_messages(shard, entry, last_seq);
+    
+    if (entry->num_messages == 0) {
+        prv_offline_store_drop_recipient(shard, entry);
+    }
+    
+    return delivered;
+}
+
+void offline_store_tick(uint64_t now_ms) {
+    if (!prv_inst.enabled) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < prv_inst.num_shards; i++) {
+        offline_shard_t *shard = &prv_inst.shards[i];
+        
+        // Group commit, one fsync covers everything written since the last one
+        if (shard->dirty && now_ms - shard->synced_at_ms >= prv_inst.sync_interval_ms) {
+            if (fdatasync(shard->segments[shard->num_segments - 1].fd) < 0) {
+                LOG_ERR("Unable to sync %s: %s", shard->dir, strerror(errno));
+            }
+            
+            shard->dirty = false;
+            shard->synced_at_ms = now_ms;
+        }
+        
+        if (shard->num_segments < 2) {
+            continue;
+        }
+        
+        offline_segment_t *oldest = &shard->segments[0];
+        
+        if ((uint64_t)oldest->live_bytes * 100 <= (uint64_t)oldest->size * prv_inst.compact_percent) {
+            if (!prv_offline_store_compact(shard)) {
+                LOG_ERR("Unable to compact %s.", shard->dir);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file offline_store.h
+ * @author Evan Stoddard
+ * @brief Durable store for messages to users that are offline
+ */
+
+#ifndef OFFLINE_STORE_H_
+#define OFFLINE_STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include "config/config.h"
+#include "model/screenname.h"
+#include "session.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Result of storing a message
+ * 
+ */
+typedef enum {
+    OFFLINE_STORE_OK = 0,
+    OFFLINE_STORE_FULL,
+    OFFLINE_STORE_ERROR,
+} offline_store_ret_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Open store, replaying existing segments to rebuild the index
+ * 
+ * Messages are kept in append-only segment files, sharded by recipient.
+ * Only the location of each message is kept in memory.
+ * 
+ * @param config Configuration
+ * @return true Store opened
+ * @return false Unable to open store
+ */
+bool offline_store_init(const config_t *config);
+
+/**
+ * @brief Append message for recipient
+ * 
+ * Written right away but only synced on the next tick after the sync
+ * interval, so all messages stored in between share one fsync.
+ * 
+ * @param recipient Recipient
+ * @param payload SNAC body to deliver (without SNAC header)
+ * @param payload_count Number of payload segments
+ * @return offline_store_ret_t Result
+ */
+offline_store_ret_t offline_store_append(screenname_id_t recipient, const struct iovec *payload, int payload_count);
+
+/**
+ * @brief Number of messages waiting for recipient
+ * 
+ * @param recipient Recipient
+ * @return uint32_t Number of messages
+ */
+uint32_t offline_store_pending(screenname_id_t recipient);
+
+/**
+ * @brief Deliver every message waiting for session in one write, then drop them
+ * 
+ * Only messages that were written in full are acknowledged, the rest stay
+ * stored after a short write.
+ * 
+ * @param session Session
+ * @param foodgroup_id Foodgroup of delivered SNACs
+ * @param subgroup_id Subgroup of delivered SNACs
+ * @return uint32_t Number of messages delivered
+ */
+uint32_t offline_store_deliver(session_t *session, uint16_t foodgroup_id, uint16_t subgroup_id);
+
+/**
+ * @brief Sync pending writes and compact the oldest segment if worthwhile
+ * 
+ * @param now_ms Current monotonic time
+ */
+void offline_store_tick(uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* OFFLINE_STORE_H_ */
\ No newline at end of file
@@ -22,10 +22,26 @@ extern "C" {
  * Definitions
  *****************************************************************************/
 
+/**
+ * @brief Size of login cookie handed out by auth (random, single use)
+ * 
+ */
+#define AUTH_COOKIE_LEN 32U
+
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
  *****************************************************************************/
 
+/**
+ * @brief Error codes sent in TLV_TAG_LOGIN_ERROR of a failed login response
+ * 
+ */
+typedef enum {
+    AUTH_LOGIN_ERROR_INVALID_SCREENNAME     = 0x0001,
+    AUTH_LOGIN_ERROR_SERVICE_UNAVAILABLE    = 0x0002,
+    AUTH_LOGIN_ERROR_INCORRECT_PASSWORD     = 0x0005,
+} auth_login_error_t;
+
 /**
  * @brief Authorization cookie type
  * 
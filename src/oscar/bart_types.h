@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file bart_types.h
+ * @author Evan Stoddard
+ * @brief BART (buddy art) types
+ */
+
+#ifndef BART_TYPES_H_
+#define BART_TYPES_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Size of hash in BART IDs of stored items (MD5)
+ * 
+ */
+#define BART_HASH_LEN       16U
+
+/**
+ * @brief Largest item that fits in a BART_DOWNLOAD_REPLY frame
+ * 
+ */
+#define BART_MAX_DATA_LEN   0xF000U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief BART item types
+ * 
+ */
+typedef enum {
+    BART_TYPE_BUDDY_ICON_SMALL  = 0x0000,
+    BART_TYPE_BUDDY_ICON        = 0x0001,
+    BART_TYPE_STATUS_STR        = 0x0002,
+    BART_TYPE_ARRIVE_SOUND      = 0x0003,
+    BART_TYPE_BUDDY_ICON_BIG    = 0x000C,
+} bart_type_t;
+
+/**
+ * @brief BART ID flags
+ * 
+ */
+typedef enum {
+    BART_FLAG_CUSTOM            = 0x01,
+    BART_FLAG_DATA              = 0x04,
+    BART_FLAG_UNKNOWN           = 0x40,
+    BART_FLAG_REDIRECT          = 0x80,
+} bart_flag_t;
+
+/**
+ * @brief BART_UPLOAD_REPLY result codes
+ * 
+ */
+typedef enum {
+    BART_REPLY_CODE_SUCCESS     = 0x00,
+    BART_REPLY_CODE_INVALID     = 0x01,
+    BART_REPLY_CODE_NO_CUSTOM   = 0x02,
+    BART_REPLY_CODE_TOO_SMALL   = 0x03,
+    BART_REPLY_CODE_TOO_BIG     = 0x04,
+    BART_REPLY_CODE_INVALID_TYPE = 0x05,
+    BART_REPLY_CODE_BANNED      = 0x06,
+    BART_REPLY_CODE_NOT_FOUND   = 0x07,
+} bart_reply_code_t;
+
+/**
+ * @brief BART ID header, followed by the hash
+ * 
+ */
+typedef struct bart_id_header_t {
+    uint16_t type;
+    uint8_t flags;
+    uint8_t length;
+} __attribute__((packed)) bart_id_header_t;
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BART_TYPES_H_ */
\ No newline at end of file
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file feedbag_types.h
+ * @author Evan Stoddard
+ * @brief Feedbag (server stored list) types
+ */
+
+#ifndef FEEDBAG_TYPES_H_
+#define FEEDBAG_TYPES_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Set on every FEEDBAG_REPLY chunk but the last
+ * 
+ */
+#define FEEDBAG_SNAC_FLAG_MORE_REPLIES 0x0001U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Feedbag item classes
+ * 
+ */
+typedef enum {
+    FEEDBAG_CLASS_BUDDY             = 0x0000,
+    FEEDBAG_CLASS_GROUP             = 0x0001,
+    FEEDBAG_CLASS_PERMIT            = 0x0002,
+    FEEDBAG_CLASS_DENY              = 0x0003,
+    FEEDBAG_CLASS_PD_INFO           = 0x0004,
+    FEEDBAG_CLASS_BUDDY_PREFS       = 0x0005,
+    FEEDBAG_CLASS_NONBUDDY          = 0x0006,
+    FEEDBAG_CLASS_CLIENT_PREFS      = 0x0009,
+    FEEDBAG_CLASS_WATCH_LIST        = 0x000D,
+    FEEDBAG_CLASS_IGNORE_LIST       = 0x000E,
+    FEEDBAG_CLASS_DATE_TIME         = 0x000F,
+    FEEDBAG_CLASS_BART              = 0x0014,
+} feedbag_class_t;
+
+/**
+ * @brief FEEDBAG_RIGHTS_REPLY TLV tags
+ * 
+ */
+typedef enum {
+    FEEDBAG_RIGHTS_MAX_CLASS_ATTRS          = 0x02,
+    FEEDBAG_RIGHTS_MAX_ITEM_ATTRS           = 0x03,
+    FEEDBAG_RIGHTS_MAX_ITEMS_BY_CLASS       = 0x04,
+    FEEDBAG_RIGHTS_MAX_CLIENT_ITEMS         = 0x05,
+    FEEDBAG_RIGHTS_MAX_ITEM_NAME_LEN        = 0x06,
+    FEEDBAG_RIGHTS_MAX_RECENT_BUDDIES       = 0x07,
+    FEEDBAG_RIGHTS_INTERACTION_BUDDIES      = 0x08,
+    FEEDBAG_RIGHTS_INTERACTION_HALF_LIFE    = 0x09,
+    FEEDBAG_RIGHTS_INTERACTION_MAX_SCORE    = 0x0A,
+    FEEDBAG_RIGHTS_MAX_UNKNOWN_0B           = 0x0B,
+    FEEDBAG_RIGHTS_MAX_BUDDIES_PER_GROUP    = 0x0C,
+    FEEDBAG_RIGHTS_MAX_MEGA_BOTS            = 0x0D,
+    FEEDBAG_RIGHTS_MAX_SMART_GROUPS         = 0x0E,
+} feedbag_rights_tlv_tag_t;
+
+/**
+ * @brief Per item result codes of FEEDBAG_STATUS
+ * 
+ */
+typedef enum {
+    FEEDBAG_STATUS_SUCCESS          = 0x0000,
+    FEEDBAG_STATUS_DB_ERROR         = 0x0001,
+    FEEDBAG_STATUS_NOT_FOUND        = 0x0002,
+    FEEDBAG_STATUS_ALREADY_EXISTS   = 0x0003,
+    FEEDBAG_STATUS_BAD_REQUEST      = 0x000A,
+    FEEDBAG_STATUS_OVER_ROW_LIMIT   = 0x000C,
+} feedbag_status_t;
+
+/**
+ * @brief Fixed fields following the item name on the wire
+ * 
+ */
+typedef struct feedbag_item_header_t {
+    uint16_t group_id;
+    uint16_t item_id;
+    uint16_t class_id;
+    uint16_t attrs_len;
+} __attribute__((packed)) feedbag_item_header_t;
+
+/**
+ * @brief Client's copy of the feedbag (FEEDBAG_QUERY_IF_MODIFIED, FEEDBAG_REPLY_NOT_MODIFIED)
+ * 
+ */
+typedef struct feedbag_if_modified_t {
+    uint32_t modified;
+    uint16_t num_items;
+} __attribute__((packed)) feedbag_if_modified_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* FEEDBAG_TYPES_H_ */
\ No newline at end of file
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file icbm_types.h
+ * @author Evan Stoddard
+ * @brief ICBM parameter types
+ */
+
+#ifndef ICBM_TYPES_H_
+#define ICBM_TYPES_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Flags in effect until the client sets its own
+ * 
+ */
+#define ICBM_PARAMS_DEFAULT_FLAGS (ICBM_PARAM_FLAG_CHANNEL_MSGS_ALLOWED | ICBM_PARAM_FLAG_MISSED_CALLS_ENABLED)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief ICBM parameter flags
+ * 
+ */
+typedef enum {
+    ICBM_PARAM_FLAG_CHANNEL_MSGS_ALLOWED    = 0x00000001,
+    ICBM_PARAM_FLAG_MISSED_CALLS_ENABLED    = 0x00000002,
+    ICBM_PARAM_FLAG_EVENTS_ALLOWED          = 0x00000008,
+    ICBM_PARAM_FLAG_SMS_SUPPORTED           = 0x00000010,
+    ICBM_PARAM_FLAG_OFFLINE_MSGS_ALLOWED    = 0x00000100,
+} icbm_param_flag_t;
+
+/**
+ * @brief ICBM parameters on the wire (ICBM_ADD_PARAMETERS)
+ * 
+ */
+typedef struct icbm_params_wire_t {
+    uint16_t channel;
+    uint32_t flags;
+    uint16_t max_message_len;
+    uint16_t max_sender_warn;
+    uint16_t max_receiver_warn;
+    uint32_t min_interval_ms;
+} __attribute__((packed)) icbm_params_wire_t;
+
+/**
+ * @brief ICBM parameter rights on the wire (ICBM_PARAMETER_REPLY)
+ * 
+ */
+typedef struct icbm_params_reply_t {
+    uint16_t max_slots;
+    uint32_t flags;
+    uint16_t max_message_len;
+    uint16_t max_sender_warn;
+    uint16_t max_receiver_warn;
+    uint32_t min_interval_ms;
+} __attribute__((packed)) icbm_params_reply_t;
+
+/**
+ * @brief ICBM parameters in effect for a session (host order)
+ * 
+ */
+typedef struct icbm_params_t {
+    uint32_t flags;
+    uint32_t min_interval_ms;
+    uint16_t max_message_len;
+    uint16_t max_sender_warn;
+    uint16_t max_receiver_warn;
+} icbm_params_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ICBM_TYPES_H_ */
\ No newline at end of file
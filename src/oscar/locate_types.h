@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file locate_types.h
+ * @author Evan Stoddard
+ * @brief LOCATE user info types
+ */
+
+#ifndef LOCATE_TYPES_H_
+#define LOCATE_TYPES_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Longest profile or away message accepted (advertised in LOCATE_RIGHTS_REPLY)
+ * 
+ */
+#define LOCATE_MAX_SIGNATURE_LEN    127U
+
+/**
+ * @brief Most capability UUIDs a user may set (advertised in LOCATE_RIGHTS_REPLY)
+ * 
+ */
+#define LOCATE_MAX_CAPABILITIES     32U
+
+/**
+ * @brief Most email addresses looked up at once (advertised in LOCATE_RIGHTS_REPLY)
+ * 
+ */
+#define LOCATE_MAX_FIND_BY_EMAIL_LIST 10U
+
+/**
+ * @brief Size of capability UUID
+ * 
+ */
+#define LOCATE_CAPABILITY_LEN       16U
+
+/**
+ * @brief LOCATE_USER_INFO_QUERY2 flags for info that is kept
+ * 
+ */
+#define LOCATE_QUERY2_FLAGS_SUPPORTED (LOCATE_QUERY2_FLAG_SIG | LOCATE_QUERY2_FLAG_UNAVAILABLE | LOCATE_QUERY2_FLAG_CAPABILITIES)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief LOCATE_SET_INFO and LOCATE_USER_INFO_REPLY TLV tag IDs
+ * 
+ */
+typedef enum {
+    LOCATE_INFO_TLV_SIG_MIME            = 0x01,
+    LOCATE_INFO_TLV_SIG                 = 0x02,
+    LOCATE_INFO_TLV_UNAVAILABLE_MIME    = 0x03,
+    LOCATE_INFO_TLV_UNAVAILABLE         = 0x04,
+    LOCATE_INFO_TLV_CAPABILITIES        = 0x05,
+} locate_info_tlv_tag_t;
+
+/**
+ * @brief LOCATE_USER_INFO_QUERY request types
+ * 
+ */
+typedef enum {
+    LOCATE_QUERY_TYPE_SIG               = 0x0001,
+    LOCATE_QUERY_TYPE_UNAVAILABLE       = 0x0003,
+    LOCATE_QUERY_TYPE_CAPABILITIES      = 0x0004,
+} locate_query_type_t;
+
+/**
+ * @brief LOCATE_USER_INFO_QUERY2 request flags
+ * 
+ */
+typedef enum {
+    LOCATE_QUERY2_FLAG_SIG              = 0x00000001,
+    LOCATE_QUERY2_FLAG_UNAVAILABLE      = 0x00000002,
+    LOCATE_QUERY2_FLAG_CAPABILITIES     = 0x00000004,
+    LOCATE_QUERY2_FLAG_CERTS            = 0x00000008,
+    LOCATE_QUERY2_FLAG_HTML_INFO        = 0x00000400,
+} locate_query2_flag_t;
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LOCATE_TYPES_H_ */
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file odir_types.h
+ * @author Evan Stoddard
+ * @brief Directory info types shared by LOCATE and ODIR
+ */
+
+#ifndef ODIR_TYPES_H_
+#define ODIR_TYPES_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Largest directory info or keyword block a user may set
+ * 
+ */
+#define DIR_MAX_INFO_LEN 0x400U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Directory info TLV tag IDs
+ * 
+ * Used in LOCATE_SET_DIR_INFO, LOCATE_SET_KEYWORD_INFO, ODIR queries and
+ * ODIR results alike.
+ */
+typedef enum {
+    DIR_INFO_TLV_FIRST_NAME     = 0x01,
+    DIR_INFO_TLV_LAST_NAME      = 0x02,
+    DIR_INFO_TLV_MIDDLE_NAME    = 0x03,
+    DIR_INFO_TLV_MAIDEN_NAME    = 0x04,
+    DIR_INFO_TLV_EMAIL          = 0x05,
+    DIR_INFO_TLV_COUNTRY        = 0x06,
+    DIR_INFO_TLV_STATE          = 0x07,
+    DIR_INFO_TLV_CITY           = 0x08,
+    DIR_INFO_TLV_SCREEN_NAME    = 0x09,
+    DIR_INFO_TLV_INTEREST       = 0x0B,
+    DIR_INFO_TLV_NICKNAME       = 0x0C,
+    DIR_INFO_TLV_ZIP            = 0x0D,
+    DIR_INFO_TLV_CHARSET        = 0x1C,
+    DIR_INFO_TLV_ADDRESS        = 0x21,
+} dir_info_tlv_tag_t;
+
+/**
+ * @brief Result codes of LOCATE_SET_DIR_REPLY and LOCATE_SET_KEYWORD_REPLY
+ * 
+ */
+typedef enum {
+    DIR_SET_RESULT_FAILURE      = 0x0000,
+    DIR_SET_RESULT_SUCCESS      = 0x0001,
+} dir_set_result_t;
+
+/**
+ * @brief Status codes of LOCATE_GET_DIR_REPLY
+ * 
+ */
+typedef enum {
+    DIR_GET_STATUS_FOUND        = 0x0001,
+    DIR_GET_STATUS_NOT_FOUND    = 0x0002,
+} dir_get_status_t;
+
+/**
+ * @brief Status codes of ODIR_INFO_REPLY
+ * 
+ */
+typedef enum {
+    ODIR_STATUS_UNAVAILABLE     = 0x0001,
+    ODIR_STATUS_TOO_MANY        = 0x0002,
+    ODIR_STATUS_BAD_QUERY       = 0x0004,
+    ODIR_STATUS_SUCCESS         = 0x0005,
+} odir_status_t;
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ODIR_TYPES_H_ */
\ No newline at end of file
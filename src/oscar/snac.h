@@ -62,6 +62,37 @@ typedef enum {
     SNAC_FOODGROUP_ID_ARS           = 0x004A,
 } snac_foodgroup_id_t;
 
+/**
+ * @brief Error codes carried by the *_ERR subgroup of every foodgroup
+ * 
+ */
+typedef enum {
+    SNAC_ERROR_INVALID_SNAC                 = 0x0001,
+    SNAC_ERROR_RATE_TO_HOST                 = 0x0002,
+    SNAC_ERROR_RATE_TO_CLIENT               = 0x0003,
+    SNAC_ERROR_NOT_LOGGED_ON                = 0x0004,
+    SNAC_ERROR_SERVICE_UNAVAILABLE          = 0x0005,
+    SNAC_ERROR_SERVICE_NOT_DEFINED          = 0x0006,
+    SNAC_ERROR_OBSOLETE_SNAC                = 0x0007,
+    SNAC_ERROR_NOT_SUPPORTED_BY_HOST        = 0x0008,
+    SNAC_ERROR_NOT_SUPPORTED_BY_CLIENT      = 0x0009,
+    SNAC_ERROR_REFUSED_BY_CLIENT            = 0x000A,
+    SNAC_ERROR_REPLY_TOO_BIG                = 0x000B,
+    SNAC_ERROR_RESPONSES_LOST               = 0x000C,
+    SNAC_ERROR_REQUEST_DENIED               = 0x000D,
+    SNAC_ERROR_BUSTED_SNAC_PAYLOAD          = 0x000E,
+    SNAC_ERROR_INSUFFICIENT_RIGHTS          = 0x000F,
+    SNAC_ERROR_IN_LOCAL_PERMIT_DENY         = 0x0010,
+    SNAC_ERROR_TOO_EVIL_SENDER              = 0x0011,
+    SNAC_ERROR_TOO_EVIL_RECIPIENT           = 0x0012,
+    SNAC_ERROR_USER_TEMP_UNAVAILABLE        = 0x0013,
+    SNAC_ERROR_NO_MATCH                     = 0x0014,
+    SNAC_ERROR_LIST_OVERFLOW                = 0x0015,
+    SNAC_ERROR_REQUEST_AMBIGUOUS            = 0x0016,
+    SNAC_ERROR_QUEUE_FULL                   = 0x0017,
+    SNAC_ERROR_NOT_WHILE_ON_AOL             = 0x0018,
+} snac_error_code_t;
+
 /*****************************************************************************
  * Foodgroup Sub IDs
  *****************************************************************************/
@@ -156,6 +187,32 @@ typedef enum {
     LOCATE_USER_INFO_QUERY2         = 0x0015,
 } locate_subgroup_id_t;
 
+/**
+ * @brief ODIR SNAC Subgroup IDs
+ * 
+ */
+typedef enum {
+    ODIR_ERR                        = 0x0001,
+    ODIR_INFO_QUERY                 = 0x0002,
+    ODIR_INFO_REPLY                 = 0x0003,
+    ODIR_KEYWORD_LIST_QUERY         = 0x0004,
+    ODIR_KEYWORD_LIST_REPLY         = 0x0005,
+} odir_subgroup_id_t;
+
+/**
+ * @brief BART SNAC Subgroup IDs
+ * 
+ */
+typedef enum {
+    BART_ERR                        = 0x0001,
+    BART_UPLOAD_QUERY               = 0x0002,
+    BART_UPLOAD_REPLY               = 0x0003,
+    BART_DOWNLOAD_QUERY             = 0x0004,
+    BART_DOWNLOAD_REPLY             = 0x0005,
+    BART_DOWNLOAD2_QUERY            = 0x0006,
+    BART_DOWNLOAD2_REPLY            = 0x0007,
+} bart_subgroup_id_t;
+
 /**
  * @brief Feedback subgroup IDs
  * 
@@ -50,7 +50,7 @@ bool snac_decode(snac_t *snac, void *buffer, ssize_t buffer_size) {
     snac->foodgroup_id = ntohs(snac->foodgroup_id);
     snac->subgroup_id = ntohs(snac->subgroup_id);
     snac->flags = ntohs(snac->flags);
-    snac->request_id = ntohl(snac->flags);
+    snac->request_id = ntohl(snac->request_id);
     
     return true;
 }
\ No newline at end of file
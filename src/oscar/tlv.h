@@ -46,10 +46,13 @@ typedef enum {
     TLV_TAG_USER_CLASS          = 0x1,
     TLV_TAG_CLIENT_NAME         = 0x3,
     TLV_TAG_SIGNON_TIME         = 0x3,
+    TLV_TAG_ERROR_URL           = 0x4,
+    TLV_TAG_IDLE_MINUTES        = 0x4,
     TLV_TAG_BOS_ADDRESS         = 0x5,
     TLV_TAG_MEMBER_SINCE        = 0x5,
     TLV_TAG_LOGIN_COOKIE        = 0x6,
     TLV_TAG_USER_STATUS         = 0x6,
+    TLV_TAG_LOGIN_ERROR         = 0x8,
     TLV_TAG_EXT_IP_ADDR         = 0xA,
     TLV_TAG_CLIENT_COUNTRY      = 0xE,
     TLV_TAG_CLIENT_LANG         = 0xF,
@@ -62,6 +65,7 @@ typedef enum {
     TLV_TAG_VERSION_LESSER      = 0x19,
     TLV_TAG_UNDEFINED           = 0x1E, // This is unknown... not denoting unknown
     TLV_TAG_BUILD_NUM           = 0x1A,
+    TLV_TAG_BART_INFO           = 0x1D,
     TLV_TAG_MD5_HASHED_PASSWORD = 0x25,
     TLV_TAG_SSI_FLAG            = 0x4A,
     TLV_TAG_CLIENT_RECONNECT    = 0x148,
@@ -87,11 +87,11 @@ ssize_t tlv_encode_bos_address(tlv_t *tlv, char *bos_address) {
     return total_size;
 }
 
-ssize_t tlv_encode_login_cookie(tlv_t *tlv, char *login_cookie) {
+ssize_t tlv_encode_login_cookie(tlv_t *tlv, uint8_t *login_cookie, size_t len) {
     ssize_t total_size = sizeof(tlv_header_t);
     
-    // Determine length of login cookie
-    size_t payload_len = strlen(login_cookie);
+    // Cookie is binary, length comes from the caller
+    size_t payload_len = len;
     total_size += payload_len;
     
     prv_tlv_encode_header(&tlv->header, TLV_TAG_LOGIN_COOKIE, payload_len);
@@ -112,7 +112,7 @@ tlv_uint16_t tlv_uint16_encode(uint16_t id, uint16_t val) {
 
 tlv_uint32_t tlv_uint32_encode(uint16_t id, uint32_t val) {
     tlv_uint32_t tlv = {
-        .header.length = htons(sizeof(uint16_t)),
+        .header.length = htons(sizeof(uint32_t)),
         .header.tag = htons(id),
         .val = htonl(val)
     };
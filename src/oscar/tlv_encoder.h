@@ -51,13 +51,14 @@ ssize_t tlv_encode_screen_name(tlv_t *tlv, char *screen_name);
 ssize_t tlv_encode_bos_address(tlv_t *tlv, char *bos_address);
 
 /**
- * @brief 
+ * @brief Encode login cookie TLV
  * 
- * @param tlv 
- * @param login_cookie 
- * @return ssize_t 
+ * @param tlv Pointer to TLV struct
+ * @param login_cookie Cookie (opaque bytes)
+ * @param len Length of cookie
+ * @return ssize_t Size of final payload
  */
-ssize_t tlv_encode_login_cookie(tlv_t *tlv, char *login_cookie);
+ssize_t tlv_encode_login_cookie(tlv_t *tlv, uint8_t *login_cookie, size_t len);
 
 /**
  * @brief 
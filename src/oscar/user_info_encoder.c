@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file user_info_encoder.c
+ * @author Evan Stoddard
+ * @brief Encode user info blocks
+ */
+
+#include "user_info_encoder.h"
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "tlv.h"
+#include "tlv_encoder.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Encode screen name and warning level shared by both block types
+ * 
+ * @param dest Destination buffer
+ * @param dest_size Size of destination buffer
+ * @param info User info
+ * @return size_t Encoded size (0 if destination too small)
+ */
+static size_t prv_user_info_encode_header(uint8_t *dest, size_t dest_size, const user_info_block_t *info);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static size_t prv_user_info_encode_header(uint8_t *dest, size_t dest_size, const user_info_block_t *info) {
+    size_t size = sizeof(uint8_t) + info->screenname_len + sizeof(uint16_t);
+    
+    if (dest_size < size) {
+        return 0;
+    }
+    
+    uint16_t warning_level = htons(info->warning_level);
+    
+    dest[0] = info->screenname_len;
+    memcpy(&dest[1], info->screenname, info->screenname_len);
+    memcpy(&dest[1 + info->screenname_len], &warning_level, sizeof(warning_level));
+    
+    return size;
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+size_t user_info_encode(uint8_t *dest, size_t dest_size, const user_info_block_t *info) {
+    if (dest == NULL || info == NULL || dest_size < USER_INFO_MAX_ENCODED_LEN) {
+        return 0;
+    }
+    
+    size_t idx = prv_user_info_encode_header(dest, dest_size, info);
+    
+    if (idx == 0) {
+        return 0;
+    }
+    
+    // TLV count is filled in once we know which optional TLVs are present
+    size_t count_idx = idx;
+    uint16_t tlv_count = 0;
+    idx += sizeof(uint16_t);
+    
+    tlv_uint16_t user_class = tlv_uint16_encode(TLV_TAG_USER_CLASS, info->user_class);
+    memcpy(&dest[idx], &user_class, sizeof(user_class));
+    idx += sizeof(user_class);
+    tlv_count++;
+    
+    tlv_uint32_t signon_time = tlv_uint32_encode(TLV_TAG_SIGNON_TIME, info->signon_time);
+    memcpy(&dest[idx], &signon_time, sizeof(signon_time));
+    idx += sizeof(signon_time);
+    tlv_count++;
+    
+    if (info->user_status != USER_STATUS_ONLINE) {
+        tlv_uint32_t user_status = tlv_uint32_encode(TLV_TAG_USER_STATUS, info->user_status);
+        memcpy(&dest[idx], &user_status, sizeof(user_status));
+        idx += sizeof(user_status);
+        tlv_count++;
+    }
+    
+    if (info->idle_minutes != 0) {
+        tlv_uint16_t idle_minutes = tlv_uint16_encode(TLV_TAG_IDLE_MINUTES, info->idle_minutes);
+        memcpy(&dest[idx], &idle_minutes, sizeof(idle_minutes));
+        idx += sizeof(idle_minutes);
+        tlv_count++;
+    }
+    
+    if (info->bart_hash != NULL) {
+        tlv_header_t header = {
+            .tag = htons(TLV_TAG_BART_INFO),
+            .length = htons(sizeof(bart_id_header_t) + BART_HASH_LEN),
+        };
+        
+        bart_id_header_t id = {
+            .type = htons(info->bart_type),
+            .flags = BART_FLAG_CUSTOM,
+            .length = BART_HASH_LEN,
+        };
+        
+        memcpy(&dest[idx], &header, sizeof(header));
+        idx += sizeof(header);
+        memcpy(&dest[idx], &id, sizeof(id));
+        idx += sizeof(id);
+        memcpy(&dest[idx], info->bart_hash, BART_HASH_LEN);
+        idx += BART_HASH_LEN;
+        tlv_count++;
+    }
+    
+    tlv_count = htons(tlv_count);
+    memcpy(&dest[count_idx], &tlv_count, sizeof(tlv_count));
+    
+    return idx;
+}
+
+size_t user_info_encode_brief(uint8_t *dest, size_t dest_size, const user_info_block_t *info) {
+    if (dest == NULL || info == NULL) {
+        return 0;
+    }
+    
+    size_t idx = prv_user_info_encode_header(dest, dest_size, info);
+    
+    if (idx == 0 || dest_size < idx + sizeof(uint16_t) + sizeof(tlv_uint16_t)) {
+        return 0;
+    }
+    
+    uint16_t tlv_count = htons(1);
+    memcpy(&dest[idx], &tlv_count, sizeof(tlv_count));
+    idx += sizeof(tlv_count);
+    
+    tlv_uint16_t user_class = tlv_uint16_encode(TLV_TAG_USER_CLASS, info->user_class);
+    memcpy(&dest[idx], &user_class, sizeof(user_class));
+    idx += sizeof(user_class);
+    
+    return idx;
+}
\ No newline at end of file
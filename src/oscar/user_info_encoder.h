@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file user_info_encoder.h
+ * @author Evan Stoddard
+ * @brief Encode user info blocks
+ */
+
+#ifndef USER_INFO_ENCODER_H_
+#define USER_INFO_ENCODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "oscar_constants.h"
+#include "user_types.h"
+#include "bart_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Upper bound on size of an encoded user info block
+ * 
+ * Screen name (string8), warning level, TLV count, the fixed size TLVs and
+ * the BART ID of the buddy icon.
+ */
+#define USER_INFO_MAX_ENCODED_LEN (1U + SCREENNAME_MAX_LEN + 4U + 6U + 8U + 8U + 6U + 4U + sizeof(bart_id_header_t) + BART_HASH_LEN)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Fields of a user info block
+ * 
+ */
+typedef struct user_info_block_t {
+    const char *screenname;
+    uint8_t screenname_len;
+    uint16_t warning_level;
+    uint16_t user_class;
+    uint32_t user_status;
+    uint32_t signon_time;
+    uint16_t idle_minutes;
+    
+    // Buddy icon (hash NULL if none)
+    const uint8_t *bart_hash;
+    uint16_t bart_type;
+} user_info_block_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Encode full user info block
+ * 
+ * @param dest Destination buffer
+ * @param dest_size Size of destination buffer
+ * @param info User info
+ * @return size_t Encoded size (0 if destination too small)
+ */
+size_t user_info_encode(uint8_t *dest, size_t dest_size, const user_info_block_t *info);
+
+/**
+ * @brief Encode user info block with only screen name, warning level and class
+ * 
+ * Used where the receiver only needs to identify the user (e.g. departures).
+ * 
+ * @param dest Destination buffer
+ * @param dest_size Size of destination buffer
+ * @param info User info
+ * @return size_t Encoded size (0 if destination too small)
+ */
+size_t user_info_encode_brief(uint8_t *dest, size_t dest_size, const user_info_block_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* USER_INFO_ENCODER_H_ */
\ No newline at end of file
@@ -28,7 +28,14 @@ extern "C" {
  * 
  */
 typedef enum {
-    
+    USER_CLASS_UNCONFIRMED      = 0x0001,
+    USER_CLASS_ADMINISTRATOR    = 0x0002,
+    USER_CLASS_AOL              = 0x0004,
+    USER_CLASS_COMMERCIAL       = 0x0008,
+    USER_CLASS_AIM              = 0x0010,
+    USER_CLASS_AWAY             = 0x0020,
+    USER_CLASS_ICQ              = 0x0040,
+    USER_CLASS_WIRELESS         = 0x0080,
 } user_class_t;
 
 /**
@@ -36,7 +43,13 @@ typedef enum {
  * 
  */
 typedef enum {
-    
+    USER_STATUS_ONLINE          = 0x0000,
+    USER_STATUS_AWAY            = 0x0001,
+    USER_STATUS_DND             = 0x0002,
+    USER_STATUS_NA              = 0x0004,
+    USER_STATUS_OCCUPIED        = 0x0010,
+    USER_STATUS_FREE_FOR_CHAT   = 0x0020,
+    USER_STATUS_INVISIBLE       = 0x0100,
 } user_status_t;
 
 /*****************************************************************************
@@ -0,0 +1,892 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file presence.c
+ * @author Evan Stoddard
+ * @brief Presence engine, fans out arrivals and departures to watchers
+ */
+
+#include "presence.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "session_manager.h"
+
+#include "config/config.h"
+
+#include "utils/timestamp.h"
+
+#include "memory/msgbuf.h"
+
+#include "oscar/snac.h"
+#include "oscar/snac_encoder.h"
+#include "oscar/user_info_encoder.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define PRESENCE_INITIAL_BUCKETS        64U
+#define PRESENCE_INITIAL_WATCHERS       4U
+#define PRESENCE_INITIAL_BATCH          8U
+#define PRESENCE_EMPTY_SLOT             UINT32_MAX
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Reverse index entry, online sessions watching a user
+ * 
+ * Watchers are kept in no particular order, the slots are an open
+ * addressed index into them keyed by watching user, so a watcher leaving
+ * is found and swapped out without scanning the others.
+ */
+typedef struct presence_entry_t {
+    screenname_id_t screenname_id;
+    
+    session_t **watchers;
+    uint32_t num_watchers;
+    uint32_t watcher_capacity;
+    
+    uint32_t *slots;
+    uint32_t num_slots;
+    
+    struct presence_entry_t *next_in_bucket;
+} presence_entry_t;
+
+/**
+ * @brief Pending notification about one subject
+ * 
+ * Message is shared by every watcher the notification was fanned out to.
+ */
+typedef struct presence_notification_t {
+    screenname_id_t subject;
+    msgbuf_t message;
+} presence_notification_t;
+
+/**
+ * @brief Notifications waiting to be written to one session
+ * 
+ * Holds at most one notification per subject, a newer one replaces the
+ * older. Notifications are kept in arrival order, the slots are an open
+ * addressed index into them keyed by subject. A batch whose session ended
+ * is left in the dirty list with a NULL session and freed on the next flush.
+ */
+typedef struct presence_batch_t {
+    session_t *session;
+    bool dirty;
+    uint64_t started_ms;
+    
+    presence_notification_t *notifications;
+    uint32_t num_notifications;
+    uint32_t capacity;
+    
+    uint32_t *slots;
+    uint32_t num_slots;
+} presence_batch_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance of presence engine
+ * 
+ * Only users with at least one watcher have an entry, so memory tracks
+ * the number of watch edges rather than the number of users.
+ */
+static struct {
+    presence_entry_t **buckets;
+    uint32_t num_buckets;
+    uint32_t num_entries;
+    
+    // Batches with notifications waiting for flush
+    presence_batch_t **dirty;
+    uint32_t num_dirty;
+    uint32_t dirty_capacity;
+    
+    // Users with a session, intersected with buddy lists for initial arrivals
+    buddy_set_t online;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get bucket for user
+ * 
+ * @param screenname_id User
+ * @return presence_entry_t** Bucket
+ */
+static presence_entry_t **prv_presence_bucket(screenname_id_t screenname_id);
+
+/**
+ * @brief Double number of buckets and rehash entries
+ * 
+ * @return true Able to grow
+ * @return false Out of memory
+ */
+static bool prv_presence_grow(void);
+
+/**
+ * @brief Find reverse index entry for user
+ * 
+ * @param screenname_id User
+ * @param create Create entry if there isn't one
+ * @return presence_entry_t* Entry (NULL if not found or out of memory)
+ */
+static presence_entry_t *prv_presence_find_entry(screenname_id_t screenname_id, bool create);
+
+/**
+ * @brief Find slot for watching session in entry
+ * 
+ * @param entry Reverse index entry (with slots allocated)
+ * @param session Watching session
+ * @return uint32_t* Slot holding watcher index (or PRESENCE_EMPTY_SLOT)
+ */
+static uint32_t *prv_presence_watcher_slot(presence_entry_t *entry, const session_t *session);
+
+/**
+ * @brief Empty slot, moving later slots of the same probe run back into it
+ * 
+ * @param entry Reverse index entry
+ * @param slot Slot to empty
+ */
+static void prv_presence_clear_watcher_slot(presence_entry_t *entry, uint32_t *slot);
+
+/**
+ * @brief Make room in entry for one more watcher
+ * 
+ * @param entry Reverse index entry
+ * @return true Room available
+ * @return false Out of memory
+ */
+static bool prv_presence_watchers_reserve(presence_entry_t *entry);
+
+/**
+ * @brief Remove session from reverse index entry of user
+ * 
+ * @param screenname_id User
+ * @param session Watching session
+ */
+static void prv_presence_remove_watcher(screenname_id_t screenname_id, session_t *session);
+
+/**
+ * @brief Build BUDDY SNAC carrying user info block of subject
+ * 
+ * @param subject Session the notification is about
+ * @param subgroup_id BUDDY_ARRIVED or BUDDY_DEPARTED
+ * @return msgbuf_t Notification (NULL on failure)
+ */
+static msgbuf_t prv_presence_build_notification(session_t *subject, uint16_t subgroup_id);
+
+/**
+ * @brief Find slot for subject in batch
+ * 
+ * @param batch Batch
+ * @param subject Subject
+ * @return uint32_t* Slot holding notification index (or PRESENCE_EMPTY_SLOT)
+ */
+static uint32_t *prv_presence_batch_slot(presence_batch_t *batch, screenname_id_t subject);
+
+/**
+ * @brief Make room in batch for one more notification
+ * 
+ * @param batch Batch
+ * @return true Room available
+ * @return false Out of memory
+ */
+static bool prv_presence_batch_reserve(presence_batch_t *batch);
+
+/**
+ * @brief Queue notification for session
+ * 
+ * Replaces any notification about the same subject still waiting.
+ * 
+ * @param dest Destination session
+ * @param subject User the notification is about
+ * @param message Notification, retained by the batch
+ */
+static void prv_presence_enqueue(session_t *dest, screenname_id_t subject, msgbuf_t message);
+
+/**
+ * @brief Write batch to its session as one coalesced write
+ * 
+ * @param batch Batch
+ */
+static void prv_presence_flush_batch(presence_batch_t *batch);
+
+/**
+ * @brief Release notifications held by batch
+ * 
+ * @param batch Batch
+ */
+static void prv_presence_clear_batch(presence_batch_t *batch);
+
+/**
+ * @brief Send user info block of subject to everyone watching it
+ * 
+ * @param subject Session whose presence changed
+ * @param subgroup_id BUDDY_ARRIVED or BUDDY_DEPARTED
+ */
+static void prv_presence_fan_out(session_t *subject, uint16_t subgroup_id);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static presence_entry_t **prv_presence_bucket(screenname_id_t screenname_id) {
+    uint32_t hash = screenname_hash(screenname_id);
+    
+    return &prv_inst.buckets[hash & (prv_inst.num_buckets - 1)];
+}
+
+static bool prv_presence_grow(void) {
+    uint32_t new_count = prv_inst.num_buckets * 2;
+    
+    if (new_count == 0) {
+        new_count = PRESENCE_INITIAL_BUCKETS;
+    }
+    
+    presence_entry_t **buckets = calloc(new_count, sizeof(presence_entry_t *));
+    
+    if (buckets == NULL) {
+        return false;
+    }
+    
+    presence_entry_t **old_buckets = prv_inst.buckets;
+    uint32_t old_count = prv_inst.num_buckets;
+    
+    prv_inst.buckets = buckets;
+    prv_inst.num_buckets = new_count;
+    
+    for (uint32_t i = 0; i < old_count; i++) {
+        presence_entry_t *entry = old_buckets[i];
+        
+        while (entry != NULL) {
+            presence_entry_t *next = entry->next_in_bucket;
+            presence_entry_t **bucket = prv_presence_bucket(entry->screenname_id);
+            
+            entry->next_in_bucket = *bucket;
+            *bucket = entry;
+            
+            entry = next;
+        }
+    }
+    
+    free(old_buckets);
+    
+    return true;
+}
+
+static presence_entry_t *prv_presence_find_entry(screenname_id_t screenname_id, bool create) {
+    if (prv_inst.num_buckets > 0) {
+        presence_entry_t *entry = *prv_presence_bucket(screenname_id);
+        
+        while (entry != NULL) {
+            if (entry->screenname_id == screenname_id) {
+                return entry;
+            }
+            
+            entry = entry->next_in_bucket;
+        }
+    }
+    
+    if (!create) {
+        return NULL;
+    }
+    
+    // Keep table load at or below one entry per bucket
+    if (prv_inst.num_entries + 1 > prv_inst.num_buckets) {
+        if (!prv_presence_grow()) {
+            return NULL;
+        }
+    }
+    
+    presence_entry_t *entry = calloc(1, sizeof(presence_entry_t));
+    
+    if (entry == NULL) {
+        return NULL;
+    }
+    
+    screenname_retain(screenname_id);
+    entry->screenname_id = screenname_id;
+    
+    presence_entry_t **bucket = prv_presence_bucket(screenname_id);
+    entry->next_in_bucket = *bucket;
+    *bucket = entry;
+    prv_inst.num_entries++;
+    
+    return entry;
+}
+
+static void prv_presence_remove_watcher(screenname_id_t screenname_id, session_t *session) {
+    if (prv_inst.num_buckets == 0) {
+        return;
+    }
+    
+    presence_entry_t **link = prv_presence_bucket(screenname_id);
+    
+    while (*link != NULL && (*link)->screenname_id != screenname_id) {
+        link = &(*link)->next_in_bucket;
+    }
+    
+    presence_entry_t *entry = *link;
+    
+    if (entry == NULL) {
+        return;
+    }
+    
+    uint32_t *slot = (entry->num_slots > 0) ? prv_presence_watcher_slot(entry, session) : NULL;
+    
+    // Order of watchers doesn't matter, swap last into the hole
+    if (slot != NULL && *slot != PRESENCE_EMPTY_SLOT) {
+        uint32_t idx = *slot;
+        
+        prv_presence_clear_watcher_slot(entry, slot);
+        entry->num_watchers--;
+        
+        if (idx != entry->num_watchers) {
+            entry->watchers[idx] = entry->watchers[entry->num_watchers];
+            *prv_presence_watcher_slot(entry, entry->watchers[idx]) = idx;
+        }
+    }
+    
+    if (entry->num_watchers > 0) {
+        return;
+    }
+    
+    *link = entry->next_in_bucket;
+    prv_inst.num_entries--;
+    
+    screenname_release(entry->screenname_id);
+    free(entry->watchers);
+    free(entry->slots);
+    free(entry);
+}
+
+static uint32_t *prv_presence_watcher_slot(presence_entry_t *entry, const session_t *session) {
+    uint32_t mask = entry->num_slots - 1;
+    uint32_t idx = screenname_hash(session->screenname_id) & mask;
+    
+    while (entry->slots[idx] != PRESENCE_EMPTY_SLOT) {
+        if (entry->watchers[entry->slots[idx]] == session) {
+            break;
+        }
+        
+        idx = (idx + 1) & mask;
+    }
+    
+    return &entry->slots[idx];
+}
+
+static void prv_presence_clear_watcher_slot(presence_entry_t *entry, uint32_t *slot) {
+    uint32_t mask = entry->num_slots - 1;
+    uint32_t hole = slot - entry->slots;
+    uint32_t idx = (hole + 1) & mask;
+    
+    // No tombstones, anything probed past the hole moves back if its home allows
+    while (entry->slots[idx] != PRESENCE_EMPTY_SLOT) {
+        uint32_t home = screenname_hash(entry->watchers[entry->slots[idx]]->screenname_id) & mask;
+        
+        if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+            entry->slots[hole] = entry->slots[idx];
+            hole = idx;
+        }
+        
+        idx = (idx + 1) & mask;
+    }
+    
+    entry->slots[hole] = PRESENCE_EMPTY_SLOT;
+}
+
+static bool prv_presence_watchers_reserve(presence_entry_t *entry) {
+    if (entry->num_watchers == entry->watcher_capacity) {
+        uint32_t new_capacity = entry->watcher_capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = PRESENCE_INITIAL_WATCHERS;
+        }
+        
+        session_t **watchers = realloc(entry->watchers, new_capacity * sizeof(session_t *));
+        
+        if (watchers == NULL) {
+            return false;
+        }
+        
+        entry->watchers = watchers;
+        entry->watcher_capacity = new_capacity;
+    }
+    
+    // Keep slots at most half full
+    if ((entry->num_watchers + 1) * 2 <= entry->num_slots) {
+        return true;
+    }
+    
+    uint32_t new_count = entry->num_slots * 2;
+    
+    if (new_count == 0) {
+        new_count = PRESENCE_INITIAL_WATCHERS * 2;
+    }
+    
+    uint32_t *slots = malloc(new_count * sizeof(uint32_t));
+    
+    if (slots == NULL) {
+        return false;
+    }
+    
+    free(entry->slots);
+    entry->slots = slots;
+    entry->num_slots = new_count;
+    memset(entry->slots, 0xFF, new_count * sizeof(uint32_t));
+    
+    for (uint32_t i = 0; i < entry->num_watchers; i++) {
+        *prv_presence_watcher_slot(entry, entry->watchers[i]) = i;
+    }
+    
+    return true;
+}
+
+static msgbuf_t prv_presence_build_notification(session_t *subject, uint16_t subgroup_id) {
+    user_info_block_t info;
+    uint8_t encoded[USER_INFO_MAX_ENCODED_LEN];
+    size_t encoded_len;
+    
+    session_user_info(subject, &info);
+    
+    if (subgroup_id == BUDDY_DEPARTED) {
+        encoded_len = user_info_encode_brief(encoded, sizeof(encoded), &info);
+    } else {
+        encoded_len = user_info_encode(encoded, sizeof(encoded), &info);
+    }
+    
+    if (encoded_len == 0) {
+        LOG_ERR("Unable to encode user info.");
+        return NULL;
+    }
+    
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_BUDDY, subgroup_id, 0, 0);
+    
+    struct iovec iov[] = {
+        { .iov_base = &snac, .iov_len = sizeof(snac_t) },
+        { .iov_base = encoded, .iov_len = encoded_len },
+    };
+    
+    return msgbuf_init(iov, 2);
+}
+
+static uint32_t *prv_presence_batch_slot(presence_batch_t *batch, screenname_id_t subject) {
+    uint32_t mask = batch->num_slots - 1;
+    uint32_t idx = screenname_hash(subject) & mask;
+    
+    while (batch->slots[idx] != PRESENCE_EMPTY_SLOT) {
+        if (batch->notifications[batch->slots[idx]].subject == subject) {
+            break;
+        }
+        
+        idx = (idx + 1) & mask;
+    }
+    
+    return &batch->slots[idx];
+}
+
+static bool prv_presence_batch_reserve(presence_batch_t *batch) {
+    if (batch->num_notifications == batch->capacity) {
+        uint32_t new_capacity = batch->capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = PRESENCE_INITIAL_BATCH;
+        }
+        
+        presence_notification_t *notifications = realloc(batch->notifications, new_capacity * sizeof(presence_notification_t));
+        
+        if (notifications == NULL) {
+            return false;
+        }
+        
+        batch->notifications = notifications;
+        batch->capacity = new_capacity;
+    }
+    
+    // Keep slots at most half full
+    if ((batch->num_notifications + 1) * 2 <= batch->num_slots) {
+        return true;
+    }
+    
+    uint32_t new_count = batch->num_slots * 2;
+    
+    if (new_count == 0) {
+        new_count = PRESENCE_INITIAL_BATCH * 2;
+    }
+    
+    uint32_t *slots = malloc(new_count * sizeof(uint32_t));
+    
+    if (slots == NULL) {
+        return false;
+    }
+    
+    free(batch->slots);
+    batch->slots = slots;
+    batch->num_slots = new_count;
+    memset(batch->slots, 0xFF, new_count * sizeof(uint32_t));
+    
+    for (uint32_t i = 0; i < batch->num_notifications; i++) {
+        *prv_presence_batch_slot(batch, batch->notifications[i].subject) = i;
+    }
+    
+    return true;
+}
+
+static void prv_presence_enqueue(session_t *dest, screenname_id_t subject, msgbuf_t message) {
+    presence_batch_t *batch = dest->presence_batch;
+    
+    if (batch == NULL) {
+        batch = calloc(1, sizeof(presence_batch_t));
+        
+        if (batch == NULL) {
+            LOG_ERR("Unable to allocate presence batch. Out of memory?");
+            return;
+        }
+        
+        batch->session = dest;
+        dest->presence_batch = batch;
+    }
+    
+    if (!prv_presence_batch_reserve(batch)) {
+        LOG_ERR("Unable to grow presence batch. Out of memory?");
+        return;
+    }
+    
+    // Collapse superseded notification about the same subject
+    uint32_t *slot = prv_presence_batch_slot(batch, subject);
+    presence_notification_t *notification;
+    
+    if (*slot == PRESENCE_EMPTY_SLOT) {
+        if (!batch->dirty) {
+            if (prv_inst.num_dirty == prv_inst.dirty_capacity) {
+                uint32_t new_capacity = prv_inst.dirty_capacity * 2;
+                
+                if (new_capacity == 0) {
+                    new_capacity = PRESENCE_INITIAL_BUCKETS;
+                }
+                
+                presence_batch_t **dirty = realloc(prv_inst.dirty, new_capacity * sizeof(presence_batch_t *));
+                
+                if (dirty == NULL) {
+                    LOG_ERR("Unable to grow presence dirty list. Out of memory?");
+                    return;
+                }
+                
+                prv_inst.dirty = dirty;
+                prv_inst.dirty_capacity = new_capacity;
+            }
+            
+            prv_inst.dirty[prv_inst.num_dirty] = batch;
+            prv_inst.num_dirty++;
+            
+            batch->dirty = true;
+            batch->started_ms = timestamp_monotonic_ms();
+        }
+        
+        *slot = batch->num_notifications;
+        notification = &batch->notifications[batch->num_notifications];
+        batch->num_notifications++;
+        
+        screenname_retain(subject);
+        notification->subject = subject;
+        notification->message = NULL;
+    } else {
+        notification = &batch->notifications[*slot];
+    }
+    
+    msgbuf_release(notification->message);
+    notification->message = msgbuf_retain(message);
+}
+
+static void prv_presence_flush_batch(presence_batch_t *batch) {
+    msgbuf_t messages[CONNECTION_MAX_BATCH_FRAMES];
+    uint32_t idx = 0;
+    
+    while (idx < batch->num_notifications) {
+        uint32_t count = 0;
+        
+        while (count < CONNECTION_MAX_BATCH_FRAMES && idx + count < batch->num_notifications) {
+            messages[count] = batch->notifications[idx + count].message;
+            count++;
+        }
+        
+        // Failed write only detaches the session, remaining frames get queued
+        session_write_msgbufs(batch->session, messages, count);
+        idx += count;
+    }
+    
+    prv_presence_clear_batch(batch);
+}
+
+static void prv_presence_clear_batch(presence_batch_t *batch) {
+    for (uint32_t i = 0; i < batch->num_notifications; i++) {
+        screenname_release(batch->notifications[i].subject);
+        msgbuf_release(batch->notifications[i].message);
+    }
+    
+    batch->num_notifications = 0;
+    
+    if (batch->slots != NULL) {
+        memset(batch->slots, 0xFF, batch->num_slots * sizeof(uint32_t));
+    }
+}
+
+static void prv_presence_fan_out(session_t *subject, uint16_t subgroup_id) {
+    presence_entry_t *entry = prv_presence_find_entry(subject->screenname_id, false);
+    
+    if (entry == NULL) {
+        return;
+    }
+    
+    // Built once, every watcher holds a reference to the same bytes
+    msgbuf_t message = prv_presence_build_notification(subject, subgroup_id);
+    
+    if (message == NULL) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < entry->num_watchers; i++) {
+        prv_presence_enqueue(entry->watchers[i], subject->screenname_id, message);
+    }
+    
+    msgbuf_release(message);
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+presence_watch_ret_t presence_watch(session_t *session, screenname_id_t screenname_id, bool temporary) {
+    if (session == NULL || screenname_id == SCREENNAME_ID_INVALID) {
+        return PRESENCE_WATCH_RET_NO_MEMORY;
+    }
+    
+    config_t *config = config_get();
+    buddy_set_t *set = temporary ? &session->temp_buddies : &session->buddies;
+    buddy_set_t *other = temporary ? &session->buddies : &session->temp_buddies;
+    uint32_t max_buddies = temporary ? config->buddy_max_temp_buddies : config->buddy_max_buddies;
+    
+    if (buddy_set_contains(set, screenname_id)) {
+        return PRESENCE_WATCH_RET_SUCCESS;
+    }
+    
+    if (buddy_set_count(set) >= max_buddies) {
+        return PRESENCE_WATCH_RET_LIST_FULL;
+    }
+    
+    // Add to forward index first so failure leaves nothing half linked
+    if (!buddy_set_add(set, screenname_id)) {
+        return PRESENCE_WATCH_RET_NO_MEMORY;
+    }
+    
+    screenname_retain(screenname_id);
+    
+    // Already watched through the other list
+    if (buddy_set_contains(other, screenname_id)) {
+        return PRESENCE_WATCH_RET_SUCCESS;
+    }
+    
+    presence_entry_t *entry = prv_presence_find_entry(screenname_id, true);
+    
+    if (entry == NULL) {
+        buddy_set_remove(set, screenname_id);
+        screenname_release(screenname_id);
+        return PRESENCE_WATCH_RET_NO_MEMORY;
+    }
+    
+    if (!prv_presence_watchers_reserve(entry)) {
+        // Drops entry again if we just created it
+        prv_presence_remove_watcher(screenname_id, session);
+        buddy_set_remove(set, screenname_id);
+        screenname_release(screenname_id);
+        return PRESENCE_WATCH_RET_NO_MEMORY;
+    }
+    
+    *prv_presence_watcher_slot(entry, session) = entry->num_watchers;
+    entry->watchers[entry->num_watchers] = session;
+    entry->num_watchers++;
+    
+    return PRESENCE_WATCH_RET_SUCCESS;
+}
+
+void presence_send_arrivals(session_t *session, const buddy_set_t *buddies) {
+    if (session == NULL || buddies == NULL) {
+        return;
+    }
+    
+    buddy_set_t here;
+    buddy_set_init(&here);
+    
+    // Only buddies that are online cost anything past the intersection
+    if (!buddy_set_intersect(&here, buddies, &prv_inst.online)) {
+        LOG_ERR("Unable to intersect buddy list with online users. Out of memory?");
+        return;
+    }
+    
+    buddy_set_iter_t iter;
+    screenname_id_t id;
+    
+    buddy_set_iter_init(&iter, &here);
+    
+    while (buddy_set_iter_next(&iter, &id)) {
+        session_t *buddy = session_manager_find(id);
+        
+        if (buddy == NULL) {
+            continue;
+        }
+        
+        msgbuf_t message = prv_presence_build_notification(buddy, BUDDY_ARRIVED);
+        
+        if (message != NULL) {
+            prv_presence_enqueue(session, id, message);
+            msgbuf_release(message);
+        }
+    }
+    
+    buddy_set_deinit(&here);
+}
+
+void presence_unwatch(session_t *session, screenname_id_t screenname_id, bool temporary) {
+    if (session == NULL) {
+        return;
+    }
+    
+    buddy_set_t *set = temporary ? &session->temp_buddies : &session->buddies;
+    buddy_set_t *other = temporary ? &session->buddies : &session->temp_buddies;
+    
+    if (!buddy_set_remove(set, screenname_id)) {
+        return;
+    }
+    
+    // Still watched through the other list
+    if (!buddy_set_contains(other, screenname_id)) {
+        prv_presence_remove_watcher(screenname_id, session);
+    }
+    
+    screenname_release(screenname_id);
+}
+
+void presence_session_online(session_t *session) {
+    if (session == NULL) {
+        return;
+    }
+    
+    if (!buddy_set_add(&prv_inst.online, session->screenname_id)) {
+        LOG_ERR("Unable to track online user. Out of memory?");
+    }
+    
+    prv_presence_fan_out(session, BUDDY_ARRIVED);
+}
+
+void presence_session_offline(session_t *session) {
+    if (session == NULL) {
+        return;
+    }
+    
+    buddy_set_remove(&prv_inst.online, session->screenname_id);
+    prv_presence_fan_out(session, BUDDY_DEPARTED);
+    
+    // Drop forward and reverse edges, cost is proportional to own buddy lists
+    buddy_set_iter_t iter;
+    screenname_id_t id;
+    
+    buddy_set_iter_init(&iter, &session->buddies);
+    
+    while (buddy_set_iter_next(&iter, &id)) {
+        prv_presence_remove_watcher(id, session);
+        screenname_release(id);
+    }
+    
+    buddy_set_iter_init(&iter, &session->temp_buddies);
+    
+    while (buddy_set_iter_next(&iter, &id)) {
+        if (!buddy_set_contains(&session->buddies, id)) {
+            prv_presence_remove_watcher(id, session);
+        }
+        
+        screenname_release(id);
+    }
+    
+    buddy_set_deinit(&session->buddies);
+    buddy_set_deinit(&session->temp_buddies);
+    
+    // Nothing left to deliver to a session that is going away
+    presence_batch_t *batch = session->presence_batch;
+    
+    if (batch != NULL) {
+        prv_presence_clear_batch(batch);
+        session->presence_batch = NULL;
+        
+        if (batch->dirty) {
+            batch->session = NULL;
+        } else {
+            free(batch->notifications);
+            free(batch->slots);
+            free(batch);
+        }
+    }
+}
+
+void presence_status_changed(session_t *session) {
+    if (session == NULL) {
+        return;
+    }
+    
+    // Every announced change is one user info replies must reflect too
+    session->info_generation++;
+    
+    prv_presence_fan_out(session, BUDDY_ARRIVED);
+}
+
+uint32_t presence_watchers(screenname_id_t screenname_id, session_t *const **watchers) {
+    presence_entry_t *entry = prv_presence_find_entry(screenname_id, false);
+    
+    if (entry == NULL) {
+        *watchers = NULL;
+        return 0;
+    }
+    
+    *watchers = entry->watchers;
+    
+    return entry->num_watchers;
+}
+
+void presence_flush(uint64_t now_ms) {
+    uint32_t window_ms = config_get()->presence_batch_window_ms;
+    uint32_t kept = 0;
+    
+    for (uint32_t i = 0; i < prv_inst.num_dirty; i++) {
+        presence_batch_t *batch = prv_inst.dirty[i];
+        
+        // Session ended while batch was waiting
+        if (batch->session == NULL) {
+            free(batch->notifications);
+            free(batch->slots);
+            free(batch);
+            continue;
+        }
+        
+        if (window_ms > 0 && (now_ms - batch->started_ms) < window_ms) {
+            prv_inst.dirty[kept] = batch;
+            kept++;
+            continue;
+        }
+        
+        batch->dirty = false;
+        prv_presence_flush_batch(batch);
+    }
+    
+    prv_inst.num_dirty = kept;
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file presence.h
+ * @author Evan Stoddard
+ * @brief Presence engine, fans out arrivals and departures to watchers
+ */
+
+#ifndef PRESENCE_H_
+#define PRESENCE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "session.h"
+#include "model/screenname.h"
+#include "model/buddy_set.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Presence watch return codes
+ * 
+ */
+typedef enum {
+    PRESENCE_WATCH_RET_SUCCESS = 0,
+    PRESENCE_WATCH_RET_LIST_FULL,
+    PRESENCE_WATCH_RET_NO_MEMORY,
+} presence_watch_ret_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Start watching user
+ * 
+ * A user on both the buddy list and the temporary buddy list is watched
+ * once, and stays watched until removed from both. Arrivals for users
+ * already online are sent by presence_send_arrivals() once a whole list
+ * has been watched.
+ * 
+ * Every path onto a buddy list ends up here, so this is where the list
+ * limits are enforced. Only the watching session is capped, a popular
+ * user can always be added by someone with room on their list.
+ * 
+ * @param session Watching session
+ * @param screenname_id User to watch
+ * @param temporary Add to temporary buddy list instead of buddy list
+ * @return presence_watch_ret_t PRESENCE_WATCH_RET_SUCCESS if watching user
+ */
+presence_watch_ret_t presence_watch(session_t *session, screenname_id_t screenname_id, bool temporary);
+
+/**
+ * @brief Queue arrivals for every user in buddies that is online right now
+ * 
+ * @param session Watching session
+ * @param buddies Users just watched
+ */
+void presence_send_arrivals(session_t *session, const buddy_set_t *buddies);
+
+/**
+ * @brief Stop watching user
+ * 
+ * @param session Watching session
+ * @param screenname_id User to stop watching
+ * @param temporary Remove from temporary buddy list instead of buddy list
+ */
+void presence_unwatch(session_t *session, screenname_id_t screenname_id, bool temporary);
+
+/**
+ * @brief Announce session's arrival to everyone watching it
+ * 
+ * @param session Session that signed on
+ */
+void presence_session_online(session_t *session);
+
+/**
+ * @brief Announce session's departure and drop everything it watches
+ * 
+ * @param session Session that is ending
+ */
+void presence_session_offline(session_t *session);
+
+/**
+ * @brief Send updated user info for session to everyone watching it
+ * 
+ * @param session Session whose info changed
+ */
+void presence_status_changed(session_t *session);
+
+/**
+ * @brief Write out batched notifications whose window has passed
+ * 
+ * Notifications are collected per destination session so each session
+ * gets at most one notification per subject and one write per flush.
+ * 
+ * @param now_ms Current monotonic time
+ */
+void presence_flush(uint64_t now_ms);
+
+/**
+ * @brief Get sessions watching user
+ * 
+ * @param screenname_id User
+ * @param watchers Set to array of watching sessions (valid until next presence call)
+ * @return uint32_t Number of watchers
+ */
+uint32_t presence_watchers(screenname_id_t screenname_id, session_t *const **watchers);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PRESENCE_H_ */
\ No newline at end of file
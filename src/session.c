@@ -0,0 +1,447 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file session.c
+ * @author Evan Stoddard
+ * @brief Signed on BOS user session
+ */
+
+#include "session.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config/config.h"
+#include "feedbag/feedbag_store.h"
+#include "locate/locate_store.h"
+#include "utils/timestamp.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define SESSION_INITIAL_PENDING 8U
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Queue message buffer while session is detached
+ * 
+ * @param session Session
+ * @param message Message buffer, retained by the queue
+ * @return true Message queued
+ * @return false Queue full or out of memory
+ */
+static bool prv_session_queue_msgbuf(session_t *session, msgbuf_t message);
+
+/**
+ * @brief Queue frame payload while session is detached
+ * 
+ * @param session Session
+ * @param iov Frame payload segments
+ * @param iov_count Number of segments
+ * @return true Frame queued
+ * @return false Queue full or out of memory
+ */
+static bool prv_session_queue_frame(session_t *session, const struct iovec *iov, int iov_count);
+
+/**
+ * @brief Write frames queued while detached to attached connection
+ * 
+ * @param session Session
+ */
+static void prv_session_flush_pending(session_t *session);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static bool prv_session_queue_msgbuf(session_t *session, msgbuf_t message) {
+    size_t size = msgbuf_size(message);
+    
+    if (session->pending_bytes + size > SESSION_MAX_PENDING_BYTES) {
+        LOG_WARN("Pending queue full for detached session, dropping frame.");
+        return false;
+    }
+    
+    if (session->num_pending == session->pending_capacity) {
+        uint32_t new_capacity = session->pending_capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = SESSION_INITIAL_PENDING;
+        }
+        
+        msgbuf_t *pending = realloc(session->pending, new_capacity * sizeof(msgbuf_t));
+        
+        if (pending == NULL) {
+            return false;
+        }
+        
+        session->pending = pending;
+        session->pending_capacity = new_capacity;
+    }
+    
+    session->pending[session->num_pending] = msgbuf_retain(message);
+    session->num_pending++;
+    session->pending_bytes += size;
+    
+    return true;
+}
+
+static bool prv_session_queue_frame(session_t *session, const struct iovec *iov, int iov_count) {
+    msgbuf_t message = msgbuf_init(iov, iov_count);
+    
+    if (message == NULL) {
+        return false;
+    }
+    
+    bool ret = prv_session_queue_msgbuf(session, message);
+    msgbuf_release(message);
+    
+    return ret;
+}
+
+static void prv_session_flush_pending(session_t *session) {
+    struct iovec payloads[CONNECTION_MAX_BATCH_FRAMES];
+    uint32_t sent = 0;
+    
+    while (sent < session->num_pending) {
+        uint32_t count = 0;
+        
+        while (count < CONNECTION_MAX_BATCH_FRAMES && sent + count < session->num_pending) {
+            payloads[count] = msgbuf_iovec(session->pending[sent + count]);
+            count++;
+        }
+        
+        ssize_t written = connection_write_frames(session->conn, payloads, count);
+        
+        if (written > 0) {
+            sent += written;
+        }
+        
+        // Connection closing detaches us again, stop flushing
+        if (written != (ssize_t)count) {
+            break;
+        }
+    }
+    
+    for (uint32_t i = 0; i < sent; i++) {
+        session->pending_bytes -= msgbuf_size(session->pending[i]);
+        msgbuf_release(session->pending[i]);
+    }
+    
+    // Keep whatever didn't make it out for the next attach
+    session->num_pending -= sent;
+    memmove(session->pending, &session->pending[sent], session->num_pending * sizeof(msgbuf_t));
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+session_t* session_init(screenname_id_t screenname_id, const uint8_t *resume_token) {
+    if (screenname_id == SCREENNAME_ID_INVALID || resume_token == NULL) {
+        return NULL;
+    }
+    
+    session_t *session = malloc(sizeof(session_t));
+    
+    if (session == NULL) {
+        return NULL;
+    }
+    
+    memset(session, 0, sizeof(session_t));
+    
+    screenname_retain(screenname_id);
+    session->screenname_id = screenname_id;
+    memcpy(session->resume_token, resume_token, SESSION_RESUME_TOKEN_LEN);
+    
+    // Until told otherwise, advertise normalized screen name
+    session->formatted_name_len = screenname_len(screenname_id);
+    memcpy(session->formatted_name, screenname_str(screenname_id), session->formatted_name_len + 1);
+    
+    session->signon_time = timestamp_unix();
+    session->user_class = USER_CLASS_AIM;
+    session->user_status = USER_STATUS_ONLINE;
+    
+    // Host limits until the client sets its own
+    config_t *config = config_get();
+    session->icbm_params.flags = ICBM_PARAMS_DEFAULT_FLAGS;
+    session->icbm_params.min_interval_ms = config->icbm_min_interval_ms;
+    session->icbm_params.max_message_len = config->icbm_max_message_len;
+    session->icbm_params.max_sender_warn = config->icbm_max_sender_warn;
+    session->icbm_params.max_receiver_warn = config->icbm_max_receiver_warn;
+    
+    return session;
+}
+
+void session_deinit(session_t *session) {
+    if (session == NULL) {
+        return;
+    }
+    
+    LOG_DEBUG("Deinitializing session...");
+    
+    if (session->conn != NULL) {
+        session->conn->session = NULL;
+    }
+    
+    for (uint32_t i = 0; i < session->num_pending; i++) {
+        msgbuf_release(session->pending[i]);
+    }
+    
+    free(session->pending);
+    
+    feedbag_store_free(session->feedbag);
+    
+    locate_store_release(session->profile);
+    locate_store_release(session->away_message);
+    locate_store_release(session->capabilities);
+    locate_cache_deinit(&session->info_cache);
+    
+    buddy_set_t *sets[] = { &session->buddies, &session->temp_buddies };
+    
+    for (uint32_t i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+        buddy_set_iter_t iter;
+        screenname_id_t id;
+        
+        buddy_set_iter_init(&iter, sets[i]);
+        
+        while (buddy_set_iter_next(&iter, &id)) {
+            screenname_release(id);
+        }
+        
+        buddy_set_deinit(sets[i]);
+    }
+    
+    for (uint32_t i = 0; i < session->num_recent_senders; i++) {
+        screenname_release(session->recent_senders[i].screenname_id);
+    }
+    
+    screenname_release(session->screenname_id);
+    
+    free(session);
+}
+
+bool session_set_formatted_name(session_t *session, const char *name, size_t len) {
+    if (session == NULL || name == NULL || len > SCREENNAME_MAX_LEN) {
+        return false;
+    }
+    
+    if (screenname_find(name, len) != session->screenname_id) {
+        return false;
+    }
+    
+    memcpy(session->formatted_name, name, len);
+    session->formatted_name[len] = '\0';
+    session->formatted_name_len = len;
+    session->info_generation++;
+    
+    return true;
+}
+
+void session_user_info(const session_t *session, user_info_block_t *info) {
+    memset(info, 0, sizeof(user_info_block_t));
+    
+    info->screenname = session->formatted_name;
+    info->screenname_len = session->formatted_name_len;
+    info->user_class = session->user_class;
+    info->user_status = session->user_status;
+    info->signon_time = session->signon_time;
+    info->warning_level = session_warning_level(session);
+    
+    if (session->has_bart_icon) {
+        info->bart_hash = session->bart_icon_hash;
+        info->bart_type = session->bart_icon_type;
+    }
+}
+
+uint16_t session_warning_level(const session_t *session) {
+    return warning_level_get(&session->warning, timestamp_monotonic_ms(), config_get()->warning_half_life_ms);
+}
+
+uint16_t session_warn(session_t *session, uint16_t delta) {
+    return warning_level_add(&session->warning, delta, timestamp_monotonic_ms(), config_get()->warning_half_life_ms);
+}
+
+void session_note_icbm_sender(session_t *session, screenname_id_t sender_id, uint64_t now_ms) {
+    session_recent_sender_t *entry = NULL;
+    
+    for (uint32_t i = 0; i < session->num_recent_senders; i++) {
+        if (session->recent_senders[i].screenname_id == sender_id) {
+            session->recent_senders[i].last_icbm_ms = now_ms;
+            return;
+        }
+        
+        if (entry == NULL || session->recent_senders[i].last_icbm_ms < entry->last_icbm_ms) {
+            entry = &session->recent_senders[i];
+        }
+    }
+    
+    if (session->num_recent_senders < SESSION_MAX_RECENT_SENDERS) {
+        entry = &session->recent_senders[session->num_recent_senders++];
+    } else {
+        screenname_release(entry->screenname_id);
+    }
+    
+    screenname_retain(sender_id);
+    memset(entry, 0, sizeof(session_recent_sender_t));
+    entry->screenname_id = sender_id;
+    entry->last_icbm_ms = now_ms;
+}
+
+bool session_allow_warning(session_t *session, screenname_id_t target_id, uint64_t now_ms) {
+    config_t *config = config_get();
+    
+    for (uint32_t i = 0; i < session->num_recent_senders; i++) {
+        session_recent_sender_t *entry = &session->recent_senders[i];
+        
+        if (entry->screenname_id != target_id) {
+            continue;
+        }
+        
+        if (now_ms - entry->last_icbm_ms > config->warning_sender_window_ms) {
+            return false;
+        }
+        
+        // Count restarts every half life, never if levels don't decay
+        if (config->warning_half_life_ms != 0 && now_ms - entry->warn_window_ms >= config->warning_half_life_ms) {
+            entry->warn_window_ms = now_ms;
+            entry->num_warnings = 0;
+        }
+        
+        if (entry->num_warnings >= config->warning_max_per_pair) {
+            return false;
+        }
+        
+        entry->num_warnings++;
+        
+        return true;
+    }
+    
+    return false;
+}
+
+bool session_is_attached(session_t *session) {
+    if (session == NULL) {
+        return false;
+    }
+    
+    return (session->conn != NULL);
+}
+
+void session_attach(session_t *session, connection_t *conn) {
+    if (session == NULL || conn == NULL) {
+        return;
+    }
+    
+    session->conn = conn;
+    session->detached_at_ms = 0;
+    conn->session = session;
+    
+    prv_session_flush_pending(session);
+}
+
+void session_detach(session_t *session, uint64_t now_ms) {
+    if (session == NULL) {
+        return;
+    }
+    
+    if (session->conn != NULL) {
+        session->conn->session = NULL;
+    }
+    
+    session->conn = NULL;
+    session->detached_at_ms = now_ms;
+}
+
+bool session_write_frame(session_t *session, const struct iovec *iov, int iov_count) {
+    if (session == NULL || iov == NULL) {
+        return false;
+    }
+    
+    if (session->conn == NULL) {
+        return prv_session_queue_frame(session, iov, iov_count);
+    }
+    
+    return (connection_write_frame(session->conn, iov, iov_count) > 0);
+}
+
+int session_write_frames(session_t *session, const struct iovec *payloads, int frame_count) {
+    if (session == NULL || payloads == NULL) {
+        return 0;
+    }
+    
+    if (session->conn != NULL) {
+        ssize_t written = connection_write_frames(session->conn, payloads, frame_count);
+        return (written > 0) ? written : 0;
+    }
+    
+    int queued = 0;
+    
+    while (queued < frame_count && prv_session_queue_frame(session, &payloads[queued], 1)) {
+        queued++;
+    }
+    
+    return queued;
+}
+
+bool session_write_msgbufs(session_t *session, const msgbuf_t *messages, int count) {
+    if (session == NULL || messages == NULL) {
+        return false;
+    }
+    
+    struct iovec payloads[CONNECTION_MAX_BATCH_FRAMES];
+    bool ret = true;
+    int idx = 0;
+    
+    while (idx < count) {
+        int batch = count - idx;
+        
+        if (batch > (int)CONNECTION_MAX_BATCH_FRAMES) {
+            batch = CONNECTION_MAX_BATCH_FRAMES;
+        }
+        
+        // Failed or short write detaches the session, the rest is queued
+        if (session->conn != NULL) {
+            for (int i = 0; i < batch; i++) {
+                payloads[i] = msgbuf_iovec(messages[idx + i]);
+            }
+            
+            ssize_t written = connection_write_frames(session->conn, payloads, batch);
+            
+            if (written > 0) {
+                idx += written;
+                batch -= written;
+            }
+            
+            if (batch == 0) {
+                continue;
+            }
+            
+            if (session->conn != NULL) {
+                ret = false;
+                idx += batch;
+                continue;
+            }
+        }
+        
+        for (int i = 0; i < batch; i++) {
+            ret &= prv_session_queue_msgbuf(session, messages[idx + i]);
+        }
+        
+        idx += batch;
+    }
+    
+    return ret;
+}
\ No newline at end of file
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file session.h
+ * @author Evan Stoddard
+ * @brief Signed on BOS user session
+ */
+
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include "connection.h"
+#include "memory/msgbuf.h"
+#include "model/screenname.h"
+#include "model/buddy_set.h"
+#include "model/warning.h"
+#include "oscar/icbm_types.h"
+#include "oscar/bart_types.h"
+#include "oscar/user_types.h"
+#include "oscar/user_info_encoder.h"
+#include "locate/locate_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define SESSION_RESUME_TOKEN_LEN        CONNECTION_RESUME_TOKEN_LEN
+
+#define SESSION_MAX_PENDING_BYTES       0x10000U
+
+#define SESSION_MAX_RECENT_SENDERS      16U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+struct presence_batch_t;
+struct feedbag_store_t;
+struct locate_blob_t;
+
+/**
+ * @brief User that recently sent an ICBM to a session
+ * 
+ */
+typedef struct session_recent_sender_t {
+    screenname_id_t screenname_id;
+    uint64_t last_icbm_ms;
+    
+    // Warnings the session gave this sender since the window started
+    uint64_t warn_window_ms;
+    uint16_t num_warnings;
+} session_recent_sender_t;
+
+/**
+ * @brief Session instance typedef
+ * 
+ * A session outlives its connection. On an unclean disconnect it is
+ * detached and everything hanging off it is kept until it is either resumed
+ * or the resume grace period expires.
+ */
+typedef struct session_t {
+    screenname_id_t screenname_id;
+    
+    // NULL while detached
+    connection_t *conn;
+    
+    uint8_t resume_token[SESSION_RESUME_TOKEN_LEN];
+    uint64_t detached_at_ms;
+    
+    // Frames queued while detached, possibly shared with other sessions
+    msgbuf_t *pending;
+    uint32_t num_pending;
+    uint32_t pending_capacity;
+    size_t pending_bytes;
+    
+    // User info advertised to other users
+    char formatted_name[SCREENNAME_MAX_LEN + 1];
+    uint8_t formatted_name_len;
+    uint32_t signon_time;
+    uint16_t user_class;
+    uint32_t user_status;
+    
+    // Decayed on read, never swept
+    warning_level_t warning;
+    
+    // ICBM parameters, checked on every message before routing
+    icbm_params_t icbm_params;
+    uint64_t last_icbm_ms;
+    
+    // Only these users may be warned, least recently heard from replaced first (each retained)
+    session_recent_sender_t recent_senders[SESSION_MAX_RECENT_SENDERS];
+    uint32_t num_recent_senders;
+    
+    // Presence forward index, users this session watches (each retained per set)
+    buddy_set_t buddies;
+    buddy_set_t temp_buddies;
+    
+    // Presence notifications waiting for flush (owned by presence engine)
+    struct presence_batch_t *presence_batch;
+    
+    // Stored feedbag, loaded on first use
+    struct feedbag_store_t *feedbag;
+    
+    // Feedbag buddies are watched once the client activates the feedbag
+    bool feedbag_in_use;
+    
+    // Locate info as encoded TLVs, shared through the locate store (NULL if unset)
+    struct locate_blob_t *profile;
+    struct locate_blob_t *away_message;
+    struct locate_blob_t *capabilities;
+    
+    // Icon this session last uploaded to the BART store, advertised in user info
+    uint8_t bart_icon_hash[BART_HASH_LEN];
+    uint16_t bart_icon_type;
+    bool has_bart_icon;
+    
+    // Bumped whenever anything in user info replies about us changes
+    uint32_t info_generation;
+    
+    // User info replies sent to users asking about us
+    locate_cache_t info_cache;
+    
+    // Session directory bookkeeping
+    struct session_t *next_in_bucket;
+    struct session_t *next_by_token;
+    struct session_t *next_detached;
+    struct session_t *prev_detached;
+} session_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Create new session for user
+ * 
+ * @param screenname_id Interned screen name of user (session takes a reference)
+ * @param resume_token Token client can present to resume session
+ * @return session_t* Pointer to new session (NULL if out of memory)
+ */
+session_t* session_init(screenname_id_t screenname_id, const uint8_t *resume_token);
+
+/**
+ * @brief Deinitialize session
+ * 
+ * @param session Session
+ */
+void session_deinit(session_t *session);
+
+/**
+ * @brief Set display form of screen name (must normalize to session's screen name)
+ * 
+ * @param session Session
+ * @param name Screen name (does not need to be null terminated)
+ * @param len Length of screen name
+ * @return true Name set
+ * @return false Name doesn't belong to session
+ */
+bool session_set_formatted_name(session_t *session, const char *name, size_t len);
+
+/**
+ * @brief Fill user info block advertised for session
+ * 
+ * @param session Session
+ * @param info User info block
+ */
+void session_user_info(const session_t *session, user_info_block_t *info);
+
+/**
+ * @brief Current (decayed) warning level of session
+ * 
+ * @param session Session
+ * @return uint16_t Warning level
+ */
+uint16_t session_warning_level(const session_t *session);
+
+/**
+ * @brief Raise warning level of session
+ * 
+ * @param session Session
+ * @param delta Amount to add
+ * @return uint16_t New warning level
+ */
+uint16_t session_warn(session_t *session, uint16_t delta);
+
+/**
+ * @brief Note ICBM to session, so it may warn the sender
+ * 
+ * @param session Receiving session
+ * @param sender_id Sending user
+ * @param now_ms Current monotonic time
+ */
+void session_note_icbm_sender(session_t *session, screenname_id_t sender_id, uint64_t now_ms);
+
+/**
+ * @brief Check that session may warn target, counting the warning if so
+ * 
+ * Target must have sent the session an ICBM within the sender window, and
+ * the session may only warn it so many times per half life.
+ * 
+ * @param session Warning session
+ * @param target_id Warned user
+ * @param now_ms Current monotonic time
+ * @return true Warning allowed
+ * @return false Warning refused
+ */
+bool session_allow_warning(session_t *session, screenname_id_t target_id, uint64_t now_ms);
+
+/**
+ * @brief Check if session currently has a connection attached
+ * 
+ * @param session Session
+ * @return true Session is attached
+ * @return false Session is detached
+ */
+bool session_is_attached(session_t *session);
+
+/**
+ * @brief Attach connection to session and flush anything queued while detached
+ * 
+ * @param session Session
+ * @param conn Connection
+ */
+void session_attach(session_t *session, connection_t *conn);
+
+/**
+ * @brief Detach connection from session
+ * 
+ * @param session Session
+ * @param now_ms Current monotonic time
+ */
+void session_detach(session_t *session, uint64_t now_ms);
+
+/**
+ * @brief Write DATA frame to session, queueing it if the session is detached
+ * 
+ * @param session Session
+ * @param iov Frame payload segments (SNAC header and body)
+ * @param iov_count Number of segments
+ * @return true Frame written or queued
+ * @return false Frame dropped
+ */
+bool session_write_frame(session_t *session, const struct iovec *iov, int iov_count);
+
+/**
+ * @brief Write several DATA frames to session, queueing them if detached
+ * 
+ * Frames after a failed or short write are left to the caller, only the
+ * leading frames counted in the return value went out (or were queued).
+ * 
+ * @param session Session
+ * @param payloads One contiguous payload (SNAC header and body) per frame
+ * @param frame_count Number of frames
+ * @return int Number of leading frames written or queued
+ */
+int session_write_frames(session_t *session, const struct iovec *payloads, int frame_count);
+
+/**
+ * @brief Write shared message buffers to session, one frame each
+ * 
+ * Nothing is copied, while detached the buffers are retained by the
+ * pending queue.
+ * 
+ * @param session Session
+ * @param messages Message buffers (SNAC header and body)
+ * @param count Number of message buffers
+ * @return true Written or queued
+ * @return false Unable to write or queue every buffer
+ */
+bool session_write_msgbufs(session_t *session, const msgbuf_t *messages, int count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SESSION_H_ */
\ No newline at end of file
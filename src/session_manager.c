@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file session_manager.c
+ * @author Evan Stoddard
+ * @brief Directory of signed on sessions
+ */
+
+#include "session_manager.h"
+
+#include "presence/presence.h"
+
+#include "offline/offline_store.h"
+
+#include "oscar/snac_decoder.h"
+
+#include "model/warning_table.h"
+
+#include "config/config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/timestamp.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define SESSION_MANAGER_INITIAL_BUCKETS 64U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private static instance of session manager
+ * 
+ * Sessions are chained into buckets by the precomputed screen name hash,
+ * and into a second set of buckets by resume token.
+ * Detached sessions are additionally linked in order of detachment so
+ * expiring them never has to look at attached sessions.
+ */
+static struct {
+    session_t **buckets;
+    session_t **token_buckets;
+    uint32_t num_buckets;
+    uint32_t num_sessions;
+    
+    session_t *detached_head;
+    session_t *detached_tail;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get bucket for screen name
+ * 
+ * @param screenname_id Interned screen name
+ * @return session_t** Pointer to head of bucket
+ */
+static session_t **prv_session_manager_bucket(screenname_id_t screenname_id);
+
+/**
+ * @brief Get token bucket for resume token
+ * 
+ * @param token Resume token
+ * @return session_t** Pointer to head of bucket
+ */
+static session_t **prv_session_manager_token_bucket(const uint8_t *token);
+
+/**
+ * @brief Add session to token bucket of its current resume token
+ * 
+ * @param session Session
+ */
+static void prv_session_manager_link_token(session_t *session);
+
+/**
+ * @brief Remove session from token bucket of its current resume token
+ * 
+ * @param session Session
+ */
+static void prv_session_manager_unlink_token(session_t *session);
+
+/**
+ * @brief Double bucket count and rehash sessions
+ * 
+ * @return true Able to grow table
+ * @return false Unable to grow table
+ */
+static bool prv_session_manager_grow(void);
+
+/**
+ * @brief Add session to detached list
+ * 
+ * @param session Session
+ */
+static void prv_session_manager_link_detached(session_t *session);
+
+/**
+ * @brief Remove session from detached list
+ * 
+ * @param session Session
+ */
+static void prv_session_manager_unlink_detached(session_t *session);
+
+/**
+ * @brief Move ICBMs queued for ending session into the offline store
+ * 
+ * Their senders were already acknowledged, so they must not be dropped
+ * with the session.
+ * 
+ * @param session Session
+ */
+static void prv_session_manager_spool_pending(session_t *session);
+
+/**
+ * @brief Constant time comparison of resume tokens
+ * 
+ * @param a Token
+ * @param b Token
+ * @return true Tokens equal
+ * @return false Tokens differ
+ */
+static bool prv_session_manager_tokens_equal(const uint8_t *a, const uint8_t *b);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static session_t **prv_session_manager_bucket(screenname_id_t screenname_id) {
+    uint32_t hash = screenname_hash(screenname_id);
+    
+    return &prv_inst.buckets[hash & (prv_inst.num_buckets - 1)];
+}
+
+static session_t **prv_session_manager_token_bucket(const uint8_t *token) {
+    uint32_t hash;
+    
+    // Tokens are random, any of their bytes make a good hash
+    memcpy(&hash, token, sizeof(uint32_t));
+    
+    return &prv_inst.token_buckets[hash & (prv_inst.num_buckets - 1)];
+}
+
+static void prv_session_manager_link_token(session_t *session) {
+    session_t **bucket = prv_session_manager_token_bucket(session->resume_token);
+    
+    session->next_by_token = *bucket;
+    *bucket = session;
+}
+
+static void prv_session_manager_unlink_token(session_t *session) {
+    session_t **link = prv_session_manager_token_bucket(session->resume_token);
+    
+    while (*link != NULL && *link != session) {
+        link = &(*link)->next_by_token;
+    }
+    
+    if (*link == session) {
+        *link = session->next_by_token;
+    }
+    
+    session->next_by_token = NULL;
+}
+
+static bool prv_session_manager_grow(void) {
+    uint32_t new_count = prv_inst.num_buckets * 2;
+    
+    if (new_count == 0) {
+        new_count = SESSION_MANAGER_INITIAL_BUCKETS;
+    }
+    
+    session_t **buckets = calloc(new_count, sizeof(session_t *));
+    session_t **token_buckets = calloc(new_count, sizeof(session_t *));
+    
+    if (buckets == NULL || token_buckets == NULL) {
+        free(buckets);
+        free(token_buckets);
+        return false;
+    }
+    
+    session_t **old_buckets = prv_inst.buckets;
+    uint32_t old_count = prv_inst.num_buckets;
+    
+    prv_inst.buckets = buckets;
+    prv_inst.num_buckets = new_count;
+    
+    free(prv_inst.token_buckets);
+    prv_inst.token_buckets = token_buckets;
+    
+    // Every session is in both tables, so one walk rebuilds both
+    for (uint32_t i = 0; i < old_count; i++) {
+        session_t *session = old_buckets[i];
+        
+        while (session != NULL) {
+            session_t *next = session->next_in_bucket;
+            session_t **bucket = prv_session_manager_bucket(session->screenname_id);
+            
+            session->next_in_bucket = *bucket;
+            *bucket = session;
+            prv_session_manager_link_token(session);
+            
+            session = next;
+        }
+    }
+    
+    free(old_buckets);
+    
+    return true;
+}
+
+static void prv_session_manager_link_detached(session_t *session) {
+    session->next_detached = NULL;
+    session->prev_detached = prv_inst.detached_tail;
+    
+    if (prv_inst.detached_tail != NULL) {
+        prv_inst.detached_tail->next_detached = session;
+    } else {
+        prv_inst.detached_head = session;
+    }
+    
+    prv_inst.detached_tail = session;
+}
+
+static void prv_session_manager_unlink_detached(session_t *session) {
+    if (session->prev_detached != NULL) {
+        session->prev_detached->next_detached = session->next_detached;
+    } else if (prv_inst.detached_head == session) {
+        prv_inst.detached_head = session->next_detached;
+    }
+    
+    if (session->next_detached != NULL) {
+        session->next_detached->prev_detached = session->prev_detached;
+    } else if (prv_inst.detached_tail == session) {
+        prv_inst.detached_tail = session->prev_detached;
+    }
+    
+    session->next_detached = NULL;
+    session->prev_detached = NULL;
+}
+
+static void prv_session_manager_spool_pending(session_t *session) {
+    uint32_t num_spooled = 0;
+    
+    for (uint32_t i = 0; i < session->num_pending; i++) {
+        struct iovec frame = msgbuf_iovec(session->pending[i]);
+        snac_t snac;
+        
+        // Presence, typing and the rest are stale by now
+        if (!snac_decode(&snac, frame.iov_base, frame.iov_len) || snac.foodgroup_id != SNAC_FOODGROUP_ID_ICBM || snac.subgroup_id != ICBM_CHANNEL_MSG_TOCLIENT) {
+            continue;
+        }
+        
+        // Stored without SNAC header, same as messages to users that were never on
+        struct iovec body = {
+            .iov_base = (uint8_t *)frame.iov_base + sizeof(snac_t),
+            .iov_len = frame.iov_len - sizeof(snac_t),
+        };
+        
+        if (offline_store_append(session->screenname_id, &body, 1) != OFFLINE_STORE_OK) {
+            LOG_WARN("Unable to store queued ICBM for %s, dropping it.", screenname_str(session->screenname_id));
+            continue;
+        }
+        
+        num_spooled++;
+    }
+    
+    if (num_spooled > 0) {
+        LOG_INFO("Stored %u queued ICBMs for %s.", num_spooled, screenname_str(session->screenname_id));
+    }
+}
+
+static bool prv_session_manager_tokens_equal(const uint8_t *a, const uint8_t *b) {
+    uint8_t diff = 0;
+    
+    for (uint32_t i = 0; i < SESSION_RESUME_TOKEN_LEN; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    
+    return (diff == 0);
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+session_t* session_manager_find(screenname_id_t screenname_id) {
+    if (prv_inst.num_buckets == 0 || screenname_id == SCREENNAME_ID_INVALID) {
+        return NULL;
+    }
+    
+    session_t *session = *prv_session_manager_bucket(screenname_id);
+    
+    while (session != NULL) {
+        if (session->screenname_id == screenname_id) {
+            return session;
+        }
+        
+        session = session->next_in_bucket;
+    }
+    
+    return NULL;
+}
+
+session_t* session_manager_begin(connection_t *conn, screenname_id_t screenname_id) {
+    if (conn == NULL || screenname_id == SCREENNAME_ID_INVALID) {
+        return NULL;
+    }
+    
+    // Only one session per user, newest sign on wins
+    session_t *existing = session_manager_find(screenname_id);
+    
+    if (existing != NULL) {
+        LOG_INFO("Replacing existing session for %s.", screenname_str(screenname_id));
+        
+        connection_t *old_conn = existing->conn;
+        session_manager_end(existing);
+        
+        if (old_conn != NULL && old_conn != conn) {
+            connection_close(old_conn);
+        }
+    }
+    
+    // Keep table load at or below one session per bucket
+    if (prv_inst.num_sessions + 1 > prv_inst.num_buckets) {
+        if (!prv_session_manager_grow()) {
+            LOG_ERR("Unable to grow session table. Out of memory?");
+            return NULL;
+        }
+    }
+    
+    session_t *session = session_init(screenname_id, conn->resume_token);
+    
+    if (session == NULL) {
+        return NULL;
+    }
+    
+    // Signing off doesn't clear a warning
+    warning_table_take(screenname_id, &session->warning, timestamp_monotonic_ms(), config_get()->warning_half_life_ms);
+    
+    session_t **bucket = prv_session_manager_bucket(screenname_id);
+    session->next_in_bucket = *bucket;
+    *bucket = session;
+    prv_session_manager_link_token(session);
+    prv_inst.num_sessions++;
+    
+    session_attach(session, conn);
+    
+    return session;
+}
+
+session_t* session_manager_resume(connection_t *conn, const uint8_t *token, size_t token_len) {
+    if (conn == NULL || token == NULL || token_len != SESSION_RESUME_TOKEN_LEN || prv_inst.num_buckets == 0) {
+        return NULL;
+    }
+    
+    session_t *session = *prv_session_manager_token_bucket(token);
+    
+    while (session != NULL && !prv_session_manager_tokens_equal(session->resume_token, token)) {
+        session = session->next_by_token;
+    }
+    
+    if (session == NULL) {
+        LOG_WARN("No session for resume token.");
+        return NULL;
+    }
+    
+    if (session_is_attached(session)) {
+        connection_t *old_conn = session->conn;
+        
+        // Old connection is usually half open after a network change, the token proves it's the same client
+        if (old_conn != conn) {
+            session_detach(session, timestamp_monotonic_ms());
+            connection_close(old_conn);
+        }
+    } else {
+        prv_session_manager_unlink_detached(session);
+    }
+    
+    // Token is single use, roll it over to the one issued on this connection
+    prv_session_manager_unlink_token(session);
+    memcpy(session->resume_token, conn->resume_token, SESSION_RESUME_TOKEN_LEN);
+    prv_session_manager_link_token(session);
+    
+    session_attach(session, conn);
+    
+    LOG_INFO("Resumed session for %s.", screenname_str(session->screenname_id));
+    
+    return session;
+}
+
+void session_manager_handle_disconnect(connection_t *conn) {
+    if (conn == NULL || conn->session == NULL) {
+        return;
+    }
+    
+    session_t *session = conn->session;
+    
+    session_detach(session, timestamp_monotonic_ms());
+    prv_session_manager_link_detached(session);
+    
+    LOG_INFO("Session for %s detached.", screenname_str(session->screenname_id));
+}
+
+void session_manager_end(session_t *session) {
+    if (session == NULL) {
+        return;
+    }
+    
+    session_t **link = prv_session_manager_bucket(session->screenname_id);
+    
+    while (*link != NULL && *link != session) {
+        link = &(*link)->next_in_bucket;
+    }
+    
+    if (*link == session) {
+        *link = session->next_in_bucket;
+        prv_session_manager_unlink_token(session);
+        prv_inst.num_sessions--;
+    }
+    
+    if (!session_is_attached(session)) {
+        prv_session_manager_unlink_detached(session);
+    }
+    
+    // Out of the directory first so buddies don't see us as online
+    presence_session_offline(session);
+    
+    prv_session_manager_spool_pending(session);
+    
+    warning_table_save(session->screenname_id, &session->warning, timestamp_monotonic_ms(), config_get()->warning_half_life_ms);
+    
+    session_deinit(session);
+}
+
+void session_manager_tick(uint64_t now_ms) {
+    // List is in order of detachment, stop at first session still in grace
+    while (prv_inst.detached_head != NULL) {
+        session_t *session = prv_inst.detached_head;
+        
+        if (now_ms - session->detached_at_ms < SESSION_MANAGER_RESUME_GRACE_PERIOD_MS) {
+            break;
+        }
+        
+        LOG_INFO("Resume grace period expired for %s.", screenname_str(session->screenname_id));
+        session_manager_end(session);
+    }
+}
+
+uint32_t session_manager_count(void) {
+    return prv_inst.num_sessions;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file session_manager.h
+ * @author Evan Stoddard
+ * @brief Directory of signed on sessions
+ */
+
+#ifndef SESSION_MANAGER_H_
+#define SESSION_MANAGER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "session.h"
+#include "connection.h"
+#include "model/screenname.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define SESSION_MANAGER_RESUME_GRACE_PERIOD_MS  60000U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Find session for user
+ * 
+ * @param screenname_id Interned screen name
+ * @return session_t* Session (NULL if user has no session)
+ */
+session_t* session_manager_find(screenname_id_t screenname_id);
+
+/**
+ * @brief Start new session for user on connection, replacing any existing one
+ * 
+ * @param conn Connection
+ * @param screenname_id Interned screen name
+ * @return session_t* New session (NULL if out of memory)
+ */
+session_t* session_manager_begin(connection_t *conn, screenname_id_t screenname_id);
+
+/**
+ * @brief Attempt to reattach a session to connection
+ * 
+ * The token alone identifies the session, so a dropped client can come
+ * back without signing on through auth again. A session still attached to
+ * a stale connection is moved over and the stale connection closed.
+ * 
+ * @param conn Connection
+ * @param token Resume token presented by client
+ * @param token_len Length of resume token
+ * @return session_t* Resumed session (NULL if there is nothing to resume)
+ */
+session_t* session_manager_resume(connection_t *conn, const uint8_t *token, size_t token_len);
+
+/**
+ * @brief Handle unclean disconnect of connection, keeping session for resume
+ * 
+ * @param conn Connection
+ */
+void session_manager_handle_disconnect(connection_t *conn);
+
+/**
+ * @brief End session and remove it from directory
+ * 
+ * @param session Session
+ */
+void session_manager_end(session_t *session);
+
+/**
+ * @brief Expire detached sessions whose grace period has passed
+ * 
+ * @param now_ms Current monotonic time
+ */
+void session_manager_tick(uint64_t now_ms);
+
+/**
+ * @brief Number of sessions (attached and detached)
+ * 
+ * @return uint32_t Session count
+ */
+uint32_t session_manager_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SESSION_MANAGER_H_ */
\ No newline at end of file
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file typing_lane.c
+ * @author Evan Stoddard
+ * @brief Low priority lane for typing notifications
+ */
+
+#include "typing_lane.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "session_manager.h"
+
+#include "config/config.h"
+
+#include "utils/timestamp.h"
+
+#include "oscar/snac.h"
+#include "oscar/snac_encoder.h"
+
+#include "logging.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TYPING_LANE_INITIAL_SLOTS   64U
+#define TYPING_LANE_EMPTY_SLOT      UINT32_MAX
+
+// SNAC header, cookie and channel, string8 sender and event code
+#define TYPING_LANE_MAX_PAYLOAD_LEN (sizeof(snac_t) + TYPING_LANE_HEADER_LEN + 1U + SCREENNAME_MAX_LEN + sizeof(uint16_t))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Newest event from one sender to one recipient
+ * 
+ */
+typedef struct typing_event_t {
+    screenname_id_t sender;
+    screenname_id_t recipient;
+    uint16_t len;
+    uint8_t payload[TYPING_LANE_MAX_PAYLOAD_LEN];
+} typing_event_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance of typing lane
+ * 
+ * Events are kept in arrival order, the slots are an open addressed index
+ * into them keyed by sender and recipient. Both are emptied on every flush.
+ */
+static struct {
+    typing_event_t *events;
+    uint32_t num_events;
+    uint32_t event_capacity;
+    
+    uint32_t *slots;
+    uint32_t num_slots;
+    
+    // When the oldest waiting event was queued
+    uint64_t started_ms;
+} prv_inst;
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Find slot for sender and recipient
+ * 
+ * @param sender Sender
+ * @param recipient Recipient
+ * @return uint32_t* Slot holding event index (or TYPING_LANE_EMPTY_SLOT)
+ */
+static uint32_t *prv_typing_lane_slot(screenname_id_t sender, screenname_id_t recipient);
+
+/**
+ * @brief Make room for one more event
+ * 
+ * @return true Room available
+ * @return false Out of memory
+ */
+static bool prv_typing_lane_reserve(void);
+
+/**
+ * @brief Write event to recipient unless its socket is backed up
+ * 
+ * @param event Event
+ * @param high_water Most unsent bytes allowed on recipient socket
+ */
+static void prv_typing_lane_send(typing_event_t *event, uint32_t high_water);
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+static uint32_t *prv_typing_lane_slot(screenname_id_t sender, screenname_id_t recipient) {
+    uint32_t mask = prv_inst.num_slots - 1;
+    uint32_t idx = (screenname_hash(sender) * 31U + screenname_hash(recipient)) & mask;
+    
+    while (prv_inst.slots[idx] != TYPING_LANE_EMPTY_SLOT) {
+        typing_event_t *event = &prv_inst.events[prv_inst.slots[idx]];
+        
+        if (event->sender == sender && event->recipient == recipient) {
+            break;
+        }
+        
+        idx = (idx + 1) & mask;
+    }
+    
+    return &prv_inst.slots[idx];
+}
+
+static bool prv_typing_lane_reserve(void) {
+    if (prv_inst.num_events == prv_inst.event_capacity) {
+        uint32_t new_capacity = prv_inst.event_capacity * 2;
+        
+        if (new_capacity == 0) {
+            new_capacity = TYPING_LANE_INITIAL_SLOTS / 2;
+        }
+        
+        typing_event_t *events = realloc(prv_inst.events, new_capacity * sizeof(typing_event_t));
+        
+        if (events == NULL) {
+            return false;
+        }
+        
+        prv_inst.events = events;
+        prv_inst.event_capacity = new_capacity;
+    }
+    
+    // Keep slots at most half full
+    if ((prv_inst.num_events + 1) * 2 <= prv_inst.num_slots) {
+        return true;
+    }
+    
+    uint32_t new_count = prv_inst.num_slots * 2;
+    
+    if (new_count == 0) {
+        new_count = TYPING_LANE_INITIAL_SLOTS;
+    }
+    
+    uint32_t *slots = malloc(new_count * sizeof(uint32_t));
+    
+    if (slots == NULL) {
+        return false;
+    }
+    
+    free(prv_inst.slots);
+    prv_inst.slots = slots;
+    prv_inst.num_slots = new_count;
+    memset(prv_inst.slots, 0xFF, new_count * sizeof(uint32_t));
+    
+    for (uint32_t i = 0; i < prv_inst.num_events; i++) {
+        *prv_typing_lane_slot(prv_inst.events[i].sender, prv_inst.events[i].recipient) = i;
+    }
+    
+    return true;
+}
+
+static void prv_typing_lane_send(typing_event_t *event, uint32_t high_water) {
+    session_t *recipient = session_manager_find(event->recipient);
+    
+    // Not worth queueing for a detached session
+    if (recipient == NULL || recipient->conn == NULL) {
+        return;
+    }
+    
+    ssize_t unsent = connection_unsent_bytes(recipient->conn);
+    
+    if (unsent < 0 || (size_t)unsent > high_water) {
+        LOG_DEBUG("Dropping typing event for %s.", screenname_str(event->recipient));
+        return;
+    }
+    
+    struct iovec iov = { .iov_base = event->payload, .iov_len = event->len };
+    connection_write_frame(recipient->conn, &iov, 1);
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+void typing_lane_enqueue(session_t *sender, screenname_id_t recipient, const uint8_t *header, uint16_t event) {
+    if (sender == NULL || recipient == SCREENNAME_ID_INVALID || !prv_typing_lane_reserve()) {
+        return;
+    }
+    
+    uint32_t *slot = prv_typing_lane_slot(sender->screenname_id, recipient);
+    typing_event_t *entry;
+    
+    if (*slot == TYPING_LANE_EMPTY_SLOT) {
+        if (prv_inst.num_events == 0) {
+            prv_inst.started_ms = timestamp_monotonic_ms();
+        }
+        
+        *slot = prv_inst.num_events;
+        entry = &prv_inst.events[prv_inst.num_events];
+        prv_inst.num_events++;
+        
+        screenname_retain(sender->screenname_id);
+        screenname_retain(recipient);
+        entry->sender = sender->screenname_id;
+        entry->recipient = recipient;
+    } else {
+        entry = &prv_inst.events[*slot];
+    }
+    
+    // Newest event replaces whatever was waiting
+    snac_t snac = snac_encode(SNAC_FOODGROUP_ID_ICBM, ICBM_CLIENT_EVENT, 0, 0);
+    uint16_t event_be = htons(event);
+    size_t len = 0;
+    
+    memcpy(&entry->payload[len], &snac, sizeof(snac_t));
+    len += sizeof(snac_t);
+    
+    memcpy(&entry->payload[len], header, TYPING_LANE_HEADER_LEN);
+    len += TYPING_LANE_HEADER_LEN;
+    
+    entry->payload[len] = sender->formatted_name_len;
+    len += 1;
+    
+    memcpy(&entry->payload[len], sender->formatted_name, sender->formatted_name_len);
+    len += sender->formatted_name_len;
+    
+    memcpy(&entry->payload[len], &event_be, sizeof(uint16_t));
+    len += sizeof(uint16_t);
+    
+    entry->len = len;
+}
+
+void typing_lane_flush(uint64_t now_ms) {
+    if (prv_inst.num_events == 0) {
+        return;
+    }
+    
+    config_t *config = config_get();
+    
+    if (now_ms - prv_inst.started_ms < config->typing_batch_window_ms) {
+        return;
+    }
+    
+    uint32_t high_water = config->typing_high_water_bytes;
+    
+    for (uint32_t i = 0; i < prv_inst.num_events; i++) {
+        prv_typing_lane_send(&prv_inst.events[i], high_water);
+    }
+    
+    for (uint32_t i = 0; i < prv_inst.num_events; i++) {
+        screenname_release(prv_inst.events[i].sender);
+        screenname_release(prv_inst.events[i].recipient);
+    }
+    
+    prv_inst.num_events = 0;
+    memset(prv_inst.slots, 0xFF, prv_inst.num_slots * sizeof(uint32_t));
+}
\ No newline at end of file
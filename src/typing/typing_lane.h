@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file typing_lane.h
+ * @author Evan Stoddard
+ * @brief Low priority lane for typing notifications
+ */
+
+#ifndef TYPING_LANE_H_
+#define TYPING_LANE_H_
+
+#include <stdint.h>
+
+#include "model/screenname.h"
+#include "session.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Cookie and channel that lead every client event
+ * 
+ */
+#define TYPING_LANE_HEADER_LEN 10U
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Queue ICBM_CLIENT_EVENT from sender to recipient
+ * 
+ * Only the newest event per sender and recipient is kept until the next
+ * flush.
+ * 
+ * @param sender Sending session
+ * @param recipient Recipient
+ * @param header Cookie and channel (TYPING_LANE_HEADER_LEN bytes)
+ * @param event Event code
+ */
+void typing_lane_enqueue(session_t *sender, screenname_id_t recipient, const uint8_t *header, uint16_t event);
+
+/**
+ * @brief Write queued events once typing_batch_window_ms has passed
+ * 
+ * Called after everything else of the loop pass so messages never wait
+ * behind events. Events for recipients whose socket has more than
+ * typing_high_water_bytes unsent, or that are detached, are dropped.
+ * 
+ * @param now_ms Current monotonic time
+ */
+void typing_lane_flush(uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TYPING_LANE_H_ */
\ No newline at end of file
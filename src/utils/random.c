@@ -12,16 +12,26 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
 #include <time.h>
 
 /*****************************************************************************
  * Definitions
  *****************************************************************************/
 
+#define RANDOM_SOURCE_PATH "/dev/urandom"
+
 /*****************************************************************************
  * Variables
  *****************************************************************************/
 
+/**
+ * @brief Whether fallback RNG has been seeded
+ * 
+ */
+static bool prv_seeded = false;
+
 /*****************************************************************************
  * Prototypes
  *****************************************************************************/
@@ -35,8 +45,23 @@ void generate_random_stream(uint8_t *dest, uint32_t bytes) {
         return;
     }
     
-    // Seed RNG
-    srand(time(NULL));
+    // Prefer kernel entropy source
+    FILE *source = fopen(RANDOM_SOURCE_PATH, "rb");
+    
+    if (source != NULL) {
+        size_t read_bytes = fread(dest, 1, bytes, source);
+        fclose(source);
+        
+        if (read_bytes == bytes) {
+            return;
+        }
+    }
+    
+    // Seed RNG once, reseeding on every call hands out repeated streams
+    if (!prv_seeded) {
+        srand(time(NULL));
+        prv_seeded = true;
+    }
     
     for (uint32_t i = 0; i < bytes; i++) {
         dest[i] = rand() % UINT8_MAX;
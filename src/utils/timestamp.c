@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file timestamp.c
+ * @author Evan Stoddard
+ * @brief Helpers for getting current time
+ */
+
+#include "timestamp.h"
+
+#include <time.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint64_t timestamp_monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U);
+}
+
+uint32_t timestamp_unix(void) {
+    return (uint32_t)time(NULL);
+}
\ No newline at end of file
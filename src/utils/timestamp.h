@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file timestamp.h
+ * @author Evan Stoddard
+ * @brief Helpers for getting current time
+ */
+
+#ifndef TIMESTAMP_H_
+#define TIMESTAMP_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Milliseconds from monotonic clock (only useful for deltas)
+ * 
+ * @return uint64_t Milliseconds
+ */
+uint64_t timestamp_monotonic_ms(void);
+
+/**
+ * @brief Seconds since the unix epoch
+ * 
+ * @return uint32_t Seconds
+ */
+uint32_t timestamp_unix(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TIMESTAMP_H_ */
\ No newline at end of file